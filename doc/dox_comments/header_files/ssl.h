@@ -2646,6 +2646,847 @@ WOLFSSL_API void wolfSSL_SetCertCbCtx(WOLFSSL*, void*);
 */
 WOLFSSL_API int  wolfSSL_pending(WOLFSSL*);
 
+/*!
+    \ingroup IO
+
+    \brief This function checks whether the SSL object has any received data
+    buffered, either decrypted application data or records that have been read
+    from the network but not yet processed. When reading ahead, the socket may
+    not be readable while records are still buffered, so event driven
+    applications should call wolfSSL_read() again while this returns 1.
+
+    \return 1 if data is buffered.
+    \return 0 if no data is buffered or ssl is NULL.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    char reply[1024];
+    ...
+    do {
+        ret = wolfSSL_read(ssl, reply, sizeof(reply));
+        ...
+    } while (ret > 0 && wolfSSL_has_pending(ssl));
+    \endcode
+
+    \sa wolfSSL_pending
+    \sa wolfSSL_CTX_set_read_ahead_size
+*/
+WOLFSSL_API int  wolfSSL_has_pending(const WOLFSSL*);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets the maximum number of bytes read from the
+    network in one go for SSL objects created from the context. Instead of
+    reading exactly the next record header and then the record, as much data
+    as is available up to sz bytes is read into the input buffer, and every
+    complete record in it is processed before the socket is read again. This
+    cuts the number of receive calls when the peer sends many small records.
+    A value of 0 turns reading ahead off. Reading ahead is not used with DTLS.
+    Requires WOLFSSL_READ_AHEAD (--enable-readahead).
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx is NULL or sz is larger than
+    WOLFSSL_MAX_READ_AHEAD_SZ.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param sz maximum number of bytes to read ahead, WOLFSSL_READ_AHEAD_SZ
+    holds one full size record.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = 0;
+    ...
+    if (wolfSSL_CTX_set_read_ahead_size(ctx, WOLFSSL_READ_AHEAD_SZ)
+                                                          != SSL_SUCCESS) {
+        // failed to turn on read ahead
+    }
+    \endcode
+
+    \sa wolfSSL_set_read_ahead_size
+    \sa wolfSSL_has_pending
+*/
+WOLFSSL_API int  wolfSSL_CTX_set_read_ahead_size(WOLFSSL_CTX*, unsigned int);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets the maximum number of bytes read from the
+    network in one go for the SSL object. See
+    wolfSSL_CTX_set_read_ahead_size() for details.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ssl is NULL or sz is larger than
+    WOLFSSL_MAX_READ_AHEAD_SZ.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+    \param sz maximum number of bytes to read ahead, 0 turns it off.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    ...
+    if (wolfSSL_set_read_ahead_size(ssl, 4096) != SSL_SUCCESS) {
+        // failed to turn on read ahead
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_set_read_ahead_size
+    \sa wolfSSL_has_pending
+*/
+WOLFSSL_API int  wolfSSL_set_read_ahead_size(WOLFSSL*, unsigned int);
+
+/*!
+    \ingroup IO
+
+    \brief This function sets whether wolfSSL_read() on SSL objects created
+    from the context returns the data of all the application data records
+    that have already been read ahead, up to the size asked for, instead of
+    the data of one record. The buffered records are decrypted one after the
+    other in the one call, without going back to the network. Only has an
+    effect when reading ahead, see wolfSSL_CTX_set_read_ahead_size().
+    Not used with DTLS.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx is NULL.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param on non-zero to read all buffered records and zero for one record
+    per read.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = 0;
+    ...
+    wolfSSL_CTX_set_read_ahead_size(ctx, 64 * 1024);
+    if (wolfSSL_CTX_set_read_batch(ctx, 1) != SSL_SUCCESS) {
+        // failed to turn on batched reads
+    }
+    \endcode
+
+    \sa wolfSSL_set_read_batch
+    \sa wolfSSL_CTX_set_read_ahead_size
+*/
+WOLFSSL_API int  wolfSSL_CTX_set_read_batch(WOLFSSL_CTX*, int);
+
+/*!
+    \ingroup IO
+
+    \brief This function sets whether wolfSSL_read() on the SSL object
+    returns the data of all the application data records that have already
+    been read ahead, up to the size asked for. See
+    wolfSSL_CTX_set_read_batch() for details.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ssl is NULL.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+    \param on non-zero to read all buffered records and zero for one record
+    per read.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    ...
+    if (wolfSSL_set_read_batch(ssl, 1) != SSL_SUCCESS) {
+        // failed to turn on batched reads
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_set_read_batch
+*/
+WOLFSSL_API int  wolfSSL_set_read_batch(WOLFSSL*, int);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets whether the input and output buffers of
+    SSL objects created from the context are freed as soon as the connection
+    is idle. wolfSSL frees them when idle by default, but keeps the input
+    buffer between reads when reading ahead. Turning this on trades the extra
+    allocations for less memory held by idle connections. Setting
+    SSL_MODE_RELEASE_BUFFERS with wolfSSL_CTX_set_mode() has the same effect.
+    When wolfSSL is built with WOLFSSL_BUFFER_POOL, freed buffers are kept in
+    a shared pool and reused by other connections.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx is NULL.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param on 1 to release buffers when idle, 0 to keep them.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = 0;
+    ...
+    if (wolfSSL_CTX_set_release_buffers(ctx, 1) != SSL_SUCCESS) {
+        // failed to set release buffers
+    }
+    \endcode
+
+    \sa wolfSSL_set_release_buffers
+    \sa wolfSSL_CTX_set_read_ahead_size
+*/
+WOLFSSL_API int  wolfSSL_CTX_set_release_buffers(WOLFSSL_CTX*, int);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets whether the input and output buffers of the
+    SSL object are freed as soon as the connection is idle. When turned on
+    after the handshake, an idle input buffer is freed immediately. See
+    wolfSSL_CTX_set_release_buffers() for details.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ssl is NULL.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+    \param on 1 to release buffers when idle, 0 to keep them.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    ...
+    if (wolfSSL_set_release_buffers(ssl, 1) != SSL_SUCCESS) {
+        // failed to set release buffers
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_set_release_buffers
+*/
+WOLFSSL_API int  wolfSSL_set_release_buffers(WOLFSSL*, int);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets whether SSL objects created from the context
+    buffer the handshake messages until the cipher suite picks the transcript
+    hash, and then start only that hash. When turned off, all transcript
+    hashes are started when the handshake starts. On by default when wolfSSL
+    is built with WOLFSSL_LAZY_HANDSHAKE_HASH (--enable-lazyhash).
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx is NULL.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param on 1 to start the transcript hash late, 0 to start all hashes.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = 0;
+    ...
+    if (wolfSSL_CTX_set_lazy_handshake_hash(ctx, 0) != SSL_SUCCESS) {
+        // failed to start all transcript hashes
+    }
+    \endcode
+
+    \sa wolfSSL_set_lazy_handshake_hash
+*/
+WOLFSSL_API int  wolfSSL_CTX_set_lazy_handshake_hash(WOLFSSL_CTX*, int);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets whether the SSL object buffers the handshake
+    messages until the cipher suite picks the transcript hash. When turned
+    off, all transcript hashes are started immediately. See
+    wolfSSL_CTX_set_lazy_handshake_hash() for details.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ssl is NULL.
+    \return SSL_FAILURE if the transcript hashes could not be started.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+    \param on 1 to start the transcript hash late, 0 to start all hashes.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    ...
+    if (wolfSSL_set_lazy_handshake_hash(ssl, 0) != SSL_SUCCESS) {
+        // failed to start all transcript hashes
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_set_lazy_handshake_hash
+*/
+WOLFSSL_API int  wolfSSL_set_lazy_handshake_hash(WOLFSSL*, int);
+
+/*!
+    \ingroup Setup
+
+    \brief This function requests that, once the handshake is done, record
+    encryption and decryption of SSL objects created from the context are
+    handed to the Linux kernel (kTLS). Application data is then passed to the
+    socket as plaintext and the kernel protects the records, allowing
+    zero-copy sends. Only TLS (not DTLS) using the default socket I/O
+    callbacks, with an AES-GCM or ChaCha20-Poly1305 cipher suite and no
+    renegotiation, compression or maximum fragment length, is offloaded.
+    Records wolfSSL still has buffered when the handshake is done, such as
+    unsent output or records read ahead, are processed by wolfSSL first and
+    each direction is handed to the kernel once they are drained.
+    When the kernel doesn't support kTLS, wolfSSL carries on processing
+    records itself. Requires wolfSSL to be built with WOLFSSL_KTLS
+    (--enable-ktls).
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx is NULL.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = 0;
+    ...
+    if (wolfSSL_CTX_UseKTLS(ctx) != SSL_SUCCESS) {
+        // failed to request kernel TLS
+    }
+    \endcode
+
+    \sa wolfSSL_UseKTLS
+    \sa wolfSSL_GetKTLS
+*/
+WOLFSSL_API int  wolfSSL_CTX_UseKTLS(WOLFSSL_CTX*);
+
+/*!
+    \ingroup Setup
+
+    \brief This function requests that, once the handshake is done, record
+    encryption and decryption of the SSL object are handed to the Linux
+    kernel (kTLS). When called after the handshake, records are offloaded
+    from then on if possible. See wolfSSL_CTX_UseKTLS() for details.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ssl is NULL.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    ...
+    if (wolfSSL_UseKTLS(ssl) != SSL_SUCCESS) {
+        // failed to request kernel TLS
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_UseKTLS
+    \sa wolfSSL_GetKTLS
+*/
+WOLFSSL_API int  wolfSSL_UseKTLS(WOLFSSL*);
+
+/*!
+    \ingroup IO
+
+    \brief This function returns which directions of records the Linux
+    kernel is encrypting (WOLFSSL_KTLS_TX) and decrypting (WOLFSSL_KTLS_RX)
+    for the SSL object. Zero means wolfSSL is processing all records.
+    A direction is only reported once records buffered at the end of the
+    handshake have been sent or read.
+
+    \return WOLFSSL_KTLS_TX and/or WOLFSSL_KTLS_RX bits.
+    \return BAD_FUNC_ARG if ssl is NULL.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    ...
+    if (wolfSSL_GetKTLS(ssl) & WOLFSSL_KTLS_TX) {
+        // kernel encrypts sent records
+    }
+    \endcode
+
+    \sa wolfSSL_UseKTLS
+*/
+WOLFSSL_API int  wolfSSL_GetKTLS(WOLFSSL*);
+
+/*!
+    \ingroup IO
+
+    \brief This function sends sz bytes of the file fd, starting at offset,
+    as application data. When the Linux kernel is encrypting sent records
+    (see wolfSSL_UseKTLS()) the file is sent with sendfile(2) without passing
+    through user space. Otherwise the file range is memory mapped and the
+    records are built from the mapping. The file offset of fd is not changed.
+    Like wolfSSL_write(), call again with the same offset and sz after
+    WOLFSSL_ERROR_WANT_WRITE. wolfSSL must be built with --enable-sendfile.
+
+    \return >0 the number of bytes sent. This may be less than sz when the
+    kernel sends the file, continue from offset plus the returned count.
+    \return 0 if sz is 0.
+    \return SSL_FATAL_ERROR upon failure, call wolfSSL_get_error() for the
+    reason.
+    \return BAD_FUNC_ARG if ssl is NULL or fd, offset or sz are negative.
+    \return SSL_BAD_FILE if the range is past the end of the file or can't
+    be mapped.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+    \param fd descriptor of a regular file open for reading.
+    \param offset position in the file of the first byte to send.
+    \param sz number of bytes to send.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    int fd;
+    long off = 0;
+    int ret;
+    ...
+    while (off < fileSz) {
+        ret = wolfSSL_sendfile(ssl, fd, off, (int)(fileSz - off));
+        if (ret <= 0) {
+            // error or WANT_WRITE, see wolfSSL_get_error()
+            break;
+        }
+        off += ret;
+    }
+    \endcode
+
+    \sa wolfSSL_write
+    \sa wolfSSL_UseKTLS
+*/
+WOLFSSL_API int  wolfSSL_sendfile(WOLFSSL*, int fd, long offset, int sz);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets the size of application data records sent at
+    the start of a burst for SSL objects created from the context. After the
+    connection has been idle for idleSec seconds, the first threshold bytes
+    are sent in records of at most smallSz bytes of plaintext, so that the
+    peer can decrypt the first data as soon as the first TCP segments arrive
+    instead of waiting for a full 16 kB record. Full size records are used
+    for the rest of the burst. Built with --enable-dynrecord, contexts start
+    with WOLFSSL_DYN_RECORD_SMALL_SZ (1400), WOLFSSL_DYN_RECORD_THRESHOLD
+    (1 MB) and WOLFSSL_DYN_RECORD_IDLE_SEC (1).
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx is NULL or smallSz is larger than a record.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param smallSz maximum plaintext size of the small records. Zero always
+    sends full size records.
+    \param threshold number of bytes to send in small records.
+    \param idleSec seconds without sending after which small records are
+    used again. Zero only uses small records at the start of the connection.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = 0;
+    ...
+    if (wolfSSL_CTX_set_dynamic_record_size(ctx, 1400, 64 * 1024, 2)
+                                                           != SSL_SUCCESS) {
+        // failed to set record sizing
+    }
+    \endcode
+
+    \sa wolfSSL_set_dynamic_record_size
+*/
+WOLFSSL_API int  wolfSSL_CTX_set_dynamic_record_size(WOLFSSL_CTX*,
+                            unsigned int smallSz, unsigned int threshold,
+                            unsigned int idleSec);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets the size of application data records sent at
+    the start of a burst for the SSL object. The next data written starts a
+    new burst. See wolfSSL_CTX_set_dynamic_record_size() for details.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ssl is NULL or smallSz is larger than a record.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+    \param smallSz maximum plaintext size of the small records. Zero always
+    sends full size records.
+    \param threshold number of bytes to send in small records.
+    \param idleSec seconds without sending after which small records are
+    used again.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    ...
+    if (wolfSSL_set_dynamic_record_size(ssl, 0, 0, 0) != SSL_SUCCESS) {
+        // failed to turn off record sizing
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_set_dynamic_record_size
+*/
+WOLFSSL_API int  wolfSSL_set_dynamic_record_size(WOLFSSL*,
+                            unsigned int smallSz, unsigned int threshold,
+                            unsigned int idleSec);
+
+/*!
+    \ingroup Debug
+
+    \brief This function gets the time the SSL object spent in its
+    handshake. Built with --enable-hstiming, usec[n] holds the microseconds
+    spent in phase n and calls[n] the number of timed calls. The phases are
+    the handshake message handlers (enum wc_FuncNum, for example
+    WC_FUNC_CERTIFICATE_VERIFY_SEND or WC_FUNC_CLIENT_KEY_EXCHANGE_DO), the
+    I/O callbacks while handshaking (WOLFSSL_HS_TIME_IO_READ and
+    WOLFSSL_HS_TIME_IO_WRITE) and the whole handshake
+    (WOLFSSL_HS_TIME_TOTAL). A handler call that returns early, on an error
+    or because I/O or an asynchronous operation would block, is not counted.
+    The handshake time is set once the handshake is done, so it can be read
+    in the handshake done callback. Time waiting for the peer with
+    non-blocking I/O is part of the handshake time only.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ssl or timing is NULL.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+    \param timing pointer to the timing to fill.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = 0;
+    WOLFSSL_HS_TIMING timing;
+    int i;
+    ...
+    if (wolfSSL_get_handshake_timing(ssl, &timing) == SSL_SUCCESS) {
+        for (i = 0; i < WOLFSSL_HS_TIME_COUNT; i++) {
+            if (timing.calls[i] > 0)
+                printf("%s: %u us\n", wolfSSL_handshake_timing_name(i),
+                       timing.usec[i]);
+        }
+    }
+    \endcode
+
+    \sa wolfSSL_handshake_timing_name
+    \sa wolfSSL_handshake_histogram_add
+*/
+WOLFSSL_API int  wolfSSL_get_handshake_timing(WOLFSSL*, WOLFSSL_HS_TIMING*);
+
+/*!
+    \ingroup Debug
+
+    \brief This function gets the name of a handshake timing phase, such as
+    "SendCertificateVerify" or "I/O read".
+
+    \return name of the phase.
+    \return NULL if phase is not less than WOLFSSL_HS_TIME_COUNT.
+
+    \param phase index into the usec and calls of WOLFSSL_HS_TIMING.
+
+    _Example_
+    \code
+    printf("%s\n", wolfSSL_handshake_timing_name(WOLFSSL_HS_TIME_TOTAL));
+    \endcode
+
+    \sa wolfSSL_get_handshake_timing
+*/
+WOLFSSL_API const char* wolfSSL_handshake_timing_name(int phase);
+
+/*!
+    \ingroup Debug
+
+    \brief This function adds the timing of one handshake to a histogram so
+    that the phases can be compared over many connections. Each timed phase
+    adds one to a bucket of its time: bucket 0 counts times under a
+    microsecond and bucket n counts 2^(n-1) to 2^n - 1 microseconds. The last
+    of the WOLFSSL_HS_HIST_BUCKETS buckets also counts longer times. The
+    histogram is not locked; keep one per thread and merge them, or
+    serialize the calls.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if hist or timing is NULL.
+
+    \param hist pointer to the histogram, zeroed before first use.
+    \param timing pointer to the timing of a handshake.
+
+    _Example_
+    \code
+    static WOLFSSL_HS_HISTOGRAM hist;
+    WOLFSSL* ssl = 0;
+    WOLFSSL_HS_TIMING timing;
+    ...
+    if (wolfSSL_get_handshake_timing(ssl, &timing) == SSL_SUCCESS)
+        wolfSSL_handshake_histogram_add(&hist, &timing);
+    \endcode
+
+    \sa wolfSSL_get_handshake_timing
+*/
+WOLFSSL_API int  wolfSSL_handshake_histogram_add(WOLFSSL_HS_HISTOGRAM*,
+                                                 const WOLFSSL_HS_TIMING*);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets the window used by a TLS v1.3 server to reject
+    replayed early data. Early data is only accepted when the client's ticket
+    age is within half the window of the age the server expects and the
+    ClientHello has not been seen in the last window. Seen ClientHello
+    messages are remembered in bloom filters shared by all SSL objects of the
+    CTX. A replay, or a rare false positive of the filters, only rejects the
+    early data and the handshake continues without it. Server CTX objects
+    start with a window of WOLFSSL_ANTI_REPLAY_WINDOW_MS (10 seconds). The
+    cache is per CTX: servers sharing ticket keys across processes or hosts
+    are only protected against replays to the same CTX.
+
+    \return 0 upon success.
+    \return BAD_FUNC_ARG if ctx is NULL, not TLS v1.3 or windowMs is larger
+    than WOLFSSL_ANTI_REPLAY_MAX_WINDOW_MS.
+    \return SIDE_ERROR if ctx is not for a server.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param windowMs the window in milliseconds, 0 accepts all early data.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = wolfSSL_CTX_new(wolfTLSv1_3_server_method());
+    ...
+    if (wolfSSL_CTX_set_early_data_anti_replay(ctx, 5000) != 0) {
+        // failed to set the window
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_get_early_data_replays
+    \sa wolfSSL_read_early_data
+*/
+WOLFSSL_API int  wolfSSL_CTX_set_early_data_anti_replay(WOLFSSL_CTX* ctx,
+                                                        unsigned int windowMs);
+
+/*!
+    \ingroup Setup
+
+    \brief This function gets the number of ClientHello messages whose early
+    data was rejected as a replay by servers using the CTX.
+
+    \return 0 upon success.
+    \return BAD_FUNC_ARG if ctx or replays is NULL.
+    \return SIDE_ERROR if ctx is not for a TLS v1.3 server.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param replays set to the number of replays detected.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx;
+    unsigned int replays;
+    ...
+    if (wolfSSL_CTX_get_early_data_replays(ctx, &replays) == 0)
+        printf("early data replays: %u\n", replays);
+    \endcode
+
+    \sa wolfSSL_CTX_set_early_data_anti_replay
+*/
+WOLFSSL_API int  wolfSSL_CTX_get_early_data_replays(WOLFSSL_CTX* ctx,
+                                                    unsigned int* replays);
+
+/*!
+    \ingroup Debug
+
+    \brief This function gets the number of TLS v1.3 HelloRetryRequest
+    messages sent or received by connections using the CTX. When built with
+    WOLFSSL_TLS13_GROUP_CACHE, a client remembers the key share group each
+    server picked against the ID set with wolfSSL_SetServerID() and sends a
+    key share for that group in the next ClientHello to the server, so only
+    the first connection pays for the extra round trip. cacheHits is the
+    number of ClientHello messages that used a remembered group.
+
+    \return 0 upon success.
+    \return BAD_FUNC_ARG if ctx or hrrCount is NULL.
+    \return BAD_MUTEX_E if the CTX lock could not be taken.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+    \param hrrCount set to the number of HelloRetryRequest messages.
+    \param cacheHits set to the number of key shares taken from the group
+    cache. May be NULL.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx;
+    unsigned int hrr, hits;
+    ...
+    wolfSSL_SetServerID(ssl, (byte*)"example.com:443", 15, 0);
+    ...
+    if (wolfSSL_CTX_get_hrr_stats(ctx, &hrr, &hits) == 0)
+        printf("HelloRetryRequests: %u, cache hits: %u\n", hrr, hits);
+    \endcode
+
+    \sa wolfSSL_SetServerID
+    \sa wolfSSL_UseKeyShare
+*/
+WOLFSSL_API int wolfSSL_CTX_get_hrr_stats(WOLFSSL_CTX* ctx,
+                                unsigned int* hrrCount, unsigned int* cacheHits);
+
+/*!
+    \ingroup Setup
+
+    \brief This function allows the server's certificate to be compressed
+    with zlib in TLS v1.3 handshakes (RFC 8879) for SSL objects created from
+    the CTX. A client sends the compress_certificate extension offering zlib
+    and accepts a CompressedCertificate message in place of the Certificate.
+    A server sends a CompressedCertificate when the client offered zlib; the
+    compressed message is made once and kept with the CTX until the
+    certificate or chain changes. SSL objects with their own certificate, and
+    client certificates, are sent uncompressed. Requires
+    WOLFSSL_CERT_COMPRESSION and libz.
+
+    \return 0 upon success.
+    \return BAD_FUNC_ARG if ctx is NULL or not using TLS v1.3.
+
+    \param ctx pointer to the SSL context, created with wolfSSL_CTX_new().
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx;
+    ...
+    if (wolfSSL_CTX_UseCertCompression(ctx) != 0) {
+        // failed to allow certificate compression
+    }
+    \endcode
+
+    \sa wolfSSL_UseCertCompression
+*/
+WOLFSSL_API int  wolfSSL_CTX_UseCertCompression(WOLFSSL_CTX* ctx);
+
+/*!
+    \ingroup Setup
+
+    \brief This function allows the server's certificate to be compressed
+    with zlib in the TLS v1.3 handshake (RFC 8879) of the SSL object. See
+    wolfSSL_CTX_UseCertCompression().
+
+    \return 0 upon success.
+    \return BAD_FUNC_ARG if ssl is NULL or not using TLS v1.3.
+
+    \param ssl a pointer to a WOLFSSL structure, created using wolfSSL_new().
+
+    _Example_
+    \code
+    WOLFSSL* ssl;
+    ...
+    if (wolfSSL_UseCertCompression(ssl) != 0) {
+        // failed to allow certificate compression
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_UseCertCompression
+*/
+WOLFSSL_API int  wolfSSL_UseCertCompression(WOLFSSL* ssl);
+
+/*!
+    \ingroup Debug
+
+    \brief This function gets the usage of the shared pool of pre-generated
+    ephemeral X25519 and P-256 key pairs. When built with
+    WOLFSSL_KEY_SHARE_POOL, wolfSSL_Init() starts a thread that keeps the
+    pool full and TLS v1.3 key shares and TLS v1.2 ECDHE keys are taken from
+    it, leaving only the shared secret computation in the handshake. Each key
+    pair is only used once. SSL objects using a crypto device generate their
+    own keys. A process that forks after wolfSSL_Init() needs to call
+    wolfSSL_Cleanup() and wolfSSL_Init() in the child to restart the thread.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if hits or misses is NULL.
+
+    \param hits set to the number of key pairs taken from the pool.
+    \param misses set to the number of key pairs generated during a
+    handshake because the pool was empty.
+
+    _Example_
+    \code
+    unsigned int hits, misses;
+
+    if (wolfSSL_key_share_pool_stats(&hits, &misses) == SSL_SUCCESS &&
+            misses > hits / 10) {
+        // pool too small for the load, increase WOLFSSL_KEY_SHARE_POOL_SZ
+    }
+    \endcode
+
+    \sa wolfSSL_Init
+*/
+WOLFSSL_API int  wolfSSL_key_share_pool_stats(unsigned int* hits,
+                                              unsigned int* misses);
+
+/*!
+    \ingroup Setup
+
+    \brief This function limits the full handshakes that servers using the
+    context run at once, so that under a connection storm some handshakes
+    finish instead of all of them timing out. A full handshake is counted
+    from its ClientHello until it finishes or its WOLFSSL is freed. Once the
+    server knows whether a ClientHello resumes a session, and before any key
+    exchange or signing is done for it, a new full handshake is held back
+    while maxInFlight full handshakes are running or while they have taken
+    longer than maxLatencyUs on average. With only the latency limit one full
+    handshake is always let through so the average can recover. Resumptions
+    and PSK handshakes are never held back. A held back handshake is refused
+    with a handshake_failure alert and HANDSHAKE_ADMISSION_E. With defer set,
+    and not using DTLS, wolfSSL_accept() instead fails with
+    HANDSHAKE_ADMISSION_WANT before the server sends its first flight and
+    is to be called again later. Zero turns a limit off, the default.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx is NULL.
+    \return SIDE_ERROR if ctx was not created with a server method.
+
+    \param ctx a pointer to a WOLFSSL_CTX structure, created with
+    wolfSSL_CTX_new().
+    \param maxInFlight the number of full handshakes that may run at once.
+    \param maxLatencyUs the average full handshake time, in microseconds,
+    to stay under.
+    \param defer non-zero to hold back handshakes rather than refuse them.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = wolfSSL_CTX_new(wolfSSLv23_server_method());
+    // up to 64 full handshakes at once, each under 200ms on average
+    wolfSSL_CTX_set_handshake_admission(ctx, 64, 200000, 1);
+    ...
+    if (wolfSSL_accept(ssl) != SSL_SUCCESS &&
+            wolfSSL_get_error(ssl, 0) == HANDSHAKE_ADMISSION_WANT) {
+        // call wolfSSL_accept() again after other handshakes progress
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_get_handshake_admission_stats
+*/
+WOLFSSL_API int  wolfSSL_CTX_set_handshake_admission(WOLFSSL_CTX*,
+                            unsigned int maxInFlight,
+                            unsigned int maxLatencyUs, int defer);
+
+/*!
+    \ingroup Debug
+
+    \brief This function gets the counters of the handshake admission
+    control of a server context: full handshakes started, resumptions,
+    full handshakes refused and held back, full handshakes finished, the
+    number running now and the moving average time of a full handshake in
+    microseconds.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if ctx or stats is NULL.
+    \return SIDE_ERROR if ctx was not created with a server method.
+
+    \param ctx a pointer to a WOLFSSL_CTX structure, created with
+    wolfSSL_CTX_new().
+    \param stats set to the counters.
+
+    _Example_
+    \code
+    WOLFSSL_ADMISSION_STATS stats;
+
+    if (wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats) ==
+                                                              SSL_SUCCESS) {
+        printf("%u running, %u refused\n", stats.inFlight, stats.rejected);
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_set_handshake_admission
+*/
+WOLFSSL_API int  wolfSSL_CTX_get_handshake_admission_stats(WOLFSSL_CTX*,
+                            WOLFSSL_ADMISSION_STATS*);
+
 /*!
     \ingroup Debug
 
@@ -7458,6 +8299,157 @@ WOLFSSL_API int   wolfSSL_DTLS_SetCookieSecret(WOLFSSL*,
                                                const unsigned char*,
                                                unsigned int);
 
+/*!
+    \ingroup Setup
+
+    \brief This function makes a DTLS server demultiplexer serving many
+    peers on one UDP socket. Each datagram read is handed to the session
+    of its peer, found by peer address in a hash table. A ClientHello from
+    an unknown peer is answered with a HelloVerifyRequest without keeping
+    any state; a session is only made when the ClientHello returns the
+    cookie. The socket is to be bound, not connected, and non-blocking.
+    Available with --enable-dtlsdemux (WOLFSSL_DTLS_DEMUX).
+
+    \return pointer to the new WOLFSSL_DTLS_DEMUXER upon success.
+    \return NULL if ctx is NULL, is not a DTLS server context, has a
+    cookie callback or if memory could not be allocated.
+
+    \param ctx a pointer to a WOLFSSL_CTX structure, created with
+    wolfDTLSv1_2_server_method(). It is to be kept until the demultiplexer
+    is freed.
+    \param sd the UDP socket.
+    \param maxPeers the most sessions to keep, 0 for no limit.
+
+    _Example_
+    \code
+    WOLFSSL_DTLS_DEMUXER* demux;
+
+    demux = wolfSSL_DtlsDemuxNew(ctx, sd, 100000);
+    if (demux == NULL) {
+        // failed to make demultiplexer
+    }
+    \endcode
+
+    \sa wolfSSL_DtlsDemuxRead
+    \sa wolfSSL_DtlsDemuxFree
+*/
+WOLFSSL_API WOLFSSL_DTLS_DEMUXER* wolfSSL_DtlsDemuxNew(WOLFSSL_CTX*, int sd,
+                                                       unsigned int maxPeers);
+
+/*!
+    \ingroup Setup
+
+    \brief This function frees a DTLS demultiplexer and all of its
+    sessions. The socket is not closed.
+
+    \return none No returns.
+
+    \param demux a pointer to a WOLFSSL_DTLS_DEMUXER, created with
+    wolfSSL_DtlsDemuxNew().
+
+    _Example_
+    \code
+    wolfSSL_DtlsDemuxFree(demux);
+    \endcode
+
+    \sa wolfSSL_DtlsDemuxNew
+*/
+WOLFSSL_API void wolfSSL_DtlsDemuxFree(WOLFSSL_DTLS_DEMUXER*);
+
+/*!
+    \ingroup IO
+
+    \brief This function reads one datagram from the socket of the
+    demultiplexer and hands it to the session of its peer, doing the
+    handshake or reading application data. ssl is set to the session, or
+    NULL when the datagram was answered without a session or dropped.
+    Sessions are non-blocking: the application calls
+    wolfSSL_dtls_got_timeout() for sessions still in the handshake when
+    their timeout passes, and writes with wolfSSL_write() on the session.
+    Data of more records in a datagram is read from the session with
+    wolfSSL_read() while wolfSSL_pending() is not 0.
+
+    \return >0 the number of bytes of application data read into data.
+    \return 0 if the datagram gave no application data.
+    \return WANT_READ if no datagram is waiting on the socket.
+    \return WOLFSSL_FATAL_ERROR if the session in ssl failed or the peer
+    closed it; wolfSSL_get_error() tells which. The session is to be
+    removed with wolfSSL_DtlsDemuxRemove().
+    \return BAD_FUNC_ARG if an argument is NULL or sz is not positive.
+    \return SOCKET_ERROR_E if reading from the socket failed.
+
+    \param demux a pointer to a WOLFSSL_DTLS_DEMUXER, created with
+    wolfSSL_DtlsDemuxNew().
+    \param ssl set to the session of the peer of the datagram.
+    \param data buffer for application data.
+    \param sz size of data in bytes.
+
+    _Example_
+    \code
+    WOLFSSL* ssl;
+    char buf[1500];
+    int ret;
+
+    while ((ret = wolfSSL_DtlsDemuxRead(demux, &ssl, buf,
+                                        sizeof(buf))) != WANT_READ) {
+        if (ret > 0)
+            wolfSSL_write(ssl, buf, ret);
+        else if (ret == WOLFSSL_FATAL_ERROR)
+            wolfSSL_DtlsDemuxRemove(demux, ssl);
+    }
+    \endcode
+
+    \sa wolfSSL_DtlsDemuxNew
+    \sa wolfSSL_DtlsDemuxRemove
+*/
+WOLFSSL_API int  wolfSSL_DtlsDemuxRead(WOLFSSL_DTLS_DEMUXER*, WOLFSSL** ssl,
+                                       void* data, int sz);
+
+/*!
+    \ingroup Setup
+
+    \brief This function removes a session from a DTLS demultiplexer and
+    frees it. A later datagram from the peer starts with a cookie exchange
+    again.
+
+    \return SSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG if demux or ssl is NULL or ssl is not a session
+    of demux.
+
+    \param demux a pointer to a WOLFSSL_DTLS_DEMUXER, created with
+    wolfSSL_DtlsDemuxNew().
+    \param ssl the session, as set by wolfSSL_DtlsDemuxRead().
+
+    _Example_
+    \code
+    wolfSSL_shutdown(ssl);
+    wolfSSL_DtlsDemuxRemove(demux, ssl);
+    \endcode
+
+    \sa wolfSSL_DtlsDemuxRead
+*/
+WOLFSSL_API int  wolfSSL_DtlsDemuxRemove(WOLFSSL_DTLS_DEMUXER*, WOLFSSL*);
+
+/*!
+    \ingroup Debug
+
+    \brief This function gets the number of sessions of a DTLS
+    demultiplexer.
+
+    \return the number of sessions, 0 if demux is NULL.
+
+    \param demux a pointer to a WOLFSSL_DTLS_DEMUXER, created with
+    wolfSSL_DtlsDemuxNew().
+
+    _Example_
+    \code
+    printf("%u peers\n", wolfSSL_DtlsDemuxCount(demux));
+    \endcode
+
+    \sa wolfSSL_DtlsDemuxRead
+*/
+WOLFSSL_API unsigned int wolfSSL_DtlsDemuxCount(WOLFSSL_DTLS_DEMUXER*);
+
 /*!
     \ingroup Setup
 
@@ -7543,6 +8535,33 @@ WOLFSSL_API int wolfSSL_SetMinVersion(WOLFSSL* ssl, int version);
     \sa wolfSSL_new
 */
 WOLFSSL_API int wolfSSL_GetObjectSize(void);  /* object size based on build */
+/*!
+    \brief This function returns the number of bytes of memory currently held
+    by the SSL object. This is the size of the WOLFSSL object plus the
+    handshake state, keys, ciphers and input/output buffers it has allocated.
+    Memory shared with the SSL context, such as certificates, is not included.
+    Handshake state is freed once the handshake completes, unless
+    wolfSSL_KeepHandshakeResources() was called, so the value drops to what
+    the record layer needs.
+
+    \return size the number of bytes held by the SSL object.
+    \return BAD_FUNC_ARG if ssl is NULL.
+
+    \param ssl pointer to the SSL session, created with wolfSSL_new().
+
+    _Example_
+    \code
+    WOLFSSL* ssl;
+    ...
+    if (wolfSSL_connect(ssl) == SSL_SUCCESS) {
+        printf("connection memory = %d\n", wolfSSL_GetMemoryUsage(ssl));
+    }
+    \endcode
+
+    \sa wolfSSL_GetObjectSize
+    \sa wolfSSL_KeepHandshakeResources
+*/
+WOLFSSL_API int wolfSSL_GetMemoryUsage(WOLFSSL*);
 /*!
     \brief Returns the record layer size of the plaintext input. This is helpful
     when an application wants to know how many bytes will be sent across the
@@ -9965,6 +10984,167 @@ WOLFSSL_API void wolfSSL_SNI_SetOptions(WOLFSSL* ssl, unsigned char type,
 WOLFSSL_API void wolfSSL_CTX_SNI_SetOptions(WOLFSSL_CTX* ctx,
                                      unsigned char type, unsigned char options);
 
+/*!
+    \brief This function is called on the server side to add a certificate
+    chain and private key served to clients that request the host name with
+    Server Name Indication. Many host names can be served from one context
+    without switching contexts in a servername callback. The name is either
+    exact, "www.example.com", or a wildcard, "*.example.com", that stands for
+    the left-most label of the requested name only. Names are not case
+    sensitive. An exact name is preferred to a wildcard. The store is looked up
+    when the ClientHello is parsed and takes precedence over the SNI set with
+    wolfSSL_CTX_UseSNI(); clients requesting other names, or none, get the
+    certificate of the context. This function is available when wolfSSL is
+    built with --enable-snistore (WOLFSSL_SNI_STORE). Add all names before
+    creating SSL objects from the context; a name can not be replaced.
+
+    \return WOLFSSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG is the error that will be returned if the context is
+    NULL or not a server context, a parameter is NULL or empty, the name is
+    longer than 253 characters, has a misplaced '*' or is already added.
+    \return MEMORY_E is the error returned when allocating memory fails.
+    \return other errors of loading the certificate chain or key.
+
+    \param ctx pointer to a server SSL context, created with wolfSSL_CTX_new().
+    \param name the NUL terminated host name or wildcard.
+    \param chain buffer with the server certificate followed by intermediate
+    certificates.
+    \param chainSz size of the chain buffer.
+    \param key buffer with the private key of the server certificate.
+    \param keySz size of the key buffer.
+    \param format WOLFSSL_FILETYPE_PEM or WOLFSSL_FILETYPE_ASN1 for both the
+    chain and key. A DER chain holds one certificate.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = wolfSSL_CTX_new(wolfTLSv1_2_server_method());
+    byte chain[] = { // PEM certificate chain of *.example.com };
+    byte key[] = { // PEM private key };
+    ...
+    if (wolfSSL_CTX_SNI_AddCertificate(ctx, "*.example.com", chain,
+            sizeof(chain), key, sizeof(key), WOLFSSL_FILETYPE_PEM)
+                                                        != WOLFSSL_SUCCESS) {
+        // adding certificate failed
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_new
+    \sa wolfSSL_CTX_UseSNI
+    \sa wolfSSL_SNI_GetRequest
+    \sa wolfSSL_CTX_set_servername_callback
+*/
+WOLFSSL_API int wolfSSL_CTX_SNI_AddCertificate(WOLFSSL_CTX* ctx,
+                 const char* name, const unsigned char* chain, long chainSz,
+                 const unsigned char* key, long keySz, int format);
+
+/*!
+    \ingroup Setup
+
+    \brief This function sets a callback the server calls on every
+    ClientHello it receives, before the message is hashed and before any
+    extension, cipher suite or key share in it is processed. Within the
+    callback the wolfSSL_client_hello_get0_* functions give access to the
+    offered parameters, and wolfSSL_set_SSL_CTX() may be used to switch to a
+    different context. The callback returns WOLFSSL_CLIENT_HELLO_SUCCESS to
+    carry on, WOLFSSL_CLIENT_HELLO_ERROR to abort the handshake with the alert
+    it stored in alert, or WOLFSSL_CLIENT_HELLO_RETRY to have wolfSSL_accept()
+    fail with CLIENT_HELLO_WANT_CB. The next call to wolfSSL_accept() then
+    calls the callback again with the same ClientHello. Retrying is not
+    available with DTLS and is treated as an abort. Once the callback
+    succeeds it is not called again for the connection.
+
+    \return none No returns.
+
+    \param ctx a pointer to a WOLFSSL_CTX structure, created with
+    wolfSSL_CTX_new().
+    \param cb the callback, or NULL to clear it.
+    \param arg user data passed to the callback.
+
+    _Example_
+    \code
+    static int HelloCb(WOLFSSL* ssl, int* alert, void* arg)
+    {
+        const unsigned char* sni;
+        size_t sniSz;
+
+        if (!wolfSSL_client_hello_get0_ext(ssl, 0, &sni, &sniSz)) {
+            *alert = unrecognized_name;
+            return WOLFSSL_CLIENT_HELLO_ERROR;
+        }
+        // look up the host name, maybe wolfSSL_set_SSL_CTX()
+        return WOLFSSL_CLIENT_HELLO_SUCCESS;
+    }
+    ...
+    wolfSSL_CTX_set_client_hello_cb(ctx, HelloCb, NULL);
+    \endcode
+
+    \sa wolfSSL_client_hello_get0_ext
+    \sa wolfSSL_client_hello_get0_ciphers
+    \sa wolfSSL_set_SSL_CTX
+*/
+WOLFSSL_API void wolfSSL_CTX_set_client_hello_cb(WOLFSSL_CTX* ctx,
+                                      CallbackClientHello cb, void* arg);
+
+/*!
+    \ingroup IO
+
+    \brief These functions return the fields of the ClientHello being
+    processed. They are only meaningful from within the callback set with
+    wolfSSL_CTX_set_client_hello_cb(). The returned pointers reference the
+    received message and are only valid during the callback.
+    wolfSSL_client_hello_get0_legacy_version() returns the version field as
+    (major << 8) | minor. The other functions set out and return the length
+    of the field in bytes. Cipher suites are two bytes each.
+
+    \return the version or length of the field.
+    \return 0 when called outside of the callback or with a NULL argument.
+
+    \param ssl a pointer to a WOLFSSL structure, created using wolfSSL_new().
+    \param out set to the start of the field.
+
+    _Example_
+    \code
+    const unsigned char* suites;
+    size_t suitesSz = wolfSSL_client_hello_get0_ciphers(ssl, &suites);
+    \endcode
+
+    \sa wolfSSL_CTX_set_client_hello_cb
+    \sa wolfSSL_client_hello_get0_ext
+*/
+WOLFSSL_API size_t wolfSSL_client_hello_get0_ciphers(WOLFSSL* ssl,
+                                      const unsigned char** out);
+
+/*!
+    \ingroup IO
+
+    \brief This function finds an extension in the ClientHello being
+    processed. It is only meaningful from within the callback set with
+    wolfSSL_CTX_set_client_hello_cb(). The data is the extension's body
+    without its type and length.
+
+    \return 1 when the extension is present, with out and outSz set.
+    \return 0 when the extension is not present or outside of the callback.
+
+    \param ssl a pointer to a WOLFSSL structure, created using wolfSSL_new().
+    \param type the extension type, for example 0 for server_name.
+    \param out set to the start of the extension data.
+    \param outSz set to the length of the extension data.
+
+    _Example_
+    \code
+    const unsigned char* ext;
+    size_t extSz;
+    if (wolfSSL_client_hello_get0_ext(ssl, 16, &ext, &extSz) == 1) {
+        // client offered ALPN
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_set_client_hello_cb
+    \sa wolfSSL_client_hello_get0_ciphers
+*/
+WOLFSSL_API int wolfSSL_client_hello_get0_ext(WOLFSSL* ssl, unsigned int type,
+                                  const unsigned char** out, size_t* outSz);
+
 /*!
     \brief This function is called on the server side to retrieve the Server
     Name Indication provided by the client from the Client Hello message sent
@@ -10286,6 +11466,85 @@ WOLFSSL_API int wolfSSL_UseMaxFragment(WOLFSSL* ssl, unsigned char mfl);
 */
 WOLFSSL_API int wolfSSL_CTX_UseMaxFragment(WOLFSSL_CTX* ctx, unsigned char mfl);
 
+/*!
+    \brief This function sets the largest record plaintext the SSL object
+    is willing to receive, using the Record Size Limit extension (RFC 8449).
+    A client offers the limit in the ClientHello. A server answers any client
+    that offers the extension, with its own limit or the protocol maximum.
+    Once negotiated, each side keeps the records it sends within the peer's
+    limit. Input and output buffers are then only as large as those records.
+    The Maximum Fragment Length extension is ignored when a client offers
+    both. Call before the handshake.
+
+    \return WOLFSSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG when ssl is NULL or limit is out of range.
+
+    \param ssl pointer to a SSL object, created with wolfSSL_new().
+    \param limit largest plaintext to receive, from
+    WOLFSSL_RECORD_SIZE_LIMIT_MIN (64) to WOLFSSL_RECORD_SIZE_LIMIT_MAX
+    (16384), or 0 to not limit.
+
+    _Example_
+    \code
+    WOLFSSL* ssl = wolfSSL_new(ctx);
+    if (wolfSSL_UseRecordSizeLimit(ssl, 1024) != WOLFSSL_SUCCESS) {
+        // failed to set the record size limit
+    }
+    \endcode
+
+    \sa wolfSSL_CTX_UseRecordSizeLimit
+    \sa wolfSSL_GetPeerRecordSizeLimit
+*/
+WOLFSSL_API int wolfSSL_UseRecordSizeLimit(WOLFSSL* ssl, unsigned short limit);
+
+/*!
+    \brief This function sets the largest record plaintext that SSL objects
+    created from the context are willing to receive. See
+    wolfSSL_UseRecordSizeLimit().
+
+    \return WOLFSSL_SUCCESS upon success.
+    \return BAD_FUNC_ARG when ctx is NULL or limit is out of range.
+
+    \param ctx pointer to a SSL context, created with wolfSSL_CTX_new().
+    \param limit largest plaintext to receive, from 64 to 16384, or 0 to not
+    limit.
+
+    _Example_
+    \code
+    WOLFSSL_CTX* ctx = wolfSSL_CTX_new(method);
+    if (wolfSSL_CTX_UseRecordSizeLimit(ctx, 1024) != WOLFSSL_SUCCESS) {
+        // failed to set the record size limit
+    }
+    \endcode
+
+    \sa wolfSSL_UseRecordSizeLimit
+*/
+WOLFSSL_API int wolfSSL_CTX_UseRecordSizeLimit(WOLFSSL_CTX* ctx,
+                                               unsigned short limit);
+
+/*!
+    \brief This function returns the record size limit the peer sent. In
+    TLS v1.3 the limit includes the content type byte so records sent carry
+    one byte less of data.
+
+    \return the peer's limit.
+    \return 0 when the extension was not negotiated.
+    \return BAD_FUNC_ARG when ssl is NULL.
+
+    \param ssl pointer to a SSL object, created with wolfSSL_new().
+
+    _Example_
+    \code
+    int limit = wolfSSL_GetPeerRecordSizeLimit(ssl);
+    if (limit > 0) {
+        // records sent are no bigger than limit
+    }
+    \endcode
+
+    \sa wolfSSL_UseRecordSizeLimit
+*/
+WOLFSSL_API int wolfSSL_GetPeerRecordSizeLimit(WOLFSSL* ssl);
+
 /*!
     \brief This function is called on the client side to enable the use of
     Truncated HMAC in the SSL object passed in the 'ssl' parameter. It
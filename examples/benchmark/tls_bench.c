@@ -81,7 +81,7 @@ bench_tls(args);
 #define BENCH_DEFAULT_PORT  11112
 #define NUM_THREAD_PAIRS    1 /* Thread pairs of server/client */
 #define BENCH_RUNTIME_SEC   1
-#define MEM_BUFFER_SZ       ((16 * 1024) + 38 + 32) /* Must be large enough to handle max packet size plus max TLS header MAX_MSG_EXTRA */
+#define MEM_BUFFER_SZ       (32 * 1024) /* Must be large enough to handle max packet size plus the TLS header MAX_MSG_EXTRA of each record it is sent in */
 #define TEST_PACKET_SIZE    (16 * 1024) /* TLS packet size */
 #define TEST_MAX_SIZE       (16 * 1024) /* Total bytes to benchmark */
 #define SHOW_VERBOSE        0 /* Default output is tab delimited format */
@@ -248,8 +248,14 @@ typedef struct {
     int runTimeSec;
     int showPeerInfo;
     int showVerbose;
+#ifdef WOLFSSL_READ_AHEAD
+    int readBatch; /* read ahead and return all buffered records */
+#endif
 #ifndef NO_WOLFSSL_SERVER
     int listenFd;
+#ifdef WOLFSSL_SENDFILE
+    int useSendFile; /* server echoes with wolfSSL_sendfile */
+#endif
 #endif
     side_t client;
     side_t server;
@@ -318,18 +324,35 @@ static int ServerMemSend(info_t* info, char* buf, int sz)
     return sz;
 }
 
+/* whether a memory recv returns the data there is instead of waiting for the
+ * size asked for: when non-blocking, or when reading ahead as that asks for
+ * more than may be sent */
+static int MemRecvPartial(info_t* info)
+{
+#ifdef BENCH_USE_NONBLOCK
+    (void)info;
+    return 1;
+#elif defined(WOLFSSL_READ_AHEAD)
+    return info->readBatch;
+#else
+    (void)info;
+    return 0;
+#endif
+}
+
 /* server recv callback */
 static int ServerMemRecv(info_t* info, char* buf, int sz)
 {
     pthread_mutex_lock(&info->to_server.mutex);
 
 #ifndef BENCH_USE_NONBLOCK
-    while (info->to_server.write_idx - info->to_server.read_idx < sz && !info->to_client.done)
+    while (info->to_server.write_idx - info->to_server.read_idx <
+                            (MemRecvPartial(info) ? 1 : sz) && !info->to_client.done)
         pthread_cond_wait(&info->to_server.cond, &info->to_server.mutex);
-#else
-    if (info->to_server.write_idx - info->to_server.read_idx < sz)
-        sz = info->to_server.write_idx - info->to_server.read_idx;
 #endif
+    if (MemRecvPartial(info) &&
+                    info->to_server.write_idx - info->to_server.read_idx < sz)
+        sz = info->to_server.write_idx - info->to_server.read_idx;
 
     XMEMCPY(buf, &info->to_server.buf[info->to_server.read_idx], sz);
     info->to_server.read_idx += sz;
@@ -360,8 +383,8 @@ static int ClientMemSend(info_t* info, char* buf, int sz)
 
 #ifndef BENCH_USE_NONBLOCK
     /* check for overflow */
-    if (info->to_client.write_idx + sz > MEM_BUFFER_SZ) {
-        printf("ClientMemSend overflow %d %d %d\n", info->to_client.write_idx, sz, MEM_BUFFER_SZ);
+    if (info->to_server.write_idx + sz > MEM_BUFFER_SZ) {
+        printf("ClientMemSend overflow %d %d %d\n", info->to_server.write_idx, sz, MEM_BUFFER_SZ);
         pthread_mutex_unlock(&info->to_server.mutex);
         return -1;
     }
@@ -390,12 +413,13 @@ static int ClientMemRecv(info_t* info, char* buf, int sz)
     pthread_mutex_lock(&info->to_client.mutex);
 
 #ifndef BENCH_USE_NONBLOCK
-    while (info->to_client.write_idx - info->to_client.read_idx < sz)
+    while (info->to_client.write_idx - info->to_client.read_idx <
+                            (MemRecvPartial(info) ? 1 : sz))
         pthread_cond_wait(&info->to_client.cond, &info->to_client.mutex);
-#else
-    if (info->to_client.write_idx - info->to_client.read_idx < sz)
-        sz = info->to_client.write_idx - info->to_client.read_idx;
 #endif
+    if (MemRecvPartial(info) &&
+                    info->to_client.write_idx - info->to_client.read_idx < sz)
+        sz = info->to_client.write_idx - info->to_client.read_idx;
 
     XMEMCPY(buf, &info->to_client.buf[info->to_client.read_idx], sz);
     info->to_client.read_idx += sz;
@@ -596,7 +620,7 @@ static int bench_tls_client(info_t* info)
 {
     byte *writeBuf = NULL, *readBuf = NULL;
     double start, total = 0;
-    int ret, readBufSz;
+    int ret, readBufSz, readSz;
     WOLFSSL_CTX* cli_ctx = NULL;
     WOLFSSL* cli_ssl = NULL;
     int haveShownPeerInfo = 0;
@@ -610,8 +634,14 @@ static int bench_tls_client(info_t* info)
     if (tls13)
         cli_ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method());
 #endif
+    /* offering TLS v1.3 without a TLS v1.3 suite fails the handshake */
+#ifndef WOLFSSL_NO_TLS12
+    if (!tls13)
+        cli_ctx = wolfSSL_CTX_new(wolfTLSv1_2_client_method());
+#else
     if (!tls13)
         cli_ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+#endif
     if (cli_ctx == NULL) {
         printf("error creating ctx\n");
         ret = MEMORY_E; goto exit;
@@ -638,6 +668,13 @@ static int bench_tls_client(info_t* info)
     wolfSSL_CTX_SetIOSend(cli_ctx, ClientSend);
     wolfSSL_CTX_SetIORecv(cli_ctx, ClientRecv);
 
+#ifdef WOLFSSL_READ_AHEAD
+    if (info->readBatch) {
+        wolfSSL_CTX_set_read_ahead_size(cli_ctx, WOLFSSL_MAX_READ_AHEAD_SZ);
+        wolfSSL_CTX_set_read_batch(cli_ctx, 1);
+    }
+#endif
+
     /* set cipher suite */
     ret = wolfSSL_CTX_set_cipher_list(cli_ctx, info->cipher);
     if (ret != WOLFSSL_SUCCESS) {
@@ -766,25 +803,33 @@ static int bench_tls_client(info_t* info)
             info->client_stats.txTotal += ret;
             total_sz += ret;
 
-            /* read echo of message from server */
+            /* read echo of message from server, may be in several records */
             XMEMSET(readBuf, 0, readBufSz);
+            readSz = 0;
             start = gettime_secs(1);
-        #ifndef BENCH_USE_NONBLOCK
-            ret = wolfSSL_read(cli_ssl, readBuf, readBufSz);
-        #else
-            do {
-                ret = wolfSSL_read(cli_ssl, readBuf, readBufSz);
-                err = wolfSSL_get_error(cli_ssl, ret);
+            while (readSz < writeSz) {
+            #ifndef BENCH_USE_NONBLOCK
+                ret = wolfSSL_read(cli_ssl, readBuf + readSz,
+                                   readBufSz - readSz);
+            #else
+                do {
+                    ret = wolfSSL_read(cli_ssl, readBuf + readSz,
+                                       readBufSz - readSz);
+                    err = wolfSSL_get_error(cli_ssl, ret);
+                }
+                while (err == WOLFSSL_ERROR_WANT_READ);
+            #endif
+                if (ret <= 0)
+                    break;
+                readSz += ret;
             }
-            while (err == WOLFSSL_ERROR_WANT_READ);
-        #endif
             info->client_stats.rxTime += gettime_secs(0) - start;
-            if (ret < 0) {
+            if (ret <= 0) {
                 printf("error on client read\n");
                 ret = wolfSSL_get_error(cli_ssl, ret);
                 goto exit;
             }
-            info->client_stats.rxTotal += ret;
+            info->client_stats.rxTotal += readSz;
             ret = 0; /* reset return code */
 
             /* validate echo */
@@ -923,6 +968,10 @@ static int bench_tls_server(info_t* info)
     WOLFSSL* srv_ssl = NULL;
     int tls13 = XSTRNCMP(info->cipher, "TLS13", 5) == 0;
     int total_sz;
+#ifdef WOLFSSL_SENDFILE
+    int fileFd = -1;
+    int sent;
+#endif
 
     /* set up server */
 #ifdef WOLFSSL_TLS13
@@ -973,6 +1022,13 @@ static int bench_tls_server(info_t* info)
     wolfSSL_CTX_SetIOSend(srv_ctx, ServerSend);
     wolfSSL_CTX_SetIORecv(srv_ctx, ServerRecv);
 
+#ifdef WOLFSSL_READ_AHEAD
+    if (info->readBatch) {
+        wolfSSL_CTX_set_read_ahead_size(srv_ctx, WOLFSSL_MAX_READ_AHEAD_SZ);
+        wolfSSL_CTX_set_read_batch(srv_ctx, 1);
+    }
+#endif
+
     /* set cipher suite */
     ret = wolfSSL_CTX_set_cipher_list(srv_ctx, info->cipher);
     if (ret != WOLFSSL_SUCCESS) {
@@ -996,6 +1052,20 @@ static int bench_tls_server(info_t* info)
         ret = MEMORY_E; goto exit;
     }
 
+#ifdef WOLFSSL_SENDFILE
+    if (info->useSendFile) {
+        /* the echo is staged in a file the kernel holds in its page cache */
+        char fileName[] = "/tmp/tls_bench_XXXXXX";
+
+        fileFd = mkstemp(fileName);
+        if (fileFd < 0) {
+            printf("failed to create sendfile file\n");
+            ret = -1; goto exit;
+        }
+        unlink(fileName);
+    }
+#endif
+
     /* BENCHMARK CONNECTIONS LOOP */
     while (!info->server.shutdown) {
     #ifdef BENCH_USE_NONBLOCK
@@ -1093,18 +1163,49 @@ static int bench_tls_server(info_t* info)
             len = ret;
             total_sz += ret;
 
-            /* write message back to client */
-            start = gettime_secs(1);
-        #ifndef BENCH_USE_NONBLOCK
-            ret = wolfSSL_write(srv_ssl, readBuf, len);
-        #else
-            do {
-                ret = wolfSSL_write(srv_ssl, readBuf, len);
-                err = wolfSSL_get_error(srv_ssl, ret);
+        #ifdef WOLFSSL_SENDFILE
+            if (info->useSendFile) {
+                if (pwrite(fileFd, readBuf, len, 0) != len) {
+                    printf("error writing sendfile file\n");
+                    ret = -1; goto exit;
+                }
+
+                /* send the file back to client */
+                start = gettime_secs(1);
+                sent = 0;
+                do {
+                    ret = wolfSSL_sendfile(srv_ssl, fileFd, sent, len - sent);
+                #ifdef BENCH_USE_NONBLOCK
+                    if (ret < 0) {
+                        err = wolfSSL_get_error(srv_ssl, ret);
+                        if (err == WOLFSSL_ERROR_WANT_WRITE)
+                            continue;
+                    }
+                #endif
+                    if (ret < 0)
+                        break;
+                    sent += ret;
+                } while (sent < len);
+                if (ret > 0)
+                    ret = sent;
+                info->server_stats.txTime += gettime_secs(0) - start;
             }
-            while (err == WOLFSSL_ERROR_WANT_WRITE);
+            else
         #endif
-            info->server_stats.txTime += gettime_secs(0) - start;
+            {
+                /* write message back to client */
+                start = gettime_secs(1);
+            #ifndef BENCH_USE_NONBLOCK
+                ret = wolfSSL_write(srv_ssl, readBuf, len);
+            #else
+                do {
+                    ret = wolfSSL_write(srv_ssl, readBuf, len);
+                    err = wolfSSL_get_error(srv_ssl, ret);
+                }
+                while (err == WOLFSSL_ERROR_WANT_WRITE);
+            #endif
+                info->server_stats.txTime += gettime_secs(0) - start;
+            }
             if (ret < 0) {
                 printf("error on server write\n");
                 ret = wolfSSL_get_error(srv_ssl, ret);
@@ -1133,6 +1234,10 @@ exit:
         wolfSSL_free(srv_ssl);
     if (srv_ctx != NULL)
         wolfSSL_CTX_free(srv_ctx);
+#ifdef WOLFSSL_SENDFILE
+    if (fileFd >= 0)
+        close(fileFd);
+#endif
     XFREE(readBuf, NULL, DYNAMIC_TYPE_TMP_BUFFER);
     info->server.ret = ret;
 
@@ -1226,6 +1331,12 @@ static void Usage(void)
     printf("-T <num>    Number of threaded server/client pairs (default %d)\n", NUM_THREAD_PAIRS);
     printf("-m          Use local memory, not socket\n");
 #endif
+#if defined(WOLFSSL_SENDFILE) && !defined(NO_WOLFSSL_SERVER)
+    printf("-F          Server echoes from a file with wolfSSL_sendfile\n");
+#endif
+#ifdef WOLFSSL_READ_AHEAD
+    printf("-B          Read ahead and decrypt all buffered records per read\n");
+#endif
 }
 
 static void ShowCiphers(void)
@@ -1265,6 +1376,12 @@ int bench_tls(void* args)
     const char* argHost = BENCH_DEFAULT_HOST;
     int argPort = BENCH_DEFAULT_PORT;
     int argShowPeerInfo = 0;
+#if defined(WOLFSSL_SENDFILE) && !defined(NO_WOLFSSL_SERVER)
+    int argSendFile = 0;
+#endif
+#ifdef WOLFSSL_READ_AHEAD
+    int argReadBatch = 0;
+#endif
 #ifdef HAVE_PTHREAD
     int doShutdown;
 #endif
@@ -1280,7 +1397,7 @@ int bench_tls(void* args)
     wolfSSL_Init();
 
     /* Parse command line arguments */
-    while ((ch = mygetopt(argc, argv, "?" "deil:p:t:vT:sch:P:mS:")) != -1) {
+    while ((ch = mygetopt(argc, argv, "?" "deil:p:t:vT:sch:P:mS:FB")) != -1) {
         switch (ch) {
             case '?' :
                 Usage();
@@ -1353,6 +1470,18 @@ int bench_tls(void* args)
             #endif
                 break;
 
+            case 'F':
+            #if defined(WOLFSSL_SENDFILE) && !defined(NO_WOLFSSL_SERVER)
+                argSendFile = 1;
+            #endif
+                break;
+
+            case 'B':
+            #ifdef WOLFSSL_READ_AHEAD
+                argReadBatch = 1;
+            #endif
+                break;
+
             default:
                 Usage();
                 ret = MY_EX_USAGE; goto exit;
@@ -1429,8 +1558,14 @@ int bench_tls(void* args)
             info->maxSize = argTestMaxSize;
             info->showPeerInfo = argShowPeerInfo;
             info->showVerbose = argShowVerbose;
+        #ifdef WOLFSSL_READ_AHEAD
+            info->readBatch = argReadBatch;
+        #endif
         #ifndef NO_WOLFSSL_SERVER
             info->listenFd = listenFd;
+        #ifdef WOLFSSL_SENDFILE
+            info->useSendFile = argSendFile;
+        #endif
         #endif
             info->client.sockFd = -1;
             info->server.sockFd = -1;
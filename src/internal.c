@@ -1563,6 +1563,21 @@ int InitSSL_Ctx(WOLFSSL_CTX* ctx, WOLFSSL_METHOD* method, void* heap)
 #ifdef WOLFSSL_EARLY_DATA
     ctx->maxEarlyDataSz = MAX_EARLY_DATA_SZ;
 #endif
+#if defined(WOLFSSL_EARLY_DATA_ANTI_REPLAY) && !defined(NO_WOLFSSL_SERVER)
+    if (ret == 0 && method->side == WOLFSSL_SERVER_END &&
+                                         IsAtLeastTLSv1_3(method->version)) {
+        ret = InitAntiReplay(ctx, heap);
+    }
+#endif
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    if (ret == 0 && method->side == WOLFSSL_SERVER_END)
+        ret = InitHsAdmission(ctx, heap);
+#endif
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+    ctx->dynRecSmallSz   = WOLFSSL_DYN_RECORD_SMALL_SZ;
+    ctx->dynRecThreshold = WOLFSSL_DYN_RECORD_THRESHOLD;
+    ctx->dynRecIdleSec   = WOLFSSL_DYN_RECORD_IDLE_SEC;
+#endif
 
     ctx->heap = heap; /* wolfSSL_CTX_load_static_memory sets */
     ctx->verifyDepth = MAX_CHAIN_DEPTH;
@@ -1604,9 +1619,22 @@ void SSL_CtxResourceFree(WOLFSSL_CTX* ctx)
     }
 #endif /* SINGLE_THREADED */
 
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+    FreeAntiReplay(ctx);
+#endif
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    FreeHsAdmission(ctx);
+#endif
+
 #ifndef NO_CERTS
     FreeDer(&ctx->privateKey);
     FreeDer(&ctx->certificate);
+    #ifdef WOLFSSL_CERT_MSG_CACHE
+        FreeCertMsgCache(ctx);
+    #endif
+    #ifdef WOLFSSL_SNI_STORE
+        FreeSNIStore(ctx);
+    #endif
     #ifdef KEEP_OUR_CERT
         if (ctx->ourCert && ctx->ownOurCert) {
             FreeX509(ctx->ourCert);
@@ -1749,6 +1777,10 @@ void InitCiphers(WOLFSSL* ssl)
     ssl->encrypt.chacha = NULL;
     ssl->decrypt.chacha = NULL;
 #endif
+#ifdef WOLFSSL_TLS_HMAC_CACHE
+    ssl->encrypt.hmac = NULL;
+    ssl->decrypt.hmac = NULL;
+#endif
 #if defined(HAVE_POLY1305) && defined(HAVE_ONE_TIME_AUTH)
     ssl->auth.poly1305 = NULL;
 #endif
@@ -1815,6 +1847,12 @@ void FreeCiphers(WOLFSSL* ssl)
     XFREE(ssl->encrypt.idea, ssl->heap, DYNAMIC_TYPE_CIPHER);
     XFREE(ssl->decrypt.idea, ssl->heap, DYNAMIC_TYPE_CIPHER);
 #endif
+#ifdef WOLFSSL_TLS_HMAC_CACHE
+    wc_HmacFree(ssl->encrypt.hmac);
+    wc_HmacFree(ssl->decrypt.hmac);
+    XFREE(ssl->encrypt.hmac, ssl->heap, DYNAMIC_TYPE_CIPHER);
+    XFREE(ssl->decrypt.hmac, ssl->heap, DYNAMIC_TYPE_CIPHER);
+#endif
 }
 
 
@@ -3810,6 +3848,14 @@ int EccMakeKey(WOLFSSL* ssl, ecc_key* key, ecc_key* peer)
     else
 #endif
     {
+#ifdef WOLFSSL_KEY_SHARE_POOL
+        ret = -1;
+        if (keySz == 32 && (ecc_curve == ECC_CURVE_DEF ||
+                                                ecc_curve == ECC_SECP256R1)) {
+            ret = KeySharePoolGet(ssl, WOLFSSL_ECC_SECP256R1, key);
+        }
+        if (ret != 0)
+#endif
         ret = wc_ecc_make_key_ex(ssl->rng, keySz, key, ecc_curve);
     }
 
@@ -4113,6 +4159,10 @@ static int X25519MakeKey(WOLFSSL* ssl, curve25519_key* key,
     else
 #endif
     {
+#ifdef WOLFSSL_KEY_SHARE_POOL
+        ret = KeySharePoolGet(ssl, WOLFSSL_ECC_X25519, key);
+        if (ret != 0)
+#endif
         ret = wc_curve25519_make_key(ssl->rng, CURVE25519_KEYSIZE, key);
     }
 
@@ -4413,6 +4463,21 @@ int SetSSL_CTX(WOLFSSL* ssl, WOLFSSL_CTX* ctx, int writeDup)
     if (ssl->options.side == WOLFSSL_SERVER_END)
         ssl->options.maxEarlyDataSz = ctx->maxEarlyDataSz;
 #endif
+#ifdef WOLFSSL_READ_AHEAD
+    ssl->options.readAheadSz = ctx->readAheadSz;
+    ssl->options.readBatch   = ctx->readBatch;
+#endif
+#ifdef WOLFSSL_KTLS
+    ssl->options.useKtls = ctx->useKtls;
+#endif
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    ssl->options.eagerHash = ctx->eagerHash;
+#endif
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+    ssl->options.dynRecSmallSz   = ctx->dynRecSmallSz;
+    ssl->options.dynRecThreshold = ctx->dynRecThreshold;
+    ssl->options.dynRecIdleSec   = ctx->dynRecIdleSec;
+#endif
 
 #ifdef HAVE_ANON
     ssl->options.haveAnon = ctx->haveAnon;
@@ -4446,6 +4511,7 @@ int SetSSL_CTX(WOLFSSL* ssl, WOLFSSL_CTX* ctx, int writeDup)
     ssl->options.partialWrite  = ctx->partialWrite;
     ssl->options.quietShutdown = ctx->quietShutdown;
     ssl->options.groupMessages = ctx->groupMessages;
+    ssl->options.releaseBuffers = ctx->releaseBuffers;
 
 #ifndef NO_DH
     #if !defined(WOLFSSL_OLD_PRIME_CHECK) && !defined(HAVE_FIPS) && \
@@ -4522,89 +4588,137 @@ int SetSSL_CTX(WOLFSSL* ssl, WOLFSSL_CTX* ctx, int writeDup)
     return ret;
 }
 
-int InitHandshakeHashes(WOLFSSL* ssl)
+/* Initialize the handshake hashes selected by mask (HS_HASH_*). */
+static int InitHandshakeHashesMask(WOLFSSL* ssl, byte mask)
 {
-    int ret;
-
-    /* make sure existing handshake hashes are free'd */
-    if (ssl->hsHashes != NULL) {
-        FreeHandshakeHashes(ssl);
-    }
+    int ret = 0;
 
-    /* allocate handshake hashes */
-    ssl->hsHashes = (HS_Hashes*)XMALLOC(sizeof(HS_Hashes), ssl->heap,
-                                                           DYNAMIC_TYPE_HASHES);
-    if (ssl->hsHashes == NULL) {
-        WOLFSSL_MSG("HS_Hashes Memory error");
-        return MEMORY_E;
-    }
-    XMEMSET(ssl->hsHashes, 0, sizeof(HS_Hashes));
+    (void)mask;
 
 #ifndef NO_OLD_TLS
 #ifndef NO_MD5
-    ret = wc_InitMd5_ex(&ssl->hsHashes->hashMd5, ssl->heap, ssl->devId);
-    if (ret != 0)
-        return ret;
+    if (mask & HS_HASH_MD5) {
+        ret = wc_InitMd5_ex(&ssl->hsHashes->hashMd5, ssl->heap, ssl->devId);
+        if (ret != 0)
+            return ret;
     #if defined(WOLFSSL_HASH_FLAGS) || defined(WOLF_CRYPTO_CB)
         wc_Md5SetFlags(&ssl->hsHashes->hashMd5, WC_HASH_FLAG_WILLCOPY);
     #endif
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        ssl->hsHashes->active |= HS_HASH_MD5;
+    #endif
+    }
 #endif
 #ifndef NO_SHA
-    ret = wc_InitSha_ex(&ssl->hsHashes->hashSha, ssl->heap, ssl->devId);
-    if (ret != 0)
-        return ret;
+    if (mask & HS_HASH_SHA) {
+        ret = wc_InitSha_ex(&ssl->hsHashes->hashSha, ssl->heap, ssl->devId);
+        if (ret != 0)
+            return ret;
     #if defined(WOLFSSL_HASH_FLAGS) || defined(WOLF_CRYPTO_CB)
         wc_ShaSetFlags(&ssl->hsHashes->hashSha, WC_HASH_FLAG_WILLCOPY);
     #endif
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        ssl->hsHashes->active |= HS_HASH_SHA;
+    #endif
+    }
 #endif
 #endif /* !NO_OLD_TLS */
 #ifndef NO_SHA256
-    ret = wc_InitSha256_ex(&ssl->hsHashes->hashSha256, ssl->heap, ssl->devId);
-    if (ret != 0)
-        return ret;
+    if (mask & HS_HASH_SHA256) {
+        ret = wc_InitSha256_ex(&ssl->hsHashes->hashSha256, ssl->heap,
+                                                                   ssl->devId);
+        if (ret != 0)
+            return ret;
     #if defined(WOLFSSL_HASH_FLAGS) || defined(WOLF_CRYPTO_CB)
         wc_Sha256SetFlags(&ssl->hsHashes->hashSha256, WC_HASH_FLAG_WILLCOPY);
     #endif
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        ssl->hsHashes->active |= HS_HASH_SHA256;
+    #endif
+    }
 #endif
 #ifdef WOLFSSL_SHA384
-    ret = wc_InitSha384_ex(&ssl->hsHashes->hashSha384, ssl->heap, ssl->devId);
-    if (ret != 0)
-        return ret;
+    if (mask & HS_HASH_SHA384) {
+        ret = wc_InitSha384_ex(&ssl->hsHashes->hashSha384, ssl->heap,
+                                                                   ssl->devId);
+        if (ret != 0)
+            return ret;
     #if defined(WOLFSSL_HASH_FLAGS) || defined(WOLF_CRYPTO_CB)
         wc_Sha384SetFlags(&ssl->hsHashes->hashSha384, WC_HASH_FLAG_WILLCOPY);
     #endif
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        ssl->hsHashes->active |= HS_HASH_SHA384;
+    #endif
+    }
 #endif
 #ifdef WOLFSSL_SHA512
-    ret = wc_InitSha512_ex(&ssl->hsHashes->hashSha512, ssl->heap, ssl->devId);
-    if (ret != 0)
-        return ret;
+    if (mask & HS_HASH_SHA512) {
+        ret = wc_InitSha512_ex(&ssl->hsHashes->hashSha512, ssl->heap,
+                                                                   ssl->devId);
+        if (ret != 0)
+            return ret;
     #if defined(WOLFSSL_HASH_FLAGS) || defined(WOLF_CRYPTO_CB)
         wc_Sha512SetFlags(&ssl->hsHashes->hashSha512, WC_HASH_FLAG_WILLCOPY);
     #endif
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        ssl->hsHashes->active |= HS_HASH_SHA512;
+    #endif
+    }
 #endif
 
     return ret;
 }
 
+int InitHandshakeHashes(WOLFSSL* ssl)
+{
+    /* make sure existing handshake hashes are free'd */
+    if (ssl->hsHashes != NULL) {
+        FreeHandshakeHashes(ssl);
+    }
+
+    /* allocate handshake hashes */
+    ssl->hsHashes = (HS_Hashes*)XMALLOC(sizeof(HS_Hashes), ssl->heap,
+                                                           DYNAMIC_TYPE_HASHES);
+    if (ssl->hsHashes == NULL) {
+        WOLFSSL_MSG("HS_Hashes Memory error");
+        return MEMORY_E;
+    }
+    XMEMSET(ssl->hsHashes, 0, sizeof(HS_Hashes));
+
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if (!ssl->options.eagerHash) {
+        /* buffer messages until the cipher suite picks the transcript hash */
+        ssl->hsHashes->lazy = 1;
+        return 0;
+    }
+#endif
+    return InitHandshakeHashesMask(ssl, HS_HASH_ALL);
+}
+
 void FreeHandshakeHashes(WOLFSSL* ssl)
 {
     if (ssl->hsHashes) {
 #ifndef NO_OLD_TLS
     #ifndef NO_MD5
-        wc_Md5Free(&ssl->hsHashes->hashMd5);
+        if (HS_HASH_ON(ssl, HS_HASH_MD5))
+            wc_Md5Free(&ssl->hsHashes->hashMd5);
     #endif
     #ifndef NO_SHA
-        wc_ShaFree(&ssl->hsHashes->hashSha);
+        if (HS_HASH_ON(ssl, HS_HASH_SHA))
+            wc_ShaFree(&ssl->hsHashes->hashSha);
     #endif
 #endif /* !NO_OLD_TLS */
     #ifndef NO_SHA256
-        wc_Sha256Free(&ssl->hsHashes->hashSha256);
+        if (HS_HASH_ON(ssl, HS_HASH_SHA256))
+            wc_Sha256Free(&ssl->hsHashes->hashSha256);
     #endif
     #ifdef WOLFSSL_SHA384
-        wc_Sha384Free(&ssl->hsHashes->hashSha384);
+        if (HS_HASH_ON(ssl, HS_HASH_SHA384))
+            wc_Sha384Free(&ssl->hsHashes->hashSha384);
     #endif
     #ifdef WOLFSSL_SHA512
-        wc_Sha512Free(&ssl->hsHashes->hashSha512);
+        if (HS_HASH_ON(ssl, HS_HASH_SHA512))
+            wc_Sha512Free(&ssl->hsHashes->hashSha512);
     #endif
     #if defined(HAVE_ED25519) && !defined(WOLFSSL_NO_CLIENT_AUTH)
         if (ssl->hsHashes->messages != NULL) {
@@ -4612,6 +4726,12 @@ void FreeHandshakeHashes(WOLFSSL* ssl)
             ssl->hsHashes->messages = NULL;
          }
     #endif
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        if (ssl->hsHashes->pending != NULL) {
+            XFREE(ssl->hsHashes->pending, ssl->heap, DYNAMIC_TYPE_HASHES);
+            ssl->hsHashes->pending = NULL;
+        }
+    #endif
 
         XFREE(ssl->hsHashes, ssl->heap, DYNAMIC_TYPE_HASHES);
         ssl->hsHashes = NULL;
@@ -4812,6 +4932,9 @@ int InitSSL(WOLFSSL* ssl, WOLFSSL_CTX* ctx, int writeDup)
     #if defined(WOLFSSL_POST_HANDSHAKE_AUTH)
         ssl->options.postHandshakeAuth = ctx->postHandshakeAuth;
     #endif
+    #if defined(WOLFSSL_CERT_COMPRESSION)
+        ssl->options.certCompress = ctx->certCompress;
+    #endif
 
     if (ctx->numGroups > 0) {
         XMEMCPY(ssl->group, ctx->group, sizeof(*ctx->group) * ctx->numGroups);
@@ -4823,6 +4946,9 @@ int InitSSL(WOLFSSL* ssl, WOLFSSL_CTX* ctx, int writeDup)
 #ifdef HAVE_MAX_FRAGMENT
     ssl->max_fragment = MAX_RECORD_SIZE;
 #endif
+#ifdef HAVE_RECORD_SIZE_LIMIT
+    ssl->recordSizeLimit = ctx->recordSizeLimit;
+#endif
 #ifdef HAVE_ALPN
     ssl->alpn_client_list = NULL;
     #if defined(OPENSSL_ALL) || defined(WOLFSSL_NGINX) || defined(WOLFSSL_HAPROXY)
@@ -5056,22 +5182,11 @@ void FreeKey(WOLFSSL* ssl, int type, void** pKey)
     }
 }
 
-int AllocKey(WOLFSSL* ssl, int type, void** pKey)
+/* Size of the memory allocated for a key of the dynamic type */
+static int KeySize(int type)
 {
-    int ret = BAD_FUNC_ARG;
     int sz = 0;
 
-    if (ssl == NULL || pKey == NULL) {
-        return BAD_FUNC_ARG;
-    }
-
-    /* Sanity check key destination */
-    if (*pKey != NULL) {
-        WOLFSSL_MSG("Key already present!");
-        return BAD_STATE_E;
-    }
-
-    /* Determine size */
     switch (type) {
     #ifndef NO_RSA
         case DYNAMIC_TYPE_RSA:
@@ -5106,6 +5221,30 @@ int AllocKey(WOLFSSL* ssl, int type, void** pKey)
         return NOT_COMPILED_IN;
     }
 
+    return sz;
+}
+
+int AllocKey(WOLFSSL* ssl, int type, void** pKey)
+{
+    int ret = BAD_FUNC_ARG;
+    int sz;
+
+    if (ssl == NULL || pKey == NULL) {
+        return BAD_FUNC_ARG;
+    }
+
+    /* Sanity check key destination */
+    if (*pKey != NULL) {
+        WOLFSSL_MSG("Key already present!");
+        return BAD_STATE_E;
+    }
+
+    /* Determine size */
+    sz = KeySize(type);
+    if (sz < 0) {
+        return sz;
+    }
+
     /* Allocate memeory for key */
     *pKey = XMALLOC(sz, ssl->heap, type);
     if (*pKey == NULL) {
@@ -5417,6 +5556,12 @@ void SSL_ResourceFree(WOLFSSL* ssl)
         XFREE(curr, ssl->heap, DYNAMIC_TYPE_TMP_BUFFER);
     }
 #endif
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_CERT_COMPRESSION)
+    if (ssl->certDecomp != NULL) {
+        XFREE(ssl->certDecomp, ssl->heap, DYNAMIC_TYPE_CERT);
+        ssl->certDecomp = NULL;
+    }
+#endif
 
 #ifdef WOLFSSL_STATIC_MEMORY
     /* check if using fixed io buffers and free them */
@@ -5460,6 +5605,11 @@ void SSL_ResourceFree(WOLFSSL* ssl)
 /* Free any handshake resources no longer needed */
 void FreeHandshakeResources(WOLFSSL* ssl)
 {
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
+    /* post-handshake authentication reuses the handshake state */
+    int postHandshakeAuth = ssl->options.tls1_3 &&
+                            ssl->options.postHandshakeAuth;
+#endif
 
 #ifdef HAVE_SECURE_RENEGOTIATION
     if (ssl->secure_renegotiation && ssl->secure_renegotiation->enabled) {
@@ -5473,7 +5623,7 @@ void FreeHandshakeResources(WOLFSSL* ssl)
         ShrinkInputBuffer(ssl, NO_FORCED_FREE);
 
 #if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
-    if (!ssl->options.tls1_3)
+    if (!postHandshakeAuth)
 #endif
     {
         /* suites */
@@ -5522,14 +5672,14 @@ void FreeHandshakeResources(WOLFSSL* ssl)
 
 #if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH) && \
                                                     defined(HAVE_SESSION_TICKET)
-    if (!ssl->options.tls1_3)
+    if (!postHandshakeAuth)
 #endif
         /* arrays */
         if (ssl->options.saveArrays == 0)
             FreeArrays(ssl, 1);
 
 #if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
-    if (!ssl->options.tls1_3 || ssl->options.side == WOLFSSL_CLIENT_END)
+    if (!postHandshakeAuth || ssl->options.side == WOLFSSL_CLIENT_END)
 #endif
     {
 #ifndef NO_RSA
@@ -5598,7 +5748,7 @@ void FreeHandshakeResources(WOLFSSL* ssl)
 #endif
 #ifdef HAVE_PK_CALLBACKS
 #if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
-    if (!ssl->options.tls1_3 || ssl->options.side == WOLFSSL_CLIENT_END)
+    if (!postHandshakeAuth || ssl->options.side == WOLFSSL_CLIENT_END)
 #endif
     {
     #ifdef HAVE_ECC
@@ -5635,6 +5785,8 @@ void FreeHandshakeResources(WOLFSSL* ssl)
     /* Some extensions need to be kept for post-handshake querying. */
     TLSX_FreeAll(ssl->extensions, ssl->heap);
     ssl->extensions = NULL;
+#elif defined(HAVE_TLS_EXTENSIONS)
+    TLSX_FreeHandshake(ssl);
 #endif
 
 #ifdef WOLFSSL_STATIC_MEMORY
@@ -5665,6 +5817,9 @@ void FreeHandshakeResources(WOLFSSL* ssl)
 /* heap argument is the heap hint used when creating SSL */
 void FreeSSL(WOLFSSL* ssl, void* heap)
 {
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    HsAdmitDone(ssl, 0);    /* abandoned handshake */
+#endif
     if (ssl->ctx) {
         FreeSSL_Ctx(ssl->ctx); /* will decrement and free underlying CTX if 0 */
     }
@@ -5673,6 +5828,142 @@ void FreeSSL(WOLFSSL* ssl, void* heap)
     (void)heap;
 }
 
+
+/* Add the size of a key to the memory usage when it is allocated */
+static WC_INLINE word32 KeyMemoryUsage(int type, const void* key)
+{
+    int sz;
+
+    if (key == NULL)
+        return 0;
+    sz = KeySize(type);
+
+    return (sz > 0) ? (word32)sz : 0;
+}
+
+
+/* Memory allocated for the cipher objects of one direction */
+static word32 CiphersMemoryUsage(const Ciphers* ciphers)
+{
+    word32 sz = 0;
+
+    (void)ciphers;
+#ifdef BUILD_ARC4
+    if (ciphers->arc4 != NULL)
+        sz += sizeof(Arc4);
+#endif
+#ifdef BUILD_DES3
+    if (ciphers->des3 != NULL)
+        sz += sizeof(Des3);
+#endif
+#if defined(BUILD_AES) || defined(BUILD_AESGCM)
+    if (ciphers->aes != NULL)
+        sz += sizeof(Aes);
+    #if defined(BUILD_AESGCM) || defined(HAVE_AESCCM) || defined(WOLFSSL_TLS13)
+    if (ciphers->additional != NULL)
+        sz += AEAD_AUTH_DATA_SZ;
+    if (ciphers->nonce != NULL)
+        sz += AESGCM_NONCE_SZ;
+    #endif
+#endif
+#ifdef HAVE_CAMELLIA
+    if (ciphers->cam != NULL)
+        sz += sizeof(Camellia);
+#endif
+#ifdef HAVE_CHACHA
+    if (ciphers->chacha != NULL)
+        sz += sizeof(ChaCha);
+#endif
+#ifdef HAVE_HC128
+    if (ciphers->hc128 != NULL)
+        sz += sizeof(HC128);
+#endif
+#ifdef BUILD_RABBIT
+    if (ciphers->rabbit != NULL)
+        sz += sizeof(Rabbit);
+#endif
+#ifdef HAVE_IDEA
+    if (ciphers->idea != NULL)
+        sz += sizeof(Idea);
+#endif
+
+    return sz;
+}
+
+
+/* Number of bytes of memory held by the SSL object.
+ * Counts the object and the handshake, key, cipher and I/O buffer memory it
+ * owns. Memory shared with the CTX, extensions and certificates is not
+ * counted. */
+word32 SSL_MemoryUsage(const WOLFSSL* ssl)
+{
+    word32 sz = sizeof(WOLFSSL);
+
+    if (ssl->suites != NULL)
+        sz += sizeof(Suites);
+    if (ssl->hsHashes != NULL)
+        sz += sizeof(HS_Hashes);
+    if (ssl->arrays != NULL) {
+        sz += sizeof(Arrays);
+        if (ssl->arrays->preMasterSecret != NULL)
+            sz += ENCRYPT_LEN;
+        if (ssl->arrays->pendingMsg != NULL)
+            sz += ssl->arrays->pendingMsgSz;
+    }
+    if (ssl->rng != NULL && ssl->options.weOwnRng)
+        sz += sizeof(WC_RNG);
+
+    if (ssl->buffers.inputBuffer.dynamicFlag)
+        sz += ssl->buffers.inputBuffer.bufferSize +
+              ssl->buffers.inputBuffer.offset;
+    if (ssl->buffers.outputBuffer.dynamicFlag)
+        sz += ssl->buffers.outputBuffer.bufferSize +
+              ssl->buffers.outputBuffer.offset;
+
+    sz += CiphersMemoryUsage(&ssl->encrypt);
+    sz += CiphersMemoryUsage(&ssl->decrypt);
+#if defined(HAVE_POLY1305) && defined(HAVE_ONE_TIME_AUTH)
+    if (ssl->auth.poly1305 != NULL)
+        sz += sizeof(Poly1305);
+#endif
+
+    sz += KeyMemoryUsage(ssl->hsType, ssl->hsKey);
+#ifndef NO_RSA
+    sz += KeyMemoryUsage(DYNAMIC_TYPE_RSA, ssl->peerRsaKey);
+#endif
+#ifdef HAVE_ECC
+    sz += KeyMemoryUsage(DYNAMIC_TYPE_ECC, ssl->peerEccKey);
+    sz += KeyMemoryUsage(DYNAMIC_TYPE_ECC, ssl->peerEccDsaKey);
+#endif
+#ifdef HAVE_ED25519
+    sz += KeyMemoryUsage(DYNAMIC_TYPE_ED25519, ssl->peerEd25519Key);
+#endif
+#ifdef HAVE_CURVE25519
+    sz += KeyMemoryUsage(DYNAMIC_TYPE_CURVE25519, ssl->peerX25519Key);
+#endif
+#if defined(HAVE_ECC) || defined(HAVE_CURVE25519)
+    if (ssl->eccTempKey != NULL) {
+    #ifdef HAVE_CURVE25519
+        if (ssl->eccTempKeyPresent == DYNAMIC_TYPE_CURVE25519)
+            sz += sizeof(curve25519_key);
+        else
+    #endif
+        {
+    #ifdef HAVE_ECC
+            sz += sizeof(ecc_key);
+    #endif
+        }
+    }
+#endif
+
+#ifdef HAVE_SESSION_TICKET
+    if (ssl->session.isDynamic)
+        sz += ssl->session.ticketLen;
+#endif
+
+    return sz;
+}
+
 #if !defined(NO_OLD_TLS) || defined(WOLFSSL_DTLS) || \
     ((defined(HAVE_CHACHA) || defined(HAVE_AESCCM) || defined(HAVE_AESGCM)) \
      && defined(HAVE_AEAD))
@@ -6519,77 +6810,471 @@ ProtocolVersion MakeDTLSv1_2(void)
         return (word32)XTIME(0);
     }
 #endif
-#if !defined(WOLFSSL_NO_CLIENT_AUTH) && defined(HAVE_ED25519) && \
-                                                !defined(NO_ED25519_CLIENT_AUTH)
-/* Store the message for use with CertificateVerify using Ed25519.
- *
- * ssl   SSL/TLS object.
- * data  Message to store.
- * sz    Size of message to store.
- * returns MEMORY_E if not able to reallocate, otherwise 0.
- */
-static int Ed25519Update(WOLFSSL* ssl, const byte* data, int sz)
+
+#if defined(WOLFSSL_HANDSHAKE_TIMING) || defined(WOLFSSL_HANDSHAKE_ADMISSION)
+
+#if !defined(WOLFSSL_HS_TIME_NOW) && !defined(USE_WINDOWS_API)
+    #include <time.h>
+#endif
+
+/* Monotonic time in microseconds. Only differences are used, so wrapping
+ * around is fine. Define WOLFSSL_HS_TIME_NOW() to provide the time. */
+static word32 HsTimeNow(void)
 {
-    int   ret = 0;
-    byte* msgs;
+#if defined(WOLFSSL_HS_TIME_NOW)
+    return (word32)WOLFSSL_HS_TIME_NOW();
+#elif defined(USE_WINDOWS_API)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER        count;
 
-    if (ssl->options.cacheMessages) {
-        msgs = (byte*)XREALLOC(ssl->hsHashes->messages,
-                                                ssl->hsHashes->length + sz,
-                                                ssl->heap, DYNAMIC_TYPE_HASHES);
-        if (msgs == NULL)
-            ret = MEMORY_E;
-        if (ret == 0) {
-            ssl->hsHashes->messages = msgs;
-            XMEMCPY(msgs + ssl->hsHashes->length, data, sz);
-            ssl->hsHashes->prevLen = ssl->hsHashes->length;
-            ssl->hsHashes->length += sz;
-        }
-    }
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
 
-    return ret;
+    return (word32)((count.QuadPart / freq.QuadPart) * 1000000 +
+                    (count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (word32)now.tv_sec * 1000000 + (word32)(now.tv_nsec / 1000);
+#endif
 }
-#endif /* HAVE_ED25519 && !WOLFSSL_NO_CLIENT_AUTH */
 
-#ifndef NO_CERTS
-int HashOutputRaw(WOLFSSL* ssl, const byte* output, int sz)
+#endif /* WOLFSSL_HANDSHAKE_TIMING || WOLFSSL_HANDSHAKE_ADMISSION */
+
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+
+static void HsTimeAdd(WOLFSSL* ssl, int phase, word32 start)
 {
-    int ret = 0;
+    ssl->hsTiming.usec[phase] += HsTimeNow() - start;
+    ssl->hsTiming.calls[phase]++;
+}
 
-    (void)output;
-    (void)sz;
+/* Handler started. The first handler starts timing the handshake. */
+void HsTimeStart(WOLFSSL* ssl, int funcNum)
+{
+    word32 now = HsTimeNow();
 
-    if (ssl->hsHashes == NULL)
-        return BAD_FUNC_ARG;
+    if (!ssl->hsTimeBegun) {
+        ssl->hsTimeBegin = now;
+        ssl->hsTimeBegun = 1;
+    }
+    ssl->hsTimeStart[funcNum] = now;
+}
 
-#ifdef HAVE_FUZZER
-    if (ssl->fuzzerCb)
-        ssl->fuzzerCb(ssl, output, sz, FUZZ_HASH, ssl->fuzzerCtx);
-#endif
-#ifndef NO_OLD_TLS
-    #ifndef NO_SHA
-        wc_ShaUpdate(&ssl->hsHashes->hashSha, output, sz);
-    #endif
-    #ifndef NO_MD5
-        wc_Md5Update(&ssl->hsHashes->hashMd5, output, sz);
-    #endif
-#endif /* NO_OLD_TLS */
+/* Handler finished. Calls left by an error or a would block are not added. */
+void HsTimeEnd(WOLFSSL* ssl, int funcNum)
+{
+    HsTimeAdd(ssl, funcNum, ssl->hsTimeStart[funcNum]);
+}
 
-    if (IsAtLeastTLSv1_2(ssl)) {
+/* Handshake finished. */
+void HsTimeDone(WOLFSSL* ssl)
+{
+    if (ssl->hsTimeBegun) {
+        HsTimeAdd(ssl, WOLFSSL_HS_TIME_TOTAL, ssl->hsTimeBegin);
+        ssl->hsTimeBegun = 0;
+    }
+}
+
+/* Time spent in an I/O callback during the handshake. The handshake of a
+ * server starts being timed when the first data is received. */
+static void HsTimeIo(WOLFSSL* ssl, int phase, word32 start, int ret)
+{
+    if (ssl->hsTimeBegun)
+        HsTimeAdd(ssl, phase, start);
+    else if (ret > 0 && ssl->options.handShakeState != HANDSHAKE_DONE) {
+        ssl->hsTimeBegin = HsTimeNow();
+        ssl->hsTimeBegun = 1;
+    }
+}
+
+#endif /* WOLFSSL_HANDSHAKE_TIMING */
+
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+/* Allocate the admission control of a server CTX. Nothing is limited until
+ * wolfSSL_CTX_set_handshake_admission() is called.
+ * returns MEMORY_E or BAD_MUTEX_E on failure and 0 on success */
+int InitHsAdmission(WOLFSSL_CTX* ctx, void* heap)
+{
+    HsAdmission* adm;
+
+    adm = (HsAdmission*)XMALLOC(sizeof(HsAdmission), heap, DYNAMIC_TYPE_CTX);
+    if (adm == NULL)
+        return MEMORY_E;
+    XMEMSET(adm, 0, sizeof(HsAdmission));
+
+    if (wc_InitMutex(&adm->lock) != 0) {
+        XFREE(adm, heap, DYNAMIC_TYPE_CTX);
+        return BAD_MUTEX_E;
+    }
+    ctx->admission = adm;
+
+    return 0;
+}
+
+void FreeHsAdmission(WOLFSSL_CTX* ctx)
+{
+    if (ctx->admission == NULL)
+        return;
+
+    wc_FreeMutex(&ctx->admission->lock);
+    XFREE(ctx->admission, ctx->heap, DYNAMIC_TYPE_CTX);
+    ctx->admission = NULL;
+}
+
+/* Too much work running to start another full handshake. With only the
+ * latency limit, one is always let through so the average can come down. */
+static int HsAdmissionBusy(HsAdmission* adm)
+{
+    if (adm->maxInFlight != 0 && adm->stats.inFlight >= adm->maxInFlight)
+        return 1;
+    if (adm->maxLatencyUs != 0 && adm->stats.inFlight > 0 &&
+                                    adm->stats.latencyUs > adm->maxLatencyUs)
+        return 1;
+    return 0;
+}
+
+/* Count a full handshake as running in the admission control of the SSL's
+ * CTX. A reference to the CTX is held until HsAdmitDone() so the count comes
+ * off the same admission control when the SSL has been moved to another CTX.
+ * Called with the admission control locked.
+ * returns 0 on success and BAD_MUTEX_E on failure */
+static int HsAdmitHold(WOLFSSL* ssl, HsAdmission* adm)
+{
+    if (wc_LockMutex(&ssl->ctx->countMutex) != 0)
+        return BAD_MUTEX_E;
+    ssl->ctx->refCount++;
+    wc_UnLockMutex(&ssl->ctx->countMutex);
+
+    adm->stats.inFlight++;
+    adm->stats.fullAdmitted++;
+    ssl->admission = adm;
+    ssl->admitCtx  = ssl->ctx;
+    ssl->admitTime = HsTimeNow();
+
+    return 0;
+}
+
+/* Decide whether a handshake goes ahead once the server knows if the
+ * ClientHello resumes. Called before any key exchange or signing is done for
+ * it. A full handshake that can't start now is either refused or, with
+ * deferring on and not DTLS, left for HsAdmitWait() to hold back before the
+ * server's first flight.
+ * returns 0 to carry on, HANDSHAKE_ADMISSION_E when refused or BAD_MUTEX_E */
+int HsAdmit(WOLFSSL* ssl, int resuming)
+{
+    HsAdmission* adm = ssl->ctx->admission;
+    int          ret = 0;
+
+    if (adm == NULL || ssl->admission != NULL || ssl->options.admitWait)
+        return 0;
+
+    if (wc_LockMutex(&adm->lock) != 0)
+        return BAD_MUTEX_E;
+
+    if (resuming) {
+        adm->stats.resumed++;
+    }
+    else if (!HsAdmissionBusy(adm)) {
+        ret = HsAdmitHold(ssl, adm);
+    }
+    else if (adm->defer && !ssl->options.dtls) {
+        adm->stats.deferred++;
+        ssl->options.admitWait = 1;
+    }
+    else {
+        adm->stats.rejected++;
+        ret = HANDSHAKE_ADMISSION_E;
+    }
+
+    wc_UnLockMutex(&adm->lock);
+
+    if (ret == HANDSHAKE_ADMISSION_E) {
+        WOLFSSL_MSG("Full handshake refused by admission control");
+        SendAlert(ssl, alert_fatal, handshake_failure);
+    }
+
+    return ret;
+}
+
+/* Hold back a deferred full handshake until there is room for it.
+ * returns 0 to carry on, HANDSHAKE_ADMISSION_WANT to be called again later
+ * or BAD_MUTEX_E */
+int HsAdmitWait(WOLFSSL* ssl)
+{
+    HsAdmission* adm = ssl->ctx->admission;
+    int          ret = 0;
+
+    if (adm == NULL || !ssl->options.admitWait)
+        return 0;
+
+    if (wc_LockMutex(&adm->lock) != 0)
+        return BAD_MUTEX_E;
+
+    if (HsAdmissionBusy(adm))
+        ret = HANDSHAKE_ADMISSION_WANT;
+    else if ((ret = HsAdmitHold(ssl, adm)) == 0)
+        ssl->options.admitWait = 0;
+
+    wc_UnLockMutex(&adm->lock);
+
+    return ret;
+}
+
+/* A full handshake stopped running. Only finished ones update the average
+ * time, weighting the new one by 1/8. The count is taken off the admission
+ * control it was added to and the CTX reference is let go. */
+void HsAdmitDone(WOLFSSL* ssl, int done)
+{
+    HsAdmission* adm = ssl->admission;
+    WOLFSSL_CTX* ctx = ssl->admitCtx;
+    word32       took;
+
+    if (adm == NULL)
+        return;
+    ssl->admission = NULL;
+    ssl->admitCtx  = NULL;
+    took = HsTimeNow() - ssl->admitTime;
+
+    if (wc_LockMutex(&adm->lock) == 0) {
+        adm->stats.inFlight--;
+        if (done) {
+            if (adm->stats.completed++ == 0)
+                adm->stats.latencyUs = took;
+            else if (took >= adm->stats.latencyUs)
+                adm->stats.latencyUs += (took - adm->stats.latencyUs) >> 3;
+            else
+                adm->stats.latencyUs -= (adm->stats.latencyUs - took) >> 3;
+        }
+        wc_UnLockMutex(&adm->lock);
+    }
+
+    FreeSSL_Ctx(ctx);
+}
+#endif /* WOLFSSL_HANDSHAKE_ADMISSION */
+
+#if !defined(WOLFSSL_NO_CLIENT_AUTH) && defined(HAVE_ED25519) && \
+                                                !defined(NO_ED25519_CLIENT_AUTH)
+/* Store the message for use with CertificateVerify using Ed25519.
+ *
+ * ssl   SSL/TLS object.
+ * data  Message to store.
+ * sz    Size of message to store.
+ * returns MEMORY_E if not able to reallocate, otherwise 0.
+ */
+static int Ed25519Update(WOLFSSL* ssl, const byte* data, int sz)
+{
+    int   ret = 0;
+    byte* msgs;
+
+    if (ssl->options.cacheMessages) {
+        msgs = (byte*)XREALLOC(ssl->hsHashes->messages,
+                                                ssl->hsHashes->length + sz,
+                                                ssl->heap, DYNAMIC_TYPE_HASHES);
+        if (msgs == NULL)
+            ret = MEMORY_E;
+        if (ret == 0) {
+            ssl->hsHashes->messages = msgs;
+            XMEMCPY(msgs + ssl->hsHashes->length, data, sz);
+            ssl->hsHashes->prevLen = ssl->hsHashes->length;
+            ssl->hsHashes->length += sz;
+        }
+    }
+
+    return ret;
+}
+#endif /* HAVE_ED25519 && !WOLFSSL_NO_CLIENT_AUTH */
+
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+/* Keep handshake message data until the transcript hash is known.
+ *
+ * ssl   The SSL/TLS object.
+ * data  The handshake message data.
+ * sz    The size of the data.
+ * returns 0 on success, otherwise failure.
+ */
+int HashPending(WOLFSSL* ssl, const byte* data, int sz)
+{
+    HS_Hashes* hs = ssl->hsHashes;
+
+    if (sz < 0)
+        return BAD_FUNC_ARG;
+
+    if (hs->pendingSz + sz > hs->pendingMax) {
+        word32 max = hs->pendingMax ? hs->pendingMax * 2 : HS_HASH_PENDING_SZ;
+        byte*  buf;
+
+        if (max < hs->pendingSz + sz)
+            max = hs->pendingSz + sz;
+        buf = (byte*)XMALLOC(max, ssl->heap, DYNAMIC_TYPE_HASHES);
+        if (buf == NULL)
+            return MEMORY_E;
+        if (hs->pending != NULL) {
+            XMEMCPY(buf, hs->pending, hs->pendingSz);
+            XFREE(hs->pending, ssl->heap, DYNAMIC_TYPE_HASHES);
+        }
+        hs->pending = buf;
+        hs->pendingMax = max;
+    }
+    XMEMCPY(hs->pending + hs->pendingSz, data, sz);
+    hs->pendingSz += sz;
+
+    return 0;
+}
+
+/* Transcript hashes needed for the negotiated version and cipher suite.
+ * TLS v1.2 CertificateVerify signs with a hash chosen from the peer's
+ * signature algorithms, so keep them all when one may be sent or received.
+ *
+ * ssl  The SSL/TLS object.
+ * returns the HS_HASH_* mask.
+ */
+byte HashNegotiatedMask(WOLFSSL* ssl)
+{
+    byte mask;
+    int  certVerify;
+
+    if (!IsAtLeastTLSv1_2(ssl))
+        return HS_HASH_MD5 | HS_HASH_SHA;
+
+    switch (ssl->specs.mac_algorithm) {
+        case sha384_mac:
+            mask = HS_HASH_SHA384;
+            break;
+        case sha512_mac:
+            mask = HS_HASH_SHA512;
+            break;
+        default:
+            mask = HS_HASH_SHA256;
+            break;
+    }
+
+    if (IsAtLeastTLSv1_3(ssl->version) || ssl->options.resuming)
+        return mask;
+
+    if (ssl->options.side == WOLFSSL_SERVER_END)
+        certVerify = ssl->options.verifyPeer;
+    else
+        certVerify = ssl->buffers.certificate != NULL &&
+                     ssl->buffers.certificate->buffer != NULL;
+
+    return certVerify ? (byte)HS_HASH_ALL : mask;
+}
+
+/* Instantiate the transcript hashes in mask and feed them the messages kept
+ * so far. Nothing to do when already committed.
+ *
+ * ssl   The SSL/TLS object.
+ * mask  The HS_HASH_* hashes to instantiate.
+ * returns 0 on success, otherwise failure.
+ */
+int HashCommit(WOLFSSL* ssl, byte mask)
+{
+    HS_Hashes* hs;
+    int        ret;
+
+    if (ssl == NULL || ssl->hsHashes == NULL)
+        return BAD_FUNC_ARG;
+
+    hs = ssl->hsHashes;
+    if (!hs->lazy)
+        return 0;
+
+    WOLFSSL_MSG("Committing handshake transcript hashes");
+    hs->lazy = 0;
+    ret = InitHandshakeHashesMask(ssl, mask);
+    if (ret == 0 && hs->pendingSz > 0) {
+    #ifndef NO_OLD_TLS
+        #ifndef NO_SHA
+        if (HS_HASH_ON(ssl, HS_HASH_SHA))
+            ret = wc_ShaUpdate(&hs->hashSha, hs->pending, hs->pendingSz);
+        #endif
+        #ifndef NO_MD5
+        if (ret == 0 && HS_HASH_ON(ssl, HS_HASH_MD5))
+            ret = wc_Md5Update(&hs->hashMd5, hs->pending, hs->pendingSz);
+        #endif
+    #endif
     #ifndef NO_SHA256
-        ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, output, sz);
-        if (ret != 0)
-            return ret;
+        if (ret == 0 && HS_HASH_ON(ssl, HS_HASH_SHA256))
+            ret = wc_Sha256Update(&hs->hashSha256, hs->pending, hs->pendingSz);
     #endif
     #ifdef WOLFSSL_SHA384
-        ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, output, sz);
-        if (ret != 0)
-            return ret;
+        if (ret == 0 && HS_HASH_ON(ssl, HS_HASH_SHA384))
+            ret = wc_Sha384Update(&hs->hashSha384, hs->pending, hs->pendingSz);
     #endif
     #ifdef WOLFSSL_SHA512
-        ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, output, sz);
+        if (ret == 0 && HS_HASH_ON(ssl, HS_HASH_SHA512))
+            ret = wc_Sha512Update(&hs->hashSha512, hs->pending, hs->pendingSz);
+    #endif
+    }
+
+    if (hs->pending != NULL) {
+        XFREE(hs->pending, ssl->heap, DYNAMIC_TYPE_HASHES);
+        hs->pending = NULL;
+    }
+    hs->pendingSz = hs->pendingMax = 0;
+
+    return ret;
+}
+#endif /* WOLFSSL_LAZY_HANDSHAKE_HASH */
+
+#ifndef NO_CERTS
+int HashOutputRaw(WOLFSSL* ssl, const byte* output, int sz)
+{
+    int ret = 0;
+
+    (void)output;
+    (void)sz;
+
+    if (ssl->hsHashes == NULL)
+        return BAD_FUNC_ARG;
+
+#ifdef HAVE_FUZZER
+    if (ssl->fuzzerCb)
+        ssl->fuzzerCb(ssl, output, sz, FUZZ_HASH, ssl->fuzzerCtx);
+#endif
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if (ssl->hsHashes->lazy) {
+        ret = HashPending(ssl, output, sz);
         if (ret != 0)
             return ret;
+    }
+#endif
+#ifndef NO_OLD_TLS
+    #ifndef NO_SHA
+        if (HS_HASH_ON(ssl, HS_HASH_SHA))
+            wc_ShaUpdate(&ssl->hsHashes->hashSha, output, sz);
+    #endif
+    #ifndef NO_MD5
+        if (HS_HASH_ON(ssl, HS_HASH_MD5))
+            wc_Md5Update(&ssl->hsHashes->hashMd5, output, sz);
+    #endif
+#endif /* NO_OLD_TLS */
+
+    if (IsAtLeastTLSv1_2(ssl)) {
+    #ifndef NO_SHA256
+        if (HS_HASH_ON(ssl, HS_HASH_SHA256)) {
+            ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, output, sz);
+            if (ret != 0)
+                return ret;
+        }
+    #endif
+    #ifdef WOLFSSL_SHA384
+        if (HS_HASH_ON(ssl, HS_HASH_SHA384)) {
+            ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, output, sz);
+            if (ret != 0)
+                return ret;
+        }
+    #endif
+    #ifdef WOLFSSL_SHA512
+        if (HS_HASH_ON(ssl, HS_HASH_SHA512)) {
+            ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, output, sz);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #if !defined(WOLFSSL_NO_CLIENT_AUTH) && defined(HAVE_ED25519) && \
                                                 !defined(NO_ED25519_CLIENT_AUTH)
@@ -6626,30 +7311,45 @@ int HashOutput(WOLFSSL* ssl, const byte* output, int sz, int ivSz)
         sz  -= DTLS_RECORD_EXTRA;
     }
 #endif
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if (ssl->hsHashes->lazy) {
+        ret = HashPending(ssl, adj, sz);
+        if (ret != 0)
+            return ret;
+    }
+#endif
 #ifndef NO_OLD_TLS
     #ifndef NO_SHA
-        wc_ShaUpdate(&ssl->hsHashes->hashSha, adj, sz);
+        if (HS_HASH_ON(ssl, HS_HASH_SHA))
+            wc_ShaUpdate(&ssl->hsHashes->hashSha, adj, sz);
     #endif
     #ifndef NO_MD5
-        wc_Md5Update(&ssl->hsHashes->hashMd5, adj, sz);
+        if (HS_HASH_ON(ssl, HS_HASH_MD5))
+            wc_Md5Update(&ssl->hsHashes->hashMd5, adj, sz);
     #endif
 #endif
 
     if (IsAtLeastTLSv1_2(ssl)) {
     #ifndef NO_SHA256
-        ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, adj, sz);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_SHA256)) {
+            ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, adj, sz);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #ifdef WOLFSSL_SHA384
-        ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, adj, sz);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_SHA384)) {
+            ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, adj, sz);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #ifdef WOLFSSL_SHA512
-        ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, adj, sz);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_SHA512)) {
+            ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, adj, sz);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #if !defined(WOLFSSL_NO_CLIENT_AUTH) && defined(HAVE_ED25519) && \
                                                 !defined(NO_ED25519_CLIENT_AUTH)
@@ -6685,30 +7385,45 @@ int HashInput(WOLFSSL* ssl, const byte* input, int sz)
         return BAD_FUNC_ARG;
     }
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if (ssl->hsHashes->lazy) {
+        ret = HashPending(ssl, adj, sz);
+        if (ret != 0)
+            return ret;
+    }
+#endif
 #ifndef NO_OLD_TLS
     #ifndef NO_SHA
-        wc_ShaUpdate(&ssl->hsHashes->hashSha, adj, sz);
+        if (HS_HASH_ON(ssl, HS_HASH_SHA))
+            wc_ShaUpdate(&ssl->hsHashes->hashSha, adj, sz);
     #endif
     #ifndef NO_MD5
-        wc_Md5Update(&ssl->hsHashes->hashMd5, adj, sz);
+        if (HS_HASH_ON(ssl, HS_HASH_MD5))
+            wc_Md5Update(&ssl->hsHashes->hashMd5, adj, sz);
     #endif
 #endif
 
     if (IsAtLeastTLSv1_2(ssl)) {
     #ifndef NO_SHA256
-        ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, adj, sz);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_SHA256)) {
+            ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, adj, sz);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #ifdef WOLFSSL_SHA384
-        ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, adj, sz);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_SHA384)) {
+            ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, adj, sz);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #ifdef WOLFSSL_SHA512
-        ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, adj, sz);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_SHA512)) {
+            ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, adj, sz);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #if !defined(WOLFSSL_NO_CLIENT_AUTH) && defined(HAVE_ED25519) && \
                                                 !defined(NO_ED25519_CLIENT_AUTH)
@@ -6849,6 +7564,9 @@ static void AddFragHeaders(byte* output, word32 fragSz, word32 fragOffset,
 static int wolfSSLReceive(WOLFSSL* ssl, byte* buf, word32 sz)
 {
     int recvd;
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+    word32 ioStart = 0;
+#endif
 
     if (ssl->CBIORecv == NULL) {
         WOLFSSL_MSG("Your IO Recv callback is null, please set");
@@ -6856,7 +7574,15 @@ static int wolfSSLReceive(WOLFSSL* ssl, byte* buf, word32 sz)
     }
 
 retry:
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+    if (ssl->options.handShakeState != HANDSHAKE_DONE)
+        ioStart = HsTimeNow();
+#endif
     recvd = ssl->CBIORecv(ssl, (char *)buf, (int)sz, ssl->IOCB_ReadCtx);
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+    if (ssl->options.handShakeState != HANDSHAKE_DONE)
+        HsTimeIo(ssl, WOLFSSL_HS_TIME_IO_READ, ioStart, recvd);
+#endif
     if (recvd < 0)
         switch (recvd) {
             case WOLFSSL_CBIO_ERR_GENERAL:        /* general/unknown error */
@@ -6918,12 +7644,589 @@ retry:
 }
 
 
-/* Switch dynamic output buffer back to static, buffer is assumed clear */
-void ShrinkOutputBuffer(WOLFSSL* ssl)
-{
-    WOLFSSL_MSG("Shrinking output buffer\n");
-    XFREE(ssl->buffers.outputBuffer.buffer - ssl->buffers.outputBuffer.offset,
-          ssl->heap, DYNAMIC_TYPE_OUT_BUFFER);
+#ifdef WOLFSSL_BUFFER_POOL
+
+/* Shared pool of input/output buffers.
+ * Buffers come in size classes, from WOLFSSL_BUFFER_POOL_MIN_SZ doubling up to
+ * WOLFSSL_BUFFER_POOL_SZ, so that short records don't hold a full record sized
+ * buffer. Free buffers are kept on a singly linked list per size class, the
+ * next pointer is stored in the buffer itself. The pool is split into shards
+ * and each thread sticks to one shard so that threads rarely contend for the
+ * same lock. */
+typedef struct BufferPoolShard {
+    wolfSSL_Mutex mutex;
+    byte*         head[WOLFSSL_BUFFER_POOL_CLASSES];  /* first free buffer */
+    word32        count[WOLFSSL_BUFFER_POOL_CLASSES]; /* number of free buffers */
+} BufferPoolShard;
+
+static BufferPoolShard bufferPool[WOLFSSL_BUFFER_POOL_SHARDS];
+static int bufferPoolInit = 0;
+#if defined(HAVE_THREAD_LS) && WOLFSSL_BUFFER_POOL_SHARDS > 1
+static THREAD_LS_T int bufferPoolShard = -1;
+static word32 bufferPoolNextShard = 0;
+#endif
+
+
+/* Initialize the shared buffer pool, called from wolfSSL_Init() */
+int InitBufferPool(void)
+{
+    int i;
+
+    if (bufferPoolInit)
+        return 0;
+
+    for (i = 0; i < WOLFSSL_BUFFER_POOL_SHARDS; i++) {
+        if (wc_InitMutex(&bufferPool[i].mutex) != 0) {
+            WOLFSSL_MSG("Bad Init Mutex buffer pool");
+            while (--i >= 0)
+                wc_FreeMutex(&bufferPool[i].mutex);
+            return BAD_MUTEX_E;
+        }
+        XMEMSET(bufferPool[i].head, 0, sizeof(bufferPool[i].head));
+        XMEMSET(bufferPool[i].count, 0, sizeof(bufferPool[i].count));
+    }
+    bufferPoolInit = 1;
+
+    return 0;
+}
+
+
+/* Free all the buffers in the shared pool, called from wolfSSL_Cleanup() */
+void FreeBufferPool(void)
+{
+    int i;
+    int c;
+
+    if (!bufferPoolInit)
+        return;
+    bufferPoolInit = 0;
+
+    for (i = 0; i < WOLFSSL_BUFFER_POOL_SHARDS; i++) {
+        for (c = 0; c < WOLFSSL_BUFFER_POOL_CLASSES; c++) {
+            byte* buf = bufferPool[i].head[c];
+
+            while (buf != NULL) {
+                byte* next = *(byte**)buf;
+                XFREE(buf, NULL, DYNAMIC_TYPE_IN_BUFFER);
+                buf = next;
+            }
+            bufferPool[i].head[c]  = NULL;
+            bufferPool[i].count[c] = 0;
+        }
+        wc_FreeMutex(&bufferPool[i].mutex);
+    }
+}
+
+
+/* Get the pool shard for the calling thread */
+static BufferPoolShard* GetBufferPoolShard(void)
+{
+#if defined(HAVE_THREAD_LS) && WOLFSSL_BUFFER_POOL_SHARDS > 1
+    if (bufferPoolShard < 0) {
+        if (wc_LockMutex(&bufferPool[0].mutex) != 0)
+            return &bufferPool[0];
+        bufferPoolShard = (int)(bufferPoolNextShard++ %
+                                WOLFSSL_BUFFER_POOL_SHARDS);
+        wc_UnLockMutex(&bufferPool[0].mutex);
+    }
+    return &bufferPool[bufferPoolShard];
+#else
+    return &bufferPool[0];
+#endif
+}
+
+
+/* Size of the buffers in a size class of the pool */
+static word32 BufferPoolClassSz(int c)
+{
+    if (c == WOLFSSL_BUFFER_POOL_CLASSES - 1)
+        return WOLFSSL_BUFFER_POOL_SZ;
+    return (word32)WOLFSSL_BUFFER_POOL_MIN_SZ << c;
+}
+
+
+/* Allocate memory for an input or output buffer.
+ * Buffers small enough come from the shared pool when the SSL object uses the
+ * default heap. The buffer is from the smallest size class that holds sz.
+ *
+ * ssl     The SSL/TLS object.
+ * sz      Number of bytes required.
+ * type    Dynamic memory type.
+ * pooled  Set to the size class + 1 when the buffer is from the pool and 0
+ *         otherwise.
+ * returns the buffer or NULL on failure.
+ */
+static byte* AllocIOBuffer(WOLFSSL* ssl, word32 sz, int type, byte* pooled)
+{
+    byte* buf = NULL;
+    int   c;
+
+    *pooled = 0;
+    if (!bufferPoolInit || ssl->heap != NULL || sz > WOLFSSL_BUFFER_POOL_SZ)
+        return (byte*)XMALLOC(sz, ssl->heap, type);
+
+    for (c = 0; c < WOLFSSL_BUFFER_POOL_CLASSES - 1; c++) {
+        if (sz <= BufferPoolClassSz(c))
+            break;
+    }
+
+    {
+        BufferPoolShard* shard = GetBufferPoolShard();
+
+        if (wc_LockMutex(&shard->mutex) == 0) {
+            buf = shard->head[c];
+            if (buf != NULL) {
+                shard->head[c] = *(byte**)buf;
+                shard->count[c]--;
+            }
+            wc_UnLockMutex(&shard->mutex);
+        }
+    }
+    if (buf == NULL)
+        buf = (byte*)XMALLOC(BufferPoolClassSz(c), NULL, type);
+    if (buf != NULL)
+        *pooled = (byte)(c + 1);
+
+    return buf;
+}
+
+
+/* Free the memory of an input or output buffer, pooled buffers go back to the
+ * pool unless their size class is full.
+ *
+ * ssl     The SSL/TLS object.
+ * buf     Start of the allocated memory.
+ * type    Dynamic memory type.
+ * pooled  Size class + 1 of a buffer from the pool, 0 otherwise.
+ */
+static void FreeIOBuffer(WOLFSSL* ssl, byte* buf, int type, byte pooled)
+{
+    (void)ssl;
+    (void)type;
+
+    if (pooled && bufferPoolInit) {
+        BufferPoolShard* shard = GetBufferPoolShard();
+        int              c = pooled - 1;
+
+        if (wc_LockMutex(&shard->mutex) == 0) {
+            if (shard->count[c] < WOLFSSL_BUFFER_POOL_MAX) {
+                *(byte**)buf = shard->head[c];
+                shard->head[c] = buf;
+                shard->count[c]++;
+                buf = NULL;
+            }
+            wc_UnLockMutex(&shard->mutex);
+        }
+        if (buf != NULL)
+            XFREE(buf, NULL, type);
+        return;
+    }
+
+    XFREE(buf, ssl->heap, type);
+}
+
+#endif /* WOLFSSL_BUFFER_POOL */
+
+
+#ifdef WOLFSSL_KEY_SHARE_POOL
+
+#if defined(SINGLE_THREADED) || !defined(HAVE_PTHREAD)
+    #error The key share pool requires POSIX threads
+#endif
+#if !defined(HAVE_CURVE25519) && (!defined(HAVE_ECC) || \
+                    (defined(NO_ECC256) && !defined(HAVE_ALL_CURVES)))
+    #error The key share pool requires X25519 or P-256
+#endif
+
+#include <pthread.h>
+#include <time.h>
+
+#define KEY_SHARE_POOL_PRIV_SZ  32
+#define KEY_SHARE_POOL_PUB_SZ   65      /* uncompressed P-256 point */
+
+/* Seconds to wait before generating again for a group that failed, doubled
+ * on each failure up to the maximum. */
+#ifndef KEY_SHARE_POOL_RETRY_MIN
+    #define KEY_SHARE_POOL_RETRY_MIN  1
+#endif
+#ifndef KEY_SHARE_POOL_RETRY_MAX
+    #define KEY_SHARE_POOL_RETRY_MAX  64
+#endif
+
+/* Groups with a pool of key pairs */
+enum {
+    KEY_SHARE_POOL_X25519 = 0,
+    KEY_SHARE_POOL_P256   = 1,
+    KEY_SHARE_POOL_CNT
+};
+
+/* A pre-generated ephemeral key pair, kept as raw bytes so that any key object
+ * can take it regardless of the math library */
+typedef struct KeySharePoolEntry {
+    byte   priv[KEY_SHARE_POOL_PRIV_SZ];
+    byte   pub[KEY_SHARE_POOL_PUB_SZ];
+} KeySharePoolEntry;
+
+/* Shared pool of ephemeral key pairs refilled by a background thread.
+ * Each key pair is handed out once and then replaced. */
+static struct {
+    pthread_mutex_t   mutex;
+    pthread_cond_t    cond;        /* signals the refill thread */
+    pthread_t         thread;
+    KeySharePoolEntry entry[KEY_SHARE_POOL_CNT][WOLFSSL_KEY_SHARE_POOL_SZ];
+    word32            count[KEY_SHARE_POOL_CNT];
+    byte              off[KEY_SHARE_POOL_CNT]; /* group not compiled in */
+    time_t            retry[KEY_SHARE_POOL_CNT]; /* after failure, time to
+                                                  * generate again */
+    word32            backoff[KEY_SHARE_POOL_CNT]; /* seconds, 0 when last
+                                                    * generate succeeded */
+    word32            hits;
+    word32            misses;
+    byte              stop;
+    byte              running;     /* refill thread started */
+} keySharePool;
+static int keySharePoolInit = 0;
+static int keySharePoolAtFork = 0;
+
+
+/* Generate a key pair of a pooled group.
+ *
+ * rng    Random number generator of the refill thread.
+ * group  Index of the group's pool.
+ * kpe    Entry to hold the key pair.
+ * returns 0 on success, otherwise failure.
+ */
+static int KeySharePoolGenerate(WC_RNG* rng, int group, KeySharePoolEntry* kpe)
+{
+    int    ret = NOT_COMPILED_IN;
+    word32 privSz = KEY_SHARE_POOL_PRIV_SZ;
+    word32 pubSz = KEY_SHARE_POOL_PUB_SZ;
+
+    if (group == KEY_SHARE_POOL_X25519) {
+#ifdef HAVE_CURVE25519
+        curve25519_key key;
+
+        ret = wc_curve25519_init(&key);
+        if (ret == 0) {
+            ret = wc_curve25519_make_key(rng, CURVE25519_KEYSIZE, &key);
+            if (ret == 0) {
+                ret = wc_curve25519_export_key_raw_ex(&key, kpe->priv, &privSz,
+                                         kpe->pub, &pubSz, EC25519_LITTLE_ENDIAN);
+            }
+            wc_curve25519_free(&key);
+        }
+#endif
+    }
+    else {
+#if defined(HAVE_ECC) && (!defined(NO_ECC256) || defined(HAVE_ALL_CURVES))
+        ecc_key key;
+
+        ret = wc_ecc_init_ex(&key, NULL, INVALID_DEVID);
+        if (ret == 0) {
+            ret = wc_ecc_make_key_ex(rng, 32, &key, ECC_SECP256R1);
+            if (ret == 0)
+                ret = wc_ecc_export_private_only(&key, kpe->priv, &privSz);
+            if (ret == 0)
+                ret = wc_ecc_export_x963(&key, kpe->pub, &pubSz);
+            wc_ecc_free(&key);
+        }
+#endif
+    }
+
+    return ret;
+}
+
+
+/* Refill thread: keeps the pool of every group full */
+static void* KeySharePoolRefill(void* arg)
+{
+    WC_RNG            rng;
+    KeySharePoolEntry kpe;
+    int               group;
+    time_t            now;
+    time_t            wake;
+
+    (void)arg;
+
+    if (wc_InitRng(&rng) != 0) {
+        WOLFSSL_MSG("Key share pool RNG init failed");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&keySharePool.mutex);
+    while (!keySharePool.stop) {
+        now = time(NULL);
+        wake = 0;
+        for (group = 0; group < KEY_SHARE_POOL_CNT; group++) {
+            if (keySharePool.off[group] ||
+                        keySharePool.count[group] >= WOLFSSL_KEY_SHARE_POOL_SZ)
+                continue;
+            if (keySharePool.retry[group] <= now)
+                break;
+            if (wake == 0 || keySharePool.retry[group] < wake)
+                wake = keySharePool.retry[group];
+        }
+        if (group == KEY_SHARE_POOL_CNT) {
+            if (wake == 0) {
+                pthread_cond_wait(&keySharePool.cond, &keySharePool.mutex);
+            }
+            else {
+                struct timespec ts;
+
+                ts.tv_sec = wake;
+                ts.tv_nsec = 0;
+                pthread_cond_timedwait(&keySharePool.cond, &keySharePool.mutex,
+                                       &ts);
+            }
+            continue;
+        }
+
+        /* Generate without holding the lock. */
+        pthread_mutex_unlock(&keySharePool.mutex);
+        if (KeySharePoolGenerate(&rng, group, &kpe) != 0) {
+            /* Try the group again later, waiting longer each time. */
+            WOLFSSL_MSG("Key share pool generate failed");
+            pthread_mutex_lock(&keySharePool.mutex);
+            if (keySharePool.backoff[group] == 0)
+                keySharePool.backoff[group] = KEY_SHARE_POOL_RETRY_MIN;
+            else if (keySharePool.backoff[group] < KEY_SHARE_POOL_RETRY_MAX)
+                keySharePool.backoff[group] *= 2;
+            keySharePool.retry[group] = time(NULL) +
+                                        (time_t)keySharePool.backoff[group];
+            continue;
+        }
+        pthread_mutex_lock(&keySharePool.mutex);
+        keySharePool.backoff[group] = 0;
+        keySharePool.retry[group] = 0;
+
+        if (keySharePool.count[group] < WOLFSSL_KEY_SHARE_POOL_SZ) {
+            XMEMCPY(&keySharePool.entry[group][keySharePool.count[group]++],
+                    &kpe, sizeof(kpe));
+        }
+    }
+    pthread_mutex_unlock(&keySharePool.mutex);
+
+    ForceZero(&kpe, sizeof(kpe));
+    wc_FreeRng(&rng);
+
+    return NULL;
+}
+
+
+/* Start the refill thread. Called with the pool locked or before it is in
+ * use. */
+static int KeySharePoolStart(void)
+{
+    if (pthread_create(&keySharePool.thread, NULL, KeySharePoolRefill,
+                                                                 NULL) != 0) {
+        WOLFSSL_MSG("Key share pool thread create failed");
+        return MEMORY_E;
+    }
+    keySharePool.running = 1;
+
+    return 0;
+}
+
+
+/* fork() handlers: the pool is locked over the fork so that the child gets it
+ * in a consistent state. */
+static void KeySharePoolForkPrepare(void)
+{
+    if (keySharePoolInit)
+        pthread_mutex_lock(&keySharePool.mutex);
+}
+
+static void KeySharePoolForkParent(void)
+{
+    if (keySharePoolInit)
+        pthread_mutex_unlock(&keySharePool.mutex);
+}
+
+/* The child must not hand out the key pairs the parent still has and has no
+ * refill thread. Wipe the pool and start a thread on first use. */
+static void KeySharePoolForkChild(void)
+{
+    if (!keySharePoolInit)
+        return;
+
+    ForceZero(keySharePool.entry, sizeof(keySharePool.entry));
+    XMEMSET(keySharePool.count, 0, sizeof(keySharePool.count));
+    XMEMSET(keySharePool.retry, 0, sizeof(keySharePool.retry));
+    XMEMSET(keySharePool.backoff, 0, sizeof(keySharePool.backoff));
+    keySharePool.hits = 0;
+    keySharePool.misses = 0;
+    keySharePool.running = 0;
+    pthread_mutex_init(&keySharePool.mutex, NULL);
+    pthread_cond_init(&keySharePool.cond, NULL);
+}
+
+
+/* Start the shared key share pool, called from wolfSSL_Init() */
+int InitKeySharePool(void)
+{
+    int ret;
+
+    if (keySharePoolInit)
+        return 0;
+
+    if (!keySharePoolAtFork) {
+        if (pthread_atfork(KeySharePoolForkPrepare, KeySharePoolForkParent,
+                           KeySharePoolForkChild) != 0) {
+            WOLFSSL_MSG("Key share pool fork handlers failed");
+            return MEMORY_E;
+        }
+        keySharePoolAtFork = 1;
+    }
+
+    XMEMSET(&keySharePool, 0, sizeof(keySharePool));
+    if (pthread_mutex_init(&keySharePool.mutex, NULL) != 0)
+        return BAD_MUTEX_E;
+    if (pthread_cond_init(&keySharePool.cond, NULL) != 0) {
+        pthread_mutex_destroy(&keySharePool.mutex);
+        return BAD_MUTEX_E;
+    }
+#ifndef HAVE_CURVE25519
+    keySharePool.off[KEY_SHARE_POOL_X25519] = 1;
+#endif
+#if !defined(HAVE_ECC) || (defined(NO_ECC256) && !defined(HAVE_ALL_CURVES))
+    keySharePool.off[KEY_SHARE_POOL_P256] = 1;
+#endif
+    ret = KeySharePoolStart();
+    if (ret != 0) {
+        pthread_cond_destroy(&keySharePool.cond);
+        pthread_mutex_destroy(&keySharePool.mutex);
+        return ret;
+    }
+    keySharePoolInit = 1;
+
+    return 0;
+}
+
+
+/* Stop the refill thread and wipe the unused key pairs, called from
+ * wolfSSL_Cleanup() */
+void FreeKeySharePool(void)
+{
+    if (!keySharePoolInit)
+        return;
+    keySharePoolInit = 0;
+
+    pthread_mutex_lock(&keySharePool.mutex);
+    keySharePool.stop = 1;
+    pthread_cond_signal(&keySharePool.cond);
+    pthread_mutex_unlock(&keySharePool.mutex);
+    if (keySharePool.running)
+        pthread_join(keySharePool.thread, NULL);
+
+    pthread_cond_destroy(&keySharePool.cond);
+    pthread_mutex_destroy(&keySharePool.mutex);
+    ForceZero(keySharePool.entry, sizeof(keySharePool.entry));
+}
+
+
+/* Take a pre-generated key pair for the named group out of the pool.
+ * Objects using a crypto device make their own keys.
+ *
+ * ssl    The SSL/TLS object.
+ * group  Named group of the key.
+ * key    Initialized curve25519_key or ecc_key to set the key pair into.
+ * returns 0 when the key was set and otherwise the key must be generated.
+ */
+int KeySharePoolGet(WOLFSSL* ssl, word16 group, void* key)
+{
+    KeySharePoolEntry kpe;
+    int               idx;
+    int               ret = -1;
+
+    if (!keySharePoolInit || ssl->devId != INVALID_DEVID)
+        return -1;
+
+    if (group == WOLFSSL_ECC_X25519)
+        idx = KEY_SHARE_POOL_X25519;
+    else if (group == WOLFSSL_ECC_SECP256R1)
+        idx = KEY_SHARE_POOL_P256;
+    else
+        return -1;
+
+    pthread_mutex_lock(&keySharePool.mutex);
+    /* in a forked child, until the first key is wanted */
+    if (!keySharePool.running && !keySharePool.stop)
+        (void)KeySharePoolStart();
+    if (keySharePool.count[idx] > 0 && !keySharePool.stop) {
+        KeySharePoolEntry* e;
+
+        e = &keySharePool.entry[idx][--keySharePool.count[idx]];
+
+        XMEMCPY(&kpe, e, sizeof(kpe));
+        ForceZero(e, sizeof(*e));
+        keySharePool.hits++;
+        ret = 0;
+    }
+    else
+        keySharePool.misses++;
+    pthread_cond_signal(&keySharePool.cond);
+    pthread_mutex_unlock(&keySharePool.mutex);
+
+    if (ret != 0)
+        return ret;
+
+    if (idx == KEY_SHARE_POOL_X25519) {
+#ifdef HAVE_CURVE25519
+        ret = wc_curve25519_import_private_raw_ex(kpe.priv,
+                     CURVE25519_KEYSIZE, kpe.pub, CURVE25519_KEYSIZE,
+                     (curve25519_key*)key, EC25519_LITTLE_ENDIAN);
+#endif
+    }
+    else {
+#ifdef HAVE_ECC
+        ret = wc_ecc_import_private_key_ex(kpe.priv, KEY_SHARE_POOL_PRIV_SZ,
+                 kpe.pub, KEY_SHARE_POOL_PUB_SZ, (ecc_key*)key, ECC_SECP256R1);
+#endif
+    }
+    ForceZero(&kpe, sizeof(kpe));
+
+    return ret;
+}
+
+
+/* Get the number of key pairs taken from the pool and the number of times the
+ * pool was empty. */
+void KeySharePoolStats(word32* hits, word32* misses)
+{
+    *hits = 0;
+    *misses = 0;
+    if (!keySharePoolInit)
+        return;
+
+    pthread_mutex_lock(&keySharePool.mutex);
+    *hits = keySharePool.hits;
+    *misses = keySharePool.misses;
+    pthread_mutex_unlock(&keySharePool.mutex);
+}
+
+#endif /* WOLFSSL_KEY_SHARE_POOL */
+
+
+/* Free the dynamic memory of the input or output buffer */
+static WC_INLINE void FreeDynamicBuffer(WOLFSSL* ssl, bufferStatic* buf,
+                                        int type)
+{
+#ifdef WOLFSSL_BUFFER_POOL
+    FreeIOBuffer(ssl, buf->buffer - buf->offset, type, buf->pooled);
+    buf->pooled = 0;
+#else
+    XFREE(buf->buffer - buf->offset, ssl->heap, type);
+    (void)ssl;
+    (void)type;
+#endif
+}
+
+
+/* Switch dynamic output buffer back to static, buffer is assumed clear */
+void ShrinkOutputBuffer(WOLFSSL* ssl)
+{
+    WOLFSSL_MSG("Shrinking output buffer\n");
+    FreeDynamicBuffer(ssl, &ssl->buffers.outputBuffer, DYNAMIC_TYPE_OUT_BUFFER);
     ssl->buffers.outputBuffer.buffer = ssl->buffers.outputBuffer.staticBuffer;
     ssl->buffers.outputBuffer.bufferSize  = STATIC_BUFFER_LEN;
     ssl->buffers.outputBuffer.dynamicFlag = 0;
@@ -6940,6 +8243,16 @@ void ShrinkInputBuffer(WOLFSSL* ssl, int forcedFree)
     if (!forcedFree && usedLength > STATIC_BUFFER_LEN)
         return;
 
+#ifdef WOLFSSL_READ_AHEAD
+    /* keep any records held past the current one and, unless releasing
+     * buffers when idle, the read ahead buffer for the next records */
+    if (!forcedFree && ssl->buffers.inputAheadSz > 0)
+        return;
+    if (!forcedFree && ssl->options.readAheadSz > 0 &&
+                                                !ssl->options.releaseBuffers)
+        return;
+#endif
+
     WOLFSSL_MSG("Shrinking input buffer\n");
 
     if (!forcedFree && usedLength > 0)
@@ -6947,15 +8260,221 @@ void ShrinkInputBuffer(WOLFSSL* ssl, int forcedFree)
                ssl->buffers.inputBuffer.buffer + ssl->buffers.inputBuffer.idx,
                usedLength);
 
-    XFREE(ssl->buffers.inputBuffer.buffer - ssl->buffers.inputBuffer.offset,
-          ssl->heap, DYNAMIC_TYPE_IN_BUFFER);
-    ssl->buffers.inputBuffer.buffer = ssl->buffers.inputBuffer.staticBuffer;
-    ssl->buffers.inputBuffer.bufferSize  = STATIC_BUFFER_LEN;
-    ssl->buffers.inputBuffer.dynamicFlag = 0;
-    ssl->buffers.inputBuffer.offset      = 0;
-    ssl->buffers.inputBuffer.idx = 0;
-    ssl->buffers.inputBuffer.length = usedLength;
+    FreeDynamicBuffer(ssl, &ssl->buffers.inputBuffer, DYNAMIC_TYPE_IN_BUFFER);
+    ssl->buffers.inputBuffer.buffer = ssl->buffers.inputBuffer.staticBuffer;
+    ssl->buffers.inputBuffer.bufferSize  = STATIC_BUFFER_LEN;
+    ssl->buffers.inputBuffer.dynamicFlag = 0;
+    ssl->buffers.inputBuffer.offset      = 0;
+    ssl->buffers.inputBuffer.idx = 0;
+    ssl->buffers.inputBuffer.length = usedLength;
+}
+
+#ifdef WOLFSSL_KTLS
+/* Hand the current record keys for one side to the kernel.
+ *
+ * ssl   The SSL/TLS object.
+ * side  ENCRYPT_SIDE_ONLY for sent records or DECRYPT_SIDE_ONLY for received.
+ * returns 0 on success and SOCKET_ERROR_E when the kernel rejects the keys.
+ */
+int KTLS_SetKeys(WOLFSSL* ssl, int side)
+{
+    int         rx = (side == DECRYPT_SIDE_ONLY);
+    int         clientKeys = (ssl->options.side == WOLFSSL_CLIENT_END) != rx;
+    const byte* key = clientKeys ? ssl->keys.client_write_key :
+                                   ssl->keys.server_write_key;
+    byte        iv[AESGCM_NONCE_SZ];
+    byte        seq[SEQ_SZ];
+    int         ret;
+
+    XMEMCPY(iv, clientKeys ? ssl->keys.client_write_IV :
+                             ssl->keys.server_write_IV, AESGCM_NONCE_SZ);
+#ifndef WOLFSSL_NO_TLS12
+    /* TLS v1.2 AES-GCM sends an explicit nonce, carry on from the last one */
+    if (!rx && !ssl->options.tls1_3 &&
+                       ssl->specs.bulk_cipher_algorithm == wolfssl_aes_gcm) {
+    #if (!defined(HAVE_FIPS) && !defined(HAVE_SELFTEST)) || \
+        (defined(HAVE_FIPS_VERSION) && (HAVE_FIPS_VERSION >= 2))
+        XMEMCPY(iv, ssl->encrypt.aes->reg, AESGCM_NONCE_SZ);
+    #else
+        XMEMCPY(iv + AESGCM_IMP_IV_SZ, ssl->keys.aead_exp_IV,
+                AESGCM_EXP_IV_SZ);
+    #endif
+    }
+#endif
+
+    if (rx) {
+        c32toa(ssl->keys.peer_sequence_number_hi, seq);
+        c32toa(ssl->keys.peer_sequence_number_lo, seq + OPAQUE32_LEN);
+    }
+    else {
+        c32toa(ssl->keys.sequence_number_hi, seq);
+        c32toa(ssl->keys.sequence_number_lo, seq + OPAQUE32_LEN);
+    }
+
+    ret = wolfIO_KtlsSetKey(rx ? ssl->rfd : ssl->wfd, rx, ssl->options.tls1_3,
+                            ssl->specs.bulk_cipher_algorithm, key,
+                            ssl->specs.key_size, iv, seq);
+    ForceZero(iv, sizeof(iv));
+
+    return (ret == 0) ? 0 : SOCKET_ERROR_E;
+}
+
+/* Move record protection into the kernel once the handshake is done, if
+ * requested and possible. Otherwise wolfSSL carries on processing records.
+ *
+ * ssl  The SSL/TLS object.
+ */
+void KTLS_Enable(WOLFSSL* ssl)
+{
+    WOLFSSL_ENTER("KTLS_Enable");
+
+    if (!ssl->options.useKtls || ssl->options.ktlsTx || ssl->options.ktlsRx ||
+            ssl->options.ktlsTxPending || ssl->options.ktlsRxPending)
+        return;
+
+    /* the kernel needs a TCP socket it can read and write itself */
+    if (ssl->options.dtls || ssl->CBIORecv != EmbedReceive ||
+                             ssl->CBIOSend != EmbedSend ||
+                             ssl->rfd != ssl->wfd) {
+        WOLFSSL_MSG("kTLS needs the default I/O callbacks on one socket");
+        return;
+    }
+    if (ssl->specs.cipher_type != aead ||
+            (ssl->specs.bulk_cipher_algorithm != wolfssl_aes_gcm &&
+             ssl->specs.bulk_cipher_algorithm != wolfssl_chacha)
+    #ifdef HAVE_POLY1305
+            || ssl->options.oldPoly
+    #endif
+            ) {
+        WOLFSSL_MSG("Cipher suite not supported by kTLS");
+        return;
+    }
+    if (ssl->options.usingCompression) {
+        WOLFSSL_MSG("kTLS doesn't do compression");
+        return;
+    }
+#ifdef HAVE_MAX_FRAGMENT
+    if (ssl->max_fragment < MAX_RECORD_SIZE) {
+        WOLFSSL_MSG("kTLS doesn't do a maximum fragment length");
+        return;
+    }
+#endif
+#ifdef HAVE_RECORD_SIZE_LIMIT
+    if (ssl->peerRecordSizeLimit != 0 &&
+            (ssl->peerRecordSizeLimit < MAX_RECORD_SIZE ||
+             (ssl->recordSizeLimit != 0 &&
+              ssl->recordSizeLimit < MAX_RECORD_SIZE))) {
+        WOLFSSL_MSG("kTLS doesn't do a record size limit");
+        return;
+    }
+#endif
+#ifdef HAVE_SECURE_RENEGOTIATION
+    if (ssl->secure_renegotiation && ssl->secure_renegotiation->enabled) {
+        WOLFSSL_MSG("kTLS can't renegotiate");
+        return;
+    }
+#endif
+
+    if (wolfIO_KtlsInit(ssl->wfd) != 0)
+        return;
+
+    ssl->options.ktlsTxPending = 1;
+    ssl->options.ktlsRxPending = 1;
+    KTLS_EnablePending(ssl);
+
+    WOLFSSL_LEAVE("KTLS_Enable", ssl->options.ktlsTx | ssl->options.ktlsRx);
+}
+
+/* Hand each side still waiting to the kernel once wolfSSL holds no records for
+ * it. Called when offload is enabled, when the output buffer has been sent and
+ * before reading the next record.
+ *
+ * ssl  The SSL/TLS object.
+ */
+void KTLS_EnablePending(WOLFSSL* ssl)
+{
+    /* unsent data is protected with the keys it was built for */
+    if (ssl->options.ktlsTxPending && ssl->buffers.outputBuffer.length == 0) {
+        ssl->options.ktlsTxPending = 0;
+        if (KTLS_SetKeys(ssl, ENCRYPT_SIDE_ONLY) == 0)
+            ssl->options.ktlsTx = 1;
+    }
+    /* data already read is decrypted by wolfSSL */
+    if (ssl->options.ktlsRxPending &&
+            ssl->buffers.inputBuffer.idx == ssl->buffers.inputBuffer.length &&
+    #ifdef WOLFSSL_READ_AHEAD
+            ssl->buffers.inputAheadSz == 0 &&
+    #endif
+            ssl->options.processReply == doProcessInit) {
+        ssl->options.ktlsRxPending = 0;
+        if (KTLS_SetKeys(ssl, DECRYPT_SIDE_ONLY) == 0)
+            ssl->options.ktlsRx = 1;
+    }
+}
+
+/* Build a record for the kernel to encrypt. The record header is kept in the
+ * output buffer to delimit records and is not sent.
+ *
+ * returns the size of the record or negative on error.
+ */
+int KTLS_BuildMessage(WOLFSSL* ssl, byte* output, int outSz,
+                      const byte* input, int inSz, int type, int hashOutput,
+                      int sizeOnly)
+{
+    int ret;
+
+    if (sizeOnly)
+        return RECORD_HEADER_SZ + inSz;
+    if (output == NULL || input == NULL)
+        return BAD_FUNC_ARG;
+    if (RECORD_HEADER_SZ + inSz > outSz) {
+        WOLFSSL_MSG("Oops, want to write past output buffer size");
+        return BUFFER_E;
+    }
+
+    if (input != output + RECORD_HEADER_SZ)
+        XMEMMOVE(output + RECORD_HEADER_SZ, input, inSz);
+    AddRecordHeader(output, (word32)inSz, (byte)type, ssl);
+
+    if (type == handshake && hashOutput) {
+        ret = HashOutput(ssl, output, RECORD_HEADER_SZ + inSz, 0);
+        if (ret != 0)
+            return ret;
+    }
+
+    return RECORD_HEADER_SZ + inSz;
+}
+
+/* Send the data of the record at the front of the output buffer.
+ * On a partial send the header is moved up to the unsent data.
+ *
+ * returns the number of output buffer bytes done with or a
+ * WOLFSSL_CBIO_ERR_* value.
+ */
+static int KTLS_Send(WOLFSSL* ssl)
+{
+    byte*  rec = ssl->buffers.outputBuffer.buffer +
+                 ssl->buffers.outputBuffer.idx;
+    byte   type = rec[0];
+    word16 len;
+    int    sent;
+
+    ato16(rec + ENUM_LEN + VERSION_SZ, &len);
+    if ((word32)(RECORD_HEADER_SZ + len) > ssl->buffers.outputBuffer.length)
+        return WOLFSSL_CBIO_ERR_GENERAL;
+
+    sent = EmbedKtlsSend(ssl, (char*)rec + RECORD_HEADER_SZ, len, type);
+    if (sent < 0)
+        return sent;
+
+    if (sent < len) {
+        AddRecordHeader(rec + sent, (word32)(len - sent), type, ssl);
+        return sent;
+    }
+
+    return RECORD_HEADER_SZ + len;
 }
+#endif /* WOLFSSL_KTLS */
 
 int SendBuffered(WOLFSSL* ssl)
 {
@@ -6973,11 +8492,27 @@ int SendBuffered(WOLFSSL* ssl)
 #endif
 
     while (ssl->buffers.outputBuffer.length > 0) {
-        int sent = ssl->CBIOSend(ssl,
+        int sent;
+    #ifdef WOLFSSL_HANDSHAKE_TIMING
+        word32 ioStart = 0;
+
+        if (ssl->options.handShakeState != HANDSHAKE_DONE)
+            ioStart = HsTimeNow();
+    #endif
+    #ifdef WOLFSSL_KTLS
+        if (ssl->options.ktlsTx)
+            sent = KTLS_Send(ssl);
+        else
+    #endif
+            sent = ssl->CBIOSend(ssl,
                                       (char*)ssl->buffers.outputBuffer.buffer +
                                       ssl->buffers.outputBuffer.idx,
                                       (int)ssl->buffers.outputBuffer.length,
                                       ssl->IOCB_WriteCtx);
+    #ifdef WOLFSSL_HANDSHAKE_TIMING
+        if (ssl->options.handShakeState != HANDSHAKE_DONE)
+            HsTimeIo(ssl, WOLFSSL_HS_TIME_IO_WRITE, ioStart, sent);
+    #endif
         if (sent < 0) {
             switch (sent) {
 
@@ -7030,6 +8565,18 @@ int SendBuffered(WOLFSSL* ssl)
 
     ssl->buffers.outputBuffer.idx = 0;
 
+#ifdef WOLFSSL_KTLS
+    /* records built after a KeyUpdate use the new keys */
+    if (ssl->options.ktlsTxRekey) {
+        ssl->options.ktlsTxRekey = 0;
+        if (KTLS_SetKeys(ssl, ENCRYPT_SIDE_ONLY) != 0)
+            return SOCKET_ERROR_E;
+    }
+    /* records left over from the handshake are sent */
+    if (ssl->options.ktlsTxPending)
+        KTLS_EnablePending(ssl);
+#endif
+
     if (ssl->buffers.outputBuffer.dynamicFlag)
         ShrinkOutputBuffer(ssl);
 
@@ -7041,6 +8588,9 @@ int SendBuffered(WOLFSSL* ssl)
 static WC_INLINE int GrowOutputBuffer(WOLFSSL* ssl, int size)
 {
     byte* tmp;
+#ifdef WOLFSSL_BUFFER_POOL
+    byte  pooled;
+#endif
 #if WOLFSSL_GENERAL_ALIGNMENT > 0
     byte  hdrSz = ssl->options.dtls ? DTLS_RECORD_HEADER_SZ :
                                       RECORD_HEADER_SZ;
@@ -7060,8 +8610,13 @@ static WC_INLINE int GrowOutputBuffer(WOLFSSL* ssl, int size)
     }
 #endif
 
+#ifdef WOLFSSL_BUFFER_POOL
+    tmp = AllocIOBuffer(ssl, size + ssl->buffers.outputBuffer.length + align,
+                        DYNAMIC_TYPE_OUT_BUFFER, &pooled);
+#else
     tmp = (byte*)XMALLOC(size + ssl->buffers.outputBuffer.length + align,
                              ssl->heap, DYNAMIC_TYPE_OUT_BUFFER);
+#endif
     WOLFSSL_MSG("growing output buffer\n");
 
     if (tmp == NULL)
@@ -7077,10 +8632,12 @@ static WC_INLINE int GrowOutputBuffer(WOLFSSL* ssl, int size)
                ssl->buffers.outputBuffer.length);
 
     if (ssl->buffers.outputBuffer.dynamicFlag)
-        XFREE(ssl->buffers.outputBuffer.buffer -
-              ssl->buffers.outputBuffer.offset, ssl->heap,
-              DYNAMIC_TYPE_OUT_BUFFER);
+        FreeDynamicBuffer(ssl, &ssl->buffers.outputBuffer,
+                          DYNAMIC_TYPE_OUT_BUFFER);
     ssl->buffers.outputBuffer.dynamicFlag = 1;
+#ifdef WOLFSSL_BUFFER_POOL
+    ssl->buffers.outputBuffer.pooled = pooled;
+#endif
 
 #if WOLFSSL_GENERAL_ALIGNMENT > 0
     if (align)
@@ -7100,6 +8657,9 @@ static WC_INLINE int GrowOutputBuffer(WOLFSSL* ssl, int size)
 int GrowInputBuffer(WOLFSSL* ssl, int size, int usedLength)
 {
     byte* tmp;
+#ifdef WOLFSSL_BUFFER_POOL
+    byte  pooled;
+#endif
 #if defined(WOLFSSL_DTLS) || WOLFSSL_GENERAL_ALIGNMENT > 0
     byte  align = ssl->options.dtls ? WOLFSSL_GENERAL_ALIGNMENT : 0;
     byte  hdrSz = DTLS_RECORD_HEADER_SZ;
@@ -7124,8 +8684,13 @@ int GrowInputBuffer(WOLFSSL* ssl, int size, int usedLength)
         return BAD_FUNC_ARG;
     }
 
+#ifdef WOLFSSL_BUFFER_POOL
+    tmp = AllocIOBuffer(ssl, size + usedLength + align, DYNAMIC_TYPE_IN_BUFFER,
+                        &pooled);
+#else
     tmp = (byte*)XMALLOC(size + usedLength + align,
                              ssl->heap, DYNAMIC_TYPE_IN_BUFFER);
+#endif
     WOLFSSL_MSG("growing input buffer\n");
 
     if (tmp == NULL)
@@ -7141,10 +8706,13 @@ int GrowInputBuffer(WOLFSSL* ssl, int size, int usedLength)
                     ssl->buffers.inputBuffer.idx, usedLength);
 
     if (ssl->buffers.inputBuffer.dynamicFlag)
-        XFREE(ssl->buffers.inputBuffer.buffer - ssl->buffers.inputBuffer.offset,
-              ssl->heap,DYNAMIC_TYPE_IN_BUFFER);
+        FreeDynamicBuffer(ssl, &ssl->buffers.inputBuffer,
+                          DYNAMIC_TYPE_IN_BUFFER);
 
     ssl->buffers.inputBuffer.dynamicFlag = 1;
+#ifdef WOLFSSL_BUFFER_POOL
+    ssl->buffers.inputBuffer.pooled = pooled;
+#endif
 #if defined(WOLFSSL_DTLS) || WOLFSSL_GENERAL_ALIGNMENT > 0
     if (align)
         ssl->buffers.inputBuffer.offset = align - hdrSz;
@@ -7179,6 +8747,59 @@ int CheckAvailableSize(WOLFSSL *ssl, int size)
 }
 
 
+#ifdef HAVE_RECORD_SIZE_LIMIT
+/* Check whether the record size limit applies to the records being read.
+ * The limit is on protected records once the peer has agreed to it.
+ *
+ * ssl  The SSL/TLS object.
+ * returns 1 when the limit applies and 0 otherwise.
+ */
+static WC_INLINE int RecordSizeLimitOn(WOLFSSL* ssl)
+{
+    return ssl->peerRecordSizeLimit != 0 && ssl->recordSizeLimit != 0 &&
+    #ifdef WOLFSSL_EARLY_DATA
+           ssl->earlyData != process_early_data &&
+    #endif
+           IsEncryptionOn(ssl, 0);
+}
+
+/* Get the most a protected record can be bigger than its plaintext with the
+ * cipher suite in use.
+ *
+ * ssl  The SSL/TLS object.
+ * returns the number of bytes.
+ */
+static word32 RecordSizeLimitExtra(WOLFSSL* ssl)
+{
+    word32 extra;
+
+#ifdef WOLFSSL_TLS13
+    /* the limit counts the content type and padding */
+    if (ssl->options.tls1_3)
+        return ssl->specs.aead_mac_size;
+#endif
+    if (ssl->specs.cipher_type == aead) {
+        extra = ssl->specs.aead_mac_size;
+        if (ssl->specs.bulk_cipher_algorithm != wolfssl_chacha)
+            extra += AESGCM_EXP_IV_SZ;
+    }
+    else {
+        extra = ssl->specs.hash_size;
+        if (ssl->specs.cipher_type == block) {
+            extra += MAX_PAD_SIZE;
+            if (ssl->options.tls1_1)
+                extra += ssl->specs.block_size;
+        }
+    }
+#ifdef HAVE_LIBZ
+    if (ssl->options.usingCompression)
+        extra += MAX_COMP_EXTRA;
+#endif
+
+    return extra;
+}
+#endif /* HAVE_RECORD_SIZE_LIMIT */
+
 /* do all verify and sanity checks on record header */
 static int GetRecordHeader(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
                            RecordLayerHeader* rh, word16 *size)
@@ -7271,6 +8892,14 @@ static int GetRecordHeader(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     if (*size > (MAX_RECORD_SIZE + MAX_COMP_EXTRA + MAX_MSG_EXTRA))
         return LENGTH_ERROR;
 #endif
+#ifdef HAVE_RECORD_SIZE_LIMIT
+    /* the plaintext is checked once decrypted */
+    if (RecordSizeLimitOn(ssl) &&
+            *size > ssl->recordSizeLimit + RecordSizeLimitExtra(ssl)) {
+        SendAlert(ssl, alert_fatal, record_overflow);
+        return LENGTH_ERROR;
+    }
+#endif
 
     /* verify record type here as well */
     switch (rh->type) {
@@ -7480,6 +9109,12 @@ static int BuildFinished(WOLFSSL* ssl, Hashes* hashes, const byte* sender)
     if (ssl == NULL)
         return BAD_FUNC_ARG;
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    ret = HashCommit(ssl, HS_HASH_ALL);
+    if (ret != 0)
+        return ret;
+#endif
+
 #ifndef NO_TLS
     if (ssl->options.tls) {
         ret = BuildTlsFinished(ssl, hashes, sender);
@@ -10144,7 +11779,7 @@ static int DoCertificate(WOLFSSL* ssl, byte* input, word32* inOutIdx,
 {
     int ret;
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_DO);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_DO);
     WOLFSSL_ENTER("DoCertificate");
 
 #ifdef SESSION_CERTS
@@ -10162,7 +11797,7 @@ static int DoCertificate(WOLFSSL* ssl, byte* input, word32* inOutIdx,
 #endif
 
     WOLFSSL_LEAVE("DoCertificate", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_DO);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_DO);
 
     return ret;
 }
@@ -10175,7 +11810,7 @@ static int DoCertificateStatus(WOLFSSL* ssl, byte* input, word32* inOutIdx,
     byte   status_type;
     word32 status_length;
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_STATUS_DO);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_STATUS_DO);
     WOLFSSL_ENTER("DoCertificateStatus");
 
     if (size < ENUM_LEN + OPAQUE24_LEN)
@@ -10311,7 +11946,7 @@ static int DoCertificateStatus(WOLFSSL* ssl, byte* input, word32* inOutIdx,
     }
 
     WOLFSSL_LEAVE("DoCertificateStatus", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_STATUS_DO);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_STATUS_DO);
 
     return ret;
 }
@@ -10329,7 +11964,7 @@ static int DoHelloRequest(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
 {
     (void)input;
 
-    WOLFSSL_START(WC_FUNC_HELLO_REQUEST_DO);
+    HS_TIME_START(ssl, WC_FUNC_HELLO_REQUEST_DO);
     WOLFSSL_ENTER("DoHelloRequest");
 
     if (size) /* must be 0 */
@@ -10351,7 +11986,7 @@ static int DoHelloRequest(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     else if (ssl->secure_renegotiation && ssl->secure_renegotiation->enabled) {
         ssl->secure_renegotiation->startScr = 1;
         WOLFSSL_LEAVE("DoHelloRequest", 0);
-        WOLFSSL_END(WC_FUNC_HELLO_REQUEST_DO);
+        HS_TIME_END(ssl, WC_FUNC_HELLO_REQUEST_DO);
         return 0;
     }
 #endif
@@ -10366,7 +12001,7 @@ int DoFinished(WOLFSSL* ssl, const byte* input, word32* inOutIdx, word32 size,
 {
     word32 finishedSz = (ssl->options.tls ? TLS_FINISHED_SZ : FINISHED_SZ);
 
-    WOLFSSL_START(WC_FUNC_FINISHED_DO);
+    HS_TIME_START(ssl, WC_FUNC_FINISHED_DO);
     WOLFSSL_ENTER("DoFinished");
 
     if (finishedSz != size)
@@ -10438,7 +12073,7 @@ int DoFinished(WOLFSSL* ssl, const byte* input, word32* inOutIdx, word32 size,
     }
 
     WOLFSSL_LEAVE("DoFinished", 0);
-    WOLFSSL_END(WC_FUNC_FINISHED_DO);
+    HS_TIME_END(ssl, WC_FUNC_FINISHED_DO);
 
     return 0;
 }
@@ -10776,6 +12411,21 @@ static int DoHandShakeMsgType(WOLFSSL* ssl, byte* input, word32* inOutIdx,
     expectedIdx = *inOutIdx + size +
                   (ssl->keys.encryptionOn ? ssl->keys.padSz : 0);
 
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+    /* before the message is checked, hashed or processed */
+    if (type == client_hello && ssl->options.side == WOLFSSL_SERVER_END &&
+            ssl->ctx->clientHelloCb != NULL &&
+            !ssl->options.clientHelloCbDone) {
+        ret = DoClientHelloCb(ssl, input + *inOutIdx, size);
+        if (ret == CLIENT_HELLO_WANT_CB && *inOutIdx >= HANDSHAKE_HEADER_SZ) {
+            /* process this msg again */
+            *inOutIdx -= HANDSHAKE_HEADER_SZ;
+        }
+        if (ret != 0)
+            return ret;
+    }
+#endif
+
 #if !defined(WOLFSSL_NO_SERVER) && \
     defined(HAVE_SECURE_RENEGOTIATION) && \
     defined(HAVE_SERVER_RENEGOTIATION_INFO)
@@ -11132,8 +12782,8 @@ static int DoHandShakeMsg(WOLFSSL* ssl, byte* input, word32* inOutIdx,
                                      &idx, ssl->arrays->pendingMsgType,
                                      ssl->arrays->pendingMsgSz - idx,
                                      ssl->arrays->pendingMsgSz);
-        #ifdef WOLFSSL_ASYNC_CRYPT
-            if (ret == WC_PENDING_E) {
+        #if defined(WOLFSSL_ASYNC_CRYPT) || defined(WOLFSSL_CLIENT_HELLO_CB)
+            if (ret == WC_PENDING_E || ret == CLIENT_HELLO_WANT_CB) {
                 /* setup to process fragment again */
                 ssl->arrays->pendingMsgOffset -= inputLength;
                 *inOutIdx -= inputLength;
@@ -12813,6 +14463,9 @@ static int GetInputData(WOLFSSL *ssl, word32 size)
     int maxLength;
     int usedLength;
     int dtlsExtra = 0;
+#ifdef WOLFSSL_READ_AHEAD
+    int readAheadExtra = 0;
+#endif
 
 
     /* check max input length */
@@ -12820,6 +14473,18 @@ static int GetInputData(WOLFSSL *ssl, word32 size)
     maxLength  = ssl->buffers.inputBuffer.bufferSize - usedLength;
     inSz       = (int)(size - usedLength);      /* from last partial read */
 
+#ifdef WOLFSSL_KTLS
+    /* the kernel hands over whole records */
+    if (ssl->options.ktlsRx && usedLength >= (int)size)
+        return 0;
+#endif
+#ifdef WOLFSSL_READ_AHEAD
+    /* an earlier read ahead may already have all the data, even when reading
+     * ahead has been turned off since */
+    if (!ssl->options.dtls && usedLength >= (int)size)
+        return 0;
+#endif
+
 #ifdef WOLFSSL_DTLS
     if (ssl->options.dtls) {
         if (size < ssl->dtls_expected_rx)
@@ -12833,9 +14498,24 @@ static int GetInputData(WOLFSSL *ssl, word32 size)
         return BUFFER_ERROR;
     }
 
+#ifdef WOLFSSL_READ_AHEAD
+    /* read as much as is available, up to the read ahead size */
+    if (ssl->options.readAheadSz > 0 && !ssl->options.dtls &&
+                (word32)(usedLength + inSz) < ssl->options.readAheadSz) {
+        readAheadExtra = (int)ssl->options.readAheadSz - usedLength - inSz;
+        inSz += readAheadExtra;
+    }
+#endif
+
     if (inSz > maxLength) {
+    #ifdef WOLFSSL_READ_AHEAD
+        if (GrowInputBuffer(ssl, size + dtlsExtra + readAheadExtra,
+                                                             usedLength) < 0)
+            return MEMORY_E;
+    #else
         if (GrowInputBuffer(ssl, size + dtlsExtra, usedLength) < 0)
             return MEMORY_E;
+    #endif
     }
 
     /* Put buffer data at start if not there */
@@ -12959,6 +14639,57 @@ static WC_INLINE int VerifyMac(WOLFSSL* ssl, const byte* input, word32 msgSz,
 }
 
 
+#ifdef WOLFSSL_KTLS
+/* Read the plaintext of the next records from the kernel and put a record
+ * header in front, as if it had been received and decrypted.
+ * A gap is left for the explicit IV so the record is laid out as usual.
+ *
+ * returns 0 on success, WANT_READ or another negative error code.
+ */
+static int KTLS_GetRecord(WOLFSSL* ssl)
+{
+    bufferStatic* in = &ssl->buffers.inputBuffer;
+    word32 ivSz = CipherHasExpIV(ssl) ? AESGCM_EXP_IV_SZ : 0;
+    word32 sz = RECORD_HEADER_SZ + ivSz + MAX_RECORD_SIZE;
+    byte   type;
+    int    recvd;
+
+    /* finish off what is already there */
+    if (in->length > in->idx)
+        return 0;
+
+    if (in->bufferSize < sz && GrowInputBuffer(ssl, (int)sz, 0) < 0)
+        return MEMORY_E;
+    in->idx = 0;
+    in->length = 0;
+
+    do {
+        recvd = EmbedKtlsReceive(ssl,
+                                 (char*)in->buffer + RECORD_HEADER_SZ + ivSz,
+                                 MAX_RECORD_SIZE, &type);
+    } while (recvd == WOLFSSL_CBIO_ERR_ISR);
+
+    if (recvd < 0) {
+        switch (recvd) {
+            case WOLFSSL_CBIO_ERR_WANT_READ:
+                return WANT_READ;
+            case WOLFSSL_CBIO_ERR_CONN_RST:
+                ssl->options.connReset = 1;
+                break;
+            case WOLFSSL_CBIO_ERR_CONN_CLOSE:
+                ssl->options.isClosed = 1;
+                break;
+        }
+        return SOCKET_ERROR_E;
+    }
+
+    AddRecordHeader(in->buffer, ivSz + (word32)recvd, type, ssl);
+    in->length = RECORD_HEADER_SZ + ivSz + (word32)recvd;
+
+    return 0;
+}
+#endif /* WOLFSSL_KTLS */
+
 /* process input requests, return 0 is done, 1 is call again to complete, and
    negative number is error */
 int ProcessReply(WOLFSSL* ssl)
@@ -12982,6 +14713,9 @@ int ProcessReply(WOLFSSL* ssl)
     #ifdef WOLFSSL_NONBLOCK_OCSP
         && ssl->error != OCSP_WANT_READ
     #endif
+    #ifdef WOLFSSL_CLIENT_HELLO_CB
+        && ssl->error != CLIENT_HELLO_WANT_CB
+    #endif
     ) {
         WOLFSSL_MSG("ProcessReply retry in error state, not allowed");
         return ssl->error;
@@ -12996,6 +14730,26 @@ int ProcessReply(WOLFSSL* ssl)
 
             readSz = RECORD_HEADER_SZ;
 
+        #ifdef WOLFSSL_READ_AHEAD
+            /* records read ahead of the last one are up next */
+            ssl->buffers.inputBuffer.length += ssl->buffers.inputAheadSz;
+            ssl->buffers.inputAheadSz = 0;
+        #endif
+
+        #ifdef WOLFSSL_KTLS
+            /* records read with the handshake have been processed */
+            if (ssl->options.ktlsRxPending && ssl->buffers.inputBuffer.idx ==
+                                            ssl->buffers.inputBuffer.length) {
+                KTLS_EnablePending(ssl);
+            }
+            if (ssl->options.ktlsRx) {
+                if ((ret = KTLS_GetRecord(ssl)) < 0)
+                    return ret;
+                ssl->options.processReply = getRecordLayerHeader;
+                continue;
+            }
+        #endif
+
         #ifdef WOLFSSL_DTLS
             if (ssl->options.dtls)
                 readSz = DTLS_RECORD_HEADER_SZ;
@@ -13129,6 +14883,18 @@ int ProcessReply(WOLFSSL* ssl)
             if (!ssl->options.dtls) {
                 if ((ret = GetInputData(ssl, ssl->curSize)) < 0)
                     return ret;
+            #ifdef WOLFSSL_READ_AHEAD
+                /* hold back any records read ahead so the input buffer ends
+                 * with the current record while it is processed */
+                readSz = (int)(ssl->buffers.inputBuffer.length -
+                               ssl->buffers.inputBuffer.idx);
+                if (readSz > ssl->curSize) {
+                    ssl->buffers.inputAheadSz = (word32)(readSz -
+                                                         ssl->curSize);
+                    ssl->buffers.inputBuffer.length -=
+                                                 ssl->buffers.inputAheadSz;
+                }
+            #endif
             } else {
 #ifdef WOLFSSL_DTLS
                 /* read ahead may already have */
@@ -13147,6 +14913,17 @@ int ProcessReply(WOLFSSL* ssl)
         /* decrypt message */
         case decryptMessage:
 
+        #ifdef WOLFSSL_KTLS
+            if (ssl->options.ktlsRx) {
+                /* the kernel has decrypted and verified the record */
+                if (CipherHasExpIV(ssl))
+                    ssl->buffers.inputBuffer.idx += AESGCM_EXP_IV_SZ;
+                ssl->keys.encryptSz    = ssl->curSize;
+                ssl->keys.padSz        = 0;
+                ssl->keys.decryptedCur = 1;
+            }
+        #endif
+
 #if !defined(WOLFSSL_TLS13) || defined(WOLFSSL_TLS13_DRAFT_18)
             if (IsEncryptionOn(ssl, 0) && ssl->keys.decryptedCur == 0)
 #else
@@ -13298,6 +15075,23 @@ int ProcessReply(WOLFSSL* ssl)
 
                 ssl->keys.encryptSz    = ssl->curSize;
                 ssl->keys.decryptedCur = 1;
+#ifdef HAVE_RECORD_SIZE_LIMIT
+                if (RecordSizeLimitOn(ssl) && !ssl->options.usingCompression) {
+                    word32 ivExtra = CipherHasExpIV(ssl) ? AESGCM_EXP_IV_SZ : 0;
+
+                #ifndef WOLFSSL_AEAD_ONLY
+                    if (ssl->options.tls1_1 && ssl->specs.cipher_type == block)
+                        ivExtra = ssl->specs.block_size;
+                #endif
+                    /* TLS v1.3 inner plaintext has the type and padding */
+                    if (ssl->curSize - ivExtra - ssl->keys.padSz >
+                                                     ssl->recordSizeLimit) {
+                        WOLFSSL_MSG("Plaintext over the record size limit");
+                        SendAlert(ssl, alert_fatal, record_overflow);
+                        return LENGTH_ERROR;
+                    }
+                }
+#endif
 #ifdef WOLFSSL_TLS13
                 if (ssl->options.tls1_3) {
                     word16 i = (word16)(ssl->buffers.inputBuffer.length -
@@ -13888,35 +15682,51 @@ int BuildCertHashes(WOLFSSL* ssl, Hashes* hashes)
 
     (void)hashes;
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    ret = HashCommit(ssl, HS_HASH_ALL);
+    if (ret != 0)
+        return ret;
+#endif
+
     if (ssl->options.tls) {
     #if !defined(NO_MD5) && !defined(NO_OLD_TLS)
-        ret = wc_Md5GetHash(&ssl->hsHashes->hashMd5, hashes->md5);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_MD5)) {
+            ret = wc_Md5GetHash(&ssl->hsHashes->hashMd5, hashes->md5);
+            if (ret != 0)
+                return ret;
+        }
     #endif
     #if !defined(NO_SHA)
-        ret = wc_ShaGetHash(&ssl->hsHashes->hashSha, hashes->sha);
-        if (ret != 0)
-            return ret;
+        if (HS_HASH_ON(ssl, HS_HASH_SHA)) {
+            ret = wc_ShaGetHash(&ssl->hsHashes->hashSha, hashes->sha);
+            if (ret != 0)
+                return ret;
+        }
     #endif
         if (IsAtLeastTLSv1_2(ssl)) {
             #ifndef NO_SHA256
+            if (HS_HASH_ON(ssl, HS_HASH_SHA256)) {
                 ret = wc_Sha256GetHash(&ssl->hsHashes->hashSha256,
                                        hashes->sha256);
                 if (ret != 0)
                     return ret;
+            }
             #endif
             #ifdef WOLFSSL_SHA384
+            if (HS_HASH_ON(ssl, HS_HASH_SHA384)) {
                 ret = wc_Sha384GetHash(&ssl->hsHashes->hashSha384,
                                        hashes->sha384);
                 if (ret != 0)
                     return ret;
+            }
             #endif
             #ifdef WOLFSSL_SHA512
+            if (HS_HASH_ON(ssl, HS_HASH_SHA512)) {
                 ret = wc_Sha512GetHash(&ssl->hsHashes->hashSha512,
                                        hashes->sha512);
                 if (ret != 0)
                     return ret;
+            }
             #endif
         }
     }
@@ -13964,6 +15774,67 @@ static void FreeBuildMsgArgs(WOLFSSL* ssl, void* pArgs)
         args->iv = NULL;
     }
 }
+
+#ifdef WOLFSSL_CBC_STITCH
+/* MAC and encrypt an AES-CBC record in one pass over the message.
+ * Each chunk of message is MACed and then encrypted while it is still in the
+ * cache. The MAC is placed after the message and the padding must already be
+ * after the MAC.
+ *
+ * ssl   The SSL/TLS object.
+ * data  The record data: explicit IV, message, MAC and padding.
+ * ivSz  The size of the explicit IV.
+ * inSz  The size of the message.
+ * size  The size of the record data.
+ * type  The record content type.
+ * returns 0 on success, otherwise failure.
+ */
+static int MacEncryptStitched(WOLFSSL* ssl, byte* data, word32 ivSz,
+                              word32 inSz, word32 size, int type)
+{
+    Hmac   hmac;
+    byte*  msg = data + ivSz;
+    word32 done = 0;
+    word32 chunkSz;
+    int    ret;
+
+    if (ssl->encrypt.setup == 0) {
+        WOLFSSL_MSG("Encrypt ciphers not setup");
+        return ENCRYPT_ERROR;
+    }
+
+    ret = TLS_HmacStart(ssl, &hmac, inSz, type, 0);
+    if (ret != 0)
+        return ret;
+
+    if (ivSz > 0)
+        ret = wc_AesCbcEncrypt(ssl->encrypt.aes, data, data, ivSz);
+
+    /* Whole blocks of message - CBC state chains between calls. */
+    while (ret == 0 && inSz - done >= AES_BLOCK_SIZE) {
+        chunkSz = min(inSz - done, CBC_STITCH_CHUNK_SZ);
+        chunkSz -= chunkSz % AES_BLOCK_SIZE;
+
+        ret = wc_HmacUpdate(&hmac, msg + done, chunkSz);
+        if (ret == 0)
+            ret = wc_AesCbcEncrypt(ssl->encrypt.aes, msg + done, msg + done,
+                                                                       chunkSz);
+        done += chunkSz;
+    }
+    if (ret == 0)
+        ret = wc_HmacUpdate(&hmac, msg + done, inSz - done);
+    if (ret == 0)
+        ret = wc_HmacFinal(&hmac, msg + inSz);
+    /* Remaining message, MAC and padding. */
+    if (ret == 0)
+        ret = wc_AesCbcEncrypt(ssl->encrypt.aes, msg + done, msg + done,
+                                                          size - ivSz - done);
+
+    wc_HmacFree(&hmac);
+
+    return ret;
+}
+#endif /* WOLFSSL_CBC_STITCH */
 #endif
 
 /* Build SSL Message, encrypted */
@@ -13987,6 +15858,13 @@ int BuildMessage(WOLFSSL* ssl, byte* output, int outSz, const byte* input,
         return BAD_FUNC_ARG;
     }
 
+#ifdef WOLFSSL_KTLS
+    if (ssl->options.ktlsTx) {
+        return KTLS_BuildMessage(ssl, output, outSz, input, inSz, type,
+                                 hashOutput, sizeOnly);
+    }
+#endif
+
 #ifdef WOLFSSL_NO_TLS12
     return BuildTls13Message(ssl, output, outSz, input, inSz, type,
                                                hashOutput, sizeOnly, asyncOkay);
@@ -14165,6 +16043,17 @@ int BuildMessage(WOLFSSL* ssl, byte* output, int outSz, const byte* input,
             }
         #endif
 
+        #ifdef WOLFSSL_CBC_STITCH
+            if (ssl->specs.cipher_type == block &&
+                    ssl->specs.bulk_cipher_algorithm == wolfssl_aes &&
+                    ssl->hmac == TLS_hmac &&
+                    args->digestSz == ssl->specs.hash_size) {
+                ret = MacEncryptStitched(ssl, output + args->headerSz,
+                                         args->ivSz, inSz, args->size, type);
+                break;
+            }
+        #endif
+
         #ifndef WOLFSSL_AEAD_ONLY
             if (ssl->specs.cipher_type != aead) {
             #ifdef HAVE_TRUNCATED_HMAC
@@ -14260,7 +16149,7 @@ int SendFinished(WOLFSSL* ssl)
     int              headerSz = HANDSHAKE_HEADER_SZ;
     int              outputSz;
 
-    WOLFSSL_START(WC_FUNC_FINISHED_SEND);
+    HS_TIME_START(ssl, WC_FUNC_FINISHED_SEND);
     WOLFSSL_ENTER("SendFinished");
 
     /* setup encrypt keys */
@@ -14360,7 +16249,7 @@ int SendFinished(WOLFSSL* ssl)
     ret = SendBuffered(ssl);
 
     WOLFSSL_LEAVE("SendFinished", ret);
-    WOLFSSL_END(WC_FUNC_FINISHED_SEND);
+    HS_TIME_END(ssl, WC_FUNC_FINISHED_SEND);
 
     return ret;
 }
@@ -14500,13 +16389,253 @@ int CreateOcspResponse(WOLFSSL* ssl, OcspRequest** ocspRequest,
 
     return ret;
 }
-#endif
-#endif /* !NO_WOLFSSL_SERVER */
+#endif
+#endif /* !NO_WOLFSSL_SERVER */
+
+#if !defined(NO_CERTS) && defined(WOLFSSL_CERT_MSG_CACHE)
+/* Free the Certificate message bodies cached in the CTX.
+ * Call whenever the certificate or chain of the CTX changes.
+ */
+void FreeCertMsgCache(WOLFSSL_CTX* ctx)
+{
+    int i;
+
+    for (i = 0; i < CERT_MSG_CACHE_CNT; i++) {
+        if (ctx->certMsg[i] != NULL) {
+            XFREE(ctx->certMsg[i], ctx->heap, DYNAMIC_TYPE_CERT);
+            ctx->certMsg[i] = NULL;
+        }
+        ctx->certMsgSz[i] = 0;
+    }
+    ctx->certMsgFailed = 0;
+}
+
+/* Encode the Certificate message body, after the handshake header, for the
+ * certificate and chain of the CTX.
+ * TLS v1.2: list length | cert length | cert | chain
+ * TLS v1.3: empty request context | list length | cert length | cert |
+ *           empty extensions | each chain cert with empty extensions
+ */
+static int EncodeCertMsg(WOLFSSL_CTX* ctx, int tls13, byte** msg, word32* sz)
+{
+    word32 certSz  = ctx->certificate->length;
+    word32 chainSz = 0;
+    word32 listSz;
+    word32 msgSz;
+    word32 i = 0;
+    word32 idx;
+    word32 len;
+    byte*  out;
+    int    chainCnt = 0;
+
+    if (ctx->certChain != NULL) {
+        chainSz = ctx->certChain->length;
+    #ifdef WOLFSSL_TLS13
+        chainCnt = ctx->certChainCnt;
+        if (tls13 && chainCnt == 0)
+            chainSz = 0;
+    #endif
+    }
+
+    listSz = CERT_HEADER_SZ + certSz + chainSz;
+    if (tls13)
+        listSz += OPAQUE16_LEN + OPAQUE16_LEN * chainCnt;
+    msgSz = CERT_HEADER_SZ + listSz;
+    if (tls13)
+        msgSz += OPAQUE8_LEN;
+
+    out = (byte*)XMALLOC(msgSz, ctx->heap, DYNAMIC_TYPE_CERT);
+    if (out == NULL)
+        return MEMORY_E;
+
+    if (tls13)
+        out[i++] = 0;
+    c32to24(listSz, out + i);
+    i += CERT_HEADER_SZ;
+    c32to24(certSz, out + i);
+    i += CERT_HEADER_SZ;
+    XMEMCPY(out + i, ctx->certificate->buffer, certSz);
+    i += certSz;
+
+    if (!tls13) {
+        if (chainSz > 0) {
+            XMEMCPY(out + i, ctx->certChain->buffer, chainSz);
+            i += chainSz;
+        }
+    }
+    else {
+        out[i++] = 0;
+        out[i++] = 0;
+        /* chain certs already have their leading sizes */
+        for (idx = 0; idx < chainSz; idx += len) {
+            c24to32(ctx->certChain->buffer + idx, &len);
+            len += CERT_HEADER_SZ;
+            if (idx + len > chainSz || i + len + OPAQUE16_LEN > msgSz) {
+                XFREE(out, ctx->heap, DYNAMIC_TYPE_CERT);
+                return BUFFER_E;
+            }
+            XMEMCPY(out + i, ctx->certChain->buffer + idx, len);
+            i += len;
+            out[i++] = 0;
+            out[i++] = 0;
+        }
+    }
+
+    if (i != msgSz) {
+        XFREE(out, ctx->heap, DYNAMIC_TYPE_CERT);
+        return BUFFER_E;
+    }
+
+    *msg = out;
+    *sz  = msgSz;
+
+    return 0;
+}
+
+#ifdef WOLFSSL_CERT_COMPRESSION
+/* Compress a TLS v1.3 Certificate message body with zlib into the body of a
+ * CompressedCertificate message (RFC 8879):
+ *   algorithm | uncompressed length | compressed length | compressed data
+ * Fails when the compressed data is no smaller than the uncompressed.
+ */
+static int CompressCertMsg(WOLFSSL_CTX* ctx, const byte* in, word32 inSz,
+                           byte** msg, word32* sz)
+{
+    word32 hdrSz = OPAQUE16_LEN + OPAQUE24_LEN + OPAQUE24_LEN;
+    byte*  out;
+    int    ret;
+
+    out = (byte*)XMALLOC(hdrSz + inSz, ctx->heap, DYNAMIC_TYPE_CERT);
+    if (out == NULL)
+        return MEMORY_E;
+
+    ret = wc_Compress(out + hdrSz, inSz, in, inSz, 0);
+    if (ret < 0) {
+        XFREE(out, ctx->heap, DYNAMIC_TYPE_CERT);
+        return ret;
+    }
+
+    c16toa(CERT_COMPRESS_ZLIB, out);
+    c32to24(inSz, out + OPAQUE16_LEN);
+    c32to24((word32)ret, out + OPAQUE16_LEN + OPAQUE24_LEN);
+
+    *msg = out;
+    *sz  = hdrSz + (word32)ret;
+
+    return 0;
+}
+#endif
+
+/* Get the Certificate message body, after the handshake header, to send for
+ * the SSL object when it uses the certificate and chain of its CTX.
+ * The body is encoded the first time it is needed and kept with the CTX.
+ *
+ * ssl   The SSL/TLS object.
+ * type  The encoding to use: CERT_MSG_TLS12, CERT_MSG_TLS13 or, for the body
+ *       of a CompressedCertificate message, CERT_MSG_TLS13_ZLIB.
+ * sz    The size of the body.
+ * returns the body, or NULL when the SSL object has its own certificate or
+ * the body couldn't be encoded.
+ */
+const byte* GetCertMsgCache(WOLFSSL* ssl, int type, word32* sz)
+{
+    WOLFSSL_CTX* ctx = ssl->ctx;
+    const byte*  msg = NULL;
+    int          ret = 0;
+
+    if (ctx == NULL || ctx->certificate == NULL ||
+            ctx->certificate->length == 0 ||
+            ssl->buffers.weOwnCert || ssl->buffers.weOwnCertChain ||
+            ssl->buffers.certificate != ctx->certificate ||
+            ssl->buffers.certChain != ctx->certChain) {
+        return NULL;
+    }
+#ifdef WOLFSSL_TLS13
+    if (ssl->buffers.certChainCnt != ctx->certChainCnt)
+        return NULL;
+#endif
+
+    if (wc_LockMutex(&ctx->countMutex) != 0)
+        return NULL;
+    /* an encoding that failed isn't tried again until the certificate or
+     * chain changes */
+    if (ctx->certMsg[type] == NULL &&
+            (ctx->certMsgFailed & (1 << type)) == 0) {
+    #ifdef WOLFSSL_CERT_COMPRESSION
+        if (type == CERT_MSG_TLS13_ZLIB) {
+            /* compress the TLS v1.3 encoding */
+            if (ctx->certMsg[CERT_MSG_TLS13] == NULL) {
+                ret = EncodeCertMsg(ctx, 1, &ctx->certMsg[CERT_MSG_TLS13],
+                                    &ctx->certMsgSz[CERT_MSG_TLS13]);
+            }
+            if (ret == 0) {
+                ret = CompressCertMsg(ctx, ctx->certMsg[CERT_MSG_TLS13],
+                                      ctx->certMsgSz[CERT_MSG_TLS13],
+                                      &ctx->certMsg[type],
+                                      &ctx->certMsgSz[type]);
+            }
+        }
+        else
+    #endif
+        {
+            ret = EncodeCertMsg(ctx, type == CERT_MSG_TLS13,
+                                &ctx->certMsg[type], &ctx->certMsgSz[type]);
+        }
+        if (ret != 0) {
+            WOLFSSL_MSG("Encoding Certificate message for cache failed");
+            ctx->certMsgFailed |= (byte)(1 << type);
+        }
+    }
+    msg = ctx->certMsg[type];
+    *sz = ctx->certMsgSz[type];
+    wc_UnLockMutex(&ctx->countMutex);
+
+    return msg;
+}
+#endif /* !NO_CERTS && WOLFSSL_CERT_MSG_CACHE */
 
 #ifndef WOLFSSL_NO_TLS12
 
 #ifndef NO_CERTS
 #if !defined(NO_WOLFSSL_SERVER) || !defined(WOLFSSL_NO_CLIENT_AUTH)
+#ifdef WOLFSSL_CERT_MSG_CACHE
+/* Send an unencrypted TLS Certificate message in one record from the body
+ * cached in the CTX.
+ */
+static int SendCertificateCached(WOLFSSL* ssl, const byte* msg, word32 msgSz)
+{
+    int   ret;
+    int   sendSz = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ + msgSz;
+    byte* output;
+
+    if ((ret = CheckAvailableSize(ssl, sendSz)) != 0)
+        return ret;
+
+    output = ssl->buffers.outputBuffer.buffer +
+             ssl->buffers.outputBuffer.length;
+
+    AddHeaders(output, msgSz, certificate, ssl);
+    XMEMCPY(output + RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ, msg, msgSz);
+    ret = HashOutput(ssl, output, sendSz, 0);
+    if (ret != 0)
+        return ret;
+
+    #if defined(WOLFSSL_CALLBACKS) || defined(OPENSSL_EXTRA)
+        if (ssl->hsInfoOn)
+            AddPacketName(ssl, "Certificate");
+        if (ssl->toInfoOn)
+            AddPacketInfo(ssl, "Certificate", handshake, output, sendSz,
+                           WRITE_PROTO, ssl->heap);
+    #endif
+
+    ssl->buffers.outputBuffer.length += sendSz;
+    if (!ssl->options.groupMessages)
+        ret = SendBuffered(ssl);
+
+    return ret;
+}
+#endif /* WOLFSSL_CERT_MSG_CACHE */
+
 /* handle generation of certificate (11) */
 int SendCertificate(WOLFSSL* ssl)
 {
@@ -14514,7 +16643,7 @@ int SendCertificate(WOLFSSL* ssl)
     word32 certSz, certChainSz, headerSz, listSz, payloadSz;
     word32 length, maxFragment;
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_SEND);
     WOLFSSL_ENTER("SendCertificate");
 
     if (ssl->options.usingPSK_cipher || ssl->options.usingAnon_cipher)
@@ -14577,6 +16706,21 @@ int SendCertificate(WOLFSSL* ssl)
 
     maxFragment = wolfSSL_GetMaxRecordSize(ssl, maxFragment);
 
+#ifdef WOLFSSL_CERT_MSG_CACHE
+    /* whole message in one plaintext record from the CTX's encoding */
+    if (certSz > 0 && ssl->fragOffset == 0 && !ssl->options.dtls &&
+                                                    !IsEncryptionOn(ssl, 1)) {
+        word32      msgSz = 0;
+        const byte* msg = GetCertMsgCache(ssl, CERT_MSG_TLS12, &msgSz);
+
+        if (msg != NULL && msgSz == payloadSz &&
+                                msgSz <= maxFragment - HANDSHAKE_HEADER_SZ) {
+            ret = SendCertificateCached(ssl, msg, msgSz);
+            length = 0;
+        }
+    }
+#endif
+
     while (length > 0 && ret == 0) {
         byte*  output = NULL;
         word32 fragSz = 0;
@@ -14766,7 +16910,7 @@ int SendCertificate(WOLFSSL* ssl)
     }
 
     WOLFSSL_LEAVE("SendCertificate", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_SEND);
 
     return ret;
 }
@@ -14787,7 +16931,7 @@ int SendCertificateRequest(WOLFSSL* ssl)
     int  typeTotal = 1;  /* only 1 for now */
     int  reqSz = ENUM_LEN + typeTotal + REQ_HEADER_SZ;  /* add auth later */
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_REQUEST_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_REQUEST_SEND);
     WOLFSSL_ENTER("SendCertificateRequest");
 
     if (IsAtLeastTLSv1_2(ssl))
@@ -14917,7 +17061,7 @@ int SendCertificateRequest(WOLFSSL* ssl)
         ret = SendBuffered(ssl);
 
     WOLFSSL_LEAVE("SendCertificateRequest", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_REQUEST_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_REQUEST_SEND);
 
     return ret;
 }
@@ -15033,7 +17177,7 @@ int SendCertificateStatus(WOLFSSL* ssl)
     int ret = 0;
     byte status_type = 0;
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_STATUS_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_STATUS_SEND);
     WOLFSSL_ENTER("SendCertificateStatus");
 
     (void) ssl;
@@ -15198,7 +17342,7 @@ int SendCertificateStatus(WOLFSSL* ssl)
     }
 
     WOLFSSL_LEAVE("SendCertificateStatus", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_STATUS_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_STATUS_SEND);
 
     return ret;
 }
@@ -15214,6 +17358,9 @@ int SendData(WOLFSSL* ssl, const void* data, int sz)
         ret,
         dtlsExtra = 0;
     int groupMsgs = 0;
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+    word32 now = 0;
+#endif
 
     if (ssl->error == WANT_WRITE
     #ifdef WOLFSSL_ASYNC_CRYPT
@@ -15279,6 +17426,14 @@ int SendData(WOLFSSL* ssl, const void* data, int sz)
             /* advance sent to previous sent + plain size just sent */
             sent = ssl->buffers.prevSent + ssl->buffers.plainSz;
             WOLFSSL_MSG("sent write buffered data");
+        #ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+            if (ssl->options.dynRecSmallSz > 0) {
+                if (ssl->options.dynRecSent < ssl->options.dynRecThreshold)
+                    ssl->options.dynRecSent += ssl->buffers.plainSz;
+                /* still in the burst, the idle timer starts again */
+                ssl->options.dynRecLastSend = LowResTimer();
+            }
+        #endif
 
             if (sent > sz) {
                 WOLFSSL_MSG("error: write() after WANT_WRITE with short size");
@@ -15293,6 +17448,17 @@ int SendData(WOLFSSL* ssl, const void* data, int sz)
     }
 #endif
 
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+    if (ssl->options.dynRecSmallSz > 0) {
+        /* after a pause the congestion window may have shrunk, so the
+         * first bytes of a new burst go out in small records again */
+        now = LowResTimer();
+        if (ssl->options.dynRecIdleSec > 0 &&
+              now - ssl->options.dynRecLastSend >= ssl->options.dynRecIdleSec)
+            ssl->options.dynRecSent = 0;
+    }
+#endif
+
     for (;;) {
         int   len;
         byte* out;
@@ -15311,6 +17477,14 @@ int SendData(WOLFSSL* ssl, const void* data, int sz)
         if (IsDtlsNotSctpMode(ssl)) {
             len = min(len, MAX_UDP_SIZE);
         }
+#endif
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+        /* small records can be decrypted as soon as their segment arrives */
+        if (ssl->options.dynRecSmallSz > 0 &&
+                ssl->options.dynRecSent < ssl->options.dynRecThreshold &&
+                len > ssl->options.dynRecSmallSz) {
+            len = ssl->options.dynRecSmallSz;
+        }
 #endif
         buffSz = len;
 
@@ -15370,6 +17544,13 @@ int SendData(WOLFSSL* ssl, const void* data, int sz)
         }
 
         sent += len;
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+        if (ssl->options.dynRecSmallSz > 0) {
+            if (ssl->options.dynRecSent < ssl->options.dynRecThreshold)
+                ssl->options.dynRecSent += len;
+            ssl->options.dynRecLastSend = now;
+        }
+#endif
 
         /* only one message per attempt */
         if (ssl->options.partialWrite == 1) {
@@ -15381,6 +17562,29 @@ int SendData(WOLFSSL* ssl, const void* data, int sz)
     return sent;
 }
 
+#ifdef WOLFSSL_READ_AHEAD
+/* Check whether the next record is application data that has been read
+ * ahead in full, so it can be processed without any I/O. */
+static int ReadAheadHasDataRecord(WOLFSSL* ssl)
+{
+    byte*  hdr;
+    word16 len;
+
+    if (ssl->options.processReply != doProcessInit ||
+            ssl->buffers.inputBuffer.idx != ssl->buffers.inputBuffer.length ||
+            ssl->buffers.inputAheadSz < RECORD_HEADER_SZ) {
+        return 0;
+    }
+
+    hdr = ssl->buffers.inputBuffer.buffer + ssl->buffers.inputBuffer.length;
+    if (hdr[0] != application_data)
+        return 0;
+    ato16(hdr + RECORD_HEADER_SZ - LENGTH_SZ, &len);
+
+    return ssl->buffers.inputAheadSz >= (word32)(RECORD_HEADER_SZ + len);
+}
+#endif
+
 /* process input data */
 int ReceiveData(WOLFSSL* ssl, byte* output, int sz, int peek)
 {
@@ -15406,6 +17610,15 @@ int ReceiveData(WOLFSSL* ssl, byte* output, int sz, int peek)
     }
 #endif /* WOLFSSL_DTLS */
 
+#ifdef WOLFSSL_READ_AHEAD
+    if (ssl->options.readBatchClose) {
+        /* close_notify came after the data returned by the last read */
+        ssl->options.readBatchClose = 0;
+        WOLFSSL_MSG("Zero return, no more data coming");
+        return 0;
+    }
+#endif
+
     if (ssl->error != 0 && ssl->error != WANT_WRITE) {
         WOLFSSL_MSG("User calling wolfSSL_read in error state, not allowed");
         return ssl->error;
@@ -15435,9 +17648,10 @@ startScr:
     if (ssl->secure_renegotiation && ssl->secure_renegotiation->startScr) {
         int err;
         WOLFSSL_MSG("Need to start scr, server requested");
+        /* only start once, a non-blocking handshake is finished above */
+        ssl->secure_renegotiation->startScr = 0;
         if ( (err = wolfSSL_Rehandshake(ssl)) != WOLFSSL_SUCCESS)
             return  err;
-        ssl->secure_renegotiation->startScr = 0;  /* only start once */
     }
 #endif
 
@@ -15458,6 +17672,22 @@ startScr:
             }
             return ssl->error;
         }
+    #if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH) && \
+        defined(WOLFSSL_ASYNC_CRYPT) && !defined(NO_WOLFSSL_CLIENT)
+        /* authentication requested after the handshake is waiting on the
+         * crypto device */
+        if (ssl->options.handShakeState != HANDSHAKE_DONE &&
+                ssl->options.side == WOLFSSL_CLIENT_END &&
+                IsAtLeastTLSv1_3(ssl->version)) {
+            int err;
+
+            if ( (err = wolfSSL_negotiate(ssl)) != WOLFSSL_SUCCESS) {
+                if (ssl->error == WC_PENDING_E)
+                    return WOLFSSL_CBIO_ERR_WANT_READ;
+                return err;
+            }
+        }
+    #endif
         #ifdef HAVE_SECURE_RENEGOTIATION
             if (ssl->secure_renegotiation &&
                 ssl->secure_renegotiation->startScr) {
@@ -15478,6 +17708,35 @@ startScr:
         ssl->buffers.clearOutputBuffer.buffer += size;
     }
 
+#ifdef WOLFSSL_READ_AHEAD
+    /* decrypt the data records already read into the rest of the output */
+    if (peek == 0 && ssl->options.readBatch && !ssl->options.dtls &&
+            ssl->options.handShakeState == HANDSHAKE_DONE) {
+        while (size < sz && ssl->buffers.clearOutputBuffer.length == 0 &&
+                                                ReadAheadHasDataRecord(ssl)) {
+            int more;
+
+            if ( (ssl->error = ProcessReply(ssl)) < 0) {
+                /* data already read is returned, error is on next call */
+                WOLFSSL_ERROR(ssl->error);
+                if (ssl->error == ZERO_RETURN)
+                    ssl->options.readBatchClose = 1;
+                break;
+            }
+            /* TLS v1.3 hides alerts and post-handshake messages in data
+             * records, they are left to be handled by the next read */
+            if (ssl->buffers.clearOutputBuffer.length == 0)
+                break;
+
+            more = min(sz - size, (int)ssl->buffers.clearOutputBuffer.length);
+            XMEMCPY(output + size, ssl->buffers.clearOutputBuffer.buffer, more);
+            ssl->buffers.clearOutputBuffer.length -= more;
+            ssl->buffers.clearOutputBuffer.buffer += more;
+            size += more;
+        }
+    }
+#endif
+
     if (ssl->buffers.clearOutputBuffer.length == 0 &&
                                            ssl->buffers.inputBuffer.dynamicFlag)
        ShrinkInputBuffer(ssl, NO_FORCED_FREE);
@@ -16013,6 +18272,21 @@ const char* wolfSSL_ERR_reason_error_string(unsigned long e)
     case TCA_ABSENT_ERROR:
         return "TLS Extension Trusted CA ID response absent";
 
+    case CLIENT_HELLO_CB_E:
+        return "ClientHello callback aborted the handshake";
+
+    case CLIENT_HELLO_WANT_CB:
+        return "ClientHello callback deferred, call again";
+
+    case HANDSHAKE_ADMISSION_E:
+        return "Full handshake refused, server overloaded";
+
+    case HANDSHAKE_ADMISSION_WANT:
+        return "Full handshake held back, server overloaded, call again";
+
+    case BAD_RECORD_SIZE_LIMIT_E:
+        return "Peer record size limit is too small";
+
     default :
         return "unknown error number";
     }
@@ -17239,7 +19513,7 @@ exit_dpk:
             return SendTls13ClientHello(ssl);
 #endif
 
-        WOLFSSL_START(WC_FUNC_CLIENT_HELLO_SEND);
+        HS_TIME_START(ssl, WC_FUNC_CLIENT_HELLO_SEND);
         WOLFSSL_ENTER("SendClientHello");
 
         if (ssl->suites == NULL) {
@@ -17461,7 +19735,7 @@ exit_dpk:
         ret = SendBuffered(ssl);
 
         WOLFSSL_LEAVE("SendClientHello", ret);
-        WOLFSSL_END(WC_FUNC_CLIENT_HELLO_SEND);
+        HS_TIME_END(ssl, WC_FUNC_CLIENT_HELLO_SEND);
 
         return ret;
     }
@@ -17662,7 +19936,7 @@ exit_dpk:
         word32          begin = i;
         int             ret;
 
-        WOLFSSL_START(WC_FUNC_SERVER_HELLO_DO);
+        HS_TIME_START(ssl, WC_FUNC_SERVER_HELLO_DO);
         WOLFSSL_ENTER("DoServerHello");
 
 #ifdef WOLFSSL_CALLBACKS
@@ -17852,7 +20126,7 @@ exit_dpk:
         ret = CompleteServerHello(ssl);
 
         WOLFSSL_LEAVE("DoServerHello", ret);
-        WOLFSSL_END(WC_FUNC_SERVER_HELLO_DO);
+        HS_TIME_END(ssl, WC_FUNC_SERVER_HELLO_DO);
 
         return ret;
     }
@@ -17918,6 +20192,11 @@ exit_dpk:
         else {
             if (DSH_CheckSessionId(ssl)) {
                 if (SetCipherSpecs(ssl) == 0) {
+            #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+                    ret = HashCommit(ssl, HashNegotiatedMask(ssl));
+                    if (ret != 0)
+                        return ret;
+            #endif
 
                     XMEMCPY(ssl->arrays->masterSecret,
                             ssl->session.masterSecret, SECRET_LEN);
@@ -17952,7 +20231,13 @@ exit_dpk:
         }
     #endif
 
-        return SetCipherSpecs(ssl);
+        ret = SetCipherSpecs(ssl);
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        if (ret == 0)
+            ret = HashCommit(ssl, HashNegotiatedMask(ssl));
+    #endif
+
+        return ret;
     }
 
 #endif /* WOLFSSL_NO_TLS12 */
@@ -17992,7 +20277,7 @@ exit_dpk:
         word16 len;
         word32 begin = *inOutIdx;
 
-        WOLFSSL_START(WC_FUNC_CERTIFICATE_REQUEST_DO);
+        HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_REQUEST_DO);
         WOLFSSL_ENTER("DoCertificateRequest");
 
         #ifdef WOLFSSL_CALLBACKS
@@ -18085,7 +20370,7 @@ exit_dpk:
             *inOutIdx += ssl->keys.padSz;
 
         WOLFSSL_LEAVE("DoCertificateRequest", 0);
-        WOLFSSL_END(WC_FUNC_CERTIFICATE_REQUEST_DO);
+        HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_REQUEST_DO);
 
         return 0;
     }
@@ -18374,7 +20659,7 @@ static int DoServerKeyExchange(WOLFSSL* ssl, const byte* input,
     (void)input;
     (void)size;
 
-    WOLFSSL_START(WC_FUNC_SERVER_KEY_EXCHANGE_DO);
+    HS_TIME_START(ssl, WC_FUNC_SERVER_KEY_EXCHANGE_DO);
     WOLFSSL_ENTER("DoServerKeyExchange");
 
 #ifdef WOLFSSL_ASYNC_CRYPT
@@ -19154,7 +21439,7 @@ static int DoServerKeyExchange(WOLFSSL* ssl, const byte* input,
 exit_dske:
 
     WOLFSSL_LEAVE("DoServerKeyExchange", ret);
-    WOLFSSL_END(WC_FUNC_SERVER_KEY_EXCHANGE_DO);
+    HS_TIME_END(ssl, WC_FUNC_SERVER_KEY_EXCHANGE_DO);
 
 #ifdef WOLFSSL_ASYNC_CRYPT
     /* Handle async operation */
@@ -19594,7 +21879,7 @@ int SendClientKeyExchange(WOLFSSL* ssl)
     SckeArgs  args[1];
 #endif
 
-    WOLFSSL_START(WC_FUNC_CLIENT_KEY_EXCHANGE_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CLIENT_KEY_EXCHANGE_SEND);
     WOLFSSL_ENTER("SendClientKeyExchange");
 
 #ifdef OPENSSL_EXTRA
@@ -20636,7 +22921,7 @@ int SendClientKeyExchange(WOLFSSL* ssl)
 exit_scke:
 
     WOLFSSL_LEAVE("SendClientKeyExchange", ret);
-    WOLFSSL_END(WC_FUNC_CLIENT_KEY_EXCHANGE_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CLIENT_KEY_EXCHANGE_SEND);
 
 #ifdef WOLFSSL_ASYNC_CRYPT
     /* Handle async operation */
@@ -20747,7 +23032,7 @@ int SendCertificateVerify(WOLFSSL* ssl)
     ScvArgs  args[1];
 #endif
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_VERIFY_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_VERIFY_SEND);
     WOLFSSL_ENTER("SendCertificateVerify");
 
 #ifdef WOLFSSL_ASYNC_CRYPT
@@ -21135,7 +23420,7 @@ int SendCertificateVerify(WOLFSSL* ssl)
 exit_scv:
 
     WOLFSSL_LEAVE("SendCertificateVerify", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_VERIFY_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_VERIFY_SEND);
 
 #ifdef WOLFSSL_ASYNC_CRYPT
     /* Handle async operation */
@@ -21277,7 +23562,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         byte   echoId   = 0;  /* ticket echo id flag */
         byte   cacheOff = 0;  /* session cache off flag */
 
-        WOLFSSL_START(WC_FUNC_SERVER_HELLO_SEND);
+        HS_TIME_START(ssl, WC_FUNC_SERVER_HELLO_SEND);
         WOLFSSL_ENTER("SendServerHello");
 
         length = VERSION_SZ + RAN_LEN
@@ -21494,7 +23779,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
             ret = SendBuffered(ssl);
 
         WOLFSSL_LEAVE("SendServerHello", ret);
-        WOLFSSL_END(WC_FUNC_SERVER_HELLO_SEND);
+        HS_TIME_END(ssl, WC_FUNC_SERVER_HELLO_SEND);
 
         return ret;
     }
@@ -21658,7 +23943,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         SskeArgs  args[1];
     #endif
 
-        WOLFSSL_START(WC_FUNC_SERVER_KEY_EXCHANGE_SEND);
+        HS_TIME_START(ssl, WC_FUNC_SERVER_KEY_EXCHANGE_SEND);
         WOLFSSL_ENTER("SendServerKeyExchange");
 
     #ifdef WOLFSSL_ASYNC_CRYPT
@@ -23036,7 +25321,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     exit_sske:
 
         WOLFSSL_LEAVE("SendServerKeyExchange", ret);
-        WOLFSSL_END(WC_FUNC_SERVER_KEY_EXCHANGE_SEND);
+        HS_TIME_END(ssl, WC_FUNC_SERVER_KEY_EXCHANGE_SEND);
 
     #ifdef WOLFSSL_ASYNC_CRYPT
         /* Handle async operation */
@@ -23206,26 +25491,141 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     }
 
 #ifndef NO_WOLFSSL_SERVER
+    /* Use the server's suite at index i if it is usable. */
+    static int UseServerSuite(WOLFSSL* ssl, Suites* peerSuites, word16 i)
+    {
+        if (VerifyServerSuite(ssl, i)) {
+            int result;
+            WOLFSSL_MSG("Verified suite validity");
+            ssl->options.cipherSuite0 = ssl->suites->suites[i];
+            ssl->options.cipherSuite  = ssl->suites->suites[i+1];
+            result = SetCipherSpecs(ssl);
+            if (result == 0)
+                PickHashSigAlgo(ssl, peerSuites->hashSigAlgo,
+                                peerSuites->hashSigAlgoSz);
+            return result;
+        }
+
+        WOLFSSL_MSG("Could not verify suite validity, continue");
+        return MATCH_SUITE_ERROR;
+    }
+
+/* Hash table of the server's suites so that each of the peer's suites is found
+ * with a short probe. Entries are the suite number in the list plus one. */
+#define SUITE_INDEX_SZ  256
+#define SUITE_INDEX_HASH(first, second) ((byte)((first) * 37 + (second)))
+
+#if WOLFSSL_MAX_SUITE_SZ / 2 <= SUITE_INDEX_SZ * 3 / 4
+    /* Index of a suite in the list or -1 when not in the table. */
+    static int SuiteIndexFind(const Suites* suites, const byte* index,
+                              byte first, byte second)
+    {
+        byte h = SUITE_INDEX_HASH(first, second);
+        int  i;
+
+        while (index[h] != 0) {
+            i = (index[h] - 1) * 2;
+            if (suites->suites[i] == first && suites->suites[i+1] == second)
+                return i;
+            h++;
+        }
+
+        return -1;
+    }
+
+    static void SuiteIndexBuild(const Suites* suites, byte* index)
+    {
+        word16 i;
+        byte   h;
+
+        XMEMSET(index, 0, SUITE_INDEX_SZ);
+
+        for (i = 0; i < suites->suiteSz; i += 2) {
+            /* keep the first of a repeated suite */
+            if (SuiteIndexFind(suites, index, suites->suites[i],
+                                              suites->suites[i+1]) >= 0) {
+                continue;
+            }
+            h = SUITE_INDEX_HASH(suites->suites[i], suites->suites[i+1]);
+            while (index[h] != 0)
+                h++;
+            index[h] = (byte)(i / 2 + 1);
+        }
+    }
+
+    int MatchSuite(WOLFSSL* ssl, Suites* peerSuites)
+    {
+        int    ret = MATCH_SUITE_ERROR;
+        int    k;
+        word16 i, j;
+        byte   offered[(WOLFSSL_MAX_SUITE_SZ / 2 + 7) / 8];
+    #ifdef WOLFSSL_SMALL_STACK
+        byte*  index;
+    #else
+        byte   index[SUITE_INDEX_SZ];
+    #endif
+
+        WOLFSSL_ENTER("MatchSuite");
+
+        /* & 0x1 equivalent % 2 */
+        if (peerSuites->suiteSz == 0 || peerSuites->suiteSz & 0x1)
+            return MATCH_SUITE_ERROR;
+
+        if (ssl->suites == NULL)
+            return SUITES_ERROR;
+
+    #ifdef WOLFSSL_SMALL_STACK
+        index = (byte*)XMALLOC(SUITE_INDEX_SZ, ssl->heap,
+                                                       DYNAMIC_TYPE_TMP_BUFFER);
+        if (index == NULL)
+            return MEMORY_E;
+    #endif
+
+        SuiteIndexBuild(ssl->suites, index);
+
+        if (!ssl->options.useClientOrder) {
+            /* Server order - mark the server's suites that the peer offers */
+            XMEMSET(offered, 0, sizeof(offered));
+            for (j = 0; j < peerSuites->suiteSz; j += 2) {
+                k = SuiteIndexFind(ssl->suites, index, peerSuites->suites[j],
+                                                       peerSuites->suites[j+1]);
+                if (k >= 0)
+                    offered[k / 16] |= (byte)(1 << ((k / 2) % 8));
+            }
+            for (i = 0; i < ssl->suites->suiteSz; i += 2) {
+                if (offered[i / 16] & (1 << ((i / 2) % 8))) {
+                    ret = UseServerSuite(ssl, peerSuites, i);
+                    if (ret != MATCH_SUITE_ERROR)
+                        break;
+                }
+            }
+        }
+        else {
+            /* Client order */
+            for (j = 0; j < peerSuites->suiteSz; j += 2) {
+                k = SuiteIndexFind(ssl->suites, index, peerSuites->suites[j],
+                                                       peerSuites->suites[j+1]);
+                if (k >= 0) {
+                    ret = UseServerSuite(ssl, peerSuites, (word16)k);
+                    if (ret != MATCH_SUITE_ERROR)
+                        break;
+                }
+            }
+        }
+
+    #ifdef WOLFSSL_SMALL_STACK
+        XFREE(index, ssl->heap, DYNAMIC_TYPE_TMP_BUFFER);
+    #endif
+
+        return ret;
+    }
+#else
     static int CompareSuites(WOLFSSL* ssl, Suites* peerSuites, word16 i,
                              word16 j)
     {
         if (ssl->suites->suites[i]   == peerSuites->suites[j] &&
             ssl->suites->suites[i+1] == peerSuites->suites[j+1] ) {
-
-            if (VerifyServerSuite(ssl, i)) {
-                int result;
-                WOLFSSL_MSG("Verified suite validity");
-                ssl->options.cipherSuite0 = ssl->suites->suites[i];
-                ssl->options.cipherSuite  = ssl->suites->suites[i+1];
-                result = SetCipherSpecs(ssl);
-                if (result == 0)
-                    PickHashSigAlgo(ssl, peerSuites->hashSigAlgo,
-                                    peerSuites->hashSigAlgoSz);
-                return result;
-            }
-            else {
-                WOLFSSL_MSG("Could not verify suite validity, continue");
-            }
+            return UseServerSuite(ssl, peerSuites, i);
         }
 
         return MATCH_SUITE_ERROR;
@@ -23268,6 +25668,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
 
         return MATCH_SUITE_ERROR;
     }
+#endif /* WOLFSSL_MAX_SUITE_SZ / 2 <= SUITE_INDEX_SZ * 3 / 4 */
 #endif
 
 #ifdef OLD_HELLO_ALLOWED
@@ -23463,11 +25864,19 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
                             ret = DeriveKeys(ssl);
                 #endif
                 ssl->options.clientState = CLIENT_KEYEXCHANGE_COMPLETE;
+            #ifdef WOLFSSL_HANDSHAKE_ADMISSION
+                if (ret == 0)
+                    ret = HsAdmit(ssl, 1);
+            #endif
 
                 return ret;
             }
         }
 
+    #ifdef WOLFSSL_HANDSHAKE_ADMISSION
+        if ((ret = HsAdmit(ssl, 0)) != 0)
+            return ret;
+    #endif
         ret = MatchSuite(ssl, &clSuites);
         if (ret != 0)return ret;
         return SanityCheckMsgReceived(ssl, client_hello);
@@ -23525,6 +25934,11 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
                 WOLFSSL_MSG("Unsupported cipher suite, ClientHello");
                 return UNSUPPORTED_SUITE;
             }
+        #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+            ret = HashCommit(ssl, HashNegotiatedMask(ssl));
+            if (ret != 0)
+                return ret;
+        #endif
 
             ret = wc_RNG_GenerateBlock(ssl->rng, ssl->arrays->serverRandom,
                                                                        RAN_LEN);
@@ -23542,12 +25956,110 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
                         ret = DeriveKeys(ssl);
             #endif
             ssl->options.clientState = CLIENT_KEYEXCHANGE_COMPLETE;
+        #ifdef WOLFSSL_HANDSHAKE_ADMISSION
+            if (ret == 0)
+                ret = HsAdmit(ssl, 1);
+        #endif
         }
 
         return ret;
     }
 
 
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+    /* Find the fields of a ClientHello and let the application's callback
+     * look at them before any of the message is processed, so that rejecting
+     * it costs no hashing, extension handling or key exchange.
+     * returns 0 to carry on, CLIENT_HELLO_WANT_CB when the callback wants to
+     * be called again for the same message, otherwise an error */
+    int DoClientHelloCb(WOLFSSL* ssl, const byte* input, word32 helloSz)
+    {
+        ClientHelloInfo info;
+        word32          i = 0;
+        int             alertType = handshake_failure;
+        int             ret;
+
+        WOLFSSL_ENTER("DoClientHelloCb");
+
+        XMEMSET(&info, 0, sizeof(info));
+
+        if (OPAQUE16_LEN + RAN_LEN + OPAQUE8_LEN > helloSz)
+            return BUFFER_ERROR;
+
+        info.version.major = input[i++];
+        info.version.minor = input[i++];
+        info.random = input + i;
+        i += RAN_LEN;
+
+        info.sessionIdSz = input[i++];
+        if (info.sessionIdSz > ID_LEN || i + info.sessionIdSz > helloSz)
+            return BUFFER_ERROR;
+        info.sessionId = input + i;
+        i += info.sessionIdSz;
+
+    #ifdef WOLFSSL_DTLS
+        if (ssl->options.dtls) {
+            /* cookie */
+            if (i + OPAQUE8_LEN > helloSz)
+                return BUFFER_ERROR;
+            i += OPAQUE8_LEN + input[i];
+            if (i > helloSz)
+                return BUFFER_ERROR;
+        }
+    #endif
+
+        if (i + OPAQUE16_LEN > helloSz)
+            return BUFFER_ERROR;
+        ato16(input + i, &info.suitesSz);
+        i += OPAQUE16_LEN;
+        if (i + info.suitesSz > helloSz)
+            return BUFFER_ERROR;
+        info.suites = input + i;
+        i += info.suitesSz;
+
+        if (i + OPAQUE8_LEN > helloSz)
+            return BUFFER_ERROR;
+        info.compSz = input[i++];
+        if (i + info.compSz > helloSz)
+            return BUFFER_ERROR;
+        info.comp = input + i;
+        i += info.compSz;
+
+        if (i < helloSz) {
+            if (i + OPAQUE16_LEN > helloSz)
+                return BUFFER_ERROR;
+            ato16(input + i, &info.extsSz);
+            i += OPAQUE16_LEN;
+            if (i + info.extsSz > helloSz)
+                return BUFFER_ERROR;
+            info.exts = input + i;
+        }
+
+        ssl->clientHello = &info;
+        ret = ssl->ctx->clientHelloCb(ssl, &alertType,
+                                                 ssl->ctx->clientHelloCbArg);
+        ssl->clientHello = NULL;
+
+        if (ret == WOLFSSL_CLIENT_HELLO_SUCCESS) {
+            ssl->options.clientHelloCbDone = 1;
+            ret = 0;
+        }
+        else if (ret == WOLFSSL_CLIENT_HELLO_RETRY && !ssl->options.dtls) {
+            WOLFSSL_MSG("ClientHello callback deferred the handshake");
+            ret = CLIENT_HELLO_WANT_CB;
+        }
+        else {
+            /* DTLS drops the record, so can't wait for the callback */
+            WOLFSSL_MSG("ClientHello callback aborted the handshake");
+            SendAlert(ssl, alert_fatal, alertType);
+            ret = CLIENT_HELLO_CB_E;
+        }
+
+        WOLFSSL_LEAVE("DoClientHelloCb", ret);
+        return ret;
+    }
+#endif /* WOLFSSL_CLIENT_HELLO_CB */
+
     /* handle processing of client_hello (1) */
     int DoClientHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
                              word32 helloSz)
@@ -23569,7 +26081,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         XMEMSET(&cookieHmac, 0, sizeof(Hmac));
 #endif /* WOLFSSL_DTLS */
 
-        WOLFSSL_START(WC_FUNC_CLIENT_HELLO_DO);
+        HS_TIME_START(ssl, WC_FUNC_CLIENT_HELLO_DO);
         WOLFSSL_ENTER("DoClientHello");
 
 #ifdef WOLFSSL_CALLBACKS
@@ -24050,12 +26562,21 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
 
             if (ssl->options.clientState == CLIENT_KEYEXCHANGE_COMPLETE) {
                 WOLFSSL_LEAVE("DoClientHello", ret);
-                WOLFSSL_END(WC_FUNC_CLIENT_HELLO_DO);
+                HS_TIME_END(ssl, WC_FUNC_CLIENT_HELLO_DO);
 
                 return ret;
             }
         }
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+        /* full handshake - before any key exchange or signing for it */
+        if ((ret = HsAdmit(ssl, 0)) != 0)
+            return ret;
+#endif
         ret = MatchSuite(ssl, &clSuites);
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        if (ret == 0)
+            ret = HashCommit(ssl, HashNegotiatedMask(ssl));
+#endif
 
 #if defined(HAVE_FFDHE) && defined(HAVE_SUPPORTED_CURVES)
         if (ret == 0 && (ssl->specs.kea == diffie_hellman_kea ||
@@ -24071,7 +26592,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     }
 #endif
         WOLFSSL_LEAVE("DoClientHello", ret);
-        WOLFSSL_END(WC_FUNC_CLIENT_HELLO_DO);
+        HS_TIME_END(ssl, WC_FUNC_CLIENT_HELLO_DO);
 
         return ret;
     }
@@ -24112,7 +26633,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         DcvArgs  args[1];
     #endif
 
-        WOLFSSL_START(WC_FUNC_CERTIFICATE_VERIFY_DO);
+        HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_VERIFY_DO);
         WOLFSSL_ENTER("DoCertificateVerify");
 
     #ifdef WOLFSSL_ASYNC_CRYPT
@@ -24403,7 +26924,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     exit_dcv:
 
         WOLFSSL_LEAVE("DoCertificateVerify", ret);
-        WOLFSSL_END(WC_FUNC_CERTIFICATE_VERIFY_DO);
+        HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_VERIFY_DO);
 
     #ifdef WOLFSSL_ASYNC_CRYPT
         /* Handle async operation */
@@ -24439,7 +26960,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         int   sendSz = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
         int   ret;
 
-        WOLFSSL_START(WC_FUNC_SERVER_HELLO_DONE_SEND);
+        HS_TIME_START(ssl, WC_FUNC_SERVER_HELLO_DONE_SEND);
         WOLFSSL_ENTER("SendServerHelloDone");
 
     #ifdef WOLFSSL_DTLS
@@ -24503,7 +27024,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         ret = SendBuffered(ssl);
 
         WOLFSSL_LEAVE("SendServerHelloDone", ret);
-        WOLFSSL_END(WC_FUNC_SERVER_HELLO_DONE_SEND);
+        HS_TIME_END(ssl, WC_FUNC_SERVER_HELLO_DONE_SEND);
 
         return ret;
     }
@@ -24656,7 +27177,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         int             outLen;
         word16          inLen;
 
-        WOLFSSL_START(WC_FUNC_TICKET_DO);
+        HS_TIME_START(ssl, WC_FUNC_TICKET_DO);
         WOLFSSL_ENTER("DoClientTicket");
 
         if (len > SESSION_TICKET_LEN ||
@@ -24730,7 +27251,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         }
 
         WOLFSSL_LEAVE("DoClientTicket", ret);
-        WOLFSSL_END(WC_FUNC_TICKET_DO);
+        HS_TIME_END(ssl, WC_FUNC_TICKET_DO);
 
         return ret;
     }
@@ -24745,7 +27266,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         word32             length = SESSION_HINT_SZ + LENGTH_SZ;
         word32             idx    = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
 
-        WOLFSSL_START(WC_FUNC_TICKET_SEND);
+        HS_TIME_START(ssl, WC_FUNC_TICKET_SEND);
         WOLFSSL_ENTER("SendTicket");
 
         if (ssl->options.createTicket) {
@@ -24823,7 +27344,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         ret = SendBuffered(ssl);
 
         WOLFSSL_LEAVE("SendTicket", ret);
-        WOLFSSL_END(WC_FUNC_TICKET_SEND);
+        HS_TIME_END(ssl, WC_FUNC_TICKET_SEND);
 
         return ret;
     }
@@ -24843,7 +27364,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         int sendSz = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
         int ret;
 
-        WOLFSSL_START(WC_FUNC_HELLO_REQUEST_SEND);
+        HS_TIME_START(ssl, WC_FUNC_HELLO_REQUEST_SEND);
         WOLFSSL_ENTER("SendHelloRequest");
 
         if (IsEncryptionOn(ssl, 1))
@@ -24881,7 +27402,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         ret = SendBuffered(ssl);
 
         WOLFSSL_LEAVE("SendHelloRequest", ret);
-        WOLFSSL_END(WC_FUNC_HELLO_REQUEST_SEND);
+        HS_TIME_END(ssl, WC_FUNC_HELLO_REQUEST_SEND);
 
         return ret;
     }
@@ -24939,6 +27460,203 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
 
         return SendBuffered(ssl);
     }
+
+#ifdef WOLFSSL_DTLS_DEMUX
+    /* Check the cookie of a DTLS ClientHello without any state for the peer.
+     * The cookie is the HMAC DoClientHello() calculates, so an SSL object
+     * with the same secret accepts it. Only a whole ClientHello in the first
+     * record of the datagram is looked at.
+     *
+     * ctx       The SSL/TLS context of the server.
+     * secret    Cookie secret.
+     * secretSz  Size of the cookie secret in bytes.
+     * peer      Address of the peer.
+     * peerSz    Size of the address in bytes.
+     * input     Datagram received from the peer.
+     * sz        Size of the datagram in bytes.
+     * hvr       Buffer to hold a HelloVerifyRequest datagram.
+     * hvrSz     On in, size of the buffer. On out, size of the datagram.
+     * returns 1 when the cookie is good, 0 when hvr is to be sent to the peer,
+     * BUFFER_ERROR when the datagram is not a ClientHello and other negative
+     * values on failure.
+     */
+    int DtlsCheckHelloCookie(WOLFSSL_CTX* ctx, const byte* secret,
+                             word32 secretSz, const byte* peer, word32 peerSz,
+                             const byte* input, word32 sz, byte* hvr,
+                             word32* hvrSz)
+    {
+        Hmac        cookieHmac;
+        byte        cookie[MAX_COOKIE_LEN];
+        int         cookieType;
+        byte        cookieSz;
+        const byte* peerCookie;
+        byte        peerCookieSz;
+        word32      recSz;
+        word32      helloSz;
+        word32      fragOffset;
+        word32      fragSz;
+        word32      begin;
+        word32      end;
+        word32      i;
+        word32      sessIdx;
+        word32      suitesIdx;
+        word32      compIdx;
+        word16      len;
+        word32      length;
+        int         ret;
+
+        if (sz < DTLS_RECORD_HEADER_SZ + DTLS_HANDSHAKE_HEADER_SZ)
+            return BUFFER_ERROR;
+
+        /* plaintext handshake record of epoch 0 holding a whole ClientHello */
+        ato16(input + DTLS_RECORD_HEADER_SZ - LENGTH_SZ, &len);
+        recSz = len;
+        if (input[0] != handshake || input[1] != DTLS_MAJOR ||
+                input[3] != 0 || input[4] != 0 ||
+                recSz < DTLS_HANDSHAKE_HEADER_SZ ||
+                recSz > sz - DTLS_RECORD_HEADER_SZ)
+            return BUFFER_ERROR;
+        i = DTLS_RECORD_HEADER_SZ;
+        if (input[i] != client_hello)
+            return BUFFER_ERROR;
+        c24to32(input + i + ENUM_LEN, &helloSz);
+        c24to32(input + i + ENUM_LEN + OPAQUE24_LEN + OPAQUE16_LEN,
+                &fragOffset);
+        c24to32(input + i + DTLS_HANDSHAKE_HEADER_SZ - OPAQUE24_LEN, &fragSz);
+        if (fragOffset != 0 || fragSz != helloSz ||
+                helloSz > recSz - DTLS_HANDSHAKE_HEADER_SZ)
+            return BUFFER_ERROR;
+        begin = i + DTLS_HANDSHAKE_HEADER_SZ;
+        end = begin + helloSz;
+
+        /* protocol version, random and session id, whose length is 0 or
+         * ID_LEN unless a bogus id is echoed for session tickets */
+        i = begin + OPAQUE16_LEN + RAN_LEN;
+        if (i + OPAQUE8_LEN > end || input[i] > ID_LEN ||
+                i + OPAQUE8_LEN + input[i] > end)
+            return BUFFER_ERROR;
+    #ifndef HAVE_SESSION_TICKET
+        if (input[i] != 0 && input[i] != ID_LEN)
+            return BUFFER_ERROR;
+    #endif
+        sessIdx = i;
+        i += OPAQUE8_LEN + input[i];
+
+        /* cookie */
+        if (i + OPAQUE8_LEN > end)
+            return BUFFER_ERROR;
+        peerCookieSz = input[i];
+        if (peerCookieSz > MAX_COOKIE_LEN ||
+                i + OPAQUE8_LEN + peerCookieSz > end)
+            return BUFFER_ERROR;
+        peerCookie = input + i + OPAQUE8_LEN;
+        i += OPAQUE8_LEN + peerCookieSz;
+
+        /* cipher suites */
+        if (i + OPAQUE16_LEN > end)
+            return BUFFER_ERROR;
+        ato16(input + i, &len);
+        if (len == 0 || (len % SUITE_LEN) != 0 || i + OPAQUE16_LEN + len > end)
+            return BUFFER_ERROR;
+        suitesIdx = i;
+        i += OPAQUE16_LEN + len;
+
+        /* compression methods */
+        if (i + OPAQUE8_LEN > end || input[i] == 0 ||
+                i + OPAQUE8_LEN + input[i] > end)
+            return BUFFER_ERROR;
+        compIdx = i;
+
+    #if !defined(NO_SHA) && defined(NO_SHA256)
+        cookieType = WC_SHA;
+        cookieSz = WC_SHA_DIGEST_SIZE;
+    #endif /* NO_SHA */
+    #ifndef NO_SHA256
+        cookieType = WC_SHA256;
+        cookieSz = WC_SHA256_DIGEST_SIZE;
+    #endif /* NO_SHA256 */
+
+        /* same fields, in the same order, as DoClientHello(): an empty
+         * session id is left out */
+        ret = wc_HmacInit(&cookieHmac, ctx->heap, INVALID_DEVID);
+        if (ret != 0)
+            return ret;
+        ret = wc_HmacSetKey(&cookieHmac, cookieType, secret, secretSz);
+        if (ret == 0)
+            ret = wc_HmacUpdate(&cookieHmac, peer, peerSz);
+        if (ret == 0)
+            ret = wc_HmacUpdate(&cookieHmac, input + begin,
+                                OPAQUE16_LEN + RAN_LEN);
+        if (ret == 0 && input[sessIdx] != 0)
+            ret = wc_HmacUpdate(&cookieHmac, input + sessIdx,
+                                OPAQUE8_LEN + input[sessIdx]);
+        if (ret == 0)
+            ret = wc_HmacUpdate(&cookieHmac, input + suitesIdx,
+                                OPAQUE16_LEN + len);
+        if (ret == 0)
+            ret = wc_HmacUpdate(&cookieHmac, input + compIdx,
+                                OPAQUE8_LEN + input[compIdx]);
+        if (ret == 0)
+            ret = wc_HmacFinal(&cookieHmac, cookie);
+        wc_HmacFree(&cookieHmac);
+        if (ret != 0)
+            return ret;
+
+        if (peerCookieSz == cookieSz &&
+                ConstantCompare(peerCookie, cookie, cookieSz) == 0)
+            return 1;
+
+        /* HelloVerifyRequest with the sequence number of the ClientHello */
+        length = VERSION_SZ + ENUM_LEN + cookieSz;
+        if (*hvrSz < DTLS_RECORD_HEADER_SZ + DTLS_HANDSHAKE_HEADER_SZ + length)
+            return BUFFER_E;
+        XMEMCPY(hvr, input, DTLS_RECORD_HEADER_SZ - LENGTH_SZ);
+        hvr[1] = ctx->method->version.major;
+        hvr[2] = ctx->method->version.minor;
+        c16toa((word16)(DTLS_HANDSHAKE_HEADER_SZ + length),
+               hvr + DTLS_RECORD_HEADER_SZ - LENGTH_SZ);
+        i = DTLS_RECORD_HEADER_SZ;
+        hvr[i++] = hello_verify_request;
+        c32to24(length, hvr + i);
+        i += OPAQUE24_LEN;
+        c16toa(0, hvr + i);
+        i += OPAQUE16_LEN;
+        c32to24(0, hvr + i);
+        i += OPAQUE24_LEN;
+        c32to24(length, hvr + i);
+        i += OPAQUE24_LEN;
+    #ifdef OPENSSL_EXTRA
+        hvr[i++] = DTLS_MAJOR;
+        hvr[i++] = DTLS_MINOR;
+    #else
+        hvr[i++] = ctx->method->version.major;
+        hvr[i++] = ctx->method->version.minor;
+    #endif
+        hvr[i++] = cookieSz;
+        XMEMCPY(hvr + i, cookie, cookieSz);
+        *hvrSz = i + cookieSz;
+
+        return 0;
+    }
+
+    /* Put a new SSL object in the state of having sent a HelloVerifyRequest
+     * in answer to the ClientHello that came before this one.
+     *
+     * ssl    The SSL/TLS object.
+     * input  Datagram holding the ClientHello with a good cookie.
+     */
+    void DtlsSetHelloVerifySent(WOLFSSL* ssl, const byte* input)
+    {
+        /* HelloVerifyRequest was handshake message 0 and had the sequence
+         * number of the first ClientHello, which is less than this one's. */
+        ssl->keys.dtls_handshake_number = 1;
+        /* record header: type, version, epoch, sequence number */
+        ato16(input + ENUM_LEN + VERSION_SZ + OPAQUE16_LEN,
+              &ssl->keys.dtls_sequence_number_hi);
+        ato32(input + ENUM_LEN + VERSION_SZ + OPAQUE16_LEN + OPAQUE16_LEN,
+              &ssl->keys.dtls_sequence_number_lo);
+    }
+#endif /* WOLFSSL_DTLS_DEMUX */
 #endif /* WOLFSSL_DTLS */
 
     typedef struct DckeArgs {
@@ -24976,7 +27694,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         (void)size;
         (void)input;
 
-        WOLFSSL_START(WC_FUNC_CLIENT_KEY_EXCHANGE_DO);
+        HS_TIME_START(ssl, WC_FUNC_CLIENT_KEY_EXCHANGE_DO);
         WOLFSSL_ENTER("DoClientKeyExchange");
 
     #ifdef WOLFSSL_ASYNC_CRYPT
@@ -25998,7 +28716,7 @@ static int DoSessionTicket(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     exit_dcke:
 
         WOLFSSL_LEAVE("DoClientKeyExchange", ret);
-        WOLFSSL_END(WC_FUNC_CLIENT_KEY_EXCHANGE_DO);
+        HS_TIME_END(ssl, WC_FUNC_CLIENT_KEY_EXCHANGE_DO);
 
     #ifdef WOLFSSL_ASYNC_CRYPT
         /* Handle async operation */
@@ -26153,6 +28871,17 @@ int wolfSSL_GetMaxRecordSize(WOLFSSL* ssl, int maxFragment)
         maxFragment = ssl->max_fragment;
     }
 #endif /* HAVE_MAX_FRAGMENT */
+#ifdef HAVE_RECORD_SIZE_LIMIT
+    if (ssl->peerRecordSizeLimit != 0) {
+        int limit = ssl->peerRecordSizeLimit;
+
+        /* TLS v1.3 inner plaintext includes the content type */
+        if (IsAtLeastTLSv1_3(ssl->version))
+            limit--;
+        if (maxFragment > limit)
+            maxFragment = limit;
+    }
+#endif /* HAVE_RECORD_SIZE_LIMIT */
 #ifdef WOLFSSL_DTLS
     if ((ssl->options.dtls) && (maxFragment > MAX_UDP_SIZE)) {
         maxFragment = MAX_UDP_SIZE;
@@ -2925,6 +2925,104 @@ static int SetAuthKeys(OneTimeAuth* authentication, Keys* keys,
 }
 #endif /* HAVE_ONE_TIME_AUTH */
 
+#ifdef WOLFSSL_TLS_HMAC_CACHE
+/* Key the record MAC HMAC of one direction and hash the inner pad so that
+ * each record's MAC starts from a copy of it.
+ *
+ * hmac    The HMAC object, allocated when NULL.
+ * type    The HMAC hash type.
+ * secret  The MAC secret.
+ * sz      The size of the MAC secret.
+ * heap    The heap hint.
+ * returns 0 on success, otherwise failure.
+ */
+static int SetMacKey(Hmac** hmac, int type, const byte* secret, word32 sz,
+                     void* heap)
+{
+    int ret;
+
+    if (*hmac == NULL) {
+        *hmac = (Hmac*)XMALLOC(sizeof(Hmac), heap, DYNAMIC_TYPE_CIPHER);
+        if (*hmac == NULL)
+            return MEMORY_E;
+    }
+    else
+        wc_HmacFree(*hmac);
+
+    ret = wc_HmacInit(*hmac, heap, INVALID_DEVID);
+    if (ret == 0)
+        ret = wc_HmacSetKey(*hmac, type, secret, sz);
+    if (ret == 0)
+        ret = wc_HmacUpdate(*hmac, NULL, 0);
+    if (ret != 0) {
+        wc_HmacFree(*hmac);
+        XFREE(*hmac, heap, DYNAMIC_TYPE_CIPHER);
+        *hmac = NULL;
+    }
+
+    return ret;
+}
+
+/* Free the keyed record MAC HMAC of one direction. */
+static void FreeMacKey(Hmac** hmac, void* heap)
+{
+    if (*hmac != NULL) {
+        wc_HmacFree(*hmac);
+        XFREE(*hmac, heap, DYNAMIC_TYPE_CIPHER);
+        *hmac = NULL;
+    }
+
+    (void)heap;
+}
+
+/* Set the keyed record MAC HMACs of the sides being provisioned.
+ * Only TLS v1.0 - v1.2 stream and block ciphers MAC records with HMAC.
+ * Crypto devices and multicast peers with their own keys use the MAC secret
+ * directly.
+ */
+static int SetMacKeys(WOLFSSL* ssl, Ciphers* enc, Ciphers* dec, Keys* keys)
+{
+    int         ret = 0;
+    int         type = wolfSSL_GetHmacType(ssl);
+    const byte* encSecret;
+    const byte* decSecret;
+
+    if (!ssl->options.tls || ssl->options.tls1_3 ||
+            ssl->specs.cipher_type == aead || ssl->specs.hash_size == 0 ||
+            ssl->devId != INVALID_DEVID || type < 0
+        #ifdef WOLFSSL_MULTICAST
+            || ssl->options.haveMcast
+        #endif
+            ) {
+        if (enc)
+            FreeMacKey(&enc->hmac, ssl->heap);
+        if (dec)
+            FreeMacKey(&dec->hmac, ssl->heap);
+        return 0;
+    }
+
+    if (ssl->options.side == WOLFSSL_CLIENT_END) {
+        encSecret = keys->client_write_MAC_secret;
+        decSecret = keys->server_write_MAC_secret;
+    }
+    else {
+        encSecret = keys->server_write_MAC_secret;
+        decSecret = keys->client_write_MAC_secret;
+    }
+
+    if (enc) {
+        ret = SetMacKey(&enc->hmac, type, encSecret, ssl->specs.hash_size,
+                        ssl->heap);
+    }
+    if (ret == 0 && dec) {
+        ret = SetMacKey(&dec->hmac, type, decSecret, ssl->specs.hash_size,
+                        ssl->heap);
+    }
+
+    return ret;
+}
+#endif /* WOLFSSL_TLS_HMAC_CACHE */
+
 #ifdef HAVE_SECURE_RENEGOTIATION
 /* function name is for cache_status++
  * This function was added because of error incrementing enum type when
@@ -3042,6 +3140,10 @@ int SetKeysSide(WOLFSSL* ssl, enum encrypt_side side)
 
     ret = SetKeys(wc_encrypt, wc_decrypt, keys, &ssl->specs, ssl->options.side,
                   ssl->heap, ssl->devId, ssl->rng, ssl->options.tls1_3);
+#ifdef WOLFSSL_TLS_HMAC_CACHE
+    if (ret == 0)
+        ret = SetMacKeys(ssl, wc_encrypt, wc_decrypt, keys);
+#endif
 
 #ifdef HAVE_SECURE_RENEGOTIATION
     if (copy) {
@@ -32,6 +32,13 @@
     #include <errno.h>
 #endif
 
+#ifdef WOLFSSL_SENDFILE
+    #include <limits.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
 #include <wolfssl/internal.h>
 #include <wolfssl/error-ssl.h>
 #include <wolfssl/wolfcrypt/coding.h>
@@ -1285,6 +1292,24 @@ int wolfSSL_METHOD_GetObjectSize(void)
 #endif
 
 
+/* Get the number of bytes of memory currently held by the SSL object.
+ * Includes the object itself, handshake state, keys, ciphers and the I/O
+ * buffers. Memory shared with the CTX is not included.
+ *
+ * ssl  The SSL/TLS object.
+ * returns BAD_FUNC_ARG when ssl is NULL and the number of bytes otherwise.
+ */
+int wolfSSL_GetMemoryUsage(WOLFSSL* ssl)
+{
+    WOLFSSL_ENTER("wolfSSL_GetMemoryUsage");
+
+    if (ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    return (int)SSL_MemoryUsage(ssl);
+}
+
+
 #ifdef WOLFSSL_STATIC_MEMORY
 
 int wolfSSL_CTX_load_static_memory(WOLFSSL_CTX** ctx, wolfSSL_method_func method,
@@ -1783,6 +1808,107 @@ int wolfSSL_write(WOLFSSL* ssl, const void* data, int sz)
         return ret;
 }
 
+#ifdef WOLFSSL_SENDFILE
+/* Send sz bytes of the file fd starting at offset as application data.
+ *
+ * With kernel TLS sending records the file goes straight from the page cache
+ * to the socket with sendfile(2). Otherwise the range is mapped and records
+ * are built straight from the mapping, saving the copy of reading the file
+ * into a user buffer first.
+ * On WANT_WRITE call again with the same offset and sz, as with
+ * wolfSSL_write().
+ *
+ * returns the number of bytes sent, which may be less than sz when the kernel
+ * sends the file, or WOLFSSL_FATAL_ERROR with the error in ssl->error.
+ */
+int wolfSSL_sendfile(WOLFSSL* ssl, int fd, long offset, int sz)
+{
+    int    ret;
+    long   pageSz;
+    long   start;
+    size_t mapSz;
+    off_t  end;
+    void*  map;
+    struct stat st;
+
+    WOLFSSL_ENTER("wolfSSL_sendfile()");
+
+    if (ssl == NULL || fd < 0 || offset < 0 || sz < 0)
+        return BAD_FUNC_ARG;
+    /* end of the range has to fit in a file offset */
+    if (offset > LONG_MAX - sz) {
+        WOLFSSL_MSG("File range too big for a file offset");
+        return BAD_FUNC_ARG;
+    }
+    end = (off_t)(offset + sz);
+    if (end < 0 || (long)end != offset + sz) {
+        WOLFSSL_MSG("File range too big for a file offset");
+        return BAD_FUNC_ARG;
+    }
+    if (sz == 0)
+        return 0;
+
+    /* touching a mapping past the end of the file raises SIGBUS */
+    if (fstat(fd, &st) != 0 || end > st.st_size) {
+        WOLFSSL_MSG("File range past end of file");
+        return WOLFSSL_BAD_FILE;
+    }
+
+#ifdef WOLFSSL_KTLS
+    if (ssl->options.ktlsTx) {
+        /* records already built go out first */
+        if (ssl->buffers.outputBuffer.length > 0) {
+            if ((ssl->error = SendBuffered(ssl)) != 0)
+                return WOLFSSL_FATAL_ERROR;
+        }
+
+        do {
+            ret = EmbedKtlsSendFile(ssl, fd, offset, sz);
+        } while (ret == WOLFSSL_CBIO_ERR_ISR);
+
+        if (ret < 0) {
+            if (ret == WOLFSSL_CBIO_ERR_WANT_WRITE)
+                ssl->error = WANT_WRITE;
+            else {
+                if (ret == WOLFSSL_CBIO_ERR_CONN_RST ||
+                                            ret == WOLFSSL_CBIO_ERR_CONN_CLOSE)
+                    ssl->options.connReset = 1;
+                ssl->error = SOCKET_ERROR_E;
+            }
+            ret = WOLFSSL_FATAL_ERROR;
+        }
+
+        WOLFSSL_LEAVE("wolfSSL_sendfile()", ret);
+        return ret;
+    }
+#endif
+
+    pageSz = sysconf(_SC_PAGESIZE);
+    if (pageSz <= 0)
+        pageSz = 4096;
+    start = offset - (offset % pageSz);
+    mapSz = (size_t)(offset - start) + (size_t)sz;
+
+    map = mmap(NULL, mapSz, PROT_READ, MAP_SHARED, fd, (off_t)start);
+    if (map == MAP_FAILED) {
+        WOLFSSL_MSG("Unable to map file range");
+        return WOLFSSL_BAD_FILE;
+    }
+#ifdef MADV_SEQUENTIAL
+    (void)madvise(map, mapSz, MADV_SEQUENTIAL);
+#endif
+
+    ret = wolfSSL_write(ssl, (byte*)map + (offset - start), sz);
+
+    munmap(map, mapSz);
+
+    WOLFSSL_LEAVE("wolfSSL_sendfile()", ret);
+
+    return ret;
+}
+#endif /* WOLFSSL_SENDFILE */
+
+
 static int wolfSSL_read_internal(WOLFSSL* ssl, void* data, int sz, int peek)
 {
     int ret;
@@ -1990,11 +2116,208 @@ int wolfSSL_SNI_GetFromBuffer(const byte* clientHello, word32 helloSz,
     return BAD_FUNC_ARG;
 }
 
+#ifdef WOLFSSL_SNI_STORE
+
+/* Adds a certificate chain and private key to serve to clients requesting the
+ * host name, without a CTX per host. The name is exact or a wildcard,
+ * "*.example.com", standing for one label. The chain has the server
+ * certificate first. Names can not be replaced once added.
+ * Returns WOLFSSL_SUCCESS on success. */
+int wolfSSL_CTX_SNI_AddCertificate(WOLFSSL_CTX* ctx, const char* name,
+                                 const unsigned char* chain, long chainSz,
+                                 const unsigned char* key, long keySz,
+                                 int format)
+{
+    SNI_StoreEntry* entry = NULL;
+    word32          nameSz;
+    word32          i;
+    int             ret;
+
+    WOLFSSL_ENTER("wolfSSL_CTX_SNI_AddCertificate");
+
+    if (ctx == NULL || ctx->method->side != WOLFSSL_SERVER_END ||
+            name == NULL || chain == NULL || chainSz <= 0 || key == NULL ||
+            keySz <= 0)
+        return BAD_FUNC_ARG;
+
+    nameSz = (word32)XSTRLEN(name);
+    if (nameSz == 0 || nameSz > SNI_STORE_MAX_NAME)
+        return BAD_FUNC_ARG;
+
+    for (i = 0; i < nameSz; i++) {
+        /* a wildcard is only the whole left-most label */
+        if (name[i] == '*' && (i != 0 || nameSz < 3 || name[1] != '.'))
+            return BAD_FUNC_ARG;
+    }
+
+    entry = (SNI_StoreEntry*)XMALLOC(sizeof(SNI_StoreEntry), ctx->heap,
+                                                             DYNAMIC_TYPE_TLSX);
+    if (entry == NULL)
+        return MEMORY_E;
+    XMEMSET(entry, 0, sizeof(SNI_StoreEntry));
+
+    entry->name = (char*)XMALLOC(nameSz + 1, ctx->heap, DYNAMIC_TYPE_TLSX);
+    if (entry->name == NULL) {
+        FreeSNIStoreEntry(entry, ctx->heap);
+        return MEMORY_E;
+    }
+
+    for (i = 0; i < nameSz; i++)
+        entry->name[i] = (char)XTOLOWER((unsigned char)name[i]);
+    entry->name[nameSz] = '\0';
+    entry->nameSz = (word16)nameSz;
+
+    ret = ProcessSNIStoreBuffer(ctx, chain, chainSz, format, CERT_TYPE, entry,
+                                1);
+    if (ret == WOLFSSL_SUCCESS) {
+        ret = ProcessSNIStoreBuffer(ctx, key, keySz, format, PRIVATEKEY_TYPE,
+                                    entry, 0);
+    }
+
+    if (ret == WOLFSSL_SUCCESS) {
+        ret = SNI_StoreAdd(ctx, entry);
+        if (ret == 0) {
+            entry = NULL; /* owned by the store */
+            ret = WOLFSSL_SUCCESS;
+        }
+    }
+
+    FreeSNIStoreEntry(entry, ctx->heap);
+
+    return ret;
+}
+
+#endif /* WOLFSSL_SNI_STORE */
+
 #endif /* NO_WOLFSSL_SERVER */
 
 #endif /* HAVE_SNI */
 
 
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+
+/* Sets the callback given each ClientHello before the server processes it.
+ * The callback sees the offered parameters through the
+ * wolfSSL_client_hello_get0_* functions and can switch CTX, abort with an
+ * alert or have wolfSSL_accept() return with CLIENT_HELLO_WANT_CB and call it
+ * again with the same ClientHello on the next wolfSSL_accept(). */
+void wolfSSL_CTX_set_client_hello_cb(WOLFSSL_CTX* ctx, CallbackClientHello cb,
+                                     void* arg)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_set_client_hello_cb");
+
+    if (ctx) {
+        ctx->clientHelloCb    = cb;
+        ctx->clientHelloCbArg = arg;
+    }
+}
+
+/* Protocol version of the ClientHello, 0 outside of the callback. */
+unsigned int wolfSSL_client_hello_get0_legacy_version(WOLFSSL* ssl)
+{
+    if (ssl == NULL || ssl->clientHello == NULL)
+        return 0;
+
+    return ((unsigned int)ssl->clientHello->version.major << 8) |
+                                              ssl->clientHello->version.minor;
+}
+
+size_t wolfSSL_client_hello_get0_random(WOLFSSL* ssl, const unsigned char** out)
+{
+    if (ssl == NULL || ssl->clientHello == NULL || out == NULL)
+        return 0;
+
+    *out = ssl->clientHello->random;
+    return RAN_LEN;
+}
+
+size_t wolfSSL_client_hello_get0_session_id(WOLFSSL* ssl,
+                                            const unsigned char** out)
+{
+    if (ssl == NULL || ssl->clientHello == NULL || out == NULL)
+        return 0;
+
+    *out = ssl->clientHello->sessionId;
+    return ssl->clientHello->sessionIdSz;
+}
+
+/* Cipher suites offered, two bytes each. */
+size_t wolfSSL_client_hello_get0_ciphers(WOLFSSL* ssl,
+                                         const unsigned char** out)
+{
+    if (ssl == NULL || ssl->clientHello == NULL || out == NULL)
+        return 0;
+
+    *out = ssl->clientHello->suites;
+    return ssl->clientHello->suitesSz;
+}
+
+size_t wolfSSL_client_hello_get0_compression_methods(WOLFSSL* ssl,
+                                                     const unsigned char** out)
+{
+    if (ssl == NULL || ssl->clientHello == NULL || out == NULL)
+        return 0;
+
+    *out = ssl->clientHello->comp;
+    return ssl->clientHello->compSz;
+}
+
+/* Finds the data of an extension in the ClientHello.
+ * returns 1 when the extension is present, otherwise 0 */
+int wolfSSL_client_hello_get0_ext(WOLFSSL* ssl, unsigned int type,
+                                  const unsigned char** out, size_t* outSz)
+{
+    const byte* exts;
+    word32      idx = 0;
+
+    if (ssl == NULL || ssl->clientHello == NULL || out == NULL ||
+                                                               outSz == NULL)
+        return 0;
+
+    exts = ssl->clientHello->exts;
+
+    while (idx + HELLO_EXT_TYPE_SZ + OPAQUE16_LEN <=
+                                                 ssl->clientHello->extsSz) {
+        word16 extType;
+        word16 extSz;
+
+        ato16(exts + idx, &extType);
+        idx += HELLO_EXT_TYPE_SZ;
+        ato16(exts + idx, &extSz);
+        idx += OPAQUE16_LEN;
+
+        if (idx + extSz > ssl->clientHello->extsSz)
+            break;
+
+        if (extType == type) {
+            *out   = exts + idx;
+            *outSz = extSz;
+            return 1;
+        }
+
+        idx += extSz;
+    }
+
+    return 0;
+}
+
+#endif /* WOLFSSL_CLIENT_HELLO_CB */
+
+#if defined(OPENSSL_ALL) || (defined(OPENSSL_EXTRA) && \
+    (defined(HAVE_STUNNEL) || defined(WOLFSSL_NGINX) || \
+     defined(HAVE_LIGHTY) || defined(WOLFSSL_HAPROXY))) || \
+    defined(WOLFSSL_CLIENT_HELLO_CB)
+
+WOLFSSL_CTX* wolfSSL_set_SSL_CTX(WOLFSSL* ssl, WOLFSSL_CTX* ctx)
+{
+    if (ssl && ctx && SetSSL_CTX(ssl, ctx, 0) == WOLFSSL_SUCCESS)
+        return ssl->ctx;
+    return NULL;
+}
+
+#endif
+
+
 #ifdef HAVE_TRUSTED_CA
 
 WOLFSSL_API int wolfSSL_UseTrustedCA(WOLFSSL* ssl, byte type,
@@ -2071,6 +2394,66 @@ int wolfSSL_CTX_UseMaxFragment(WOLFSSL_CTX* ctx, byte mfl)
 #endif /* NO_WOLFSSL_CLIENT */
 #endif /* HAVE_MAX_FRAGMENT */
 
+#ifdef HAVE_RECORD_SIZE_LIMIT
+
+/* Set the largest record plaintext this end is willing to receive.
+ * A client offers it in the ClientHello and a server answers with it when the
+ * client offers the extension.
+ *
+ * ssl    The SSL/TLS object.
+ * limit  Limit of 64 to 16384 bytes, 0 to not limit.
+ * returns WOLFSSL_SUCCESS on success and BAD_FUNC_ARG otherwise.
+ */
+int wolfSSL_UseRecordSizeLimit(WOLFSSL* ssl, unsigned short limit)
+{
+    WOLFSSL_ENTER("wolfSSL_UseRecordSizeLimit");
+
+    if (ssl == NULL || (limit != 0 && (limit < WOLFSSL_RECORD_SIZE_LIMIT_MIN ||
+                                       limit > WOLFSSL_RECORD_SIZE_LIMIT_MAX)))
+        return BAD_FUNC_ARG;
+
+    ssl->recordSizeLimit = limit;
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Set the largest record plaintext that SSL objects created from the context
+ * are willing to receive.
+ *
+ * ctx    The SSL/TLS context.
+ * limit  Limit of 64 to 16384 bytes, 0 to not limit.
+ * returns WOLFSSL_SUCCESS on success and BAD_FUNC_ARG otherwise.
+ */
+int wolfSSL_CTX_UseRecordSizeLimit(WOLFSSL_CTX* ctx, unsigned short limit)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_UseRecordSizeLimit");
+
+    if (ctx == NULL || (limit != 0 && (limit < WOLFSSL_RECORD_SIZE_LIMIT_MIN ||
+                                       limit > WOLFSSL_RECORD_SIZE_LIMIT_MAX)))
+        return BAD_FUNC_ARG;
+
+    ctx->recordSizeLimit = limit;
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Get the record size limit the peer negotiated.
+ *
+ * ssl  The SSL/TLS object.
+ * returns the peer's limit, 0 when not negotiated or BAD_FUNC_ARG.
+ */
+int wolfSSL_GetPeerRecordSizeLimit(WOLFSSL* ssl)
+{
+    if (ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    return ssl->peerRecordSizeLimit;
+}
+
+#endif /* HAVE_RECORD_SIZE_LIMIT */
+
 #ifdef HAVE_TRUNCATED_HMAC
 #ifndef NO_WOLFSSL_CLIENT
 
@@ -3632,6 +4015,552 @@ int wolfSSL_pending(WOLFSSL* ssl)
 }
 
 
+/* Checks whether there is data buffered in the SSL object, either decrypted
+ * application data or records received but not yet processed. With read ahead
+ * the socket may not be readable while records are still buffered.
+ *
+ * ssl  The SSL/TLS object.
+ * returns 1 when data is buffered and 0 otherwise.
+ */
+int wolfSSL_has_pending(const WOLFSSL* ssl)
+{
+    WOLFSSL_ENTER("wolfSSL_has_pending");
+
+    if (ssl == NULL)
+        return 0;
+
+    if (ssl->buffers.clearOutputBuffer.length > 0)
+        return 1;
+    if (ssl->buffers.inputBuffer.length > ssl->buffers.inputBuffer.idx)
+        return 1;
+#ifdef WOLFSSL_READ_AHEAD
+    if (ssl->buffers.inputAheadSz > 0)
+        return 1;
+#endif
+
+    return 0;
+}
+
+
+#ifdef WOLFSSL_READ_AHEAD
+/* Sets the maximum number of bytes to read from the network in one go.
+ * Instead of reading exactly the next record header or record, as much data as
+ * is available, up to this size, is read into the input buffer and all the
+ * complete records in it are processed before reading again.
+ * A value of zero turns off reading ahead. Not used with DTLS.
+ *
+ * ctx  The SSL/TLS CTX object.
+ * sz   Maximum number of bytes to read ahead.
+ * returns BAD_FUNC_ARG when ctx is NULL or sz is too big and WOLFSSL_SUCCESS
+ * on success.
+ */
+int wolfSSL_CTX_set_read_ahead_size(WOLFSSL_CTX* ctx, unsigned int sz)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_set_read_ahead_size");
+
+    if (ctx == NULL || sz > WOLFSSL_MAX_READ_AHEAD_SZ)
+        return BAD_FUNC_ARG;
+
+    ctx->readAheadSz = sz;
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Sets the maximum number of bytes to read from the network in one go.
+ * A value of zero turns off reading ahead. Not used with DTLS.
+ *
+ * ssl  The SSL/TLS object.
+ * sz   Maximum number of bytes to read ahead.
+ * returns BAD_FUNC_ARG when ssl is NULL or sz is too big and WOLFSSL_SUCCESS
+ * on success.
+ */
+int wolfSSL_set_read_ahead_size(WOLFSSL* ssl, unsigned int sz)
+{
+    WOLFSSL_ENTER("wolfSSL_set_read_ahead_size");
+
+    if (ssl == NULL || sz > WOLFSSL_MAX_READ_AHEAD_SZ)
+        return BAD_FUNC_ARG;
+
+    ssl->options.readAheadSz = sz;
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Sets whether a read returns the data of all the application data records
+ * that have been read ahead, up to the size asked for, instead of the data of
+ * one record. The records are decrypted one after the other in one call.
+ *
+ * ctx  The SSL/TLS CTX object.
+ * on   Non-zero to read all buffered records and zero for one record.
+ * returns BAD_FUNC_ARG when ctx is NULL and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_CTX_set_read_batch(WOLFSSL_CTX* ctx, int on)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_set_read_batch");
+
+    if (ctx == NULL)
+        return BAD_FUNC_ARG;
+
+    ctx->readBatch = (on != 0);
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Sets whether a read returns the data of all the application data records
+ * that have been read ahead, up to the size asked for.
+ *
+ * ssl  The SSL/TLS object.
+ * on   Non-zero to read all buffered records and zero for one record.
+ * returns BAD_FUNC_ARG when ssl is NULL and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_set_read_batch(WOLFSSL* ssl, int on)
+{
+    WOLFSSL_ENTER("wolfSSL_set_read_batch");
+
+    if (ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    ssl->options.readBatch = (on != 0);
+
+    return WOLFSSL_SUCCESS;
+}
+#endif /* WOLFSSL_READ_AHEAD */
+
+
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+/* Sets the sizes of application data records sent at the start of a burst.
+ * The first threshold bytes after the connection has been idle for idleSec
+ * seconds are sent in records of at most smallSz bytes of plaintext so the
+ * peer can decrypt data as soon as the first segments arrive. Full size
+ * records are used after that.
+ * A smallSz of zero always sends full size records. An idleSec of zero only
+ * uses small records at the start of the connection.
+ *
+ * ctx        The SSL/TLS CTX object.
+ * smallSz    Maximum plaintext size of small records.
+ * threshold  Number of bytes to send in small records.
+ * idleSec    Seconds without sending after which small records are used again.
+ * returns BAD_FUNC_ARG when ctx is NULL or smallSz is bigger than a record
+ * and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_CTX_set_dynamic_record_size(WOLFSSL_CTX* ctx, unsigned int smallSz,
+                                    unsigned int threshold, unsigned int idleSec)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_set_dynamic_record_size");
+
+    if (ctx == NULL || smallSz > MAX_RECORD_SIZE)
+        return BAD_FUNC_ARG;
+
+    ctx->dynRecSmallSz   = (word16)smallSz;
+    ctx->dynRecThreshold = threshold;
+    ctx->dynRecIdleSec   = idleSec;
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Sets the sizes of application data records sent at the start of a burst.
+ * See wolfSSL_CTX_set_dynamic_record_size(). The next data sent starts a new
+ * burst.
+ *
+ * ssl        The SSL/TLS object.
+ * smallSz    Maximum plaintext size of small records.
+ * threshold  Number of bytes to send in small records.
+ * idleSec    Seconds without sending after which small records are used again.
+ * returns BAD_FUNC_ARG when ssl is NULL or smallSz is bigger than a record
+ * and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_set_dynamic_record_size(WOLFSSL* ssl, unsigned int smallSz,
+                                    unsigned int threshold, unsigned int idleSec)
+{
+    WOLFSSL_ENTER("wolfSSL_set_dynamic_record_size");
+
+    if (ssl == NULL || smallSz > MAX_RECORD_SIZE)
+        return BAD_FUNC_ARG;
+
+    ssl->options.dynRecSmallSz   = (word16)smallSz;
+    ssl->options.dynRecThreshold = threshold;
+    ssl->options.dynRecIdleSec   = idleSec;
+    ssl->options.dynRecSent      = 0;
+
+    return WOLFSSL_SUCCESS;
+}
+#endif /* WOLFSSL_DYNAMIC_RECORD_SIZE */
+
+
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+static const char* hsTimeName[WOLFSSL_HS_TIME_COUNT] = {
+    "SendHelloRequest",
+    "DoHelloRequest",
+    "SendClientHello",
+    "DoClientHello",
+    "SendServerHello",
+    "DoServerHello",
+    "SendEncryptedExtensions",
+    "DoEncryptedExtensions",
+    "SendCertificateRequest",
+    "DoCertificateRequest",
+    "SendCertificate",
+    "DoCertificate",
+    "SendCertificateVerify",
+    "DoCertificateVerify",
+    "SendFinished",
+    "DoFinished",
+    "SendKeyUpdate",
+    "DoKeyUpdate",
+    "SendEarlyData",
+    "DoEarlyData",
+    "SendNewSessionTicket",
+    "DoNewSessionTicket",
+    "SendServerHelloDone",
+    "DoServerHelloDone",
+    "SendTicket",
+    "DoTicket",
+    "SendClientKeyExchange",
+    "DoClientKeyExchange",
+    "SendCertificateStatus",
+    "DoCertificateStatus",
+    "SendServerKeyExchange",
+    "DoServerKeyExchange",
+    "SendEndOfEarlyData",
+    "DoEndOfEarlyData",
+    "I/O read",
+    "I/O write",
+    "Handshake",
+};
+
+/* Gets the time spent in the handshake of the connection.
+ * usec[n] is the time spent in phase n and calls[n] the number of timed
+ * calls. The phases are the message handlers (enum wc_FuncNum), the I/O
+ * callbacks while handshaking (WOLFSSL_HS_TIME_IO_READ and
+ * WOLFSSL_HS_TIME_IO_WRITE) and the whole handshake (WOLFSSL_HS_TIME_TOTAL).
+ * A handler call that returns early, on error or because it would block, is
+ * not counted. The handshake time is set once the handshake is done.
+ *
+ * ssl     The SSL/TLS object.
+ * timing  The timing to fill.
+ * returns BAD_FUNC_ARG when ssl or timing is NULL and WOLFSSL_SUCCESS on
+ * success.
+ */
+int wolfSSL_get_handshake_timing(WOLFSSL* ssl, WOLFSSL_HS_TIMING* timing)
+{
+    WOLFSSL_ENTER("wolfSSL_get_handshake_timing");
+
+    if (ssl == NULL || timing == NULL)
+        return BAD_FUNC_ARG;
+
+    XMEMCPY(timing, &ssl->hsTiming, sizeof(WOLFSSL_HS_TIMING));
+
+    return WOLFSSL_SUCCESS;
+}
+
+/* Gets the name of a handshake timing phase.
+ *
+ * phase  Index into the usec and calls of WOLFSSL_HS_TIMING.
+ * returns NULL when phase is out of range and the name otherwise.
+ */
+const char* wolfSSL_handshake_timing_name(int phase)
+{
+    if (phase < 0 || phase >= WOLFSSL_HS_TIME_COUNT)
+        return NULL;
+
+    return hsTimeName[phase];
+}
+
+/* Adds the timing of a handshake to a histogram.
+ * Each phase that was timed adds one to the bucket of its time: bucket 0 for
+ * less than a microsecond and bucket n for 2^(n-1) to 2^n - 1 microseconds.
+ * The last bucket also counts longer times. The histogram is not locked, use
+ * one per thread or serialize the calls.
+ *
+ * hist    The histogram to add to.
+ * timing  The timing of a handshake.
+ * returns BAD_FUNC_ARG when hist or timing is NULL and WOLFSSL_SUCCESS on
+ * success.
+ */
+int wolfSSL_handshake_histogram_add(WOLFSSL_HS_HISTOGRAM* hist,
+                                    const WOLFSSL_HS_TIMING* timing)
+{
+    int phase, bucket;
+    unsigned int usec;
+
+    if (hist == NULL || timing == NULL)
+        return BAD_FUNC_ARG;
+
+    for (phase = 0; phase < WOLFSSL_HS_TIME_COUNT; phase++) {
+        if (timing->calls[phase] == 0)
+            continue;
+
+        for (bucket = 0, usec = timing->usec[phase];
+                          usec != 0 && bucket < WOLFSSL_HS_HIST_BUCKETS - 1;
+                          usec >>= 1) {
+            bucket++;
+        }
+        hist->bucket[phase][bucket]++;
+    }
+    hist->count++;
+
+    return WOLFSSL_SUCCESS;
+}
+#endif /* WOLFSSL_HANDSHAKE_TIMING */
+
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+/* Limits the full handshakes that servers using the CTX run at once.
+ * A new full handshake is held back while maxInFlight are running or while
+ * full handshakes have been taking longer than maxLatencyUs on average.
+ * Resumptions are not limited. Held back handshakes are refused with a
+ * handshake_failure alert, or with defer set and not using DTLS,
+ * wolfSSL_accept() fails with HANDSHAKE_ADMISSION_WANT before the server
+ * sends its first flight and is to be called again later. Zero turns a limit
+ * off.
+ *
+ * ctx           The SSL/TLS CTX object.
+ * maxInFlight   The number of full handshakes that may run at once.
+ * maxLatencyUs  The average full handshake time to stay under, microseconds.
+ * defer         Hold back handshakes rather than refuse them.
+ * returns BAD_FUNC_ARG when ctx is NULL, SIDE_ERROR when not a server,
+ * BAD_MUTEX_E on lock failure and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_CTX_set_handshake_admission(WOLFSSL_CTX* ctx,
+                                        unsigned int maxInFlight,
+                                        unsigned int maxLatencyUs, int defer)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_set_handshake_admission");
+
+    if (ctx == NULL)
+        return BAD_FUNC_ARG;
+    if (ctx->admission == NULL)
+        return SIDE_ERROR;
+
+    if (wc_LockMutex(&ctx->admission->lock) != 0)
+        return BAD_MUTEX_E;
+    ctx->admission->maxInFlight  = maxInFlight;
+    ctx->admission->maxLatencyUs = maxLatencyUs;
+    ctx->admission->defer        = (defer != 0);
+    wc_UnLockMutex(&ctx->admission->lock);
+
+    return WOLFSSL_SUCCESS;
+}
+
+/* Gets what the admission control of the CTX has done so far.
+ *
+ * ctx    The SSL/TLS CTX object.
+ * stats  The counters and current state.
+ * returns BAD_FUNC_ARG when ctx or stats is NULL, SIDE_ERROR when not a
+ * server, BAD_MUTEX_E on lock failure and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_CTX_get_handshake_admission_stats(WOLFSSL_CTX* ctx,
+                                              WOLFSSL_ADMISSION_STATS* stats)
+{
+    if (ctx == NULL || stats == NULL)
+        return BAD_FUNC_ARG;
+    if (ctx->admission == NULL)
+        return SIDE_ERROR;
+
+    if (wc_LockMutex(&ctx->admission->lock) != 0)
+        return BAD_MUTEX_E;
+    *stats = ctx->admission->stats;
+    wc_UnLockMutex(&ctx->admission->lock);
+
+    return WOLFSSL_SUCCESS;
+}
+#endif /* WOLFSSL_HANDSHAKE_ADMISSION */
+
+
+#ifdef WOLFSSL_KEY_SHARE_POOL
+/* Gets the usage of the shared pool of pre-generated X25519 and P-256 key
+ * pairs.
+ *
+ * hits    Set to the number of key pairs taken from the pool.
+ * misses  Set to the number of key pairs generated as the pool was empty.
+ * returns BAD_FUNC_ARG when hits or misses is NULL and WOLFSSL_SUCCESS on
+ * success.
+ */
+int wolfSSL_key_share_pool_stats(unsigned int* hits, unsigned int* misses)
+{
+    word32 h, m;
+
+    WOLFSSL_ENTER("wolfSSL_key_share_pool_stats");
+
+    if (hits == NULL || misses == NULL)
+        return BAD_FUNC_ARG;
+
+    KeySharePoolStats(&h, &m);
+    *hits = h;
+    *misses = m;
+
+    return WOLFSSL_SUCCESS;
+}
+#endif /* WOLFSSL_KEY_SHARE_POOL */
+
+
+/* Sets whether I/O buffers are freed as soon as the connection is idle.
+ * The read ahead buffer is otherwise kept between reads.
+ *
+ * ctx  The SSL/TLS CTX object.
+ * on   Non-zero to release buffers when idle and zero to keep them.
+ * returns BAD_FUNC_ARG when ctx is NULL and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_CTX_set_release_buffers(WOLFSSL_CTX* ctx, int on)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_set_release_buffers");
+
+    if (ctx == NULL)
+        return BAD_FUNC_ARG;
+
+    ctx->releaseBuffers = (on != 0);
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Sets whether I/O buffers are freed as soon as the connection is idle.
+ * When turned on after the handshake, an idle input buffer is freed now.
+ *
+ * ssl  The SSL/TLS object.
+ * on   Non-zero to release buffers when idle and zero to keep them.
+ * returns BAD_FUNC_ARG when ssl is NULL and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_set_release_buffers(WOLFSSL* ssl, int on)
+{
+    WOLFSSL_ENTER("wolfSSL_set_release_buffers");
+
+    if (ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    ssl->options.releaseBuffers = (on != 0);
+
+    if (ssl->options.releaseBuffers &&
+            ssl->options.handShakeState == HANDSHAKE_DONE &&
+            ssl->buffers.clearOutputBuffer.length == 0 &&
+            ssl->buffers.inputBuffer.dynamicFlag) {
+        ShrinkInputBuffer(ssl, NO_FORCED_FREE);
+    }
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+/* Sets whether handshake messages are buffered until the cipher suite picks
+ * the transcript hash. Otherwise all transcript hashes are started when the
+ * handshake starts. On by default.
+ *
+ * ctx  The SSL/TLS CTX object.
+ * on   Non-zero to start the transcript hash late and zero to start all.
+ * returns BAD_FUNC_ARG when ctx is NULL and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_CTX_set_lazy_handshake_hash(WOLFSSL_CTX* ctx, int on)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_set_lazy_handshake_hash");
+
+    if (ctx == NULL)
+        return BAD_FUNC_ARG;
+
+    ctx->eagerHash = (on == 0);
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Sets whether handshake messages are buffered until the cipher suite picks
+ * the transcript hash. When turned off, all hashes are started now.
+ *
+ * ssl  The SSL/TLS object.
+ * on   Non-zero to start the transcript hash late and zero to start all.
+ * returns BAD_FUNC_ARG when ssl is NULL, WOLFSSL_FAILURE when the hashes
+ * can't be started and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_set_lazy_handshake_hash(WOLFSSL* ssl, int on)
+{
+    WOLFSSL_ENTER("wolfSSL_set_lazy_handshake_hash");
+
+    if (ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    ssl->options.eagerHash = (on == 0);
+
+    if (ssl->options.eagerHash && ssl->hsHashes != NULL &&
+            HashCommit(ssl, HS_HASH_ALL) != 0) {
+        return WOLFSSL_FAILURE;
+    }
+
+    return WOLFSSL_SUCCESS;
+}
+#endif /* WOLFSSL_LAZY_HANDSHAKE_HASH */
+
+
+#ifdef WOLFSSL_KTLS
+/* Requests that the Linux kernel encrypts and decrypts records once the
+ * handshake is done. Only TLS over the default socket I/O callbacks with an
+ * AES-GCM or ChaCha20-Poly1305 cipher suite is offloaded. wolfSSL carries on
+ * processing records when the kernel doesn't support kTLS.
+ *
+ * ctx  The SSL/TLS CTX object.
+ * returns BAD_FUNC_ARG when ctx is NULL and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_CTX_UseKTLS(WOLFSSL_CTX* ctx)
+{
+    WOLFSSL_ENTER("wolfSSL_CTX_UseKTLS");
+
+    if (ctx == NULL)
+        return BAD_FUNC_ARG;
+
+    ctx->useKtls = 1;
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Requests that the Linux kernel encrypts and decrypts records once the
+ * handshake is done. When the handshake is already done, records are
+ * offloaded from now on if possible.
+ *
+ * ssl  The SSL/TLS object.
+ * returns BAD_FUNC_ARG when ssl is NULL and WOLFSSL_SUCCESS on success.
+ */
+int wolfSSL_UseKTLS(WOLFSSL* ssl)
+{
+    WOLFSSL_ENTER("wolfSSL_UseKTLS");
+
+    if (ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    ssl->options.useKtls = 1;
+
+    if (ssl->options.handShakeState == HANDSHAKE_DONE)
+        KTLS_Enable(ssl);
+
+    return WOLFSSL_SUCCESS;
+}
+
+
+/* Gets which directions of records the kernel is processing.
+ *
+ * ssl  The SSL/TLS object.
+ * returns BAD_FUNC_ARG when ssl is NULL, otherwise a combination of
+ * WOLFSSL_KTLS_TX and WOLFSSL_KTLS_RX.
+ */
+int wolfSSL_GetKTLS(WOLFSSL* ssl)
+{
+    int ret = 0;
+
+    if (ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    if (ssl->options.ktlsTx)
+        ret |= WOLFSSL_KTLS_TX;
+    if (ssl->options.ktlsRx)
+        ret |= WOLFSSL_KTLS_RX;
+
+    return ret;
+}
+#endif /* WOLFSSL_KTLS */
+
+
 #ifndef WOLFSSL_LEANPSK
 /* turn on handshake group messages for context */
 int wolfSSL_CTX_set_group_messages(WOLFSSL_CTX* ctx)
@@ -4449,6 +5378,23 @@ int AddCA(WOLFSSL_CERT_MANAGER* cm, DerBuffer** pDer, int type, int verify)
 
         static ClientRow ClientCache[SESSION_ROWS];  /* Client Cache */
                                                      /* uses session mutex */
+
+        #ifdef WOLFSSL_TLS13_GROUP_CACHE
+        typedef struct ClientGroup {
+            word16 idLen;                       /* serverID length */
+            word16 group;                       /* key share group picked */
+            byte   serverID[SERVER_ID_LEN];     /* server identity */
+        } ClientGroup;
+
+        typedef struct ClientGroupRow {
+            int nextIdx;                /* where to place next one   */
+            ClientGroup Groups[SESSIONS_PER_ROW];
+        } ClientGroupRow;
+
+        /* outlives the sessions, a new ticket doesn't change server policy */
+        static ClientGroupRow ClientGroupCache[SESSION_ROWS];
+                                                     /* uses session mutex */
+        #endif
     #endif  /* NO_CLIENT_CACHE */
 
 #endif /* NO_SESSION_CACHE */
@@ -4473,6 +5419,18 @@ int wolfSSL_Init(void)
             WOLFSSL_MSG("Bad Init Mutex count");
             return BAD_MUTEX_E;
         }
+#ifdef WOLFSSL_BUFFER_POOL
+        if (InitBufferPool() != 0) {
+            WOLFSSL_MSG("Bad Init buffer pool");
+            return BAD_MUTEX_E;
+        }
+#endif
+#ifdef WOLFSSL_KEY_SHARE_POOL
+        if (InitKeySharePool() != 0) {
+            WOLFSSL_MSG("Bad Init key share pool");
+            return BAD_MUTEX_E;
+        }
+#endif
     }
 
     if (wc_LockMutex(&count_mutex) != 0) {
@@ -4493,7 +5451,7 @@ int wolfSSL_Init(void)
 /* process user cert chain to pass during the handshake */
 static int ProcessUserChain(WOLFSSL_CTX* ctx, const unsigned char* buff,
                          long sz, int format, int type, WOLFSSL* ssl,
-                         long* used, EncryptedInfo* info)
+                         long* used, EncryptedInfo* info, SNI_StoreEntry* entry)
 {
     int ret = 0;
     void* heap = wolfSSL_CTX_GetHeap(ctx, ssl);
@@ -4613,7 +5571,16 @@ static int ProcessUserChain(WOLFSSL_CTX* ctx, const unsigned char* buff,
         /* only retain actual size used */
         ret = 0;
         if (idx > 0) {
-            if (ssl) {
+            if (entry) {
+                FreeDer(&entry->certChain);
+                ret = AllocDer(&entry->certChain, idx, type, heap);
+                if (ret == 0) {
+                    XMEMCPY(entry->certChain->buffer, chainBuffer, idx);
+                }
+            #ifdef WOLFSSL_TLS13
+                entry->certChainCnt = cnt;
+            #endif
+            } else if (ssl) {
                 if (ssl->buffers.weOwnCertChain) {
                     FreeDer(&ssl->buffers.certChain);
                 }
@@ -4628,6 +5595,9 @@ static int ProcessUserChain(WOLFSSL_CTX* ctx, const unsigned char* buff,
             #endif
             } else if (ctx) {
                 FreeDer(&ctx->certChain);
+            #ifdef WOLFSSL_CERT_MSG_CACHE
+                FreeCertMsgCache(ctx);
+            #endif
                 ret = AllocDer(&ctx->certChain, idx, type, heap);
                 if (ret == 0) {
                     XMEMCPY(ctx->certChain->buffer, chainBuffer, idx);
@@ -4646,10 +5616,11 @@ static int ProcessUserChain(WOLFSSL_CTX* ctx, const unsigned char* buff,
 }
 /* process the buffer buff, length sz, into ctx of format and type
    used tracks bytes consumed, userChain specifies a user cert chain
-   to pass during the handshake */
-int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
+   to pass during the handshake, entry when set takes the buffer in place
+   of ctx */
+static int ProcessBufferEx(WOLFSSL_CTX* ctx, const unsigned char* buff,
                          long sz, int format, int type, WOLFSSL* ssl,
-                         long* used, int userChain)
+                         long* used, int userChain, SNI_StoreEntry* entry)
 {
     DerBuffer*    der = NULL;        /* holds DER or RAW (for NTRU) */
     int           ret = 0;
@@ -4739,7 +5710,8 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
          * Remainder are processed using ProcessUserChain and are loaded into
          *   ssl->buffers.certChain. */
         if (userChain) {
-            ret = ProcessUserChain(ctx, buff, sz, format, type, ssl, used, info);
+            ret = ProcessUserChain(ctx, buff, sz, format, type, ssl, used, info,
+                                   entry);
         }
     }
 
@@ -4816,7 +5788,11 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
     }
 #endif /* WOLFSSL_TRUST_PEER_CERT */
     else if (type == CERT_TYPE) {
-        if (ssl) {
+        if (entry) {
+            FreeDer(&entry->certificate);
+            entry->certificate = der;
+        }
+        else if (ssl) {
              /* Make sure previous is free'd */
             if (ssl->buffers.weOwnCert) {
                 FreeDer(&ssl->buffers.certificate);
@@ -4836,6 +5812,9 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
         }
         else if (ctx) {
             FreeDer(&ctx->certificate); /* Make sure previous is free'd */
+        #ifdef WOLFSSL_CERT_MSG_CACHE
+            FreeCertMsgCache(ctx);
+        #endif
         #ifdef KEEP_OUR_CERT
             if (ctx->ourCert) {
                 if (ctx->ownOurCert) {
@@ -4849,7 +5828,11 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
         }
     }
     else if (type == PRIVATEKEY_TYPE) {
-        if (ssl) {
+        if (entry) {
+            FreeDer(&entry->key);
+            entry->key = der;
+        }
+        else if (ssl) {
              /* Make sure previous is free'd */
             if (ssl->buffers.weOwnKey) {
                 FreeDer(&ssl->buffers.key);
@@ -4908,7 +5891,12 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
                         WOLFSSL_MSG("Private Key size too small");
                     }
 
-                    if (ssl) {
+                    if (entry) {
+                        entry->keyType = rsa_sa_algo;
+                        entry->keySz = keySz;
+                        entry->haveStaticECC = 0;
+                    }
+                    else if (ssl) {
                         ssl->buffers.keyType = rsa_sa_algo;
                         ssl->buffers.keySz = keySz;
                     }
@@ -4966,7 +5954,12 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
                     }
 
                     eccKey = 1;
-                    if (ssl) {
+                    if (entry) {
+                        entry->haveStaticECC = 1;
+                        entry->keyType = ecc_dsa_sa_algo;
+                        entry->keySz = keySz;
+                    }
+                    else if (ssl) {
                         ssl->options.haveStaticECC = 1;
                         ssl->buffers.keyType = ecc_dsa_sa_algo;
                         ssl->buffers.keySz = keySz;
@@ -5030,7 +6023,11 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
                     }
                 }
                 if (ret == 0) {
-                    if (ssl) {
+                    if (entry) {
+                        entry->keyType = ed25519_sa_algo;
+                        entry->keySz = keySz;
+                    }
+                    else if (ssl) {
                         ssl->buffers.keyType = ed25519_sa_algo;
                         ssl->buffers.keySz = keySz;
                     }
@@ -5104,14 +6101,18 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
             case CTC_SHA384wECDSA:
             case CTC_SHA512wECDSA:
                 WOLFSSL_MSG("ECDSA cert signature");
-                if (ssl)
+                if (entry)
+                    entry->haveECDSAsig = 1;
+                else if (ssl)
                     ssl->options.haveECDSAsig = 1;
                 else if (ctx)
                     ctx->haveECDSAsig = 1;
                 break;
             case CTC_ED25519:
                 WOLFSSL_MSG("ED25519 cert signature");
-                if (ssl)
+                if (entry)
+                    entry->haveECDSAsig = 1;
+                else if (ssl)
                     ssl->options.haveECDSAsig = 1;
                 else if (ctx)
                     ctx->haveECDSAsig = 1;
@@ -5122,7 +6123,22 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
         }
 
     #if defined(HAVE_ECC) || defined(HAVE_ED25519)
-        if (ssl) {
+        if (entry) {
+            entry->pkCurveOID = cert->pkCurveOID;
+        #ifndef WC_STRICT_SIG
+            if (cert->keyOID == ECDSAk) {
+                entry->haveECC = 1;
+            }
+            #ifdef HAVE_ED25519
+                else if (cert->keyOID == ED25519k) {
+                    entry->haveECC = 1;
+                }
+            #endif
+        #else
+            entry->haveECC = entry->haveECDSAsig;
+        #endif
+        }
+        else if (ssl) {
             ssl->pkCurveOID = cert->pkCurveOID;
         #ifndef WC_STRICT_SIG
             if (cert->keyOID == ECDSAk) {
@@ -5239,7 +6255,13 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
         }
 
     #ifdef HAVE_PK_CALLBACKS
-        if (ssl && ssl->buffers.keyType == 0) {
+        if (entry) {
+            if (entry->keyType == 0) {
+                entry->keyType = keyType;
+                entry->keySz = keySz;
+            }
+        }
+        else if (ssl && ssl->buffers.keyType == 0) {
             ssl->buffers.keyType = keyType;
             ssl->buffers.keySz = keySz;
         }
@@ -5285,6 +6307,29 @@ int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
     return WOLFSSL_SUCCESS;
 }
 
+int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
+                         long sz, int format, int type, WOLFSSL* ssl,
+                         long* used, int userChain)
+{
+    return ProcessBufferEx(ctx, buff, sz, format, type, ssl, used, userChain,
+                           NULL);
+}
+
+#ifdef WOLFSSL_SNI_STORE
+/* process the buffer buff, length sz, of format and type into the SNI store
+   entry, checked against the settings of ctx */
+int ProcessSNIStoreBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
+                         long sz, int format, int type, SNI_StoreEntry* entry,
+                         int userChain)
+{
+    if (ctx == NULL || entry == NULL)
+        return BAD_FUNC_ARG;
+
+    return ProcessBufferEx(ctx, buff, sz, format, type, NULL, NULL, userChain,
+                           entry);
+}
+#endif
+
 
 /* CA PEM file for verification, may have multiple/chain certs to process */
 static int ProcessChainBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
@@ -8016,6 +9061,9 @@ int wolfSSL_SetServerID(WOLFSSL* ssl, const byte* id, int len, int newSession)
 
         ssl->session.idLen = (word16)min(SERVER_ID_LEN, (word32)len);
         XMEMCPY(ssl->session.serverID, id, ssl->session.idLen);
+    #ifdef WOLFSSL_TLS13_GROUP_CACHE
+        ssl->cachedGroup = GetSessionClientGroup(ssl, id, len);
+    #endif
     }
     #ifdef HAVE_EXT_CACHE
     else
@@ -9414,6 +10462,7 @@ int wolfSSL_DTLS_SetCookieSecret(WOLFSSL* ssl,
             FALL_THROUGH;
 
         case SECOND_REPLY_DONE:
+            HS_TIME_DONE(ssl);
 #ifndef NO_HANDSHAKE_DONE_CB
             if (ssl->hsDoneCb) {
                 int cbret = ssl->hsDoneCb(ssl, ssl->hsDoneCtx);
@@ -9429,6 +10478,9 @@ int wolfSSL_DTLS_SetCookieSecret(WOLFSSL* ssl,
                 if (!ssl->options.keepResources) {
                     FreeHandshakeResources(ssl);
                 }
+            #ifdef WOLFSSL_KTLS
+                KTLS_Enable(ssl);
+            #endif
             }
 #ifdef WOLFSSL_DTLS
             else {
@@ -9651,6 +10703,12 @@ int wolfSSL_DTLS_SetCookieSecret(WOLFSSL* ssl,
             FALL_THROUGH;
 
         case ACCEPT_FIRST_REPLY_DONE :
+        #ifdef WOLFSSL_HANDSHAKE_ADMISSION
+            if ( (ssl->error = HsAdmitWait(ssl)) != 0) {
+                WOLFSSL_ERROR(ssl->error);
+                return WOLFSSL_FATAL_ERROR;
+            }
+        #endif
             if ( (ssl->error = SendServerHello(ssl)) != 0) {
                 WOLFSSL_ERROR(ssl->error);
                 return WOLFSSL_FATAL_ERROR;
@@ -9785,6 +10843,10 @@ int wolfSSL_DTLS_SetCookieSecret(WOLFSSL* ssl,
             FALL_THROUGH;
 
         case ACCEPT_THIRD_REPLY_DONE :
+            HS_TIME_DONE(ssl);
+        #ifdef WOLFSSL_HANDSHAKE_ADMISSION
+            HsAdmitDone(ssl, 1);
+        #endif
 #ifndef NO_HANDSHAKE_DONE_CB
             if (ssl->hsDoneCb) {
                 int cbret = ssl->hsDoneCb(ssl, ssl->hsDoneCtx);
@@ -9800,6 +10862,9 @@ int wolfSSL_DTLS_SetCookieSecret(WOLFSSL* ssl,
                 if (!ssl->options.keepResources) {
                     FreeHandshakeResources(ssl);
                 }
+            #ifdef WOLFSSL_KTLS
+                KTLS_Enable(ssl);
+            #endif
             }
 #ifdef WOLFSSL_DTLS
             else {
@@ -9878,6 +10943,12 @@ int wolfSSL_Cleanup(void)
 #endif
     if (wc_FreeMutex(&count_mutex) != 0)
         ret = BAD_MUTEX_E;
+#ifdef WOLFSSL_KEY_SHARE_POOL
+    FreeKeySharePool();
+#endif
+#ifdef WOLFSSL_BUFFER_POOL
+    FreeBufferPool();
+#endif
 
     if (wolfCrypt_Cleanup() != 0) {
         WOLFSSL_MSG("Error with wolfCrypt_Cleanup call");
@@ -10027,6 +11098,98 @@ WOLFSSL_SESSION* GetSessionClient(WOLFSSL* ssl, const byte* id, int len)
     return ret;
 }
 
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+
+/* Get the key share group the server with id picked on the last handshake,
+   return 0 when not known */
+word16 GetSessionClientGroup(WOLFSSL* ssl, const byte* id, int len)
+{
+    word16 group = 0;
+    word32 row;
+    int    idx;
+    int    error = 0;
+
+    WOLFSSL_ENTER("GetSessionClientGroup");
+
+    if (ssl->ctx->sessionCacheOff || ssl->options.side == WOLFSSL_SERVER_END)
+        return 0;
+
+    len = min(SERVER_ID_LEN, (word32)len);
+    row = HashSession(id, len, &error) % SESSION_ROWS;
+    if (error != 0) {
+        WOLFSSL_MSG("Hash session failed");
+        return 0;
+    }
+
+    if (wc_LockMutex(&session_mutex) != 0) {
+        WOLFSSL_MSG("Lock session mutex failed");
+        return 0;
+    }
+
+    for (idx = 0; idx < SESSIONS_PER_ROW; idx++) {
+        ClientGroup* cg = &ClientGroupCache[row].Groups[idx];
+
+        if (cg->idLen == (word16)len && XMEMCMP(cg->serverID, id, len) == 0) {
+            WOLFSSL_MSG("Found key share group for serverid");
+            group = cg->group;
+            break;
+        }
+    }
+
+    wc_UnLockMutex(&session_mutex);
+
+    return group;
+}
+
+/* Remember the key share group the server picked against the serverID */
+void AddSessionClientGroup(WOLFSSL* ssl)
+{
+    ClientGroup* cg = NULL;
+    word32       row;
+    int          idx;
+    int          error = 0;
+
+    WOLFSSL_ENTER("AddSessionClientGroup");
+
+    if (ssl->ctx->sessionCacheOff || ssl->session.idLen == 0 ||
+                                                        ssl->namedGroup == 0) {
+        return;
+    }
+
+    row = HashSession(ssl->session.serverID, ssl->session.idLen, &error) %
+                                                                  SESSION_ROWS;
+    if (error != 0) {
+        WOLFSSL_MSG("Hash session failed");
+        return;
+    }
+
+    if (wc_LockMutex(&session_mutex) != 0) {
+        WOLFSSL_MSG("Lock session mutex failed");
+        return;
+    }
+
+    for (idx = 0; idx < SESSIONS_PER_ROW; idx++) {
+        if (ClientGroupCache[row].Groups[idx].idLen == ssl->session.idLen &&
+                XMEMCMP(ClientGroupCache[row].Groups[idx].serverID,
+                        ssl->session.serverID, ssl->session.idLen) == 0) {
+            cg = &ClientGroupCache[row].Groups[idx];
+            break;
+        }
+    }
+    if (cg == NULL) {
+        cg = &ClientGroupCache[row].Groups[ClientGroupCache[row].nextIdx++];
+        if (ClientGroupCache[row].nextIdx == SESSIONS_PER_ROW)
+            ClientGroupCache[row].nextIdx = 0;
+        cg->idLen = ssl->session.idLen;
+        XMEMCPY(cg->serverID, ssl->session.serverID, ssl->session.idLen);
+    }
+    cg->group = ssl->namedGroup;
+
+    wc_UnLockMutex(&session_mutex);
+}
+
+#endif /* WOLFSSL_TLS13_GROUP_CACHE */
+
 #endif /* NO_CLIENT_CACHE */
 
 /* Restore the master secret and session information for certificates.
@@ -14794,10 +15957,24 @@ int wolfSSL_EVP_MD_type(const WOLFSSL_EVP_MD *md)
         ssl->options.handShakeState  = NULL_STATE;
         ssl->options.handShakeDone = 0;
         /* ssl->options.processReply = doProcessInit; */
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+        HsAdmitDone(ssl, 0);
+        ssl->options.admitWait = 0;
+#endif
+#ifdef HAVE_RECORD_SIZE_LIMIT
+        ssl->peerRecordSizeLimit = 0;
+#endif
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+        ssl->options.clientHelloCbDone = 0;
+#endif
 
         ssl->keys.encryptionOn = 0;
         XMEMSET(&ssl->msgsReceived, 0, sizeof(ssl->msgsReceived));
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        if (ssl->hsHashes != NULL && InitHandshakeHashes(ssl) != 0)
+            return WOLFSSL_FAILURE;
+#else
         if (ssl->hsHashes != NULL) {
 #ifndef NO_OLD_TLS
 #ifndef NO_MD5
@@ -14847,6 +16024,7 @@ int wolfSSL_EVP_MD_type(const WOLFSSL_EVP_MD *md)
         #endif
 #endif
         }
+#endif /* WOLFSSL_LAZY_HANDSHAKE_HASH */
 #ifdef SESSION_CERTS
         ssl->session.chain.count = 0;
 #endif
@@ -14879,8 +16057,12 @@ int wolfSSL_EVP_MD_type(const WOLFSSL_EVP_MD *md)
         /* WOLFSSL_MODE_ACCEPT_MOVING_WRITE_BUFFER is wolfSSL default mode */
 
         WOLFSSL_ENTER("SSL_CTX_set_mode");
-        if (mode == SSL_MODE_ENABLE_PARTIAL_WRITE)
+        if (ctx == NULL)
+            return 0;
+        if (mode & SSL_MODE_ENABLE_PARTIAL_WRITE)
             ctx->partialWrite = 1;
+        if (mode & SSL_MODE_RELEASE_BUFFERS)
+            ctx->releaseBuffers = 1;
 
         return mode;
     }
@@ -21365,6 +22547,9 @@ long wolfSSL_CTX_add_extra_chain_cert(WOLFSSL_CTX* ctx, WOLFSSL_X509* x509)
 #endif
 
         FreeDer(&ctx->certChain);
+    #ifdef WOLFSSL_CERT_MSG_CACHE
+        FreeCertMsgCache(ctx);
+    #endif
         ret = AllocDer(&ctx->certChain, idx, CERT_TYPE, ctx->heap);
         if (ret == 0) {
             XMEMCPY(ctx->certChain->buffer, chain, idx);
@@ -21443,6 +22628,9 @@ int wolfSSL_CTX_set_read_ahead(WOLFSSL_CTX* ctx, int v)
     }
 
     ctx->readAhead = (byte)v;
+#ifdef WOLFSSL_READ_AHEAD
+    ctx->readAheadSz = v ? WOLFSSL_READ_AHEAD_SZ : 0;
+#endif
 
     return WOLFSSL_SUCCESS;
 }
@@ -31974,6 +33162,9 @@ void* wolfSSL_GetDhAgreeCtx(WOLFSSL* ssl)
         WOLFSSL_ENTER("wolfSSL_CTX_use_certificate");
 
         FreeDer(&ctx->certificate); /* Make sure previous is free'd */
+    #ifdef WOLFSSL_CERT_MSG_CACHE
+        FreeCertMsgCache(ctx);
+    #endif
         ret = AllocDer(&ctx->certificate, x->derCert->length, CERT_TYPE,
                        ctx->heap);
         if (ret != 0)
@@ -33999,14 +35190,6 @@ const char * wolfSSL_get_servername(WOLFSSL* ssl, byte type)
 #endif /* NO_WOLFSSL_SERVER */
 #endif /* HAVE_SNI */
 
-WOLFSSL_CTX* wolfSSL_set_SSL_CTX(WOLFSSL* ssl, WOLFSSL_CTX* ctx)
-{
-    if (ssl && ctx && SetSSL_CTX(ssl, ctx, 0) == WOLFSSL_SUCCESS)
-        return ssl->ctx;
-    return NULL;
-}
-
-
 VerifyCallback wolfSSL_CTX_get_verify_callback(WOLFSSL_CTX* ctx)
 {
     WOLFSSL_ENTER("wolfSSL_CTX_get_verify_callback");
@@ -132,10 +132,18 @@ int BuildTlsHandshakeHash(WOLFSSL* ssl, byte* hash, word32* hashLen)
     if (ssl == NULL || hash == NULL || hashLen == NULL || *hashLen < HSHASH_SZ)
         return BAD_FUNC_ARG;
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if (HashCommit(ssl, HS_HASH_ALL) != 0)
+        return BUILD_MSG_ERROR;
+#endif
+
     /* for constant timing perform these even if error */
 #ifndef NO_OLD_TLS
-    ret |= wc_Md5GetHash(&ssl->hsHashes->hashMd5, hash);
-    ret |= wc_ShaGetHash(&ssl->hsHashes->hashSha, &hash[WC_MD5_DIGEST_SIZE]);
+    if (HS_HASH_ON(ssl, HS_HASH_MD5 | HS_HASH_SHA)) {
+        ret |= wc_Md5GetHash(&ssl->hsHashes->hashMd5, hash);
+        ret |= wc_ShaGetHash(&ssl->hsHashes->hashSha,
+                                                  &hash[WC_MD5_DIGEST_SIZE]);
+    }
 #endif
 
     if (IsAtLeastTLSv1_2(ssl)) {
@@ -934,9 +942,12 @@ static int Hmac_UpdateFinal_CT(Hmac* hmac, byte* digest, const byte* in,
     c32toa(realLen >> ((sizeof(word32) * 8) - 3), lenBytes);
     c32toa(realLen << 3, lenBytes + sizeof(word32));
 
-    ret = Hmac_HashUpdate(hmac, (unsigned char*)hmac->ipad, blockSz);
-    if (ret != 0)
-        return ret;
+    /* Inner pad already hashed when copied from the keyed HMAC. */
+    if (!hmac->innerHashKeyed) {
+        ret = Hmac_HashUpdate(hmac, (unsigned char*)hmac->ipad, blockSz);
+        if (ret != 0)
+            return ret;
+    }
 
     XMEMSET(hmac->innerHash, 0, macLen);
 
@@ -1122,6 +1133,68 @@ static int Hmac_UpdateFinal(Hmac* hmac, byte* digest, const byte* in,
 
 #endif
 
+/* Set up the HMAC of a record MAC for the direction.
+ *
+ * ssl     The SSL/TLS object.
+ * hmac    The HMAC object to set up. Free with wc_HmacFree().
+ * verify  Whether the MAC is of a record received.
+ * returns 0 on success, otherwise failure.
+ */
+static int TLS_HmacSetup(WOLFSSL* ssl, Hmac* hmac, int verify)
+{
+    int ret;
+#ifdef WOLFSSL_TLS_HMAC_CACHE
+    Hmac* keyed = verify ? ssl->decrypt.hmac : ssl->encrypt.hmac;
+
+    /* Copy the HMAC keyed when the keys were set. */
+    if (keyed != NULL) {
+        XMEMCPY(hmac, keyed, sizeof(Hmac));
+        return 0;
+    }
+#endif
+
+    ret = wc_HmacInit(hmac, ssl->heap, ssl->devId);
+    if (ret != 0)
+        return ret;
+
+    ret = wc_HmacSetKey(hmac, wolfSSL_GetHmacType(ssl),
+                        wolfSSL_GetMacSecret(ssl, verify),
+                        ssl->specs.hash_size);
+    if (ret != 0)
+        wc_HmacFree(hmac);
+
+    return ret;
+}
+
+#ifdef WOLFSSL_CBC_STITCH
+/* Start the MAC of a record so that the caller can MAC the message in parts.
+ * The record header is MACed.
+ *
+ * ssl      The SSL/TLS object.
+ * hmac     The HMAC object. Free with wc_HmacFree() when ret is 0.
+ * sz       The size of the message.
+ * content  The record content type.
+ * verify   Whether the MAC is of a record received.
+ * returns 0 on success, otherwise failure.
+ */
+int TLS_HmacStart(WOLFSSL* ssl, Hmac* hmac, word32 sz, int content, int verify)
+{
+    byte inner[WOLFSSL_TLS_HMAC_INNER_SZ];
+    int  ret;
+
+    wolfSSL_SetTlsHmacInner(ssl, inner, sz, content, verify);
+
+    ret = TLS_HmacSetup(ssl, hmac, verify);
+    if (ret == 0) {
+        ret = wc_HmacUpdate(hmac, inner, sizeof(inner));
+        if (ret != 0)
+            wc_HmacFree(hmac);
+    }
+
+    return ret;
+}
+#endif
+
 int TLS_hmac(WOLFSSL* ssl, byte* digest, const byte* in, word32 sz, int padSz,
              int content, int verify)
 {
@@ -1147,14 +1220,11 @@ int TLS_hmac(WOLFSSL* ssl, byte* digest, const byte* in, word32 sz, int padSz,
 
     wolfSSL_SetTlsHmacInner(ssl, myInner, sz, content, verify);
 
-    ret = wc_HmacInit(&hmac, ssl->heap, ssl->devId);
+    ret = TLS_HmacSetup(ssl, &hmac, verify);
     if (ret != 0)
         return ret;
 
-    ret = wc_HmacSetKey(&hmac, wolfSSL_GetHmacType(ssl),
-                                              wolfSSL_GetMacSecret(ssl, verify),
-                                              ssl->specs.hash_size);
-    if (ret == 0) {
+    {
         /* Constant time verification required. */
         if (verify && padSz >= 0) {
 #if !defined(WOLFSSL_NO_HASH_RAW) && !defined(HAVE_FIPS) && \
@@ -1270,12 +1340,50 @@ static TLSX* TLSX_New(TLSX_Type type, void* data, void* heap)
         extension->type = type;
         extension->data = data;
         extension->resp = 0;
+    #ifdef WOLFSSL_TLSX_INDEX
+        extension->index = NULL;
+    #endif
         extension->next = NULL;
     }
 
     return extension;
 }
 
+#ifdef WOLFSSL_TLSX_INDEX
+/**
+ * Builds the lookup table of a list once it has TLSX_INDEX_MIN extensions.
+ * Shorter lists are walked. Without memory the list is walked too.
+ */
+static void TLSX_IndexBuild(TLSX* list, void* heap)
+{
+    TLSX* extension;
+    TLSX_Index* index;
+    word16 idx;
+    int count = 0;
+
+    for (extension = list; extension != NULL; extension = extension->next)
+        count++;
+
+    if (count < TLSX_INDEX_MIN)
+        return;
+
+    index = (TLSX_Index*)XMALLOC(sizeof(TLSX_Index), heap, DYNAMIC_TYPE_TLSX);
+    if (index == NULL)
+        return;
+
+    XMEMSET(index, 0, sizeof(TLSX_Index));
+
+    for (extension = list; extension != NULL; extension = extension->next) {
+        extension->index = index;
+        idx = TLSX_ToSemaphore(extension->type);
+        if (idx < TLSX_INDEX_SZ && index->slot[idx] == NULL)
+            index->slot[idx] = extension;
+    }
+
+    (void)heap;
+}
+#endif
+
 /**
  * Creates a new extension and pushes it to the provided list.
  * Checks for duplicate extensions, keeps the newest.
@@ -1283,14 +1391,27 @@ static TLSX* TLSX_New(TLSX_Type type, void* data, void* heap)
 static int TLSX_Push(TLSX** list, TLSX_Type type, void* data, void* heap)
 {
     TLSX* extension = TLSX_New(type, data, heap);
+#ifdef WOLFSSL_TLSX_INDEX
+    word16 idx = TLSX_ToSemaphore(type);
+    TLSX_Index* index = (*list != NULL) ? (*list)->index : NULL;
+#endif
 
     if (extension == NULL)
         return MEMORY_E;
 
+#ifdef WOLFSSL_TLSX_INDEX
+    /* all extensions of a list share the lookup table. */
+    extension->index = index;
+#endif
+
     /* pushes the new extension on the list. */
     extension->next = *list;
     *list = extension;
 
+#ifdef WOLFSSL_TLSX_INDEX
+    /* only search for a duplicate when the table has one. */
+    if (index == NULL || idx >= TLSX_INDEX_SZ || index->slot[idx] != NULL)
+#endif
     /* remove duplicate extensions, there should be only one of each type. */
     do {
         if (extension->next && extension->next->type == type) {
@@ -1298,6 +1419,9 @@ static int TLSX_Push(TLSX** list, TLSX_Type type, void* data, void* heap)
 
             extension->next = next->next;
             next->next = NULL;
+        #ifdef WOLFSSL_TLSX_INDEX
+            next->index = NULL;
+        #endif
 
             TLSX_FreeAll(next, heap);
 
@@ -1308,6 +1432,13 @@ static int TLSX_Push(TLSX** list, TLSX_Type type, void* data, void* heap)
         }
     } while ((extension = extension->next));
 
+#ifdef WOLFSSL_TLSX_INDEX
+    if (index == NULL)
+        TLSX_IndexBuild(*list, heap);
+    else if (idx < TLSX_INDEX_SZ)
+        index->slot[idx] = *list;
+#endif
+
     return 0;
 }
 
@@ -1882,6 +2013,310 @@ byte TLSX_SNI_Status(TLSX* extensions, byte type)
     return 0;
 }
 
+#ifdef WOLFSSL_SNI_STORE
+
+#define SNI_STORE_HASH_INIT 0x811c9dc5
+
+/** FNV-1a hash of a host name ignoring case, continuing from hash. */
+static word32 SNI_StoreHash(word32 hash, const byte* name, word16 sz)
+{
+    word16 i;
+
+    for (i = 0; i < sz; i++) {
+        hash ^= (byte)XTOLOWER(name[i]);
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+/** Compares a received host name with a lower case stored one. */
+static int SNI_StoreMatch(const char* stored, const byte* name, word16 sz)
+{
+    word16 i;
+
+    for (i = 0; i < sz; i++) {
+        if ((byte)stored[i] != (byte)XTOLOWER(name[i]))
+            return 0;
+    }
+
+    return 1;
+}
+
+/** Finds the entry for a host name: an exact match first, then a wildcard
+ * covering the left-most label. */
+static SNI_StoreEntry* SNI_StoreFind(SNI_Store* store, const byte* name,
+                                                                     word16 sz)
+{
+    SNI_StoreEntry* entry;
+    word32 hash;
+    word16 i;
+
+    if (sz == 0 || sz > SNI_STORE_MAX_NAME)
+        return NULL;
+
+    hash = SNI_StoreHash(SNI_STORE_HASH_INIT, name, sz);
+
+    for (entry = store->bucket[hash & (store->bucketSz - 1)]; entry;
+                                                         entry = entry->next) {
+        if (entry->hash == hash && entry->nameSz == sz &&
+                                          SNI_StoreMatch(entry->name, name, sz))
+            return entry;
+    }
+
+    for (i = 0; i < sz && name[i] != '.'; i++);
+
+    if (i == 0 || i + 1 >= sz)
+        return NULL; /* no label to replace */
+
+    /* hash of "*" followed by ".suffix" */
+    hash = SNI_StoreHash(SNI_STORE_HASH_INIT, (const byte*)"*", 1);
+    hash = SNI_StoreHash(hash, name + i, sz - i);
+
+    for (entry = store->bucket[hash & (store->bucketSz - 1)]; entry;
+                                                         entry = entry->next) {
+        if (entry->hash == hash && entry->nameSz == sz - i + 1 &&
+                entry->name[0] == '*' &&
+                SNI_StoreMatch(entry->name + 1, name + i, sz - i))
+            return entry;
+    }
+
+    return NULL;
+}
+
+/** Adds an entry to the store of the CTX, which takes ownership of it.
+ * The number of buckets doubles when there are as many entries. */
+int SNI_StoreAdd(WOLFSSL_CTX* ctx, SNI_StoreEntry* entry)
+{
+    SNI_Store* store = ctx->sniStore;
+    SNI_StoreEntry* cur;
+    word32 i;
+
+    if (store == NULL) {
+        store = (SNI_Store*)XMALLOC(sizeof(SNI_Store), ctx->heap,
+                                                             DYNAMIC_TYPE_TLSX);
+        if (store == NULL)
+            return MEMORY_E;
+
+        store->bucket = (SNI_StoreEntry**)XMALLOC(
+                            sizeof(SNI_StoreEntry*) * SNI_STORE_INIT_SZ,
+                            ctx->heap, DYNAMIC_TYPE_TLSX);
+        if (store->bucket == NULL) {
+            XFREE(store, ctx->heap, DYNAMIC_TYPE_TLSX);
+            return MEMORY_E;
+        }
+
+        XMEMSET(store->bucket, 0, sizeof(SNI_StoreEntry*) * SNI_STORE_INIT_SZ);
+        store->bucketSz = SNI_STORE_INIT_SZ;
+        store->count    = 0;
+        ctx->sniStore   = store;
+    }
+
+    entry->hash = SNI_StoreHash(SNI_STORE_HASH_INIT, (const byte*)entry->name,
+                                                                entry->nameSz);
+
+    for (cur = store->bucket[entry->hash & (store->bucketSz - 1)]; cur;
+                                                             cur = cur->next) {
+        if (cur->hash == entry->hash && cur->nameSz == entry->nameSz &&
+                       XMEMCMP(cur->name, entry->name, entry->nameSz) == 0) {
+            /* handshakes may be using the buffers of the existing entry */
+            WOLFSSL_MSG("Host name already in SNI store");
+            return BAD_FUNC_ARG;
+        }
+    }
+
+    if (store->count >= store->bucketSz) {
+        word32 sz = store->bucketSz * 2;
+        SNI_StoreEntry** bucket = (SNI_StoreEntry**)XMALLOC(
+                        sizeof(SNI_StoreEntry*) * sz, ctx->heap,
+                        DYNAMIC_TYPE_TLSX);
+
+        if (bucket == NULL)
+            return MEMORY_E;
+
+        XMEMSET(bucket, 0, sizeof(SNI_StoreEntry*) * sz);
+
+        for (i = 0; i < store->bucketSz; i++) {
+            while ((cur = store->bucket[i])) {
+                store->bucket[i] = cur->next;
+                cur->next = bucket[cur->hash & (sz - 1)];
+                bucket[cur->hash & (sz - 1)] = cur;
+            }
+        }
+
+        XFREE(store->bucket, ctx->heap, DYNAMIC_TYPE_TLSX);
+        store->bucket   = bucket;
+        store->bucketSz = sz;
+    }
+
+    i = entry->hash & (store->bucketSz - 1);
+    entry->next = store->bucket[i];
+    store->bucket[i] = entry;
+    store->count++;
+
+    return 0;
+}
+
+/** Releases an entry with its certificate, chain and key. */
+void FreeSNIStoreEntry(SNI_StoreEntry* entry, void* heap)
+{
+    if (entry == NULL)
+        return;
+
+    FreeDer(&entry->certificate);
+    FreeDer(&entry->certChain);
+    FreeDer(&entry->key);
+    XFREE(entry->name, heap, DYNAMIC_TYPE_TLSX);
+    XFREE(entry, heap, DYNAMIC_TYPE_TLSX);
+
+    (void)heap;
+}
+
+/** Releases the store of a CTX. */
+void FreeSNIStore(WOLFSSL_CTX* ctx)
+{
+    SNI_Store* store = ctx->sniStore;
+    SNI_StoreEntry* entry;
+    word32 i;
+
+    if (store == NULL)
+        return;
+
+    for (i = 0; i < store->bucketSz; i++) {
+        while ((entry = store->bucket[i])) {
+            store->bucket[i] = entry->next;
+            FreeSNIStoreEntry(entry, ctx->heap);
+        }
+    }
+
+    XFREE(store->bucket, ctx->heap, DYNAMIC_TYPE_TLSX);
+    XFREE(store, ctx->heap, DYNAMIC_TYPE_TLSX);
+    ctx->sniStore = NULL;
+}
+
+/** Serves the certificate, chain and key of a store entry. As with the CTX
+ * certificate, the SSL uses the buffers without owning them. */
+static void TLSX_SNI_StoreUse(WOLFSSL* ssl, SNI_StoreEntry* entry)
+{
+    int resetSuites;
+
+    if (ssl->buffers.weOwnCert) {
+        FreeDer(&ssl->buffers.certificate);
+    #ifdef KEEP_OUR_CERT
+        FreeX509(ssl->ourCert);
+        if (ssl->ourCert) {
+            XFREE(ssl->ourCert, ssl->heap, DYNAMIC_TYPE_X509);
+            ssl->ourCert = NULL;
+        }
+    #endif
+        ssl->buffers.weOwnCert = 0;
+    }
+    if (ssl->buffers.weOwnCertChain) {
+        FreeDer(&ssl->buffers.certChain);
+        ssl->buffers.weOwnCertChain = 0;
+    }
+    if (ssl->buffers.weOwnKey) {
+        FreeDer(&ssl->buffers.key);
+        ssl->buffers.weOwnKey = 0;
+    }
+
+    ssl->buffers.certificate  = entry->certificate;
+    ssl->buffers.certChain    = entry->certChain;
+#ifdef WOLFSSL_TLS13
+    ssl->buffers.certChainCnt = entry->certChainCnt;
+#endif
+    ssl->buffers.key          = entry->key;
+    ssl->buffers.keyType      = entry->keyType;
+    ssl->buffers.keyId        = 0;
+    ssl->buffers.keySz        = entry->keySz;
+    ssl->buffers.keyDevId     = INVALID_DEVID;
+#if defined(HAVE_ECC) || defined(HAVE_ED25519)
+    ssl->pkCurveOID           = entry->pkCurveOID;
+#endif
+
+    /* suites depend on the kind of certificate and key */
+    resetSuites = ssl->options.haveECDSAsig  != entry->haveECDSAsig ||
+                  ssl->options.haveECC       != entry->haveECC ||
+                  ssl->options.haveStaticECC != entry->haveStaticECC;
+
+    ssl->options.haveECDSAsig  = entry->haveECDSAsig;
+    ssl->options.haveECC       = entry->haveECC;
+    ssl->options.haveStaticECC = entry->haveStaticECC;
+
+    if (resetSuites && ssl->suites != NULL) {
+        word16 havePSK = 0;
+        word16 haveRSA = 0;
+
+    #ifndef NO_PSK
+        havePSK = ssl->options.havePSK;
+    #endif
+    #ifndef NO_RSA
+        haveRSA = 1;
+    #endif
+
+        InitSuites(ssl->suites, ssl->version, ssl->buffers.keySz, haveRSA,
+                   havePSK, ssl->options.haveDH, ssl->options.haveNTRU,
+                   ssl->options.haveECDSAsig, ssl->options.haveECC,
+                   ssl->options.haveStaticECC, ssl->options.side);
+    }
+}
+
+/** Looks the requested host name up in the store of the CTX and serves the
+ * certificate found. Returns 1 when a name matched and 0 otherwise. */
+static int TLSX_SNI_StoreParse(WOLFSSL* ssl, byte* input, word16 length)
+{
+    word16 size = 0;
+    word16 offset = 0;
+
+    if (OPAQUE16_LEN > length)
+        return BUFFER_ERROR;
+
+    ato16(input, &size);
+    offset += OPAQUE16_LEN;
+
+    if (length != OPAQUE16_LEN + size)
+        return BUFFER_ERROR;
+
+    for (size = 0; offset < length; offset += size) {
+        SNI_StoreEntry* entry;
+        byte type = input[offset++];
+        int ret;
+
+        if (offset + OPAQUE16_LEN > length)
+            return BUFFER_ERROR;
+
+        ato16(input + offset, &size);
+        offset += OPAQUE16_LEN;
+
+        if (offset + size > length)
+            return BUFFER_ERROR;
+
+        if (type != WOLFSSL_SNI_HOST_NAME)
+            continue;
+
+        entry = SNI_StoreFind(ssl->ctx->sniStore, input + offset, size);
+        if (entry == NULL)
+            continue;
+
+        WOLFSSL_MSG("SNI store match");
+
+        ret = TLSX_UseSNI(&ssl->extensions, type, input + offset, size,
+                                                                     ssl->heap);
+        if (ret != WOLFSSL_SUCCESS)
+            return ret;
+
+        TLSX_SNI_SetStatus(ssl->extensions, type, WOLFSSL_SNI_REAL_MATCH);
+        TLSX_SetResponse(ssl, TLSX_SERVER_NAME);
+        TLSX_SNI_StoreUse(ssl, entry);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif /* WOLFSSL_SNI_STORE */
+
 /** Parses a buffer of SNI extensions. */
 static int TLSX_SNI_Parse(WOLFSSL* ssl, byte* input, word16 length,
                                                                  byte isRequest)
@@ -1921,6 +2356,15 @@ static int TLSX_SNI_Parse(WOLFSSL* ssl, byte* input, word16 length,
     }
 
 #ifndef NO_WOLFSSL_SERVER
+#ifdef WOLFSSL_SNI_STORE
+    if (ssl->ctx->sniStore != NULL) {
+        int ret = TLSX_SNI_StoreParse(ssl, input, length);
+
+        if (ret != 0)
+            return ret > 0 ? 0 : ret; /* the store answers for the name */
+    }
+#endif
+
     if (!extension || !extension->data) {
         #if defined(WOLFSSL_ALWAYS_KEEP_SNI) && !defined(NO_WOLFSSL_SERVER)
             /* This will keep SNI even though TLSX_UseSNI has not been called.
@@ -2669,6 +3113,12 @@ static int TLSX_MFL_Parse(WOLFSSL* ssl, byte* input, word16 length,
             return TLSX_HandleUnsupportedExtension(ssl);
 #endif
 
+#ifdef HAVE_RECORD_SIZE_LIMIT
+    /* Record Size Limit supersedes Maximum Fragment Length. */
+    if (isRequest && ssl->peerRecordSizeLimit != 0)
+        return 0;
+#endif
+
     switch (*input) {
         case WOLFSSL_MFL_2_8 : ssl->max_fragment =  256; break;
         case WOLFSSL_MFL_2_9 : ssl->max_fragment =  512; break;
@@ -2735,6 +3185,137 @@ int TLSX_UseMaxFragment(TLSX** extensions, byte mfl, void* heap)
 
 #endif /* HAVE_MAX_FRAGMENT */
 
+/******************************************************************************/
+/* Record Size Limit                                                          */
+/******************************************************************************/
+
+#ifdef HAVE_RECORD_SIZE_LIMIT
+
+/* Create a new Record Size Limit object in the extensions or update it.
+ *
+ * ssl    The SSL/TLS object.
+ * limit  The largest plaintext to receive, 0 for the protocol maximum.
+ * returns 0 on success and other values indicate failure.
+ */
+static int TLSX_RecordSizeLimit_Use(WOLFSSL* ssl, word16 limit)
+{
+    int   ret = 0;
+    TLSX* extension;
+
+    /* Find the Record Size Limit extension if it exists. */
+    extension = TLSX_Find(ssl->extensions, TLSX_RECORD_SIZE_LIMIT);
+    if (extension == NULL) {
+        /* Push new Record Size Limit extension. */
+        ret = TLSX_Push(&ssl->extensions, TLSX_RECORD_SIZE_LIMIT, NULL,
+            ssl->heap);
+        if (ret != 0)
+            return ret;
+
+        extension = TLSX_Find(ssl->extensions, TLSX_RECORD_SIZE_LIMIT);
+        if (extension == NULL)
+            return MEMORY_E;
+    }
+
+    extension->val = limit;
+
+    return 0;
+}
+
+/* Writes the Record Size Limit extension into the output buffer.
+ * A server that has no limit of its own responds with the protocol maximum,
+ * the inner plaintext of a TLS v1.3 record has an extra content type byte.
+ *
+ * limit    The limit to write or 0 for the protocol maximum.
+ * output   The buffer to write into.
+ * msgType  The type of the message this extension is being written into.
+ * returns the number of bytes written into the buffer.
+ */
+static word16 TLSX_RecordSizeLimit_Write(word16 limit, byte* output,
+                                         byte msgType)
+{
+    if (limit == 0) {
+        limit = MAX_RECORD_SIZE;
+        if (msgType == encrypted_extensions)
+            limit++;
+    }
+
+    c16toa(limit, output);
+
+    return OPAQUE16_LEN;
+}
+
+/* Parse the Record Size Limit extension.
+ * A server ignores a Maximum Fragment Length extension when both are offered.
+ *
+ * ssl        The SSL/TLS object.
+ * input      The extension data.
+ * length     The length of the extension data.
+ * isRequest  Whether the extension is from a ClientHello.
+ * returns 0 on success and other values indicate failure.
+ */
+static int TLSX_RecordSizeLimit_Parse(WOLFSSL* ssl, byte* input, word16 length,
+                                      byte isRequest)
+{
+    word16 limit;
+
+    if (length != OPAQUE16_LEN)
+        return BUFFER_ERROR;
+
+#ifdef WOLFSSL_OLD_UNSUPPORTED_EXTENSION
+    (void) isRequest;
+#else
+    if (!isRequest)
+        if (TLSX_CheckUnsupportedExtension(ssl, TLSX_RECORD_SIZE_LIMIT))
+            return TLSX_HandleUnsupportedExtension(ssl);
+#endif
+
+    ato16(input, &limit);
+    if (limit < WOLFSSL_RECORD_SIZE_LIMIT_MIN) {
+        SendAlert(ssl, alert_fatal, illegal_parameter);
+        return BAD_RECORD_SIZE_LIMIT_E;
+    }
+    /* a client may offer more than the version chosen allows, a server may
+     * not answer with it */
+    if (!isRequest && limit > MAX_RECORD_SIZE +
+                              (IsAtLeastTLSv1_3(ssl->version) ? 1 : 0)) {
+        SendAlert(ssl, alert_fatal, illegal_parameter);
+        return BAD_RECORD_SIZE_LIMIT_E;
+    }
+
+    ssl->peerRecordSizeLimit = limit;
+
+#ifndef NO_WOLFSSL_SERVER
+    if (isRequest) {
+        int ret;
+
+    #ifdef HAVE_MAX_FRAGMENT
+        ssl->max_fragment = MAX_RECORD_SIZE;
+        TLSX_Remove(&ssl->extensions, TLSX_MAX_FRAGMENT_LENGTH, ssl->heap);
+    #endif
+
+        ret = TLSX_RecordSizeLimit_Use(ssl, ssl->recordSizeLimit);
+        if (ret != 0)
+            return ret;
+
+        TLSX_SetResponse(ssl, TLSX_RECORD_SIZE_LIMIT);
+    }
+#endif
+
+    return 0;
+}
+
+#define RSL_GET_SIZE(a)  OPAQUE16_LEN
+#define RSL_WRITE        TLSX_RecordSizeLimit_Write
+#define RSL_PARSE        TLSX_RecordSizeLimit_Parse
+
+#else
+
+#define RSL_GET_SIZE(a)       0
+#define RSL_WRITE(a, b, c)    0
+#define RSL_PARSE(a, b, c, d) 0
+
+#endif /* HAVE_RECORD_SIZE_LIMIT */
+
 /******************************************************************************/
 /* Truncated HMAC                                                             */
 /******************************************************************************/
@@ -6409,6 +6990,10 @@ static int TLSX_KeyShare_GenX25519Key(WOLFSSL *ssl, KeyShareEntry* kse)
     ret = wc_curve25519_init(key);
     if (ret != 0)
         goto end;
+#ifdef WOLFSSL_KEY_SHARE_POOL
+    ret = KeySharePoolGet(ssl, WOLFSSL_ECC_X25519, key);
+    if (ret != 0)
+#endif
     ret = wc_curve25519_make_key(ssl->rng, CURVE25519_KEYSIZE, key);
     if (ret != 0)
         goto end;
@@ -6527,6 +7112,10 @@ static int TLSX_KeyShare_GenEccKey(WOLFSSL *ssl, KeyShareEntry* kse)
     ret = wc_ecc_init_ex(eccKey, ssl->heap, ssl->devId);
     if (ret != 0)
         goto end;
+#ifdef WOLFSSL_KEY_SHARE_POOL
+    ret = KeySharePoolGet(ssl, kse->group, eccKey);
+    if (ret != 0)
+#endif
     ret = wc_ecc_make_key_ex(ssl->rng, keySize, eccKey, curveId);
 #ifdef WOLFSSL_ASYNC_CRYPT
     /* TODO: Make this function non-blocking */
@@ -8408,6 +8997,112 @@ static int TLSX_PostHandAuth_Use(WOLFSSL* ssl)
 
 #endif
 
+/******************************************************************************/
+/* Certificate Compression                                                    */
+/******************************************************************************/
+
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_CERT_COMPRESSION)
+/* Get the size of the encoded Certificate Compression extension.
+ * Only in ClientHello.
+ *
+ * msgType  The type of the message this extension is being written into.
+ * returns the number of bytes of the encoded Certificate Compression
+ * extension.
+ */
+static word16 TLSX_CertCompress_GetSize(byte msgType)
+{
+    if (msgType == client_hello)
+        return OPAQUE8_LEN + OPAQUE16_LEN;
+
+    return SANITY_MSG_E;
+}
+
+/* Writes the Certificate Compression extension into the output buffer.
+ * Assumes that the the output buffer is big enough to hold data.
+ * Only in ClientHello. zlib is the only algorithm offered.
+ *
+ * output   The buffer to write into.
+ * msgType  The type of the message this extension is being written into.
+ * returns the number of bytes written into the buffer.
+ */
+static word16 TLSX_CertCompress_Write(byte* output, byte msgType)
+{
+    if (msgType == client_hello) {
+        output[0] = OPAQUE16_LEN;
+        c16toa(CERT_COMPRESS_ZLIB, output + OPAQUE8_LEN);
+        return OPAQUE8_LEN + OPAQUE16_LEN;
+    }
+
+    return SANITY_MSG_E;
+}
+
+/* Parse the Certificate Compression extension.
+ * Only in ClientHello.
+ *
+ * ssl      The SSL/TLS object.
+ * input    The extension data.
+ * length   The length of the extension data.
+ * msgType  The type of the message this extension is being parsed from.
+ * returns 0 on success and other values indicate failure.
+ */
+static int TLSX_CertCompress_Parse(WOLFSSL* ssl, byte* input, word16 length,
+                                   byte msgType)
+{
+    word16 idx;
+    word16 algo;
+
+    if (msgType != client_hello)
+        return SANITY_MSG_E;
+
+    /* Algorithm list length must be non-zero, even and match. */
+    if (length < OPAQUE8_LEN || input[0] < OPAQUE16_LEN ||
+            (input[0] % OPAQUE16_LEN) != 0 || input[0] + OPAQUE8_LEN != length)
+        return BUFFER_E;
+
+    for (idx = OPAQUE8_LEN; idx < length; idx += OPAQUE16_LEN) {
+        ato16(input + idx, &algo);
+        if (algo == CERT_COMPRESS_ZLIB)
+            ssl->options.peerCertCompress = 1;
+    }
+
+    return 0;
+}
+
+/* Create a new Certificate Compression object in the extensions.
+ *
+ * ssl    The SSL/TLS object.
+ * returns 0 on success and other values indicate failure.
+ */
+static int TLSX_CertCompress_Use(WOLFSSL* ssl)
+{
+    int   ret = 0;
+    TLSX* extension;
+
+    /* Find the Certificate Compression extension if it exists. */
+    extension = TLSX_Find(ssl->extensions, TLSX_CERT_COMPRESSION);
+    if (extension == NULL) {
+        /* Push new Certificate Compression extension. */
+        ret = TLSX_Push(&ssl->extensions, TLSX_CERT_COMPRESSION, NULL,
+            ssl->heap);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+#define CCE_GET_SIZE  TLSX_CertCompress_GetSize
+#define CCE_WRITE     TLSX_CertCompress_Write
+#define CCE_PARSE     TLSX_CertCompress_Parse
+
+#else
+
+#define CCE_GET_SIZE(a)       0
+#define CCE_WRITE(a, b)       0
+#define CCE_PARSE(a, b, c, d) 0
+
+#endif
+
 /******************************************************************************/
 /* Early Data Indication                                                      */
 /******************************************************************************/
@@ -8545,6 +9240,16 @@ int TLSX_EarlyData_Use(WOLFSSL* ssl, word32 max)
 TLSX* TLSX_Find(TLSX* list, TLSX_Type type)
 {
     TLSX* extension = list;
+#ifdef WOLFSSL_TLSX_INDEX
+    word16 idx = TLSX_ToSemaphore(type);
+
+    if (list != NULL && list->index != NULL && idx < TLSX_INDEX_SZ) {
+        extension = list->index->slot[idx];
+        if (extension != NULL && extension->type != type)
+            extension = NULL;
+        return extension;
+    }
+#endif
 
     while (extension && extension->type != type)
         extension = extension->next;
@@ -8557,6 +9262,13 @@ void TLSX_Remove(TLSX** list, TLSX_Type type, void* heap)
 {
     TLSX* extension = *list;
     TLSX** next = list;
+#ifdef WOLFSSL_TLSX_INDEX
+    word16 idx = TLSX_ToSemaphore(type);
+
+    if (extension != NULL && extension->index != NULL &&
+                                             TLSX_Find(*list, type) == NULL)
+        return;
+#endif
 
     while (extension && extension->type != type) {
         next = &extension->next;
@@ -8566,14 +9278,58 @@ void TLSX_Remove(TLSX** list, TLSX_Type type, void* heap)
     if (extension) {
         *next = extension->next;
         extension->next = NULL;
+    #ifdef WOLFSSL_TLSX_INDEX
+        if (extension->index != NULL) {
+            if (idx < TLSX_INDEX_SZ)
+                extension->index->slot[idx] = NULL;
+            /* the last extension of a list frees the lookup table. */
+            if (*list == NULL)
+                XFREE(extension->index, heap, DYNAMIC_TYPE_TLSX);
+            extension->index = NULL;
+        }
+    #endif
         TLSX_FreeAll(extension, heap);
     }
 }
 
+/** Releases the extensions that are only used during the handshake.
+ * Extensions that can be queried after the handshake are kept. */
+void TLSX_FreeHandshake(WOLFSSL* ssl)
+{
+#ifdef WOLFSSL_TLS13
+    TLSX_Remove(&ssl->extensions, TLSX_KEY_SHARE, ssl->heap);
+    TLSX_Remove(&ssl->extensions, TLSX_SUPPORTED_VERSIONS, ssl->heap);
+    TLSX_Remove(&ssl->extensions, TLSX_COOKIE, ssl->heap);
+    #if defined(HAVE_SESSION_TICKET) || !defined(NO_PSK)
+    TLSX_Remove(&ssl->extensions, TLSX_PRE_SHARED_KEY, ssl->heap);
+    TLSX_Remove(&ssl->extensions, TLSX_PSK_KEY_EXCHANGE_MODES, ssl->heap);
+    #endif
+    #ifdef WOLFSSL_CERT_COMPRESSION
+    TLSX_Remove(&ssl->extensions, TLSX_CERT_COMPRESSION, ssl->heap);
+    #endif
+#endif
+
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
+    /* needed to send a post-handshake CertificateRequest */
+    if (ssl->options.tls1_3 && ssl->options.postHandshakeAuth)
+        return;
+#endif
+#if !defined(WOLFSSL_NO_SIGALG)
+    TLSX_Remove(&ssl->extensions, TLSX_SIGNATURE_ALGORITHMS, ssl->heap);
+#endif
+#if defined(WOLFSSL_TLS13) && !defined(WOLFSSL_TLS13_DRAFT_18) && \
+                                            !defined(WOLFSSL_TLS13_DRAFT_22)
+    TLSX_Remove(&ssl->extensions, TLSX_SIGNATURE_ALGORITHMS_CERT, ssl->heap);
+#endif
+}
+
 /** Releases all extensions in the provided list. */
 void TLSX_FreeAll(TLSX* list, void* heap)
 {
     TLSX* extension;
+#ifdef WOLFSSL_TLSX_INDEX
+    TLSX_Index* index = (list != NULL) ? list->index : NULL;
+#endif
 
     while ((extension = list)) {
         list = extension->next;
@@ -8592,6 +9348,11 @@ void TLSX_FreeAll(TLSX* list, void* heap)
                 MFL_FREE_ALL(extension->data, heap);
                 break;
 
+    #ifdef HAVE_RECORD_SIZE_LIMIT
+            case TLSX_RECORD_SIZE_LIMIT:
+                break;
+    #endif
+
             case TLSX_TRUNCATED_HMAC:
                 /* Nothing to do. */
                 break;
@@ -8659,6 +9420,11 @@ void TLSX_FreeAll(TLSX* list, void* heap)
                 break;
     #endif
 
+    #ifdef WOLFSSL_CERT_COMPRESSION
+            case TLSX_CERT_COMPRESSION:
+                break;
+    #endif
+
     #if !defined(WOLFSSL_TLS13_DRAFT_18) && !defined(WOLFSSL_TLS13_DRAFT_22)
             case TLSX_SIGNATURE_ALGORITHMS_CERT:
                 break;
@@ -8673,6 +9439,10 @@ void TLSX_FreeAll(TLSX* list, void* heap)
         XFREE(extension, heap, DYNAMIC_TYPE_TLSX);
     }
 
+#ifdef WOLFSSL_TLSX_INDEX
+    XFREE(index, heap, DYNAMIC_TYPE_TLSX);
+#endif
+
     (void)heap;
 }
 
@@ -8723,6 +9493,12 @@ static int TLSX_GetSize(TLSX* list, byte* semaphore, byte msgType, word16* pLeng
                 length += MFL_GET_SIZE(extension->data);
                 break;
 
+    #ifdef HAVE_RECORD_SIZE_LIMIT
+            case TLSX_RECORD_SIZE_LIMIT:
+                length += RSL_GET_SIZE(msgType);
+                break;
+    #endif
+
             case TLSX_TRUNCATED_HMAC:
                 /* always empty. */
                 break;
@@ -8799,6 +9575,12 @@ static int TLSX_GetSize(TLSX* list, byte* semaphore, byte msgType, word16* pLeng
                 break;
     #endif
 
+    #ifdef WOLFSSL_CERT_COMPRESSION
+            case TLSX_CERT_COMPRESSION:
+                length += CCE_GET_SIZE(msgType);
+                break;
+    #endif
+
     #if !defined(WOLFSSL_TLS13_DRAFT_18) && !defined(WOLFSSL_TLS13_DRAFT_22)
             case TLSX_SIGNATURE_ALGORITHMS_CERT:
                 length += SAC_GET_SIZE(extension->data);
@@ -8869,6 +9651,14 @@ static int TLSX_Write(TLSX* list, byte* output, byte* semaphore,
                 offset += MFL_WRITE((byte*)extension->data, output + offset);
                 break;
 
+    #ifdef HAVE_RECORD_SIZE_LIMIT
+            case TLSX_RECORD_SIZE_LIMIT:
+                WOLFSSL_MSG("Record Size Limit extension to write");
+                offset += RSL_WRITE((word16)extension->val, output + offset,
+                                    msgType);
+                break;
+    #endif
+
             case TLSX_TRUNCATED_HMAC:
                 WOLFSSL_MSG("Truncated HMAC extension to write");
                 /* always empty. */
@@ -8969,6 +9759,13 @@ static int TLSX_Write(TLSX* list, byte* output, byte* semaphore,
                 break;
     #endif
 
+    #ifdef WOLFSSL_CERT_COMPRESSION
+            case TLSX_CERT_COMPRESSION:
+                WOLFSSL_MSG("Certificate Compression extension to write");
+                offset += CCE_WRITE(output + offset, msgType);
+                break;
+    #endif
+
     #if !defined(WOLFSSL_TLS13_DRAFT_18) && !defined(WOLFSSL_TLS13_DRAFT_22)
             case TLSX_SIGNATURE_ALGORITHMS_CERT:
                 WOLFSSL_MSG("Signature Algorithms extension to write");
@@ -9486,6 +10283,14 @@ int TLSX_PopulateExtensions(WOLFSSL* ssl, byte isServer)
                  return ret;
         }
 #endif /* (HAVE_ECC || HAVE_CURVE25519) && HAVE_SUPPORTED_CURVES */
+
+#ifdef HAVE_RECORD_SIZE_LIMIT
+        if (ssl->recordSizeLimit != 0) {
+            ret = TLSX_RecordSizeLimit_Use(ssl, ssl->recordSizeLimit);
+            if (ret != 0)
+                return ret;
+        }
+#endif
     } /* is not server */
 
 #if !defined(WOLFSSL_NO_SIGALG)
@@ -9534,6 +10339,20 @@ int TLSX_PopulateExtensions(WOLFSSL* ssl, byte isServer)
                 if (ssl->options.resuming && ssl->session.namedGroup != 0)
                     namedGroup = ssl->session.namedGroup;
                 else
+        #endif
+        #ifdef WOLFSSL_TLS13_GROUP_CACHE
+                /* Send the group the server picked last time to avoid a
+                 * HelloRetryRequest. */
+                if (ssl->cachedGroup != 0 &&
+                        TLSX_KeyShare_IsSupported(ssl->cachedGroup) &&
+                        TLSX_SupportedGroups_Find(ssl, ssl->cachedGroup)) {
+                    namedGroup = ssl->cachedGroup;
+                    if (wc_LockMutex(&ssl->ctx->countMutex) == 0) {
+                        ssl->ctx->groupCacheHits++;
+                        wc_UnLockMutex(&ssl->ctx->countMutex);
+                    }
+                }
+                else
         #endif
                 {
         #if defined(HAVE_ECC) && (!defined(NO_ECC256) || \
@@ -9649,6 +10468,13 @@ int TLSX_PopulateExtensions(WOLFSSL* ssl, byte isServer)
                     return ret;
             }
         #endif
+        #if defined(WOLFSSL_CERT_COMPRESSION)
+            if (!isServer && ssl->options.certCompress) {
+                ret = TLSX_CertCompress_Use(ssl);
+                if (ret != 0)
+                    return ret;
+            }
+        #endif
         }
 
     #endif
@@ -9697,6 +10523,9 @@ int TLSX_GetRequestSize(WOLFSSL* ssl, byte msgType, word16* pLength)
             TURN_ON(semaphore, TLSX_ToSemaphore(TLSX_COOKIE));
     #ifdef WOLFSSL_POST_HANDSHAKE_AUTH
             TURN_ON(semaphore, TLSX_ToSemaphore(TLSX_POST_HANDSHAKE_AUTH));
+    #endif
+    #ifdef WOLFSSL_CERT_COMPRESSION
+            TURN_ON(semaphore, TLSX_ToSemaphore(TLSX_CERT_COMPRESSION));
     #endif
         }
     #if defined(HAVE_SESSION_TICKET) || !defined(NO_PSK)
@@ -9791,6 +10620,9 @@ int TLSX_WriteRequest(WOLFSSL* ssl, byte* output, byte msgType, word16* pOffset)
             TURN_ON(semaphore, TLSX_ToSemaphore(TLSX_COOKIE));
     #ifdef WOLFSSL_POST_HANDSHAKE_AUTH
             TURN_ON(semaphore, TLSX_ToSemaphore(TLSX_POST_HANDSHAKE_AUTH));
+    #endif
+    #ifdef WOLFSSL_CERT_COMPRESSION
+            TURN_ON(semaphore, TLSX_ToSemaphore(TLSX_CERT_COMPRESSION));
     #endif
         }
     #if defined(HAVE_SESSION_TICKET) || !defined(NO_PSK)
@@ -10241,6 +11073,25 @@ int TLSX_Parse(WOLFSSL* ssl, byte* input, word16 length, byte msgType,
                 ret = MFL_PARSE(ssl, input + offset, size, isRequest);
                 break;
 
+    #ifdef HAVE_RECORD_SIZE_LIMIT
+            case TLSX_RECORD_SIZE_LIMIT:
+                WOLFSSL_MSG("Record Size Limit extension received");
+
+#ifdef WOLFSSL_TLS13
+                if (IsAtLeastTLSv1_3(ssl->version) &&
+                        msgType != client_hello &&
+                        msgType != encrypted_extensions) {
+                    return EXT_NOT_ALLOWED;
+                }
+                else if (!IsAtLeastTLSv1_3(ssl->version) &&
+                         msgType == encrypted_extensions) {
+                    return EXT_NOT_ALLOWED;
+                }
+#endif
+                ret = RSL_PARSE(ssl, input + offset, size, isRequest);
+                break;
+    #endif
+
             case TLSX_TRUNCATED_HMAC:
                 WOLFSSL_MSG("Truncated HMAC extension received");
 
@@ -10465,6 +11316,24 @@ int TLSX_Parse(WOLFSSL* ssl, byte* input, word16 length, byte msgType,
                 break;
     #endif
 
+    #ifdef WOLFSSL_CERT_COMPRESSION
+            case TLSX_CERT_COMPRESSION:
+                WOLFSSL_MSG("Certificate Compression extension received");
+
+                if (!IsAtLeastTLSv1_3(ssl->version))
+                    break;
+
+                /* Compressing client certificates is not supported so the
+                 * extension in a CertificateRequest is ignored. */
+                if (msgType == certificate_request)
+                    break;
+                if (msgType != client_hello)
+                    return EXT_NOT_ALLOWED;
+
+                ret = CCE_PARSE(ssl, input + offset, size, msgType);
+                break;
+    #endif
+
     #if !defined(WOLFSSL_TLS13_DRAFT_18) && !defined(WOLFSSL_TLS13_DRAFT_22)
             case TLSX_SIGNATURE_ALGORITHMS_CERT:
                 WOLFSSL_MSG("Signature Algorithms extension received");
@@ -133,6 +133,11 @@
 #ifndef HAVE_HKDF
     #error The build option HAVE_HKDF is required for TLS 1.3
 #endif
+#if defined(WOLFSSL_EARLY_DATA_ANTI_REPLAY) && \
+    (!defined(WOLFSSL_EARLY_DATA) || !defined(HAVE_SESSION_TICKET))
+    #error The early data anti-replay cache requires WOLFSSL_EARLY_DATA and \
+           HAVE_SESSION_TICKET
+#endif
 
 
 /* Set ret to error value and jump to label.
@@ -207,30 +212,24 @@ static int Tls13_HKDF_Extract(byte* prk, const byte* salt, int saltLen,
     return ret;
 }
 
-/* Expand data using HMAC, salt and label and info.
- * TLS v1.3 defines this function.
+/* Encode the HkdfLabel structure that is expanded.
  *
- * okm          The generated pseudorandom key - output key material.
+ * data         The buffer to hold the encoding of MAX_HKDF_LABEL_SZ bytes.
  * okmLen       The length of generated pseudorandom key - output key material.
- * prk          The salt - pseudo-random key.
- * prkLen       The length of the salt - pseudo-random key.
  * protocol     The TLS protocol label.
  * protocolLen  The length of the TLS protocol label.
+ * label        The label used to distinguish the context.
+ * labelLen     The length of the label.
  * info         The information to expand.
  * infoLen      The length of the information.
- * digest       The type of digest to use.
- * returns 0 on success, otherwise failure.
+ * returns the length of the encoding.
  */
-static int HKDF_Expand_Label(byte* okm, word32 okmLen,
-                             const byte* prk, word32 prkLen,
-                             const byte* protocol, word32 protocolLen,
-                             const byte* label, word32 labelLen,
-                             const byte* info, word32 infoLen,
-                             int digest)
+static int SetHkdfLabel(byte* data, word32 okmLen,
+                        const byte* protocol, word32 protocolLen,
+                        const byte* label, word32 labelLen,
+                        const byte* info, word32 infoLen)
 {
-    int    ret = 0;
-    int    idx = 0;
-    byte   data[MAX_HKDF_LABEL_SZ];
+    int idx = 0;
 
     /* Output length. */
     data[idx++] = (byte)(okmLen >> 8);
@@ -246,9 +245,41 @@ static int HKDF_Expand_Label(byte* okm, word32 okmLen,
     /* Length of hash of messages */
     data[idx++] = (byte)infoLen;
     /* Hash of messages */
-    XMEMCPY(&data[idx], info, infoLen);
+    if (infoLen > 0)
+        XMEMCPY(&data[idx], info, infoLen);
     idx += infoLen;
 
+    return idx;
+}
+
+/* Expand data using HMAC, salt and label and info.
+ * TLS v1.3 defines this function.
+ *
+ * okm          The generated pseudorandom key - output key material.
+ * okmLen       The length of generated pseudorandom key - output key material.
+ * prk          The salt - pseudo-random key.
+ * prkLen       The length of the salt - pseudo-random key.
+ * protocol     The TLS protocol label.
+ * protocolLen  The length of the TLS protocol label.
+ * info         The information to expand.
+ * infoLen      The length of the information.
+ * digest       The type of digest to use.
+ * returns 0 on success, otherwise failure.
+ */
+static int HKDF_Expand_Label(byte* okm, word32 okmLen,
+                             const byte* prk, word32 prkLen,
+                             const byte* protocol, word32 protocolLen,
+                             const byte* label, word32 labelLen,
+                             const byte* info, word32 infoLen,
+                             int digest)
+{
+    int    ret = 0;
+    int    idx;
+    byte   data[MAX_HKDF_LABEL_SZ];
+
+    idx = SetHkdfLabel(data, okmLen, protocol, protocolLen, label, labelLen,
+                       info, infoLen);
+
 #ifdef WOLFSSL_DEBUG_TLS
     WOLFSSL_MSG("  PRK");
     WOLFSSL_BUFFER(prk, prkLen);
@@ -400,6 +431,11 @@ static int DeriveKey(WOLFSSL* ssl, byte* output, int outputLen,
     word32      protocolLen;
     int         digestAlg = 0;
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if (includeMsgs && (ret = HashCommit(ssl, HS_HASH_ALL)) != 0)
+        return ret;
+#endif
+
     switch (hashAlgo) {
         #ifndef NO_SHA256
             case sha256_mac:
@@ -928,6 +964,12 @@ static int BuildTls13HandshakeHmac(WOLFSSL* ssl, byte* key, byte* hash,
     int  hashSz = WC_SHA256_DIGEST_SIZE;
     int  ret = BAD_FUNC_ARG;
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if ((ret = HashCommit(ssl, HS_HASH_ALL)) != 0)
+        return ret;
+    ret = BAD_FUNC_ARG;
+#endif
+
     /* Get the hash of the previous handshake messages. */
     switch (ssl->specs.mac_algorithm) {
     #ifndef NO_SHA256
@@ -981,6 +1023,85 @@ static const byte writeKeyLabel[WRITE_KEY_LABEL_SZ+1] = "key";
 /* The label to use when deriving IVs. */
 static const byte writeIVLabel[WRITE_IV_LABEL_SZ+1]   = "iv";
 
+#ifdef WOLFSSL_HMAC_PADS
+/* Derive the key and IV from a traffic secret.
+ * The key pads of the secret's HMAC are hashed once for both.
+ *
+ * ssl     The SSL/TLS object.
+ * secret  The traffic secret.
+ * key     The buffer to hold the key.
+ * iv      The buffer to hold the IV.
+ * returns 0 on success, otherwise failure.
+ */
+static int DeriveKeyAndIV(WOLFSSL* ssl, const byte* secret, byte* key,
+                          byte* iv)
+{
+    int       ret;
+    int       idx;
+    byte      data[MAX_HKDF_LABEL_SZ];
+    word32    hashSz = 0;
+    int       digestAlg = 0;
+#ifdef WOLFSSL_SMALL_STACK
+    HmacPads* pads;
+#else
+    HmacPads  pads[1];
+#endif
+
+    switch (ssl->specs.mac_algorithm) {
+        #ifndef NO_SHA256
+            case sha256_mac:
+                hashSz    = WC_SHA256_DIGEST_SIZE;
+                digestAlg = WC_SHA256;
+            break;
+        #endif
+
+        #ifdef WOLFSSL_SHA384
+            case sha384_mac:
+                hashSz    = WC_SHA384_DIGEST_SIZE;
+                digestAlg = WC_SHA384;
+            break;
+        #endif
+
+        #ifdef WOLFSSL_TLS13_SHA512
+            case sha512_mac:
+                hashSz    = WC_SHA512_DIGEST_SIZE;
+                digestAlg = WC_SHA512;
+            break;
+        #endif
+
+            default:
+                return BAD_FUNC_ARG;
+    }
+
+#ifdef WOLFSSL_SMALL_STACK
+    pads = (HmacPads*)XMALLOC(sizeof(HmacPads), ssl->heap, DYNAMIC_TYPE_HMAC);
+    if (pads == NULL)
+        return MEMORY_E;
+#endif
+
+    ret = wc_HmacPadsSetKey(pads, digestAlg, secret, hashSz);
+    if (ret == 0) {
+        idx = SetHkdfLabel(data, ssl->specs.key_size, tls13ProtocolLabel,
+                           TLS13_PROTOCOL_LABEL_SZ, writeKeyLabel,
+                           WRITE_KEY_LABEL_SZ, NULL, 0);
+        ret = wc_HKDF_ExpandPads(pads, data, idx, key, ssl->specs.key_size);
+    }
+    if (ret == 0) {
+        idx = SetHkdfLabel(data, ssl->specs.iv_size, tls13ProtocolLabel,
+                           TLS13_PROTOCOL_LABEL_SZ, writeIVLabel,
+                           WRITE_IV_LABEL_SZ, NULL, 0);
+        ret = wc_HKDF_ExpandPads(pads, data, idx, iv, ssl->specs.iv_size);
+    }
+
+    wc_HmacPadsFree(pads);
+#ifdef WOLFSSL_SMALL_STACK
+    XFREE(pads, ssl->heap, DYNAMIC_TYPE_HMAC);
+#endif
+
+    return ret;
+}
+#endif /* WOLFSSL_HMAC_PADS */
+
 /* Derive the keys and IVs for TLS v1.3.
  *
  * ssl      The SSL/TLS object.
@@ -1009,6 +1130,9 @@ static int DeriveTls13Keys(WOLFSSL* ssl, int secret, int side, int store)
     byte  key_dig[MAX_PRF_DIG];
 #endif
     int   provision;
+#ifdef WOLFSSL_HMAC_PADS
+    int   ivIdx;
+#endif
 
 #ifdef WOLFSSL_SMALL_STACK
     key_dig = (byte*)XMALLOC(MAX_PRF_DIG, ssl->heap, DYNAMIC_TYPE_DIGEST);
@@ -1082,6 +1206,33 @@ static int DeriveTls13Keys(WOLFSSL* ssl, int secret, int side, int store)
 
     /* Key data = client key | server key | client IV | server IV */
 
+#ifdef WOLFSSL_HMAC_PADS
+    if (provision & PROVISION_CLIENT) {
+        /* Derive the client key and IV.  */
+        WOLFSSL_MSG("Derive Client Key and IV");
+        ivIdx = (provision == PROVISION_CLIENT_SERVER) ?
+                                        2 * ssl->specs.key_size :
+                                        ssl->specs.key_size;
+        ret = DeriveKeyAndIV(ssl, ssl->clientSecret, &key_dig[i],
+                             &key_dig[ivIdx]);
+        if (ret != 0)
+            goto end;
+        i += ssl->specs.key_size;
+    }
+
+    if (provision & PROVISION_SERVER) {
+        /* Derive the server key and IV.  */
+        WOLFSSL_MSG("Derive Server Key and IV");
+        ivIdx = (provision == PROVISION_CLIENT_SERVER) ?
+                                        2 * ssl->specs.key_size +
+                                        ssl->specs.iv_size :
+                                        ssl->specs.key_size;
+        ret = DeriveKeyAndIV(ssl, ssl->serverSecret, &key_dig[i],
+                             &key_dig[ivIdx]);
+        if (ret != 0)
+            goto end;
+    }
+#else
     if (provision & PROVISION_CLIENT) {
         /* Derive the client key.  */
         WOLFSSL_MSG("Derive Client Key");
@@ -1124,6 +1275,7 @@ static int DeriveTls13Keys(WOLFSSL* ssl, int secret, int side, int store)
         if (ret != 0)
             goto end;
     }
+#endif /* WOLFSSL_HMAC_PADS */
 
     /* Store keys and IVs but don't activate them. */
     ret = StoreKeys(ssl, key_dig, provision);
@@ -1368,20 +1520,31 @@ static int HashInputRaw(WOLFSSL* ssl, const byte* input, int sz)
 {
     int ret = BAD_FUNC_ARG;
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if (ssl->hsHashes->lazy)
+        return HashPending(ssl, input, sz);
+#endif
+
 #ifndef NO_SHA256
-    ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, input, sz);
-    if (ret != 0)
-        return ret;
+    if (HS_HASH_ON(ssl, HS_HASH_SHA256)) {
+        ret = wc_Sha256Update(&ssl->hsHashes->hashSha256, input, sz);
+        if (ret != 0)
+            return ret;
+    }
 #endif
 #ifdef WOLFSSL_SHA384
-    ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, input, sz);
-    if (ret != 0)
-        return ret;
+    if (HS_HASH_ON(ssl, HS_HASH_SHA384)) {
+        ret = wc_Sha384Update(&ssl->hsHashes->hashSha384, input, sz);
+        if (ret != 0)
+            return ret;
+    }
 #endif
 #ifdef WOLFSSL_TLS13_SHA512
-    ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, input, sz);
-    if (ret != 0)
-        return ret;
+    if (HS_HASH_ON(ssl, HS_HASH_SHA512)) {
+        ret = wc_Sha512Update(&ssl->hsHashes->hashSha512, input, sz);
+        if (ret != 0)
+            return ret;
+    }
 #endif
 
     return ret;
@@ -2051,6 +2214,13 @@ int BuildTls13Message(WOLFSSL* ssl, byte* output, int outSz, const byte* input,
 
     WOLFSSL_ENTER("BuildTls13Message");
 
+#ifdef WOLFSSL_KTLS
+    if (ssl->options.ktlsTx) {
+        return KTLS_BuildMessage(ssl, output, outSz, input, inSz, type,
+                                 hashOutput, sizeOnly);
+    }
+#endif
+
     ret = WC_NOT_PENDING_E;
 #ifdef WOLFSSL_ASYNC_CRYPT
     if (asyncOkay) {
@@ -2260,6 +2430,20 @@ static int CreateCookie(WOLFSSL* ssl, byte* hash, byte hashSz)
 }
 #endif
 
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+/* Count a HelloRetryRequest sent or received against the CTX.
+ *
+ * ssl  The SSL/TLS object.
+ */
+static void CountHelloRetryRequest(WOLFSSL* ssl)
+{
+    if (wc_LockMutex(&ssl->ctx->countMutex) == 0) {
+        ssl->ctx->hrrCount++;
+        wc_UnLockMutex(&ssl->ctx->countMutex);
+    }
+}
+#endif
+
 /* Restart the handshake hash with a hash of the previous messages.
  *
  * ssl The SSL/TLS object.
@@ -2539,7 +2723,7 @@ int SendTls13ClientHello(WOLFSSL* ssl)
     int    sendSz;
     int    ret;
 
-    WOLFSSL_START(WC_FUNC_CLIENT_HELLO_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CLIENT_HELLO_SEND);
     WOLFSSL_ENTER("SendTls13ClientHello");
 
 #ifdef HAVE_SESSION_TICKET
@@ -2707,7 +2891,7 @@ int SendTls13ClientHello(WOLFSSL* ssl)
 
 
     WOLFSSL_LEAVE("SendTls13ClientHello", ret);
-    WOLFSSL_END(WC_FUNC_CLIENT_HELLO_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CLIENT_HELLO_SEND);
 
     return ret;
 }
@@ -2773,6 +2957,9 @@ static int DoTls13HelloRetryRequest(WOLFSSL* ssl, const byte* input,
 
     ssl->options.tls1_3 = 1;
     ssl->options.serverState = SERVER_HELLO_RETRY_REQUEST_COMPLETE;
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+    CountHelloRetryRequest(ssl);
+#endif
 
     WOLFSSL_LEAVE("DoTls13HelloRetryRequest", ret);
 
@@ -2811,7 +2998,7 @@ int DoTls13ServerHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     PreSharedKey*   psk = NULL;
 #endif
 
-    WOLFSSL_START(WC_FUNC_SERVER_HELLO_DO);
+    HS_TIME_START(ssl, WC_FUNC_SERVER_HELLO_DO);
     WOLFSSL_ENTER("DoTls13ServerHello");
 
 #ifdef WOLFSSL_CALLBACKS
@@ -3021,6 +3208,11 @@ int DoTls13ServerHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     ret = SetCipherSpecs(ssl);
     if (ret != 0)
         return ret;
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    ret = HashCommit(ssl, HashNegotiatedMask(ssl));
+    if (ret != 0)
+        return ret;
+#endif
 
 #if defined(HAVE_SESSION_TICKET) || !defined(NO_PSK)
 #ifndef WOLFSSL_TLS13_DRAFT_18
@@ -3052,13 +3244,16 @@ int DoTls13ServerHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     else {
         ssl->options.tls1_3 = 1;
         ssl->options.serverState = SERVER_HELLO_RETRY_REQUEST_COMPLETE;
+    #ifdef WOLFSSL_TLS13_GROUP_CACHE
+        CountHelloRetryRequest(ssl);
+    #endif
 
         ret = RestartHandshakeHash(ssl);
     }
 #endif
 
     WOLFSSL_LEAVE("DoTls13ServerHello", ret);
-    WOLFSSL_END(WC_FUNC_SERVER_HELLO_DO);
+    HS_TIME_END(ssl, WC_FUNC_SERVER_HELLO_DO);
 
     return ret;
 }
@@ -3084,7 +3279,7 @@ static int DoTls13EncryptedExtensions(WOLFSSL* ssl, const byte* input,
     word32 i = begin;
     word16 totalExtSz;
 
-    WOLFSSL_START(WC_FUNC_ENCRYPTED_EXTENSIONS_DO);
+    HS_TIME_START(ssl, WC_FUNC_ENCRYPTED_EXTENSIONS_DO);
     WOLFSSL_ENTER("DoTls13EncryptedExtensions");
 
 #ifdef WOLFSSL_CALLBACKS
@@ -3130,7 +3325,7 @@ static int DoTls13EncryptedExtensions(WOLFSSL* ssl, const byte* input,
     ssl->options.serverState = SERVER_ENCRYPTED_EXTENSIONS_COMPLETE;
 
     WOLFSSL_LEAVE("DoTls13EncryptedExtensions", ret);
-    WOLFSSL_END(WC_FUNC_ENCRYPTED_EXTENSIONS_DO);
+    HS_TIME_END(ssl, WC_FUNC_ENCRYPTED_EXTENSIONS_DO);
 
     return ret;
 }
@@ -3160,7 +3355,7 @@ static int DoTls13CertificateRequest(WOLFSSL* ssl, const byte* input,
     CertReqCtx* certReqCtx;
 #endif
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_REQUEST_DO);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_REQUEST_DO);
     WOLFSSL_ENTER("DoTls13CertificateRequest");
 
 #ifdef WOLFSSL_CALLBACKS
@@ -3270,7 +3465,7 @@ static int DoTls13CertificateRequest(WOLFSSL* ssl, const byte* input,
     *inOutIdx += ssl->keys.padSz;
 
     WOLFSSL_LEAVE("DoTls13CertificateRequest", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_REQUEST_DO);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_REQUEST_DO);
 
     return ret;
 }
@@ -3306,6 +3501,88 @@ static void RefineSuites(WOLFSSL* ssl, Suites* peerSuites)
     XMEMCPY(ssl->suites->suites, &suites, sizeof(suites));
 }
 
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+/* Check that the early data of a ClientHello is fresh and not a replay.
+ * The ticket age must be within half the window of the expected age so a
+ * ClientHello is only ever accepted within one window. Binders accepted in
+ * the last window are remembered and a repeated binder is a replay.
+ * A false positive from the bloom filter only rejects the early data and the
+ * handshake continues as 1-RTT.
+ *
+ * ssl      The SSL/TLS object.
+ * binder   The binder of the first pre-shared key.
+ * len      The length of the binder in bytes.
+ * ageDiff  Difference between expected and reported ticket age in ms.
+ * returns 1 when the early data can be accepted and 0 otherwise.
+ */
+static int AntiReplayCheck(WOLFSSL* ssl, const byte* binder, word32 len,
+                           int ageDiff)
+{
+    AntiReplay*      ar = ssl->ctx->antiReplay;
+    AntiReplayShard* shard;
+    word32           bits[ANTI_REPLAY_HASHES];
+    word32           now;
+    word32           elapsed;
+    int              seen = 1;
+    int              i;
+
+    if (ar == NULL || ar->windowMs == 0)
+        return 1;
+
+    if (ageDiff > (int)(ar->windowMs / 2) ||
+                                         ageDiff < -(int)(ar->windowMs / 2)) {
+        WOLFSSL_MSG("Early data ticket age outside anti-replay window");
+        return 0;
+    }
+    if (len <= ANTI_REPLAY_HASHES * OPAQUE32_LEN)
+        return 0;
+
+    /* Binder is a MAC over the ClientHello - use its bytes as the hashes. */
+    for (i = 0; i < ANTI_REPLAY_HASHES; i++) {
+        ato32(binder + i * OPAQUE32_LEN, &bits[i]);
+        bits[i] %= WOLFSSL_ANTI_REPLAY_BITS;
+    }
+    shard = &ar->shard[binder[ANTI_REPLAY_HASHES * OPAQUE32_LEN] %
+                                                    WOLFSSL_ANTI_REPLAY_SHARDS];
+
+    now = TimeNowInMilliseconds();
+    if (now == (word32)GETTIME_ERROR)
+        return 0;
+    if (wc_LockMutex(&shard->lock) != 0)
+        return 0;
+
+    /* Start a new generation each window, keeping the previous one. */
+    elapsed = now - shard->genStart;
+    if (elapsed >= ar->windowMs) {
+        shard->cur ^= 1;
+        XMEMSET(shard->filter[shard->cur], 0, sizeof(shard->filter[0]));
+        if (elapsed >= 2 * ar->windowMs) {
+            XMEMSET(shard->filter[shard->cur ^ 1], 0,
+                    sizeof(shard->filter[0]));
+        }
+        shard->genStart = now;
+    }
+
+    for (i = 0; i < ANTI_REPLAY_HASHES; i++) {
+        word32 idx = bits[i] / WOLFSSL_BIT_SIZE;
+        byte   bit = (byte)(1 << (bits[i] % WOLFSSL_BIT_SIZE));
+
+        if (((shard->filter[0][idx] | shard->filter[1][idx]) & bit) == 0)
+            seen = 0;
+        shard->filter[shard->cur][idx] |= bit;
+    }
+    if (seen)
+        shard->replays++;
+
+    wc_UnLockMutex(&shard->lock);
+
+    if (seen) {
+        WOLFSSL_MSG("Early data replay detected");
+    }
+    return !seen;
+}
+#endif
+
 /* Handle any Pre-Shared Key (PSK) extension.
  * Must do this in ClientHello as it requires a hash of the truncated message.
  * Don't know size of binders until Pre-Shared Key extension has been parsed.
@@ -3332,6 +3609,9 @@ static int DoPreSharedKeys(WOLFSSL* ssl, const byte* input, word32 helloSz,
     int           pskCnt = 0;
     TLSX*         extEarlyData;
 #endif
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+    int           ageDiff = 0;
+#endif
 #ifndef NO_PSK
     const char*   cipherName = NULL;
     byte          cipherSuite0 = TLS13_BYTE;
@@ -3396,6 +3676,9 @@ static int DoPreSharedKeys(WOLFSSL* ssl, const byte* input, word32 helloSz,
                 ssl->options.resuming = 0;
                 break;
             }
+        #ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+            ageDiff = diff;
+        #endif
 
             /* Check whether resumption is possible based on suites in SSL and
              * ciphersuite in ticket.
@@ -3494,6 +3777,14 @@ static int DoPreSharedKeys(WOLFSSL* ssl, const byte* input, word32 helloSz,
 
         ssl->options.sendVerify = 0;
 
+    #ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        /* Other identities may use a different hash. */
+        ret = HashCommit(ssl, ((PreSharedKey*)ext->data)->next == NULL ?
+                                       HashNegotiatedMask(ssl) : HS_HASH_ALL);
+        if (ret != 0)
+            return ret;
+    #endif
+
         /* Derive the Finished message secret. */
         ret = DeriveFinishedSecret(ssl, binderKey,
                                              ssl->keys.client_write_MAC_secret);
@@ -3536,7 +3827,12 @@ static int DoPreSharedKeys(WOLFSSL* ssl, const byte* input, word32 helloSz,
 #ifdef WOLFSSL_EARLY_DATA
     extEarlyData = TLSX_Find(ssl->extensions, TLSX_EARLY_DATA);
     if (extEarlyData != NULL) {
-        if (ssl->earlyData != no_early_data && current == ext->data) {
+        if (ssl->earlyData != no_early_data && current == ext->data
+        #ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+            && AntiReplayCheck(ssl, current->binder, current->binderLen,
+                                                                     ageDiff)
+        #endif
+            ) {
             extEarlyData->resp = 1;
 
             /* Derive early data decryption key. */
@@ -3834,7 +4130,7 @@ int DoTls13ClientHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
 #endif
     int             foundVersion;
 
-    WOLFSSL_START(WC_FUNC_CLIENT_HELLO_DO);
+    HS_TIME_START(ssl, WC_FUNC_CLIENT_HELLO_DO);
     WOLFSSL_ENTER("DoTls13ClientHello");
 
 #ifdef WOLFSSL_CALLBACKS
@@ -4048,7 +4344,7 @@ int DoTls13ClientHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
         /* Check wheter resuming has been chosen */
         if (ssl->options.clientState == CLIENT_KEYEXCHANGE_COMPLETE) {
             WOLFSSL_LEAVE("DoTls13ClientHello", ret);
-            WOLFSSL_END(WC_FUNC_CLIENT_HELLO_DO);
+            HS_TIME_END(ssl, WC_FUNC_CLIENT_HELLO_DO);
 
             return ret;
         }
@@ -4060,6 +4356,12 @@ int DoTls13ClientHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     }
 #endif
 
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    /* a full handshake is admitted before its key share is generated */
+    if ((ret = HsAdmit(ssl, usingPSK)) != 0)
+        return ret;
+#endif
+
     if (!usingPSK) {
         if ((ret = MatchSuite(ssl, &clSuites)) < 0) {
             WOLFSSL_MSG("Unsupported cipher suite, ClientHello");
@@ -4094,6 +4396,10 @@ int DoTls13ClientHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
             if ((ret = HashInput(ssl, input + begin, helloSz)) != 0)
                 return ret;
         }
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+        if ((ret = HashCommit(ssl, HashNegotiatedMask(ssl))) != 0)
+            return ret;
+#endif
 
         if (IsAtLeastTLSv1_3(ssl->version)) {
             /* Derive early secret for handshake secret. */
@@ -4103,7 +4409,7 @@ int DoTls13ClientHello(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     }
 
     WOLFSSL_LEAVE("DoTls13ClientHello", ret);
-    WOLFSSL_END(WC_FUNC_CLIENT_HELLO_DO);
+    HS_TIME_END(ssl, WC_FUNC_CLIENT_HELLO_DO);
 
     return ret;
 }
@@ -4199,7 +4505,7 @@ int SendTls13ServerHello(WOLFSSL* ssl, byte extMsgType)
     word32 idx = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
     int    sendSz;
 
-    WOLFSSL_START(WC_FUNC_SERVER_HELLO_SEND);
+    HS_TIME_START(ssl, WC_FUNC_SERVER_HELLO_SEND);
     WOLFSSL_ENTER("SendTls13ServerHello");
 
 #ifndef WOLFSSL_TLS13_DRAFT_18
@@ -4319,7 +4625,7 @@ int SendTls13ServerHello(WOLFSSL* ssl, byte extMsgType)
         ret = SendBuffered(ssl);
 
     WOLFSSL_LEAVE("SendTls13ServerHello", ret);
-    WOLFSSL_END(WC_FUNC_SERVER_HELLO_SEND);
+    HS_TIME_END(ssl, WC_FUNC_SERVER_HELLO_SEND);
 
     return ret;
 }
@@ -4340,7 +4646,7 @@ static int SendTls13EncryptedExtensions(WOLFSSL* ssl)
     word32 idx = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
     int    sendSz;
 
-    WOLFSSL_START(WC_FUNC_ENCRYPTED_EXTENSIONS_SEND);
+    HS_TIME_START(ssl, WC_FUNC_ENCRYPTED_EXTENSIONS_SEND);
     WOLFSSL_ENTER("SendTls13EncryptedExtensions");
 
     ssl->keys.encryptionOn = 1;
@@ -4420,7 +4726,7 @@ static int SendTls13EncryptedExtensions(WOLFSSL* ssl)
         ret = SendBuffered(ssl);
 
     WOLFSSL_LEAVE("SendTls13EncryptedExtensions", ret);
-    WOLFSSL_END(WC_FUNC_ENCRYPTED_EXTENSIONS_SEND);
+    HS_TIME_END(ssl, WC_FUNC_ENCRYPTED_EXTENSIONS_SEND);
 
     return ret;
 }
@@ -4448,7 +4754,7 @@ static int SendTls13CertificateRequest(WOLFSSL* ssl, byte* reqCtx,
     TLSX*  ext;
 #endif
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_REQUEST_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_REQUEST_SEND);
     WOLFSSL_ENTER("SendTls13CertificateRequest");
 
     if (ssl->options.side == WOLFSSL_SERVER_END)
@@ -4557,7 +4863,7 @@ static int SendTls13CertificateRequest(WOLFSSL* ssl, byte* reqCtx,
         ret = SendBuffered(ssl);
 
     WOLFSSL_LEAVE("SendTls13CertificateRequest", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_REQUEST_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_REQUEST_SEND);
 
     return ret;
 }
@@ -4641,6 +4947,10 @@ static WC_INLINE void DecodeSigAlg(byte* input, byte* hashAlgo, byte* hsType)
 static WC_INLINE int GetMsgHash(WOLFSSL* ssl, byte* hash)
 {
     int ret = 0;
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if ((ret = HashCommit(ssl, HS_HASH_ALL)) != 0)
+        return ret;
+#endif
     switch (ssl->specs.mac_algorithm) {
     #ifndef NO_SHA256
         case sha256_mac:
@@ -4971,6 +5281,56 @@ static word32 AddCertExt(WOLFSSL* ssl, byte* cert, word32 len, word16 extSz,
     return i;
 }
 
+#ifdef WOLFSSL_CERT_MSG_CACHE
+/* Send the TLS v1.3 Certificate, or CompressedCertificate, message in one
+ * record from the body cached in the CTX.
+ *
+ * ssl    The SSL/TLS object.
+ * msg    The encoded message body.
+ * msgSz  The size of the message body.
+ * type   The handshake message type.
+ * returns 0 on success, otherwise failure.
+ */
+static int SendTls13CertificateCached(WOLFSSL* ssl, const byte* msg,
+                                      word32 msgSz, byte type)
+{
+    int    ret;
+    int    sendSz = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ + msgSz +
+                    MAX_MSG_EXTRA;
+    byte*  output;
+
+    if ((ret = CheckAvailableSize(ssl, sendSz)) != 0)
+        return ret;
+
+    output = ssl->buffers.outputBuffer.buffer +
+             ssl->buffers.outputBuffer.length;
+
+    AddTls13Headers(output, msgSz, type, ssl);
+    XMEMCPY(output + RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ, msg, msgSz);
+
+    /* This message is always encrypted. */
+    sendSz = BuildTls13Message(ssl, output, sendSz, output + RECORD_HEADER_SZ,
+                               HANDSHAKE_HEADER_SZ + msgSz, handshake, 1, 0, 0);
+    if (sendSz < 0)
+        return sendSz;
+
+    #ifdef WOLFSSL_CALLBACKS
+        if (ssl->hsInfoOn)
+            AddPacketName(ssl, "Certificate");
+        if (ssl->toInfoOn) {
+            AddPacketInfo(ssl, "Certificate", handshake, output,
+                    sendSz, WRITE_PROTO, ssl->heap);
+        }
+    #endif
+
+    ssl->buffers.outputBuffer.length += sendSz;
+    if (!ssl->options.groupMessages)
+        ret = SendBuffered(ssl);
+
+    return ret;
+}
+#endif /* WOLFSSL_CERT_MSG_CACHE */
+
 /* handle generation TLS v1.3 certificate (11) */
 /* Send the certificate for this end and any CAs that help with validation.
  * This message is always encrypted in TLS v1.3.
@@ -4991,7 +5351,7 @@ static int SendTls13Certificate(WOLFSSL* ssl)
     byte   certReqCtxLen = 0;
     byte*  certReqCtx = NULL;
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_SEND);
     WOLFSSL_ENTER("SendTls13Certificate");
 
 #ifdef WOLFSSL_POST_HANDSHAKE_AUTH
@@ -5060,6 +5420,41 @@ static int SendTls13Certificate(WOLFSSL* ssl)
 
     maxFragment = wolfSSL_GetMaxRecordSize(ssl, MAX_RECORD_SIZE);
 
+#ifdef WOLFSSL_CERT_COMPRESSION
+    /* compressed message from the CTX when the client can decompress it */
+    if (certSz > 0 && ssl->fragOffset == 0 && certReqCtxLen == 0 &&
+            extSz == OPAQUE16_LEN && ssl->options.side == WOLFSSL_SERVER_END &&
+            ssl->options.certCompress && ssl->options.peerCertCompress) {
+        word32      msgSz = 0;
+        word32      uncompSz = 0;
+        const byte* msg = GetCertMsgCache(ssl, CERT_MSG_TLS13_ZLIB, &msgSz);
+
+        if (msg != NULL)
+            c24to32(msg + OPAQUE16_LEN, &uncompSz);
+        if (msg != NULL && uncompSz == payloadSz &&
+                                msgSz <= maxFragment - HANDSHAKE_HEADER_SZ) {
+            ret = SendTls13CertificateCached(ssl, msg, msgSz,
+                                             compressed_certificate);
+            length = 0;
+        }
+    }
+#endif
+#ifdef WOLFSSL_CERT_MSG_CACHE
+    /* whole message in one record from the CTX's encoding when there is no
+     * request context and no certificate extensions */
+    if (length > 0 && certSz > 0 && ssl->fragOffset == 0 &&
+                            certReqCtxLen == 0 && extSz == OPAQUE16_LEN) {
+        word32      msgSz = 0;
+        const byte* msg = GetCertMsgCache(ssl, CERT_MSG_TLS13, &msgSz);
+
+        if (msg != NULL && msgSz == payloadSz &&
+                                msgSz <= maxFragment - HANDSHAKE_HEADER_SZ) {
+            ret = SendTls13CertificateCached(ssl, msg, msgSz, certificate);
+            length = 0;
+        }
+    }
+#endif
+
     while (length > 0 && ret == 0) {
         byte*  output = NULL;
         word32 fragSz = 0;
@@ -5199,7 +5594,7 @@ static int SendTls13Certificate(WOLFSSL* ssl)
 #endif
 
     WOLFSSL_LEAVE("SendTls13Certificate", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_SEND);
 
     return ret;
 }
@@ -5251,7 +5646,7 @@ static int SendTls13CertificateVerify(WOLFSSL* ssl)
     Scv13Args  args[1];
 #endif
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_VERIFY_SEND);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_VERIFY_SEND);
     WOLFSSL_ENTER("SendTls13CertificateVerify");
 
 #ifdef WOLFSSL_ASYNC_CRYPT
@@ -5541,7 +5936,7 @@ static int SendTls13CertificateVerify(WOLFSSL* ssl)
 exit_scv:
 
     WOLFSSL_LEAVE("SendTls13CertificateVerify", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_VERIFY_SEND);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_VERIFY_SEND);
 
 #ifdef WOLFSSL_ASYNC_CRYPT
     /* Handle async operation */
@@ -5572,7 +5967,7 @@ static int DoTls13Certificate(WOLFSSL* ssl, byte* input, word32* inOutIdx,
 {
     int ret;
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_DO);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_DO);
     WOLFSSL_ENTER("DoTls13Certificate");
 
     ret = ProcessPeerCerts(ssl, input, inOutIdx, totalSz);
@@ -5593,10 +5988,86 @@ static int DoTls13Certificate(WOLFSSL* ssl, byte* input, word32* inOutIdx,
     }
 
     WOLFSSL_LEAVE("DoTls13Certificate", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_DO);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_DO);
+
+    return ret;
+}
+
+#if !defined(NO_CERTS) && defined(WOLFSSL_CERT_COMPRESSION)
+/* handle processing TLS v1.3 compressed_certificate (25) */
+/* Decompress a TLS v1.3 CompressedCertificate message and handle the
+ * Certificate message it holds (RFC 8879).
+ * The decompressed message is kept until processing completes.
+ *
+ * ssl       The SSL/TLS object.
+ * input     The message buffer.
+ * inOutIdx  On entry, the index into the message buffer of
+ *           CompressedCertificate.
+ *           On exit, the index of byte after the CompressedCertificate
+ *           message.
+ * totalSz   The length of the current handshake message.
+ * returns 0 on success and otherwise failure.
+ */
+static int DoTls13CompressedCertificate(WOLFSSL* ssl, byte* input,
+                                        word32* inOutIdx, word32 totalSz)
+{
+    int    ret;
+    word16 algo;
+    word32 uncompSz;
+    word32 compSz;
+    word32 idx = 0;
+    word32 hdrSz = OPAQUE16_LEN + OPAQUE24_LEN + OPAQUE24_LEN;
+
+    WOLFSSL_ENTER("DoTls13CompressedCertificate");
+
+    if (ssl->certDecomp == NULL) {
+        if (totalSz < hdrSz)
+            return BUFFER_ERROR;
+        ato16(input + *inOutIdx, &algo);
+        c24to32(input + *inOutIdx + OPAQUE16_LEN, &uncompSz);
+        c24to32(input + *inOutIdx + OPAQUE16_LEN + OPAQUE24_LEN, &compSz);
+
+        /* Only zlib is offered. */
+        if (algo != CERT_COMPRESS_ZLIB)
+            return INVALID_PARAMETER;
+        if (compSz != totalSz - hdrSz || uncompSz == 0 ||
+                                                uncompSz > MAX_HANDSHAKE_SZ) {
+            return BUFFER_ERROR;
+        }
+
+        ssl->certDecomp = (byte*)XMALLOC(uncompSz, ssl->heap,
+                                         DYNAMIC_TYPE_CERT);
+        if (ssl->certDecomp == NULL)
+            return MEMORY_E;
+
+        ret = wc_DeCompress(ssl->certDecomp, uncompSz,
+                            input + *inOutIdx + hdrSz, compSz);
+        if (ret != (int)uncompSz) {
+            WOLFSSL_MSG("Certificate decompression failed");
+            XFREE(ssl->certDecomp, ssl->heap, DYNAMIC_TYPE_CERT);
+            ssl->certDecomp = NULL;
+            SendAlert(ssl, alert_fatal, bad_certificate);
+            return DECOMPRESS_E;
+        }
+        ssl->certDecompSz = uncompSz;
+    }
+
+    ret = DoTls13Certificate(ssl, ssl->certDecomp, &idx, ssl->certDecompSz);
+    if (ret == WC_PENDING_E)
+        return ret;
+
+    XFREE(ssl->certDecomp, ssl->heap, DYNAMIC_TYPE_CERT);
+    ssl->certDecomp = NULL;
+    ssl->certDecompSz = 0;
+
+    if (ret == 0)
+        *inOutIdx += totalSz + ssl->keys.padSz;
+
+    WOLFSSL_LEAVE("DoTls13CompressedCertificate", ret);
 
     return ret;
 }
+#endif
 
 #if !defined(NO_RSA) || defined(HAVE_ECC) || defined(HAVE_ED25519)
 
@@ -5650,7 +6121,7 @@ static int DoTls13CertificateVerify(WOLFSSL* ssl, byte* input,
     Dcv13Args  args[1];
 #endif
 
-    WOLFSSL_START(WC_FUNC_CERTIFICATE_VERIFY_DO);
+    HS_TIME_START(ssl, WC_FUNC_CERTIFICATE_VERIFY_DO);
     WOLFSSL_ENTER("DoTls13CertificateVerify");
 
 #ifdef WOLFSSL_ASYNC_CRYPT
@@ -5900,7 +6371,7 @@ static int DoTls13CertificateVerify(WOLFSSL* ssl, byte* input,
 exit_dcv:
 
     WOLFSSL_LEAVE("DoTls13CertificateVerify", ret);
-    WOLFSSL_END(WC_FUNC_CERTIFICATE_VERIFY_DO);
+    HS_TIME_END(ssl, WC_FUNC_CERTIFICATE_VERIFY_DO);
 
 #ifdef WOLFSSL_ASYNC_CRYPT
     /* Handle async operation */
@@ -5942,7 +6413,7 @@ static int DoTls13Finished(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     byte*  secret;
     byte   mac[WC_MAX_DIGEST_SIZE];
 
-    WOLFSSL_START(WC_FUNC_FINISHED_DO);
+    HS_TIME_START(ssl, WC_FUNC_FINISHED_DO);
     WOLFSSL_ENTER("DoTls13Finished");
 
     /* check against totalSz */
@@ -6013,8 +6484,14 @@ static int DoTls13Finished(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     }
 
 #ifndef NO_WOLFSSL_CLIENT
-    if (ssl->options.side == WOLFSSL_CLIENT_END)
+    if (ssl->options.side == WOLFSSL_CLIENT_END) {
         ssl->options.serverState = SERVER_FINISHED_COMPLETE;
+    #if defined(WOLFSSL_TLS13_GROUP_CACHE) && !defined(NO_SESSION_CACHE) && \
+                                                   !defined(NO_CLIENT_CACHE)
+        /* Server is authenticated - remember the group it picked. */
+        AddSessionClientGroup(ssl);
+    #endif
+    }
 #endif
 #ifndef NO_WOLFSSL_SERVER
     if (ssl->options.side == WOLFSSL_SERVER_END) {
@@ -6025,7 +6502,7 @@ static int DoTls13Finished(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
 #endif
 
     WOLFSSL_LEAVE("DoTls13Finished", 0);
-    WOLFSSL_END(WC_FUNC_FINISHED_DO);
+    HS_TIME_END(ssl, WC_FUNC_FINISHED_DO);
 
     return 0;
 }
@@ -6047,7 +6524,7 @@ static int SendTls13Finished(WOLFSSL* ssl)
     int   outputSz;
     byte* secret;
 
-    WOLFSSL_START(WC_FUNC_FINISHED_SEND);
+    HS_TIME_START(ssl, WC_FUNC_FINISHED_SEND);
     WOLFSSL_ENTER("SendTls13Finished");
 
     outputSz = WC_MAX_DIGEST_SIZE + DTLS_HANDSHAKE_HEADER_SZ + MAX_MSG_EXTRA;
@@ -6176,7 +6653,7 @@ static int SendTls13Finished(WOLFSSL* ssl)
         return ret;
 
     WOLFSSL_LEAVE("SendTls13Finished", ret);
-    WOLFSSL_END(WC_FUNC_FINISHED_SEND);
+    HS_TIME_END(ssl, WC_FUNC_FINISHED_SEND);
 
     return ret;
 }
@@ -6197,7 +6674,7 @@ static int SendTls13KeyUpdate(WOLFSSL* ssl)
     int    outputSz;
     word32 i = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
 
-    WOLFSSL_START(WC_FUNC_KEY_UPDATE_SEND);
+    HS_TIME_START(ssl, WC_FUNC_KEY_UPDATE_SEND);
     WOLFSSL_ENTER("SendTls13KeyUpdate");
 
     outputSz = OPAQUE8_LEN + MAX_MSG_EXTRA;
@@ -6248,9 +6725,18 @@ static int SendTls13KeyUpdate(WOLFSSL* ssl)
         return ret;
     if ((ret = SetKeysSide(ssl, ENCRYPT_SIDE_ONLY)) != 0)
         return ret;
+#ifdef WOLFSSL_KTLS
+    if (ssl->options.ktlsTx) {
+        /* the KeyUpdate has to go out with the old keys */
+        if (ssl->buffers.outputBuffer.length > 0)
+            ssl->options.ktlsTxRekey = 1;
+        else if ((ret = KTLS_SetKeys(ssl, ENCRYPT_SIDE_ONLY)) != 0)
+            return ret;
+    }
+#endif
 
     WOLFSSL_LEAVE("SendTls13KeyUpdate", ret);
-    WOLFSSL_END(WC_FUNC_KEY_UPDATE_SEND);
+    HS_TIME_END(ssl, WC_FUNC_KEY_UPDATE_SEND);
 
     return ret;
 }
@@ -6271,7 +6757,7 @@ static int DoTls13KeyUpdate(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     int    ret;
     word32 i = *inOutIdx;
 
-    WOLFSSL_START(WC_FUNC_KEY_UPDATE_DO);
+    HS_TIME_START(ssl, WC_FUNC_KEY_UPDATE_DO);
     WOLFSSL_ENTER("DoTls13KeyUpdate");
 
     /* check against totalSz */
@@ -6304,12 +6790,18 @@ static int DoTls13KeyUpdate(WOLFSSL* ssl, const byte* input, word32* inOutIdx,
     }
     if ((ret = SetKeysSide(ssl, DECRYPT_SIDE_ONLY)) != 0)
         return ret;
+#ifdef WOLFSSL_KTLS
+    if (ssl->options.ktlsRx &&
+                       (ret = KTLS_SetKeys(ssl, DECRYPT_SIDE_ONLY)) != 0) {
+        return ret;
+    }
+#endif
 
     if (ssl->keys.keyUpdateRespond)
         return SendTls13KeyUpdate(ssl);
 
     WOLFSSL_LEAVE("DoTls13KeyUpdate", ret);
-    WOLFSSL_END(WC_FUNC_KEY_UPDATE_DO);
+    HS_TIME_END(ssl, WC_FUNC_KEY_UPDATE_DO);
 
     return 0;
 }
@@ -6331,7 +6823,7 @@ static int SendTls13EndOfEarlyData(WOLFSSL* ssl)
     word32 length;
     word32 idx = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
 
-    WOLFSSL_START(WC_FUNC_END_OF_EARLY_DATA_SEND);
+    HS_TIME_START(ssl, WC_FUNC_END_OF_EARLY_DATA_SEND);
     WOLFSSL_ENTER("SendTls13EndOfEarlyData");
 
     length = 0;
@@ -6363,7 +6855,7 @@ static int SendTls13EndOfEarlyData(WOLFSSL* ssl)
         ret = SendBuffered(ssl);
 
     WOLFSSL_LEAVE("SendTls13EndOfEarlyData", ret);
-    WOLFSSL_END(WC_FUNC_END_OF_EARLY_DATA_SEND);
+    HS_TIME_END(ssl, WC_FUNC_END_OF_EARLY_DATA_SEND);
 
     return ret;
 }
@@ -6386,7 +6878,7 @@ static int DoTls13EndOfEarlyData(WOLFSSL* ssl, const byte* input,
 
     (void)input;
 
-    WOLFSSL_START(WC_FUNC_END_OF_EARLY_DATA_DO);
+    HS_TIME_START(ssl, WC_FUNC_END_OF_EARLY_DATA_DO);
     WOLFSSL_ENTER("DoTls13EndOfEarlyData");
 
     if ((*inOutIdx - begin) != size)
@@ -6406,7 +6898,7 @@ static int DoTls13EndOfEarlyData(WOLFSSL* ssl, const byte* input,
     ret = SetKeysSide(ssl, DECRYPT_SIDE_ONLY);
 
     WOLFSSL_LEAVE("DoTls13EndOfEarlyData", ret);
-    WOLFSSL_END(WC_FUNC_END_OF_EARLY_DATA_DO);
+    HS_TIME_END(ssl, WC_FUNC_END_OF_EARLY_DATA_DO);
 
     return ret;
 }
@@ -6439,7 +6931,7 @@ static int DoTls13NewSessionTicket(WOLFSSL* ssl, const byte* input,
     byte         nonceLength;
 #endif
 
-    WOLFSSL_START(WC_FUNC_NEW_SESSION_TICKET_DO);
+    HS_TIME_START(ssl, WC_FUNC_NEW_SESSION_TICKET_DO);
     WOLFSSL_ENTER("DoTls13NewSessionTicket");
 
     /* Lifetime hint. */
@@ -6536,7 +7028,7 @@ static int DoTls13NewSessionTicket(WOLFSSL* ssl, const byte* input,
 #endif /* HAVE_SESSION_TICKET */
 
     WOLFSSL_LEAVE("DoTls13NewSessionTicket", 0);
-    WOLFSSL_END(WC_FUNC_NEW_SESSION_TICKET_DO);
+    HS_TIME_END(ssl, WC_FUNC_NEW_SESSION_TICKET_DO);
 
     return 0;
 }
@@ -6563,6 +7055,11 @@ static int ExpectedResumptionSecret(WOLFSSL* ssl)
     Digest      digest;
     static byte header[] = { 0x14, 0x00, 0x00, 0x00 };
 
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    if ((ret = HashCommit(ssl, HS_HASH_ALL)) != 0)
+        return ret;
+#endif
+
     /* Copy the running hash so we can restore it after. */
     switch (ssl->specs.mac_algorithm) {
     #ifndef NO_SHA256
@@ -6654,7 +7151,7 @@ static int SendTls13NewSessionTicket(WOLFSSL* ssl)
     word32 length;
     word32 idx = RECORD_HEADER_SZ + HANDSHAKE_HEADER_SZ;
 
-    WOLFSSL_START(WC_FUNC_NEW_SESSION_TICKET_SEND);
+    HS_TIME_START(ssl, WC_FUNC_NEW_SESSION_TICKET_SEND);
     WOLFSSL_ENTER("SendTls13NewSessionTicket");
 
 #ifdef WOLFSSL_TLS13_TICKET_BEFORE_FINISHED
@@ -6760,7 +7257,7 @@ static int SendTls13NewSessionTicket(WOLFSSL* ssl)
         ret = SendBuffered(ssl);
 
     WOLFSSL_LEAVE("SendTls13NewSessionTicket", 0);
-    WOLFSSL_END(WC_FUNC_NEW_SESSION_TICKET_SEND);
+    HS_TIME_END(ssl, WC_FUNC_NEW_SESSION_TICKET_SEND);
 
     return ret;
 }
@@ -6912,6 +7409,18 @@ static int SanityCheckTls13MsgReceived(WOLFSSL* ssl, byte type)
             break;
 #endif
 
+#ifdef WOLFSSL_CERT_COMPRESSION
+        case compressed_certificate:
+            /* Only the server's certificate is compressed and only when the
+             * client offered to decompress it. */
+            if (ssl->options.side != WOLFSSL_CLIENT_END ||
+                                                !ssl->options.certCompress) {
+                WOLFSSL_MSG("CompressedCertificate not expected");
+                return SANITY_MSG_E;
+            }
+            FALL_THROUGH;
+#endif
+
         case certificate:
     #ifndef NO_WOLFSSL_CLIENT
             if (ssl->options.side == WOLFSSL_CLIENT_END &&
@@ -7107,6 +7616,21 @@ int DoTls13HandShakeMsgType(WOLFSSL* ssl, byte* input, word32* inOutIdx,
     if (*inOutIdx + size > totalSz)
         return INCOMPLETE_DATA;
 
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+    /* before the message is checked, hashed or processed */
+    if (type == client_hello && ssl->options.side == WOLFSSL_SERVER_END &&
+            ssl->ctx->clientHelloCb != NULL &&
+            !ssl->options.clientHelloCbDone) {
+        ret = DoClientHelloCb(ssl, input + *inOutIdx, size);
+        if (ret == CLIENT_HELLO_WANT_CB && *inOutIdx >= HANDSHAKE_HEADER_SZ) {
+            /* process this msg again */
+            *inOutIdx -= HANDSHAKE_HEADER_SZ;
+        }
+        if (ret != 0)
+            return ret;
+    }
+#endif
+
     /* sanity check msg received */
     if ((ret = SanityCheckTls13MsgReceived(ssl, type)) != 0) {
         WOLFSSL_MSG("Sanity Check on handshake message type received failed");
@@ -7215,6 +7739,13 @@ int DoTls13HandShakeMsgType(WOLFSSL* ssl, byte* input, word32* inOutIdx,
         break;
 #endif
 
+#if !defined(NO_CERTS) && defined(WOLFSSL_CERT_COMPRESSION)
+    case compressed_certificate:
+        WOLFSSL_MSG("processing compressed certificate");
+        ret = DoTls13CompressedCertificate(ssl, input, inOutIdx, size);
+        break;
+#endif
+
 #if !defined(NO_RSA) || defined(HAVE_ECC) || defined(HAVE_ED25519)
     case certificate_verify:
         WOLFSSL_MSG("processing certificate verify");
@@ -7305,8 +7836,16 @@ int DoTls13HandShakeMsgType(WOLFSSL* ssl, byte* input, word32* inOutIdx,
                 ssl->options.connectState  = FIRST_REPLY_DONE;
                 ssl->options.handShakeState = CLIENT_HELLO_COMPLETE;
 
-                if (wolfSSL_connect_TLSv13(ssl) != SSL_SUCCESS)
-                    ret = POST_HAND_AUTH_ERROR;
+                ret = wolfSSL_connect_TLSv13(ssl);
+            #ifdef WOLFSSL_ASYNC_CRYPT
+                /* The message is done with. The handshake isn't and is
+                 * finished by the next read or write. */
+                if (ret != SSL_SUCCESS && ssl->error == WC_PENDING_E) {
+                    ssl->error = 0;
+                    ret = SSL_SUCCESS;
+                }
+            #endif
+                ret = (ret == SSL_SUCCESS) ? 0 : POST_HAND_AUTH_ERROR;
             }
         #endif
         }
@@ -7421,8 +7960,8 @@ int DoTls13HandShakeMsg(WOLFSSL* ssl, byte* input, word32* inOutIdx,
                                 &idx, ssl->arrays->pendingMsgType,
                                 ssl->arrays->pendingMsgSz - HANDSHAKE_HEADER_SZ,
                                 ssl->arrays->pendingMsgSz);
-        #ifdef WOLFSSL_ASYNC_CRYPT
-            if (ret == WC_PENDING_E) {
+        #if defined(WOLFSSL_ASYNC_CRYPT) || defined(WOLFSSL_CLIENT_HELLO_CB)
+            if (ret == WC_PENDING_E || ret == CLIENT_HELLO_WANT_CB) {
                 /* setup to process fragment again */
                 ssl->arrays->pendingMsgOffset -= inputLength;
                 *inOutIdx -= inputLength + ssl->keys.padSz;
@@ -7654,6 +8193,7 @@ int wolfSSL_connect_TLSv13(WOLFSSL* ssl)
             FALL_THROUGH;
 
         case FINISHED_DONE:
+            HS_TIME_DONE(ssl);
         #ifndef NO_HANDSHAKE_DONE_CB
             if (ssl->hsDoneCb != NULL) {
                 int cbret = ssl->hsDoneCb(ssl, ssl->hsDoneCtx);
@@ -7668,6 +8208,9 @@ int wolfSSL_connect_TLSv13(WOLFSSL* ssl)
             if (!ssl->options.keepResources) {
                 FreeHandshakeResources(ssl);
             }
+        #ifdef WOLFSSL_KTLS
+            KTLS_Enable(ssl);
+        #endif
 
             WOLFSSL_LEAVE("wolfSSL_connect_TLSv13()", WOLFSSL_SUCCESS);
             return WOLFSSL_SUCCESS;
@@ -7892,6 +8435,45 @@ int wolfSSL_update_keys(WOLFSSL* ssl)
     return ret;
 }
 
+#if !defined(NO_CERTS) && defined(WOLFSSL_CERT_COMPRESSION)
+/* Allow the server's certificate to be compressed with zlib (RFC 8879) in
+ * TLS v1.3 connections.
+ * A client offers to decompress the certificate. A server compresses its
+ * certificate when the client offered and keeps the compressed message with
+ * the CTX.
+ *
+ * ctx  The SSL/TLS CTX object.
+ * returns BAD_FUNC_ARG when ctx is NULL or not using TLS v1.3 and 0 on
+ * success.
+ */
+int wolfSSL_CTX_UseCertCompression(WOLFSSL_CTX* ctx)
+{
+    if (ctx == NULL || !IsAtLeastTLSv1_3(ctx->method->version))
+        return BAD_FUNC_ARG;
+
+    ctx->certCompress = 1;
+
+    return 0;
+}
+
+/* Allow the server's certificate to be compressed with zlib (RFC 8879) in a
+ * TLS v1.3 connection.
+ *
+ * ssl  The SSL/TLS object.
+ * returns BAD_FUNC_ARG when ssl is NULL or not using TLS v1.3 and 0 on
+ * success.
+ */
+int wolfSSL_UseCertCompression(WOLFSSL* ssl)
+{
+    if (ssl == NULL || !IsAtLeastTLSv1_3(ssl->version))
+        return BAD_FUNC_ARG;
+
+    ssl->options.certCompress = 1;
+
+    return 0;
+}
+#endif
+
 #if !defined(NO_CERTS) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
 /* Allow post-handshake authentication in TLS v1.3 connections.
  *
@@ -8233,6 +8815,9 @@ int wolfSSL_accept_TLSv13(WOLFSSL* ssl)
                     WOLFSSL_ERROR(ssl->error);
                     return WOLFSSL_FATAL_ERROR;
                 }
+            #ifdef WOLFSSL_TLS13_GROUP_CACHE
+                CountHelloRetryRequest(ssl);
+            #endif
             }
 
             ssl->options.acceptState = TLS13_ACCEPT_FIRST_REPLY_DONE;
@@ -8248,6 +8833,9 @@ int wolfSSL_accept_TLSv13(WOLFSSL* ssl)
                     WOLFSSL_ERROR(ssl->error);
                     return WOLFSSL_FATAL_ERROR;
                 }
+            #ifdef WOLFSSL_TLS13_GROUP_CACHE
+                CountHelloRetryRequest(ssl);
+            #endif
             }
 
             ssl->options.acceptState = TLS13_ACCEPT_HELLO_RETRY_REQUEST_DONE;
@@ -8287,6 +8875,12 @@ int wolfSSL_accept_TLSv13(WOLFSSL* ssl)
             FALL_THROUGH;
 
         case TLS13_ACCEPT_SECOND_REPLY_DONE :
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+            if ((ssl->error = HsAdmitWait(ssl)) != 0) {
+                WOLFSSL_ERROR(ssl->error);
+                return WOLFSSL_FATAL_ERROR;
+            }
+#endif
             if ((ssl->error = SendTls13ServerHello(ssl, server_hello)) != 0) {
                 WOLFSSL_ERROR(ssl->error);
                 return WOLFSSL_FATAL_ERROR;
@@ -8431,6 +9025,10 @@ int wolfSSL_accept_TLSv13(WOLFSSL* ssl)
             FALL_THROUGH;
 
         case TLS13_TICKET_SENT :
+            HS_TIME_DONE(ssl);
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+            HsAdmitDone(ssl, 1);
+#endif
 #ifndef NO_HANDSHAKE_DONE_CB
             if (ssl->hsDoneCb) {
                 int cbret = ssl->hsDoneCb(ssl, ssl->hsDoneCtx);
@@ -8445,6 +9043,9 @@ int wolfSSL_accept_TLSv13(WOLFSSL* ssl)
             if (!ssl->options.keepResources) {
                 FreeHandshakeResources(ssl);
             }
+        #ifdef WOLFSSL_KTLS
+            KTLS_Enable(ssl);
+        #endif
 
             WOLFSSL_LEAVE("SSL_accept()", WOLFSSL_SUCCESS);
             return WOLFSSL_SUCCESS;
@@ -8501,6 +9102,125 @@ int wolfSSL_set_max_early_data(WOLFSSL* ssl, unsigned int sz)
     return 0;
 }
 
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+/* Allocate the early data anti-replay cache of a server CTX.
+ *
+ * ctx   The SSL/TLS CTX object.
+ * heap  The heap hint to allocate with.
+ * returns MEMORY_E or BAD_MUTEX_E on failure and 0 on success.
+ */
+int InitAntiReplay(WOLFSSL_CTX* ctx, void* heap)
+{
+    AntiReplay* ar;
+    int         i;
+
+    ar = (AntiReplay*)XMALLOC(sizeof(AntiReplay), heap, DYNAMIC_TYPE_CTX);
+    if (ar == NULL)
+        return MEMORY_E;
+    XMEMSET(ar, 0, sizeof(AntiReplay));
+
+    for (i = 0; i < WOLFSSL_ANTI_REPLAY_SHARDS; i++) {
+        if (wc_InitMutex(&ar->shard[i].lock) != 0) {
+            while (--i >= 0)
+                wc_FreeMutex(&ar->shard[i].lock);
+            XFREE(ar, heap, DYNAMIC_TYPE_CTX);
+            return BAD_MUTEX_E;
+        }
+    }
+    ar->windowMs = WOLFSSL_ANTI_REPLAY_WINDOW_MS;
+    ctx->antiReplay = ar;
+
+    return 0;
+}
+
+/* Free the early data anti-replay cache of a CTX.
+ *
+ * ctx  The SSL/TLS CTX object.
+ */
+void FreeAntiReplay(WOLFSSL_CTX* ctx)
+{
+    int i;
+
+    if (ctx->antiReplay == NULL)
+        return;
+
+    for (i = 0; i < WOLFSSL_ANTI_REPLAY_SHARDS; i++)
+        wc_FreeMutex(&ctx->antiReplay->shard[i].lock);
+    XFREE(ctx->antiReplay, ctx->heap, DYNAMIC_TYPE_CTX);
+    ctx->antiReplay = NULL;
+}
+
+/* Sets the window in which early data is checked for replay by the server.
+ * Early data is only accepted when the ticket age is within half the window of
+ * the expected age and the ClientHello has not been seen in the last window.
+ * A value of zero turns off the check and all early data is accepted.
+ *
+ * ctx       The SSL/TLS CTX object.
+ * windowMs  The window in milliseconds.
+ * returns BAD_FUNC_ARG when ctx is NULL, not using TLS v1.3 or the window is
+ * longer than WOLFSSL_ANTI_REPLAY_MAX_WINDOW_MS, SIDE_ERROR when not a server
+ * and 0 on success.
+ */
+int wolfSSL_CTX_set_early_data_anti_replay(WOLFSSL_CTX* ctx,
+                                           unsigned int windowMs)
+{
+    int i;
+
+    WOLFSSL_ENTER("wolfSSL_CTX_set_early_data_anti_replay");
+
+    if (ctx == NULL || !IsAtLeastTLSv1_3(ctx->method->version) ||
+                                   windowMs > WOLFSSL_ANTI_REPLAY_MAX_WINDOW_MS)
+        return BAD_FUNC_ARG;
+    if (ctx->method->side == WOLFSSL_CLIENT_END || ctx->antiReplay == NULL)
+        return SIDE_ERROR;
+
+    /* Binders were recorded against the old window - start again. */
+    for (i = 0; i < WOLFSSL_ANTI_REPLAY_SHARDS; i++) {
+        AntiReplayShard* shard = &ctx->antiReplay->shard[i];
+
+        if (wc_LockMutex(&shard->lock) != 0)
+            return BAD_MUTEX_E;
+        shard->genStart = TimeNowInMilliseconds();
+        XMEMSET(shard->filter, 0, sizeof(shard->filter));
+        wc_UnLockMutex(&shard->lock);
+    }
+    ctx->antiReplay->windowMs = windowMs;
+
+    return 0;
+}
+
+/* Gets the number of ClientHello messages whose early data was rejected as a
+ * replay by servers using the CTX.
+ *
+ * ctx      The SSL/TLS CTX object.
+ * replays  The number of replays detected.
+ * returns BAD_FUNC_ARG when ctx or replays is NULL, SIDE_ERROR when not a
+ * server and 0 on success.
+ */
+int wolfSSL_CTX_get_early_data_replays(WOLFSSL_CTX* ctx,
+                                       unsigned int* replays)
+{
+    int i;
+
+    if (ctx == NULL || replays == NULL)
+        return BAD_FUNC_ARG;
+    if (ctx->antiReplay == NULL)
+        return SIDE_ERROR;
+
+    *replays = 0;
+    for (i = 0; i < WOLFSSL_ANTI_REPLAY_SHARDS; i++) {
+        AntiReplayShard* shard = &ctx->antiReplay->shard[i];
+
+        if (wc_LockMutex(&shard->lock) != 0)
+            return BAD_MUTEX_E;
+        *replays += shard->replays;
+        wc_UnLockMutex(&shard->lock);
+    }
+
+    return 0;
+}
+#endif /* WOLFSSL_EARLY_DATA_ANTI_REPLAY */
+
 /* Write early data to the server.
  *
  * ssl    The SSL/TLS object.
@@ -8601,6 +9321,34 @@ int wolfSSL_read_early_data(WOLFSSL* ssl, void* data, int sz, int* outSz)
 }
 #endif
 
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+/* Gets the HelloRetryRequest statistics of connections using the CTX.
+ *
+ * ctx        The SSL/TLS CTX object.
+ * hrrCount   The number of HelloRetryRequests sent or received.
+ * cacheHits  The number of ClientHellos whose key share came from the group
+ *            the server picked on a previous connection.
+ *            May be NULL.
+ * returns BAD_FUNC_ARG when ctx or hrrCount is NULL, BAD_MUTEX_E when locking
+ * fails and 0 on success.
+ */
+int wolfSSL_CTX_get_hrr_stats(WOLFSSL_CTX* ctx, unsigned int* hrrCount,
+                              unsigned int* cacheHits)
+{
+    if (ctx == NULL || hrrCount == NULL)
+        return BAD_FUNC_ARG;
+
+    if (wc_LockMutex(&ctx->countMutex) != 0)
+        return BAD_MUTEX_E;
+    *hrrCount = ctx->hrrCount;
+    if (cacheHits != NULL)
+        *cacheHits = ctx->groupCacheHits;
+    wc_UnLockMutex(&ctx->countMutex);
+
+    return 0;
+}
+#endif /* WOLFSSL_TLS13_GROUP_CACHE */
+
 #undef ERROR_OUT
 
 #endif /* !WOLFCRYPT_ONLY */
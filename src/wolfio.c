@@ -274,6 +274,255 @@ int EmbedSend(WOLFSSL* ssl, char *buf, int sz, void *ctx)
 }
 
 
+#ifdef WOLFSSL_KTLS
+
+#ifdef NO_INLINE
+    #include <wolfssl/wolfcrypt/misc.h>
+#else
+    #define WOLFSSL_MISC_INCLUDED
+    #include <wolfcrypt/src/misc.c>
+#endif
+
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#ifdef WOLFSSL_SENDFILE
+    #include <sys/sendfile.h>
+#endif
+
+#ifndef SOL_TLS
+    #define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+    #define TCP_ULP 31
+#endif
+
+/* Attach the kernel TLS upper layer protocol to a TCP socket.
+ *  return : 0 on success, -1 when kTLS isn't available
+ */
+int wolfIO_KtlsInit(SOCKET_T sd)
+{
+    if (setsockopt(sd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+        WOLFSSL_MSG("Kernel TLS not available on socket");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Give the kernel the record keys for one direction.
+ * cipher is the bulk cipher algorithm, iv is the 12 byte nonce base (for
+ * AES-GCM the 4 byte salt followed by the 8 byte IV) and seq is the next
+ * record sequence number in network order.
+ *  return : 0 on success, -1 on error
+ */
+int wolfIO_KtlsSetKey(SOCKET_T sd, int rx, int tls13, int cipher,
+                      const unsigned char* key, int keySz,
+                      const unsigned char* iv, const unsigned char* seq)
+{
+    union {
+        struct tls12_crypto_info_aes_gcm_128 gcm128;
+    #ifdef TLS_CIPHER_AES_GCM_256
+        struct tls12_crypto_info_aes_gcm_256 gcm256;
+    #endif
+    #ifdef TLS_CIPHER_CHACHA20_POLY1305
+        struct tls12_crypto_info_chacha20_poly1305 chacha;
+    #endif
+    } info;
+    socklen_t infoSz;
+    int ret;
+
+    XMEMSET(&info, 0, sizeof(info));
+    info.gcm128.info.version = tls13 ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+
+    if (cipher == wolfssl_aes_gcm && keySz == TLS_CIPHER_AES_GCM_128_KEY_SIZE) {
+        info.gcm128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+        XMEMCPY(info.gcm128.salt, iv, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+        XMEMCPY(info.gcm128.iv, iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE,
+                TLS_CIPHER_AES_GCM_128_IV_SIZE);
+        XMEMCPY(info.gcm128.key, key, keySz);
+        XMEMCPY(info.gcm128.rec_seq, seq, TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE);
+        infoSz = sizeof(info.gcm128);
+    }
+#ifdef TLS_CIPHER_AES_GCM_256
+    else if (cipher == wolfssl_aes_gcm &&
+                                   keySz == TLS_CIPHER_AES_GCM_256_KEY_SIZE) {
+        info.gcm256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+        XMEMCPY(info.gcm256.salt, iv, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+        XMEMCPY(info.gcm256.iv, iv + TLS_CIPHER_AES_GCM_256_SALT_SIZE,
+                TLS_CIPHER_AES_GCM_256_IV_SIZE);
+        XMEMCPY(info.gcm256.key, key, keySz);
+        XMEMCPY(info.gcm256.rec_seq, seq, TLS_CIPHER_AES_GCM_256_REC_SEQ_SIZE);
+        infoSz = sizeof(info.gcm256);
+    }
+#endif
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    else if (cipher == wolfssl_chacha &&
+                           keySz == TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE) {
+        info.chacha.info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+        XMEMCPY(info.chacha.iv, iv, TLS_CIPHER_CHACHA20_POLY1305_IV_SIZE);
+        XMEMCPY(info.chacha.key, key, keySz);
+        XMEMCPY(info.chacha.rec_seq, seq,
+                TLS_CIPHER_CHACHA20_POLY1305_REC_SEQ_SIZE);
+        infoSz = sizeof(info.chacha);
+    }
+#endif
+    else {
+        WOLFSSL_MSG("Cipher not supported by kernel TLS");
+        return -1;
+    }
+
+    ret = setsockopt(sd, SOL_TLS, rx ? TLS_RX : TLS_TX, &info, infoSz);
+    ForceZero(&info, sizeof(info));
+    if (ret != 0) {
+        WOLFSSL_MSG("Setting kernel TLS keys failed");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Translates the last socket error of a kernel TLS send or receive. */
+static int KtlsTranslateError(int isSend)
+{
+    int err = wolfSSL_LastError();
+
+    if (err == SOCKET_EWOULDBLOCK || err == SOCKET_EAGAIN) {
+        WOLFSSL_MSG("\tWould block");
+        return isSend ? WOLFSSL_CBIO_ERR_WANT_WRITE :
+                        WOLFSSL_CBIO_ERR_WANT_READ;
+    }
+    else if (err == SOCKET_ECONNRESET) {
+        WOLFSSL_MSG("\tConnection reset");
+        return WOLFSSL_CBIO_ERR_CONN_RST;
+    }
+    else if (err == SOCKET_EINTR) {
+        WOLFSSL_MSG("\tSocket interrupted");
+        return WOLFSSL_CBIO_ERR_ISR;
+    }
+    else if (err == SOCKET_EPIPE || err == SOCKET_ECONNABORTED) {
+        WOLFSSL_MSG("\tConnection closed");
+        return WOLFSSL_CBIO_ERR_CONN_CLOSE;
+    }
+
+    /* includes EBADMSG when the kernel fails to decrypt a record */
+    WOLFSSL_MSG("\tGeneral error");
+    return WOLFSSL_CBIO_ERR_GENERAL;
+}
+
+/* Receive the plaintext of records of one content type from a socket the
+ * kernel decrypts.
+ *  return : nb bytes read, or error
+ */
+int EmbedKtlsReceive(WOLFSSL* ssl, char* buf, int sz, unsigned char* type)
+{
+    int sd = *(int*)ssl->IOCB_ReadCtx;
+    int recvd;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr* cmsg;
+    union {
+        char buf[CMSG_SPACE(sizeof(unsigned char))];
+        struct cmsghdr align;
+    } control;
+
+    XMEMSET(&msg, 0, sizeof(msg));
+    iov.iov_base = buf;
+    iov.iov_len = sz;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    recvd = (int)recvmsg(sd, &msg, ssl->rflags);
+    if (recvd < 0) {
+        WOLFSSL_MSG("Embed kTLS receive error");
+        return KtlsTranslateError(0);
+    }
+    else if (recvd == 0) {
+        WOLFSSL_MSG("Embed kTLS receive connection closed");
+        return WOLFSSL_CBIO_ERR_CONN_CLOSE;
+    }
+
+    *type = application_data;
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_TLS &&
+                                     cmsg->cmsg_type == TLS_GET_RECORD_TYPE) {
+        *type = *(unsigned char*)CMSG_DATA(cmsg);
+    }
+
+    return recvd;
+}
+
+/* Send plaintext for the kernel to encrypt as records of the given content
+ * type.
+ *  return : nb bytes sent, or error
+ */
+int EmbedKtlsSend(WOLFSSL* ssl, char* buf, int sz, unsigned char type)
+{
+    int sd = *(int*)ssl->IOCB_WriteCtx;
+    int sent;
+
+    if (type == application_data) {
+        sent = wolfIO_Send(sd, buf, sz, ssl->wflags);
+    }
+    else {
+        struct msghdr msg;
+        struct iovec iov;
+        struct cmsghdr* cmsg;
+        union {
+            char buf[CMSG_SPACE(sizeof(unsigned char))];
+            struct cmsghdr align;
+        } control;
+
+        XMEMSET(&msg, 0, sizeof(msg));
+        XMEMSET(&control, 0, sizeof(control));
+        iov.iov_base = buf;
+        iov.iov_len = sz;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_TLS;
+        cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+        *(unsigned char*)CMSG_DATA(cmsg) = type;
+
+        sent = (int)sendmsg(sd, &msg, ssl->wflags);
+    }
+
+    if (sent < 0) {
+        WOLFSSL_MSG("Embed kTLS send error");
+        return KtlsTranslateError(1);
+    }
+
+    return sent;
+}
+
+#ifdef WOLFSSL_SENDFILE
+/* Send part of a file as application data records with the kernel doing
+ * both the file read and the encryption.
+ *  return : nb bytes sent, or error
+ */
+int EmbedKtlsSendFile(WOLFSSL* ssl, int fd, long offset, int sz)
+{
+    int sd = *(int*)ssl->IOCB_WriteCtx;
+    off_t off = (off_t)offset;
+    int sent;
+
+    sent = (int)sendfile(sd, fd, &off, (size_t)sz);
+    if (sent < 0) {
+        WOLFSSL_MSG("Embed kTLS sendfile error");
+        return KtlsTranslateError(1);
+    }
+
+    return sent;
+}
+#endif /* WOLFSSL_SENDFILE */
+
+#endif /* WOLFSSL_KTLS */
+
+
 #ifdef WOLFSSL_DTLS
 
 #include <wolfssl/wolfcrypt/sha.h>
@@ -497,6 +746,414 @@ int EmbedGenerateCookie(WOLFSSL* ssl, byte *buf, int sz, void *ctx)
     return sz;
 }
 
+#ifdef WOLFSSL_DTLS_DEMUX
+
+#ifdef NO_INLINE
+    #include <wolfssl/wolfcrypt/misc.h>
+#else
+    #define WOLFSSL_MISC_INCLUDED
+    #include <wolfcrypt/src/misc.c>
+#endif
+
+/* FNV-1a hash of a peer address, started from the random seed */
+static word32 DtlsDemuxHash(word32 hash, const byte* peer, word32 peerSz)
+{
+    word32 i;
+
+    for (i = 0; i < peerSz; i++) {
+        hash ^= peer[i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+/* Finds the session of a peer address, NULL when there is none */
+static DtlsDemuxPeer* DtlsDemuxFind(WOLFSSL_DTLS_DEMUXER* demux, word32 hash,
+                                    const byte* peer, word32 peerSz)
+{
+    DtlsDemuxPeer* entry;
+
+    for (entry = demux->bucket[hash & (demux->bucketSz - 1)]; entry != NULL;
+                                                         entry = entry->next) {
+        if (entry->hash == hash &&
+                entry->ssl->buffers.dtlsCtx.peer.sz == peerSz &&
+                XMEMCMP(entry->ssl->buffers.dtlsCtx.peer.sa, peer,
+                        peerSz) == 0)
+            return entry;
+    }
+
+    return NULL;
+}
+
+/* Adds a session, doubling the number of buckets when there are as many
+ * sessions */
+static int DtlsDemuxInsert(WOLFSSL_DTLS_DEMUXER* demux, DtlsDemuxPeer* entry)
+{
+    DtlsDemuxPeer* cur;
+    word32 i;
+
+    if (demux->count >= demux->bucketSz) {
+        word32 sz = demux->bucketSz * 2;
+        DtlsDemuxPeer** bucket = (DtlsDemuxPeer**)XMALLOC(
+                        sizeof(DtlsDemuxPeer*) * sz, demux->ctx->heap,
+                        DYNAMIC_TYPE_SOCKADDR);
+
+        if (bucket == NULL)
+            return MEMORY_E;
+
+        XMEMSET(bucket, 0, sizeof(DtlsDemuxPeer*) * sz);
+
+        for (i = 0; i < demux->bucketSz; i++) {
+            while ((cur = demux->bucket[i]) != NULL) {
+                demux->bucket[i] = cur->next;
+                cur->next = bucket[cur->hash & (sz - 1)];
+                bucket[cur->hash & (sz - 1)] = cur;
+            }
+        }
+
+        XFREE(demux->bucket, demux->ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+        demux->bucket   = bucket;
+        demux->bucketSz = sz;
+    }
+
+    i = entry->hash & (demux->bucketSz - 1);
+    entry->next = demux->bucket[i];
+    demux->bucket[i] = entry;
+    demux->count++;
+
+    return 0;
+}
+
+/* The receive callback of the sessions: hands over the datagram read by the
+ * demultiplexer when it is for the session.
+ *  return : nb bytes read, or error
+ */
+static int DtlsDemuxReceive(WOLFSSL* ssl, char* buf, int sz, void* ctx)
+{
+    WOLFSSL_DTLS_DEMUXER* demux = (WOLFSSL_DTLS_DEMUXER*)ctx;
+
+    if (demux->pending != ssl || demux->bufLen <= 0)
+        return WOLFSSL_CBIO_ERR_WANT_READ;
+
+    /* like recvfrom, the rest of a datagram too big for buf is lost */
+    if (sz > demux->bufLen)
+        sz = demux->bufLen;
+    XMEMCPY(buf, demux->buf, sz);
+    demux->bufLen = 0;
+
+    return sz;
+}
+
+/* Handles the datagram of a peer without a session. A ClientHello without
+ * the right cookie is answered with a HelloVerifyRequest and nothing is kept.
+ * A session is only made for a ClientHello with the right cookie.
+ *  return : 0 with entry set to the new session or NULL, or error
+ */
+static int DtlsDemuxAccept(WOLFSSL_DTLS_DEMUXER* demux, SOCKADDR_S* peer,
+                           XSOCKLENT peerSz, word32 hash, int recvd,
+                           DtlsDemuxPeer** entry)
+{
+    byte     hvr[DTLS_RECORD_HEADER_SZ + DTLS_HANDSHAKE_HEADER_SZ +
+                 VERSION_SZ + ENUM_LEN + MAX_COOKIE_LEN];
+    word32   hvrSz = (word32)sizeof(hvr);
+    WOLFSSL* ssl;
+    DtlsDemuxPeer* cur;
+    int      ret;
+
+    *entry = NULL;
+
+    ret = DtlsCheckHelloCookie(demux->ctx, demux->secret, COOKIE_SECRET_SZ,
+                               (const byte*)peer, (word32)peerSz, demux->buf,
+                               (word32)recvd, hvr, &hvrSz);
+    if (ret == BUFFER_ERROR) {
+        WOLFSSL_MSG("Dropped datagram from unknown peer");
+        return 0;
+    }
+    if (ret < 0)
+        return ret;
+    if (ret == 0) {
+        /* a lost HelloVerifyRequest is sent again for the next ClientHello */
+        if (SENDTO_FUNCTION(demux->sd, (char*)hvr, (int)hvrSz, 0,
+                            (const SOCKADDR*)peer, peerSz) < 0) {
+            WOLFSSL_MSG("Send of HelloVerifyRequest failed");
+        }
+        return 0;
+    }
+
+    if (demux->maxPeers > 0 && demux->count >= demux->maxPeers) {
+        WOLFSSL_MSG("Dropped ClientHello, too many peers");
+        return 0;
+    }
+
+    cur = (DtlsDemuxPeer*)XMALLOC(sizeof(DtlsDemuxPeer), demux->ctx->heap,
+                                  DYNAMIC_TYPE_SOCKADDR);
+    if (cur == NULL)
+        return MEMORY_E;
+
+    ssl = wolfSSL_new(demux->ctx);
+    if (ssl == NULL) {
+        XFREE(cur, demux->ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+        return MEMORY_E;
+    }
+
+    ret = wolfSSL_dtls_set_peer(ssl, peer, (unsigned int)peerSz);
+    if (ret == WOLFSSL_SUCCESS)
+        ret = wolfSSL_set_fd(ssl, demux->sd);
+    ret = (ret == WOLFSSL_SUCCESS) ? 0 : MEMORY_E;
+    if (ret == 0)
+        ret = wolfSSL_DTLS_SetCookieSecret(ssl, demux->secret,
+                                           COOKIE_SECRET_SZ);
+    if (ret == 0) {
+        wolfSSL_dtls_set_using_nonblock(ssl, 1);
+        wolfSSL_SSLSetIORecv(ssl, DtlsDemuxReceive);
+        wolfSSL_SSLSetIOSend(ssl, EmbedSendTo);
+        wolfSSL_SetIOReadCtx(ssl, demux);
+        DtlsSetHelloVerifySent(ssl, demux->buf);
+
+        cur->ssl  = ssl;
+        cur->hash = hash;
+        ret = DtlsDemuxInsert(demux, cur);
+    }
+
+    if (ret != 0) {
+        wolfSSL_free(ssl);
+        XFREE(cur, demux->ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+        return ret;
+    }
+
+    *entry = cur;
+
+    return 0;
+}
+
+/* Makes a demultiplexer of DTLS server sessions on the UDP socket sd, bound
+ * and not connected. The sessions use ctx, which has to stay alive. maxPeers
+ * limits the number of sessions, 0 for no limit.
+ *  return : demultiplexer, or NULL on failure
+ */
+WOLFSSL_DTLS_DEMUXER* wolfSSL_DtlsDemuxNew(WOLFSSL_CTX* ctx, int sd,
+                                         unsigned int maxPeers)
+{
+    WOLFSSL_DTLS_DEMUXER* demux;
+    int ret;
+
+    WOLFSSL_ENTER("wolfSSL_DtlsDemuxNew");
+
+    if (ctx == NULL || ctx->method->side != WOLFSSL_SERVER_END ||
+            ctx->method->version.major != DTLS_MAJOR)
+        return NULL;
+
+    /* sessions are made only for cookies the demultiplexer can check */
+    if (ctx->CBIOCookie != NULL) {
+        WOLFSSL_MSG("Cookie callback not supported with demultiplexer");
+        return NULL;
+    }
+#ifdef WOLFSSL_SCTP
+    if (ctx->dtlsSctp) {
+        WOLFSSL_MSG("DTLS-over-SCTP not supported with demultiplexer");
+        return NULL;
+    }
+#endif
+
+    demux = (WOLFSSL_DTLS_DEMUXER*)XMALLOC(sizeof(WOLFSSL_DTLS_DEMUXER),
+                                         ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+    if (demux == NULL)
+        return NULL;
+    XMEMSET(demux, 0, sizeof(WOLFSSL_DTLS_DEMUXER));
+    demux->ctx      = ctx;
+    demux->sd       = sd;
+    demux->maxPeers = maxPeers;
+
+    demux->bucket = (DtlsDemuxPeer**)XMALLOC(
+                            sizeof(DtlsDemuxPeer*) * DTLS_DEMUX_INIT_SZ,
+                            ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+    if (demux->bucket == NULL) {
+        XFREE(demux, ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+        return NULL;
+    }
+    XMEMSET(demux->bucket, 0, sizeof(DtlsDemuxPeer*) * DTLS_DEMUX_INIT_SZ);
+    demux->bucketSz = DTLS_DEMUX_INIT_SZ;
+
+    ret = wc_InitRng_ex(&demux->rng, ctx->heap, INVALID_DEVID);
+    if (ret == 0) {
+        ret = wc_RNG_GenerateBlock(&demux->rng, demux->secret,
+                                   COOKIE_SECRET_SZ);
+        if (ret == 0) {
+            ret = wc_RNG_GenerateBlock(&demux->rng, (byte*)&demux->hashSeed,
+                                       sizeof(demux->hashSeed));
+        }
+        if (ret != 0)
+            wc_FreeRng(&demux->rng);
+    }
+    if (ret != 0) {
+        WOLFSSL_MSG("Demultiplexer random setup failed");
+        XFREE(demux->bucket, ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+        XFREE(demux, ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+        return NULL;
+    }
+
+    return demux;
+}
+
+/* Frees the demultiplexer and all of its sessions. The socket is left open.
+ */
+void wolfSSL_DtlsDemuxFree(WOLFSSL_DTLS_DEMUXER* demux)
+{
+    DtlsDemuxPeer* entry;
+    void* heap;
+    word32 i;
+
+    WOLFSSL_ENTER("wolfSSL_DtlsDemuxFree");
+
+    if (demux == NULL)
+        return;
+
+    heap = demux->ctx->heap;
+    for (i = 0; i < demux->bucketSz; i++) {
+        while ((entry = demux->bucket[i]) != NULL) {
+            demux->bucket[i] = entry->next;
+            wolfSSL_free(entry->ssl);
+            XFREE(entry, heap, DYNAMIC_TYPE_SOCKADDR);
+        }
+    }
+
+    wc_FreeRng(&demux->rng);
+    ForceZero(demux->secret, COOKIE_SECRET_SZ);
+    XFREE(demux->bucket, heap, DYNAMIC_TYPE_SOCKADDR);
+    XFREE(demux, heap, DYNAMIC_TYPE_SOCKADDR);
+    (void)heap;
+}
+
+/* Reads one datagram from the socket and hands it to the session of its peer,
+ * setting ssl to the session. ssl is NULL when the datagram was answered
+ * without a session or dropped.
+ *  return : nb bytes of application data read into data, 0 when there is
+ *           none, WANT_READ when no datagram is waiting, WOLFSSL_FATAL_ERROR
+ *           when the session in ssl has failed or was closed by the peer, or
+ *           other error
+ */
+int wolfSSL_DtlsDemuxRead(WOLFSSL_DTLS_DEMUXER* demux, WOLFSSL** ssl,
+                          void* data, int sz)
+{
+    SOCKADDR_S     peer;
+    XSOCKLENT      peerSz = sizeof(peer);
+    DtlsDemuxPeer* entry;
+    WOLFSSL*       cur;
+    word32         hash;
+    int            recvd;
+    int            err;
+    int            ret;
+
+    WOLFSSL_ENTER("wolfSSL_DtlsDemuxRead");
+
+    if (demux == NULL || ssl == NULL || data == NULL || sz <= 0)
+        return BAD_FUNC_ARG;
+
+    *ssl = NULL;
+
+    XMEMSET(&peer, 0, sizeof(peer));
+    recvd = (int)RECVFROM_FUNCTION(demux->sd, (char*)demux->buf,
+                                   (int)sizeof(demux->buf), 0,
+                                   (SOCKADDR*)&peer, &peerSz);
+    recvd = TranslateReturnCode(recvd, demux->sd);
+
+    if (recvd < 0) {
+        err = wolfSSL_LastError();
+        if (err == SOCKET_EWOULDBLOCK || err == SOCKET_EAGAIN) {
+            WOLFSSL_MSG("\tWould block");
+            return WANT_READ;
+        }
+        else if (err == SOCKET_EINTR || err == SOCKET_ECONNREFUSED ||
+                 err == SOCKET_ECONNRESET) {
+            /* nothing for one peer stops the socket serving the others */
+            WOLFSSL_MSG("\tSocket interrupted or peer unreachable");
+            return 0;
+        }
+        WOLFSSL_MSG("\tGeneral error");
+        return SOCKET_ERROR_E;
+    }
+
+    hash = DtlsDemuxHash(demux->hashSeed, (const byte*)&peer, (word32)peerSz);
+    entry = DtlsDemuxFind(demux, hash, (const byte*)&peer, (word32)peerSz);
+    if (entry == NULL) {
+        ret = DtlsDemuxAccept(demux, &peer, peerSz, hash, recvd, &entry);
+        if (ret != 0 || entry == NULL)
+            return ret;
+    }
+
+    cur = entry->ssl;
+    *ssl = cur;
+
+    demux->pending = cur;
+    demux->bufLen  = recvd;
+    if (!cur->options.handShakeDone) {
+        ret = wolfSSL_accept(cur);
+        if (ret == WOLFSSL_SUCCESS)
+            ret = 0;
+    }
+    else
+        ret = wolfSSL_read(cur, data, sz);
+    demux->pending = NULL;
+    demux->bufLen  = 0;
+
+    if (ret < 0) {
+        err = wolfSSL_get_error(cur, ret);
+        if (err == WOLFSSL_ERROR_WANT_READ || err == WOLFSSL_ERROR_WANT_WRITE)
+            ret = 0;
+        else
+            ret = WOLFSSL_FATAL_ERROR;
+    }
+    else if (ret == 0 && cur->options.handShakeDone &&
+             wolfSSL_get_error(cur, ret) == WOLFSSL_ERROR_ZERO_RETURN)
+        ret = WOLFSSL_FATAL_ERROR;
+
+    return ret;
+}
+
+/* Removes the session from the demultiplexer and frees it.
+ *  return : WOLFSSL_SUCCESS, or BAD_FUNC_ARG when not a session of demux
+ */
+int wolfSSL_DtlsDemuxRemove(WOLFSSL_DTLS_DEMUXER* demux, WOLFSSL* ssl)
+{
+    DtlsDemuxPeer** prev;
+    DtlsDemuxPeer*  entry;
+    word32          hash;
+
+    WOLFSSL_ENTER("wolfSSL_DtlsDemuxRemove");
+
+    if (demux == NULL || ssl == NULL)
+        return BAD_FUNC_ARG;
+
+    hash = DtlsDemuxHash(demux->hashSeed,
+                         (const byte*)ssl->buffers.dtlsCtx.peer.sa,
+                         ssl->buffers.dtlsCtx.peer.sz);
+
+    for (prev = &demux->bucket[hash & (demux->bucketSz - 1)];
+                              (entry = *prev) != NULL; prev = &entry->next) {
+        if (entry->ssl == ssl) {
+            *prev = entry->next;
+            demux->count--;
+            wolfSSL_free(ssl);
+            XFREE(entry, demux->ctx->heap, DYNAMIC_TYPE_SOCKADDR);
+            return WOLFSSL_SUCCESS;
+        }
+    }
+
+    return BAD_FUNC_ARG;
+}
+
+/* Number of sessions of the demultiplexer */
+unsigned int wolfSSL_DtlsDemuxCount(WOLFSSL_DTLS_DEMUXER* demux)
+{
+    if (demux == NULL)
+        return 0;
+
+    return demux->count;
+}
+
+#endif /* WOLFSSL_DTLS_DEMUX */
+
 #ifdef WOLFSSL_SESSION_EXPORT
 
     /* get the peer information in human readable form (ip, port, family)
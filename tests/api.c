@@ -48,6 +48,14 @@
 #ifdef WOLFSSL_ASNC_CRYPT
     #include <wolfssl/wolfcrypt/async.h>
 #endif
+#ifdef WOLFSSL_SENDFILE
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+#ifdef WOLFSSL_KEY_SHARE_POOL
+    #include <unistd.h>
+    #include <sys/wait.h>
+#endif
 #ifdef HAVE_ECC
     #include <wolfssl/wolfcrypt/ecc.h>   /* wc_ecc_fp_free */
     #ifndef ECC_ASN963_MAX_BUF_SZ
@@ -1811,6 +1819,38 @@ static void test_wolfSSL_EVP_get_cipherbynid(void)
 #define HAVE_IO_TESTS_DEPENDENCIES
 #endif
 
+/* features tested by running a client and a server through
+ * test_wolfSSL_client_server() */
+#if defined(HAVE_SNI) || defined(HAVE_ALPN) || \
+    defined(WOLFSSL_READ_AHEAD) || defined(WOLFSSL_KTLS) || \
+    defined(WOLFSSL_SENDFILE) || defined(WOLFSSL_DYNAMIC_RECORD_SIZE) || \
+    defined(WOLFSSL_CERT_MSG_CACHE) || defined(WOLFSSL_HANDSHAKE_TIMING) || \
+    defined(WOLFSSL_KEY_SHARE_POOL)
+#define HAVE_CLIENT_SERVER_TESTS
+#endif
+
+/* suite matching of the server checked against a reference */
+#if !defined(WOLFSSL_NO_TLS12) && defined(HAVE_ECC) && defined(HAVE_AESGCM) && \
+    !defined(NO_SHA256)
+#define HAVE_MATCH_SUITE_TEST
+#endif
+
+/* features tested by running a client and a server in one thread over the
+ * test_memio_* transport */
+#if (defined(WOLFSSL_EARLY_DATA_ANTI_REPLAY) || \
+     defined(WOLFSSL_CLIENT_HELLO_CB) || \
+     defined(WOLFSSL_TLS13_GROUP_CACHE) || \
+     defined(WOLFSSL_CERT_COMPRESSION) || \
+     defined(WOLFSSL_HANDSHAKE_ADMISSION) || \
+     defined(WOLFSSL_LAZY_HANDSHAKE_HASH) || \
+     defined(WOLFSSL_TLS_HMAC_CACHE) || defined(WOLFSSL_CBC_STITCH) || \
+     defined(HAVE_RECORD_SIZE_LIMIT) || defined(HAVE_MATCH_SUITE_TEST)) && \
+    !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && !defined(NO_FILESYSTEM) && \
+    !defined(NO_CERTS) && !defined(NO_RSA)
+#define HAVE_MEMIO_TEST
+#endif
+
 /* helper functions */
 #ifdef HAVE_IO_TESTS_DEPENDENCIES
 #ifdef WOLFSSL_SESSION_EXPORT
@@ -2614,8 +2654,8 @@ done:
 
 #endif /* !NO_WOLFSSL_CLIENT && !NO_WOLFSSL_SERVER */
 
-/* SNI / ALPN / session export helper functions */
-#if defined(HAVE_SNI) || defined(HAVE_ALPN) || defined(WOLFSSL_SESSION_EXPORT)
+/* client / server helper functions */
+#if defined(HAVE_CLIENT_SERVER_TESTS) || defined(WOLFSSL_SESSION_EXPORT)
 
 static THREAD_RETURN WOLFSSL_THREAD run_wolfssl_server(void* args)
 {
@@ -2716,7 +2756,8 @@ static THREAD_RETURN WOLFSSL_THREAD run_wolfssl_server(void* args)
         if (ret != WOLFSSL_SUCCESS) {
             err = wolfSSL_get_error(ssl, 0);
         }
-    } while (ret != WOLFSSL_SUCCESS && err == WC_PENDING_E);
+    } while (ret != WOLFSSL_SUCCESS && (err == WC_PENDING_E ||
+                                        err == CLIENT_HELLO_WANT_CB));
 
     if (ret != WOLFSSL_SUCCESS) {
         char buff[WOLFSSL_MAX_ERROR_SZ];
@@ -2865,8 +2906,7 @@ static void run_wolfssl_client(void* args)
 #endif
 }
 
-#endif /* defined(HAVE_SNI) || defined(HAVE_ALPN) ||
-          defined(WOLFSSL_SESSION_EXPORT) */
+#endif /* HAVE_CLIENT_SERVER_TESTS || WOLFSSL_SESSION_EXPORT */
 #endif /* io tests dependencies */
 
 #if !defined(NO_WOLFSSL_CLIENT) && !defined(NO_WOLFSSL_SERVER)
@@ -3119,7 +3159,7 @@ static void test_wolfSSL_dtls_export(void)
  | TLS extensions tests
  *----------------------------------------------------------------------------*/
 
-#if defined(HAVE_SNI) || defined(HAVE_ALPN)
+#ifdef HAVE_CLIENT_SERVER_TESTS
 /* connection test runner */
 static void test_wolfSSL_client_server(callback_functions* client_callbacks,
                                        callback_functions* server_callbacks)
@@ -3170,7 +3210,61 @@ static void test_wolfSSL_client_server(callback_functions* client_callbacks,
 #endif
 }
 
-#endif /* defined(HAVE_SNI) || defined(HAVE_ALPN) */
+#endif /* HAVE_CLIENT_SERVER_TESTS */
+
+#ifdef HAVE_MEMIO_TEST
+#define TEST_MEMIO_BUF_SZ   (64 * 1024)
+
+/* In memory transport between a client and a server in one thread */
+typedef struct test_memio_ctx {
+    byte c2s[TEST_MEMIO_BUF_SZ];
+    int  c2sLen;
+    byte s2c[TEST_MEMIO_BUF_SZ];
+    int  s2cLen;
+} test_memio_ctx;
+
+static int test_memio_write_cb(WOLFSSL* ssl, char* data, int sz, void* ctx)
+{
+    test_memio_ctx* mem = (test_memio_ctx*)ctx;
+    byte* buf = wolfSSL_is_server(ssl) ? mem->s2c : mem->c2s;
+    int*  len = wolfSSL_is_server(ssl) ? &mem->s2cLen : &mem->c2sLen;
+
+    if (*len + sz > TEST_MEMIO_BUF_SZ)
+        return WOLFSSL_CBIO_ERR_GENERAL;
+    XMEMCPY(buf + *len, data, sz);
+    *len += sz;
+
+    return sz;
+}
+
+static int test_memio_read_cb(WOLFSSL* ssl, char* data, int sz, void* ctx)
+{
+    test_memio_ctx* mem = (test_memio_ctx*)ctx;
+    byte* buf = wolfSSL_is_server(ssl) ? mem->c2s : mem->s2c;
+    int*  len = wolfSSL_is_server(ssl) ? &mem->c2sLen : &mem->s2cLen;
+
+    if (*len == 0)
+        return WOLFSSL_CBIO_ERR_WANT_READ;
+    if (sz > *len)
+        sz = *len;
+    XMEMCPY(data, buf, sz);
+    XMEMMOVE(buf, buf + sz, *len - sz);
+    *len -= sz;
+
+    return sz;
+}
+
+static WOLFSSL* test_memio_new_ssl(WOLFSSL_CTX* ctx, test_memio_ctx* mem)
+{
+    WOLFSSL* ssl;
+
+    AssertNotNull(ssl = wolfSSL_new(ctx));
+    wolfSSL_SetIOReadCtx(ssl, mem);
+    wolfSSL_SetIOWriteCtx(ssl, mem);
+
+    return ssl;
+}
+#endif /* HAVE_MEMIO_TEST */
 
 
 #ifdef HAVE_SNI
@@ -3483,6 +3577,83 @@ static void test_wolfSSL_SNI_GetFromBuffer(void)
                                           sizeof(buffer5), 0, result, &length));
 }
 
+#if defined(WOLFSSL_SNI_STORE) && defined(HAVE_ECC) && \
+    defined(HAVE_AESGCM) && !defined(NO_RSA) && !defined(NO_FILESYSTEM)
+static int add_SNI_store_cert(WOLFSSL_CTX* ctx, const char* name,
+                              const char* certFile, const char* keyFile)
+{
+    byte*  cert = NULL;
+    byte*  key = NULL;
+    size_t certSz = 0;
+    size_t keySz = 0;
+    int    ret;
+
+    AssertIntEQ(0, load_file(certFile, &cert, &certSz));
+    AssertIntEQ(0, load_file(keyFile, &key, &keySz));
+
+    ret = wolfSSL_CTX_SNI_AddCertificate(ctx, name, cert, (long)certSz,
+                                     key, (long)keySz, WOLFSSL_FILETYPE_PEM);
+    free(cert);
+    free(key);
+
+    return ret;
+}
+
+static void use_SNI_store_at_ctx(WOLFSSL_CTX* ctx)
+{
+    AssertIntEQ(WOLFSSL_SUCCESS,
+        add_SNI_store_cert(ctx, "example.com", svrCertFile, svrKeyFile));
+    AssertIntEQ(WOLFSSL_SUCCESS,
+        add_SNI_store_cert(ctx, "*.wolfssl.com", eccCertFile, eccKeyFile));
+}
+
+static void use_ECDSA_only_at_ctx(WOLFSSL_CTX* ctx)
+{
+    AssertIntEQ(WOLFSSL_SUCCESS,
+        wolfSSL_CTX_load_verify_locations(ctx, caEccCertFile, 0));
+    AssertIntEQ(WOLFSSL_SUCCESS,
+        wolfSSL_CTX_set_cipher_list(ctx, "ECDHE-ECDSA-AES128-GCM-SHA256"));
+}
+
+static void test_wolfSSL_SNI_AddCertificate(void)
+{
+    WOLFSSL_CTX* ctx;
+    unsigned long i;
+    callback_functions callbacks[] = {
+        /* wildcard selects the ECC certificate over the RSA one of the CTX */
+        {0, use_ECDSA_only_at_ctx, use_SNI_at_ssl, 0, 0},
+        {0, use_SNI_store_at_ctx,  0, verify_SNI_real_matching, 0},
+    };
+
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfSSLv23_client_method()));
+    AssertIntEQ(BAD_FUNC_ARG,
+        add_SNI_store_cert(ctx, "example.com", svrCertFile, svrKeyFile));
+    wolfSSL_CTX_free(ctx);
+
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfSSLv23_server_method()));
+    AssertIntEQ(BAD_FUNC_ARG,
+        add_SNI_store_cert(NULL, "example.com", svrCertFile, svrKeyFile));
+    AssertIntEQ(BAD_FUNC_ARG,
+        add_SNI_store_cert(ctx, "", svrCertFile, svrKeyFile));
+    AssertIntEQ(BAD_FUNC_ARG,
+        add_SNI_store_cert(ctx, "www.*.com", svrCertFile, svrKeyFile));
+    AssertIntEQ(BAD_FUNC_ARG,
+        add_SNI_store_cert(ctx, "*", svrCertFile, svrKeyFile));
+    AssertIntEQ(WOLFSSL_SUCCESS,
+        add_SNI_store_cert(ctx, "*.Example.com", svrCertFile, svrKeyFile));
+    /* names are not case sensitive and can not be replaced */
+    AssertIntEQ(BAD_FUNC_ARG,
+        add_SNI_store_cert(ctx, "*.example.COM", eccCertFile, eccKeyFile));
+    wolfSSL_CTX_free(ctx);
+
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
+        callbacks[i    ].method = wolfSSLv23_client_method;
+        callbacks[i + 1].method = wolfSSLv23_server_method;
+        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+    }
+}
+#endif
+
 #endif /* HAVE_SNI */
 
 static void test_wolfSSL_UseSNI(void)
@@ -3492,6 +3663,169 @@ static void test_wolfSSL_UseSNI(void)
     test_wolfSSL_UseSNI_connection();
 
     test_wolfSSL_SNI_GetFromBuffer();
+#if defined(WOLFSSL_SNI_STORE) && defined(HAVE_ECC) && \
+    defined(HAVE_AESGCM) && !defined(NO_RSA) && !defined(NO_FILESYSTEM)
+    test_wolfSSL_SNI_AddCertificate();
+#endif
+#endif
+}
+
+#if defined(WOLFSSL_CLIENT_HELLO_CB) && defined(HAVE_SNI) && \
+    !defined(NO_WOLFSSL_SERVER)
+static int clientHelloCbCalls = 0;
+
+/* defers once, then checks what the client offered */
+static int client_hello_cb_check(WOLFSSL* ssl, int* alert, void* arg)
+{
+    const unsigned char* data;
+    size_t sz;
+
+    (void)alert;
+    AssertTrue(arg == &clientHelloCbCalls);
+
+    if (clientHelloCbCalls++ == 0)
+        return WOLFSSL_CLIENT_HELLO_RETRY;
+
+    AssertIntGE(wolfSSL_client_hello_get0_legacy_version(ssl), 0x0303);
+    AssertIntEQ(32, wolfSSL_client_hello_get0_random(ssl, &data));
+    sz = wolfSSL_client_hello_get0_ciphers(ssl, &data);
+    AssertIntGT(sz, 0);
+    AssertIntEQ(sz % 2, 0);
+    AssertIntGE(wolfSSL_client_hello_get0_compression_methods(ssl, &data), 1);
+
+    /* server_name: list length, type, name length, name */
+    AssertIntEQ(1, wolfSSL_client_hello_get0_ext(ssl, 0, &data, &sz));
+    AssertIntEQ(sz, 5 + 15);
+    AssertIntEQ(0, XMEMCMP(data + 5, "www.wolfssl.com", 15));
+    AssertIntEQ(0, wolfSSL_client_hello_get0_ext(ssl, 0xfefe, &data, &sz));
+
+    return WOLFSSL_CLIENT_HELLO_SUCCESS;
+}
+
+static int client_hello_cb_abort(WOLFSSL* ssl, int* alert, void* arg)
+{
+    (void)ssl;
+    (void)arg;
+
+    clientHelloCbCalls++;
+    *alert = unrecognized_name;
+    return WOLFSSL_CLIENT_HELLO_ERROR;
+}
+
+static void use_client_hello_cb_check_at_ctx(WOLFSSL_CTX* ctx)
+{
+    wolfSSL_CTX_set_client_hello_cb(ctx, client_hello_cb_check,
+                                                       &clientHelloCbCalls);
+}
+
+static void use_client_hello_cb_abort_at_ctx(WOLFSSL_CTX* ctx)
+{
+    wolfSSL_CTX_set_client_hello_cb(ctx, client_hello_cb_abort, NULL);
+}
+
+static void verify_CLIENT_HELLO_CB_E_on_server(WOLFSSL* ssl)
+{
+    AssertIntEQ(CLIENT_HELLO_CB_E, wolfSSL_get_error(ssl, 0));
+}
+#endif
+
+static void test_wolfSSL_CTX_set_client_hello_cb(void)
+{
+#if defined(WOLFSSL_CLIENT_HELLO_CB) && defined(HAVE_SNI) && \
+    !defined(NO_WOLFSSL_SERVER)
+    WOLFSSL_CTX* ctx;
+    WOLFSSL*     ssl;
+    const unsigned char* data;
+    size_t sz;
+    unsigned long i;
+    int expected[] = { 2, 1 };
+#if defined(HAVE_MEMIO_TEST) && defined(OPENSSL_EXTRA) && \
+    !defined(WOLFSSL_NO_TLS12)
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL*        ssl_c;
+    test_memio_ctx* mem;
+    int             conn;
+    int             ret_c;
+    int             ret_s;
+#endif
+    callback_functions callbacks[] = {
+        /* deferred once then accepted */
+        {0, 0, use_SNI_at_ssl, 0, 0},
+        {0, use_client_hello_cb_check_at_ctx, 0, 0, 0},
+
+        /* aborted with an alert */
+        {0, 0, use_SNI_at_ssl, verify_FATAL_ERROR_on_client, 0},
+        {0, use_client_hello_cb_abort_at_ctx, 0,
+                                        verify_CLIENT_HELLO_CB_E_on_server, 0},
+    };
+
+    /* nothing to report outside of the callback */
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfSSLv23_client_method()));
+    AssertNotNull(ssl = wolfSSL_new(ctx));
+    AssertIntEQ(0, wolfSSL_client_hello_get0_legacy_version(ssl));
+    AssertIntEQ(0, wolfSSL_client_hello_get0_ciphers(ssl, &data));
+    AssertIntEQ(0, wolfSSL_client_hello_get0_ext(ssl, 0, &data, &sz));
+    AssertIntEQ(0, wolfSSL_client_hello_get0_random(NULL, &data));
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
+        callbacks[i    ].method = wolfSSLv23_client_method;
+        callbacks[i + 1].method = wolfSSLv23_server_method;
+        clientHelloCbCalls = 0;
+        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+        AssertIntEQ(expected[i / 2], clientHelloCbCalls);
+    }
+
+#if defined(HAVE_MEMIO_TEST) && defined(OPENSSL_EXTRA) && \
+    !defined(WOLFSSL_NO_TLS12)
+    /* called again for the next connection after wolfSSL_clear() */
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+
+    AssertNotNull(ctx_c = wolfSSL_CTX_new(wolfTLSv1_2_client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_c, caCertFile, 0));
+    wolfSSL_SetIORecv(ctx_c, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_c, test_memio_write_cb);
+
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_2_server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    wolfSSL_SetIORecv(ctx, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx, test_memio_write_cb);
+    use_client_hello_cb_check_at_ctx(ctx);
+
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+    ssl = test_memio_new_ssl(ctx, mem);
+    /* the handshake data is needed again for the next connection */
+    wolfSSL_KeepArrays(ssl);
+    wolfSSL_KeepHandshakeResources(ssl);
+    clientHelloCbCalls = 0;
+    for (conn = 0; conn < 2; conn++) {
+        ssl_c = test_memio_new_ssl(ctx_c, mem);
+        use_SNI_at_ssl(ssl_c);
+        for (i = 0; i < 10; i++) {
+            ret_c = wolfSSL_connect(ssl_c);
+            ret_s = wolfSSL_accept(ssl);
+            if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+                break;
+        }
+        AssertIntLT(i, 10);
+        wolfSSL_free(ssl_c);
+
+        AssertIntEQ(wolfSSL_clear(ssl), WOLFSSL_SUCCESS);
+        XMEMSET(mem, 0, sizeof(test_memio_ctx));
+    }
+    /* deferred on the first connection only */
+    AssertIntEQ(3, clientHelloCbCalls);
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+    wolfSSL_CTX_free(ctx_c);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+#endif
 #endif
 }
 
@@ -3704,206 +4038,2794 @@ static void verify_ALPN_not_matching_continue(WOLFSSL* ssl)
     AssertIntEQ(WOLFSSL_ALPN_NOT_FOUND,
                 wolfSSL_ALPN_GetProtocol(ssl, &proto, &protoSz));
 
-    /* check value */
-    AssertIntEQ(1, (0 == protoSz));
-    AssertIntEQ(1, (NULL == proto));
+    /* check value */
+    AssertIntEQ(1, (0 == protoSz));
+    AssertIntEQ(1, (NULL == proto));
+}
+
+static void verify_ALPN_matching_http1(WOLFSSL* ssl)
+{
+    /* http/1.1 */
+    char nego_proto[] = {0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e, 0x31};
+    char *proto;
+    word16 protoSz = 0;
+
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_GetProtocol(ssl, &proto, &protoSz));
+
+    /* check value */
+    AssertIntEQ(1, sizeof(nego_proto) == protoSz);
+    AssertIntEQ(0, XMEMCMP(nego_proto, proto, protoSz));
+}
+
+static void verify_ALPN_matching_spdy2(WOLFSSL* ssl)
+{
+    /* spdy/2 */
+    char nego_proto[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x32};
+    char *proto;
+    word16 protoSz = 0;
+
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_GetProtocol(ssl, &proto, &protoSz));
+
+    /* check value */
+    AssertIntEQ(1, sizeof(nego_proto) == protoSz);
+    AssertIntEQ(0, XMEMCMP(nego_proto, proto, protoSz));
+}
+
+static void verify_ALPN_client_list(WOLFSSL* ssl)
+{
+    /* http/1.1,spdy/1,spdy/2,spdy/3 */
+    char alpn_list[] = {0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e, 0x31, 0x2c,
+                        0x73, 0x70, 0x64, 0x79, 0x2f, 0x31, 0x2c,
+                        0x73, 0x70, 0x64, 0x79, 0x2f, 0x32, 0x2c,
+                        0x73, 0x70, 0x64, 0x79, 0x2f, 0x33};
+    char    *clist = NULL;
+    word16  clistSz = 0;
+
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_GetPeerProtocol(ssl, &clist,
+                                                          &clistSz));
+
+    /* check value */
+    AssertIntEQ(1, sizeof(alpn_list) == clistSz);
+    AssertIntEQ(0, XMEMCMP(alpn_list, clist, clistSz));
+
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_FreePeerProtocol(ssl, &clist));
+}
+
+static void test_wolfSSL_UseALPN_connection(void)
+{
+    unsigned long i;
+    callback_functions callbacks[] = {
+        /* success case same list */
+        {0, 0, use_ALPN_all, 0, 0},
+        {0, 0, use_ALPN_all, verify_ALPN_matching_http1, 0},
+
+        /* success case only one for server */
+        {0, 0, use_ALPN_all, 0, 0},
+        {0, 0, use_ALPN_one, verify_ALPN_matching_spdy2, 0},
+
+        /* success case only one for client */
+        {0, 0, use_ALPN_one, 0, 0},
+        {0, 0, use_ALPN_all, verify_ALPN_matching_spdy2, 0},
+
+        /* success case none for client */
+        {0, 0, 0, 0, 0},
+        {0, 0, use_ALPN_all, 0, 0},
+
+        /* success case mismatch behavior but option 'continue' set */
+        {0, 0, use_ALPN_all_continue, verify_ALPN_not_matching_continue, 0},
+        {0, 0, use_ALPN_unknown_continue, 0, 0},
+
+        /* success case read protocol send by client */
+        {0, 0, use_ALPN_all, 0, 0},
+        {0, 0, use_ALPN_one, verify_ALPN_client_list, 0},
+
+        /* mismatch behavior with same list
+         * the first and only this one must be taken */
+        {0, 0, use_ALPN_all, 0, 0},
+        {0, 0, use_ALPN_all, verify_ALPN_not_matching_spdy3, 0},
+
+        /* default mismatch behavior */
+        {0, 0, use_ALPN_all, 0, 0},
+        {0, 0, use_ALPN_unknown, verify_ALPN_FATAL_ERROR_on_client, 0},
+    };
+
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
+        callbacks[i    ].method = wolfSSLv23_client_method;
+        callbacks[i + 1].method = wolfSSLv23_server_method;
+        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+    }
+}
+
+static void test_wolfSSL_UseALPN_params(void)
+{
+#ifndef NO_WOLFSSL_CLIENT
+    /* "http/1.1" */
+    char http1[] = {0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e, 0x31};
+    /* "spdy/1" */
+    char spdy1[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x31};
+    /* "spdy/2" */
+    char spdy2[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x32};
+    /* "spdy/3" */
+    char spdy3[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x33};
+    char buff[256];
+    word32 idx;
+
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl = wolfSSL_new(ctx);
+
+    AssertNotNull(ctx);
+    AssertNotNull(ssl);
+
+    /* error cases */
+    AssertIntNE(WOLFSSL_SUCCESS,
+                wolfSSL_UseALPN(NULL, http1, sizeof(http1),
+                                WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, NULL, 0,
+                                             WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+
+    /* success case */
+    /* http1 only */
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                wolfSSL_UseALPN(ssl, http1, sizeof(http1),
+                                WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+
+    /* http1, spdy1 */
+    XMEMCPY(buff, http1, sizeof(http1));
+    idx = sizeof(http1);
+    buff[idx++] = ',';
+    XMEMCPY(buff+idx, spdy1, sizeof(spdy1));
+    idx += sizeof(spdy1);
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, buff, idx,
+                                             WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+
+    /* http1, spdy2, spdy1 */
+    XMEMCPY(buff, http1, sizeof(http1));
+    idx = sizeof(http1);
+    buff[idx++] = ',';
+    XMEMCPY(buff+idx, spdy2, sizeof(spdy2));
+    idx += sizeof(spdy2);
+    buff[idx++] = ',';
+    XMEMCPY(buff+idx, spdy1, sizeof(spdy1));
+    idx += sizeof(spdy1);
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, buff, idx,
+                                             WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+
+    /* spdy3, http1, spdy2, spdy1 */
+    XMEMCPY(buff, spdy3, sizeof(spdy3));
+    idx = sizeof(spdy3);
+    buff[idx++] = ',';
+    XMEMCPY(buff+idx, http1, sizeof(http1));
+    idx += sizeof(http1);
+    buff[idx++] = ',';
+    XMEMCPY(buff+idx, spdy2, sizeof(spdy2));
+    idx += sizeof(spdy2);
+    buff[idx++] = ',';
+    XMEMCPY(buff+idx, spdy1, sizeof(spdy1));
+    idx += sizeof(spdy1);
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, buff, idx,
+                                             WOLFSSL_ALPN_CONTINUE_ON_MISMATCH));
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+#endif
+}
+#endif /* HAVE_ALPN  */
+
+static void test_wolfSSL_UseALPN(void)
+{
+#ifdef HAVE_ALPN
+    test_wolfSSL_UseALPN_connection();
+    test_wolfSSL_UseALPN_params();
+#endif
+}
+
+#if defined(HAVE_CLIENT_SERVER_TESTS) && defined(WOLFSSL_TLS13) && \
+    defined(HAVE_SNI) && defined(HAVE_ALPN) && \
+    defined(HAVE_SUPPORTED_CURVES) && defined(HAVE_ECC)
+#define HAVE_TLSX_INDEX_TEST
+/* Long extension lists are found through a lookup table with
+ * WOLFSSL_TLSX_INDEX, short ones are walked. The client list gets the table
+ * while the ClientHello is built. The ALPN response replaces an extension,
+ * the end of the handshake removes some and a key share is added again. */
+static void use_TLSX_many_at_ssl(WOLFSSL* ssl)
+{
+    AssertIntEQ(WOLFSSL_SUCCESS,
+             wolfSSL_UseSNI(ssl, WOLFSSL_SNI_HOST_NAME, "ww2.wolfssl.com", 15));
+    use_ALPN_unknown(ssl);
+#ifdef HAVE_MAX_FRAGMENT
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseMaxFragment(ssl, WOLFSSL_MFL_2_12));
+#endif
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                         wolfSSL_UseSupportedCurve(ssl, WOLFSSL_ECC_SECP256R1));
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                         wolfSSL_UseKeyShare(ssl, WOLFSSL_ECC_SECP256R1));
+#ifdef HAVE_SESSION_TICKET
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseSessionTicket(ssl));
+#endif
+
+    /* replace the host name and the protocol list */
+    use_SNI_at_ssl(ssl);
+    use_ALPN_one(ssl);
+#ifdef HAVE_MAX_FRAGMENT
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseMaxFragment(ssl, WOLFSSL_MFL_2_13));
+#endif
+}
+
+static void use_TLSX_many_no_key_share_at_ssl(WOLFSSL* ssl)
+{
+    use_TLSX_many_at_ssl(ssl);
+    /* HelloRetryRequest replaces the key share and adds a cookie */
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_NoKeyShares(ssl));
+}
+
+static void use_TLSX_many_at_server(WOLFSSL* ssl)
+{
+    use_MANDATORY_SNI_at_ssl(ssl);
+    use_ALPN_all(ssl);
+}
+
+static void verify_TLSX_many_on_client(WOLFSSL* ssl)
+{
+    verify_ALPN_matching_spdy2(ssl);
+
+    /* key share was removed at the end of the handshake, a new one is added */
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                         wolfSSL_UseKeyShare(ssl, WOLFSSL_ECC_SECP256R1));
+    verify_ALPN_matching_spdy2(ssl);
+}
+
+static void verify_TLSX_many_on_server(WOLFSSL* ssl)
+{
+    verify_SNI_real_matching(ssl);
+    verify_ALPN_matching_spdy2(ssl);
+}
+
+static void test_wolfSSL_TLSX_Index(void)
+{
+    callback_functions client_cb;
+    callback_functions server_cb;
+
+    XMEMSET(&client_cb, 0, sizeof(callback_functions));
+    XMEMSET(&server_cb, 0, sizeof(callback_functions));
+    client_cb.method    = wolfTLSv1_3_client_method;
+    client_cb.ssl_ready = use_TLSX_many_at_ssl;
+    client_cb.on_result = verify_TLSX_many_on_client;
+    server_cb.method    = wolfTLSv1_3_server_method;
+    server_cb.ssl_ready = use_TLSX_many_at_server;
+    server_cb.on_result = verify_TLSX_many_on_server;
+
+    test_wolfSSL_client_server(&client_cb, &server_cb);
+
+    client_cb.ssl_ready = use_TLSX_many_no_key_share_at_ssl;
+    test_wolfSSL_client_server(&client_cb, &server_cb);
+}
+#endif
+
+static void test_wolfSSL_DisableExtendedMasterSecret(void)
+{
+#if defined(HAVE_EXTENDED_MASTER) && !defined(NO_WOLFSSL_CLIENT)
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl = wolfSSL_new(ctx);
+
+    AssertNotNull(ctx);
+    AssertNotNull(ssl);
+
+    /* error cases */
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_DisableExtendedMasterSecret(NULL));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_DisableExtendedMasterSecret(NULL));
+
+    /* success cases */
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_DisableExtendedMasterSecret(ctx));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_DisableExtendedMasterSecret(ssl));
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+#endif
+}
+
+/*----------------------------------------------------------------------------*
+ | Record layer tests
+ *----------------------------------------------------------------------------*/
+
+#ifdef WOLFSSL_READ_AHEAD
+#define READ_AHEAD_MSG      "0123456789abcdef"
+#define READ_AHEAD_MSG_CNT  32
+
+static void use_read_ahead(WOLFSSL* ssl)
+{
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                wolfSSL_set_read_ahead_size(ssl, WOLFSSL_READ_AHEAD_SZ));
+}
+
+static void use_read_ahead_release(WOLFSSL* ssl)
+{
+    use_read_ahead(ssl);
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_release_buffers(ssl, 1));
+}
+
+/* client sends many small records back to back */
+static void write_small_records(WOLFSSL* ssl)
+{
+    int i;
+    int len = (int)XSTRLEN(READ_AHEAD_MSG);
+
+    AssertTrue(wolfSSL_is_init_finished(ssl));
+    for (i = 0; i < READ_AHEAD_MSG_CNT; i++)
+        AssertIntEQ(len, wolfSSL_write(ssl, READ_AHEAD_MSG, len));
+}
+
+/* server reads them one record at a time out of the read ahead buffer */
+static void read_small_records(WOLFSSL* ssl)
+{
+    int  i;
+    int  len = (int)XSTRLEN(READ_AHEAD_MSG);
+    char input[sizeof(READ_AHEAD_MSG)];
+
+    AssertTrue(wolfSSL_is_init_finished(ssl));
+    for (i = 0; i < READ_AHEAD_MSG_CNT; i++) {
+        AssertIntEQ(len, wolfSSL_read(ssl, input, len));
+        AssertIntEQ(0, XMEMCMP(input, READ_AHEAD_MSG, len));
+    }
+    AssertIntEQ(0, wolfSSL_has_pending(ssl));
+}
+
+static byte   readBatchOut[READ_AHEAD_MSG_CNT * 64];
+static int    readBatchOutSz;
+
+static void use_read_batch(WOLFSSL* ssl)
+{
+    use_read_ahead(ssl);
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_read_batch(ssl, 1));
+}
+
+static int read_batch_collect(WOLFSSL* ssl, char* buf, int sz, void* ctx)
+{
+    (void)ssl;
+    (void)ctx;
+
+    if (readBatchOutSz + sz > (int)sizeof(readBatchOut))
+        return WOLFSSL_CBIO_ERR_GENERAL;
+    XMEMCPY(readBatchOut + readBatchOutSz, buf, sz);
+    readBatchOutSz += sz;
+
+    return sz;
+}
+
+static void send_collected(WOLFSSL* ssl)
+{
+    int sent = 0;
+    int ret;
+
+    wolfSSL_SSLSetIOSend(ssl, EmbedSend);
+    while (sent < readBatchOutSz) {
+        ret = EmbedSend(ssl, (char*)readBatchOut + sent, readBatchOutSz - sent,
+                        wolfSSL_GetIOWriteCtx(ssl));
+        AssertIntGT(ret, 0);
+        sent += ret;
+    }
+}
+
+/* client builds many small records and sends them in one go */
+static void write_small_records_at_once(WOLFSSL* ssl)
+{
+    readBatchOutSz = 0;
+    wolfSSL_SSLSetIOSend(ssl, read_batch_collect);
+    write_small_records(ssl);
+    send_collected(ssl);
+}
+
+/* client sends close_notify in the same go as the records */
+static void write_small_records_close_at_once(WOLFSSL* ssl)
+{
+    readBatchOutSz = 0;
+    wolfSSL_SSLSetIOSend(ssl, read_batch_collect);
+    write_small_records(ssl);
+    AssertIntEQ(WOLFSSL_SHUTDOWN_NOT_DONE, wolfSSL_shutdown(ssl));
+    send_collected(ssl);
+}
+
+/* server gets the data of all of them in one read */
+static void read_small_records_batched(WOLFSSL* ssl)
+{
+    int  i;
+    int  len = (int)XSTRLEN(READ_AHEAD_MSG);
+    char input[sizeof(READ_AHEAD_MSG) * READ_AHEAD_MSG_CNT];
+
+    AssertTrue(wolfSSL_is_init_finished(ssl));
+    AssertIntEQ(len * READ_AHEAD_MSG_CNT,
+                wolfSSL_read(ssl, input, (int)sizeof(input)));
+    for (i = 0; i < READ_AHEAD_MSG_CNT; i++)
+        AssertIntEQ(0, XMEMCMP(input + i * len, READ_AHEAD_MSG, len));
+    AssertIntEQ(0, wolfSSL_has_pending(ssl));
+}
+
+/* server gets the data, then the close_notify read with it */
+static void read_small_records_batched_close(WOLFSSL* ssl)
+{
+    char input[1];
+
+    read_small_records_batched(ssl);
+    AssertIntEQ(0, wolfSSL_read(ssl, input, (int)sizeof(input)));
+    AssertIntEQ(WOLFSSL_ERROR_ZERO_RETURN, wolfSSL_get_error(ssl, 0));
+}
+
+/* server stops reading ahead with records still in the buffer */
+static void read_small_records_stop_ahead(WOLFSSL* ssl)
+{
+    int  i;
+    int  len = (int)XSTRLEN(READ_AHEAD_MSG);
+    char input[sizeof(READ_AHEAD_MSG)];
+
+    AssertTrue(wolfSSL_is_init_finished(ssl));
+    for (i = 0; i < READ_AHEAD_MSG_CNT; i++) {
+        AssertIntEQ(len, wolfSSL_read(ssl, input, len));
+        AssertIntEQ(0, XMEMCMP(input, READ_AHEAD_MSG, len));
+        if (i == 0) {
+            AssertIntEQ(1, wolfSSL_has_pending(ssl));
+            AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_read_ahead_size(ssl, 0));
+        }
+    }
+    AssertIntEQ(0, wolfSSL_has_pending(ssl));
+}
+#endif /* WOLFSSL_READ_AHEAD */
+
+static void test_wolfSSL_read_ahead(void)
+{
+#if defined(WOLFSSL_READ_AHEAD) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER)
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl;
+    unsigned long i;
+    callback_functions callbacks[] = {
+        /* highest version */
+        {0, 0, use_read_ahead, write_small_records, 0},
+        {0, 0, use_read_ahead, read_small_records, 0},
+
+        /* only one side reading ahead */
+        {0, 0, 0, write_small_records, 0},
+        {0, 0, use_read_ahead, read_small_records, 0},
+
+        /* releasing buffers when idle */
+        {0, 0, use_read_ahead_release, write_small_records, 0},
+        {0, 0, use_read_ahead_release, read_small_records, 0},
+
+        /* all records read ahead returned by one read */
+        {0, 0, 0, write_small_records_at_once, 0},
+        {0, 0, use_read_batch, read_small_records_batched, 0},
+
+        /* close_notify read ahead with the records ends the next read */
+        {0, 0, 0, write_small_records_close_at_once, 0},
+        {0, 0, use_read_batch, read_small_records_batched_close, 0},
+
+        /* reading ahead turned off with records buffered */
+        {0, 0, 0, write_small_records_at_once, 0},
+        {0, 0, use_read_ahead, read_small_records_stop_ahead, 0},
+#ifndef WOLFSSL_NO_TLS12
+        /* TLS v1.2 */
+        {0, 0, use_read_ahead, write_small_records, 0},
+        {0, 0, use_read_ahead, read_small_records, 0},
+#endif
+    };
+
+    AssertNotNull(ctx);
+    ssl = wolfSSL_new(ctx);
+    AssertNotNull(ssl);
+
+    /* error cases */
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_set_read_ahead_size(NULL, 0));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_set_read_ahead_size(NULL, 0));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_set_read_ahead_size(ctx,
+                                                WOLFSSL_MAX_READ_AHEAD_SZ + 1));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_set_read_ahead_size(ssl,
+                                                WOLFSSL_MAX_READ_AHEAD_SZ + 1));
+    AssertIntEQ(0, wolfSSL_has_pending(NULL));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_set_read_batch(NULL, 1));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_set_read_batch(NULL, 1));
+
+    /* success cases */
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_set_read_ahead_size(ctx, 0));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_set_read_ahead_size(ctx,
+                                                WOLFSSL_MAX_READ_AHEAD_SZ));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_read_ahead_size(ssl, 0));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_read_ahead_size(ssl,
+                                                WOLFSSL_READ_AHEAD_SZ));
+    AssertIntEQ(0, wolfSSL_has_pending(ssl));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_set_read_batch(ctx, 1));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_read_batch(ssl, 1));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_read_batch(ssl, 0));
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
+        callbacks[i    ].method = wolfSSLv23_client_method;
+        callbacks[i + 1].method = wolfSSLv23_server_method;
+    }
+#ifndef WOLFSSL_NO_TLS12
+    callbacks[12].method = wolfTLSv1_2_client_method;
+    callbacks[13].method = wolfTLSv1_2_server_method;
+#endif
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2)
+        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+#endif
+}
+
+static void test_wolfSSL_release_buffers(void)
+{
+#ifndef NO_WOLFSSL_CLIENT
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl;
+
+    AssertNotNull(ctx);
+    ssl = wolfSSL_new(ctx);
+    AssertNotNull(ssl);
+
+    /* error cases */
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_set_release_buffers(NULL, 1));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_set_release_buffers(NULL, 1));
+
+    /* success cases */
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_set_release_buffers(ctx, 1));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_set_release_buffers(ctx, 0));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_release_buffers(ssl, 1));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_release_buffers(ssl, 0));
+#if defined(OPENSSL_EXTRA) || defined(HAVE_WEBSERVER)
+    AssertIntEQ(SSL_MODE_RELEASE_BUFFERS,
+                wolfSSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS));
+#endif
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+#endif
+}
+
+#if !defined(NO_WOLFSSL_CLIENT) && !defined(NO_WOLFSSL_SERVER) && \
+    (defined(HAVE_SNI) || defined(HAVE_ALPN) || defined(WOLFSSL_READ_AHEAD))
+static int memUsageKeep = 0;
+static int memUsageFree = 0;
+
+static void keep_handshake_resources(WOLFSSL* ssl)
+{
+    AssertIntEQ(0, wolfSSL_KeepHandshakeResources(ssl));
+}
+
+static void get_memory_usage_keep(WOLFSSL* ssl)
+{
+    memUsageKeep = wolfSSL_GetMemoryUsage(ssl);
+}
+
+static void get_memory_usage_free(WOLFSSL* ssl)
+{
+    memUsageFree = wolfSSL_GetMemoryUsage(ssl);
+}
+#endif
+
+static void test_wolfSSL_GetMemoryUsage(void)
+{
+#ifndef NO_WOLFSSL_CLIENT
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl;
+
+    AssertNotNull(ctx);
+    ssl = wolfSSL_new(ctx);
+    AssertNotNull(ssl);
+
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_GetMemoryUsage(NULL));
+#ifndef WOLFSSL_LEANPSK
+    /* handshake state is allocated with the object */
+    AssertIntGT(wolfSSL_GetMemoryUsage(ssl), wolfSSL_GetObjectSize());
+#endif
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+#endif
+
+#if !defined(NO_WOLFSSL_CLIENT) && !defined(NO_WOLFSSL_SERVER) && \
+    (defined(HAVE_SNI) || defined(HAVE_ALPN) || \
+     defined(WOLFSSL_READ_AHEAD)) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+    {
+        callback_functions client_cb;
+        callback_functions server_cb;
+
+        /* handshake state kept */
+        XMEMSET(&client_cb, 0, sizeof(callback_functions));
+        XMEMSET(&server_cb, 0, sizeof(callback_functions));
+        client_cb.method = wolfSSLv23_client_method;
+        server_cb.method = wolfSSLv23_server_method;
+        client_cb.ssl_ready = keep_handshake_resources;
+        client_cb.on_result = get_memory_usage_keep;
+        test_wolfSSL_client_server(&client_cb, &server_cb);
+
+        /* handshake state freed */
+        XMEMSET(&client_cb, 0, sizeof(callback_functions));
+        XMEMSET(&server_cb, 0, sizeof(callback_functions));
+        client_cb.method = wolfSSLv23_client_method;
+        server_cb.method = wolfSSLv23_server_method;
+        client_cb.on_result = get_memory_usage_free;
+        test_wolfSSL_client_server(&client_cb, &server_cb);
+
+        AssertIntGT(memUsageFree, 0);
+        AssertIntLT(memUsageFree, memUsageKeep);
+    }
+#endif
+}
+
+#if defined(WOLFSSL_KTLS) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+static void use_ktls(WOLFSSL* ssl)
+{
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseKTLS(ssl));
+}
+
+/* data was exchanged whether or not the kernel took over the records */
+static void check_ktls(WOLFSSL* ssl)
+{
+    int state = wolfSSL_GetKTLS(ssl);
+
+    AssertIntGE(state, 0);
+    AssertIntEQ(0, state & ~(WOLFSSL_KTLS_TX | WOLFSSL_KTLS_RX));
+}
+
+#ifdef WOLFSSL_READ_AHEAD
+/* records read ahead with the handshake are decrypted by wolfSSL first */
+static void use_ktls_read_ahead(WOLFSSL* ssl)
+{
+    use_ktls(ssl);
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                wolfSSL_set_read_ahead_size(ssl, WOLFSSL_READ_AHEAD_SZ));
+}
+
+/* the kernel takes over receiving once the buffered records are read */
+static void check_ktls_drained(WOLFSSL* ssl)
+{
+    char buf[16];
+
+    check_ktls(ssl);
+    /* server closes the connection */
+    AssertIntLE(wolfSSL_read(ssl, buf, sizeof(buf)), 0);
+    if (wolfSSL_GetKTLS(ssl) & WOLFSSL_KTLS_TX)
+        AssertIntEQ(WOLFSSL_KTLS_RX, wolfSSL_GetKTLS(ssl) & WOLFSSL_KTLS_RX);
+}
+#endif
+#endif
+
+static void test_wolfSSL_UseKTLS(void)
+{
+#if defined(WOLFSSL_KTLS) && !defined(NO_WOLFSSL_CLIENT)
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl;
+
+    AssertNotNull(ctx);
+    ssl = wolfSSL_new(ctx);
+    AssertNotNull(ssl);
+
+    /* error cases */
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_UseKTLS(NULL));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_UseKTLS(NULL));
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_GetKTLS(NULL));
+
+    /* success cases, nothing offloaded before the handshake */
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_UseKTLS(ctx));
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseKTLS(ssl));
+    AssertIntEQ(0, wolfSSL_GetKTLS(ssl));
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+
+#if !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+    {
+        unsigned long i;
+        callback_functions callbacks[] = {
+            /* highest version */
+            {0, 0, use_ktls, check_ktls, 0},
+            {0, 0, use_ktls, check_ktls, 0},
+    #ifndef WOLFSSL_NO_TLS12
+            /* TLS v1.2 */
+            {0, 0, use_ktls, check_ktls, 0},
+            {0, 0, use_ktls, check_ktls, 0},
+    #endif
+    #ifdef WOLFSSL_READ_AHEAD
+            /* session ticket read ahead with the server's Finished */
+            {0, 0, use_ktls_read_ahead, check_ktls_drained, 0},
+            {0, 0, use_ktls, check_ktls, 0},
+    #endif
+        };
+
+        for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions);
+                                                                     i += 2) {
+            callbacks[i    ].method = wolfSSLv23_client_method;
+            callbacks[i + 1].method = wolfSSLv23_server_method;
+        }
+    #ifndef WOLFSSL_NO_TLS12
+        callbacks[2].method = wolfTLSv1_2_client_method;
+        callbacks[3].method = wolfTLSv1_2_server_method;
+    #endif
+        for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2)
+            test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+    }
+#endif
+#endif
+}
+
+#if defined(WOLFSSL_SENDFILE) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+#define SENDFILE_OFFSET 4097
+#define SENDFILE_SZ     2000
+
+static void sendfile_server(WOLFSSL* ssl)
+{
+    int fd = open(svrCertFile, O_RDONLY);
+    int sent = 0;
+    int ret;
+
+    AssertIntGE(fd, 0);
+    while (sent < SENDFILE_SZ) {
+        ret = wolfSSL_sendfile(ssl, fd, SENDFILE_OFFSET + sent,
+                               SENDFILE_SZ - sent);
+        AssertIntGT(ret, 0);
+        sent += ret;
+    }
+    close(fd);
+}
+
+static void sendfile_client(WOLFSSL* ssl)
+{
+    byte expected[SENDFILE_SZ];
+    byte got[SENDFILE_SZ];
+    int  gotSz = 0;
+    int  ret;
+    int  fd = open(svrCertFile, O_RDONLY);
+
+    AssertIntGE(fd, 0);
+    AssertIntEQ(SENDFILE_SZ,
+                (int)pread(fd, expected, SENDFILE_SZ, SENDFILE_OFFSET));
+    close(fd);
+
+    while (gotSz < SENDFILE_SZ) {
+        ret = wolfSSL_read(ssl, got + gotSz, SENDFILE_SZ - gotSz);
+        AssertIntGT(ret, 0);
+        gotSz += ret;
+    }
+    AssertIntEQ(0, XMEMCMP(expected, got, SENDFILE_SZ));
+}
+#endif
+
+static void test_wolfSSL_sendfile(void)
+{
+#if defined(WOLFSSL_SENDFILE) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_FILESYSTEM) && !defined(NO_CERTS)
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl;
+    int          fd;
+
+    AssertNotNull(ctx);
+    ssl = wolfSSL_new(ctx);
+    AssertNotNull(ssl);
+    fd = open(svrCertFile, O_RDONLY);
+    AssertIntGE(fd, 0);
+
+    /* error cases */
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_sendfile(NULL, fd, 0, 1));
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_sendfile(ssl, -1, 0, 1));
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_sendfile(ssl, fd, -1, 1));
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_sendfile(ssl, fd, 0, -1));
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_sendfile(ssl, fd, LONG_MAX, 1));
+    AssertIntEQ(BAD_FUNC_ARG, wolfSSL_sendfile(ssl, fd, LONG_MAX - 10, 11));
+    /* past the end of the file */
+    AssertIntEQ(WOLFSSL_BAD_FILE, wolfSSL_sendfile(ssl, fd, 1 << 30, 1));
+
+    /* nothing to send */
+    AssertIntEQ(0, wolfSSL_sendfile(ssl, fd, 0, 0));
+
+    close(fd);
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+
+#if !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+    {
+        unsigned long i;
+        callback_functions callbacks[] = {
+            /* highest version */
+            {0, 0, 0, sendfile_client, 0},
+            {0, 0, 0, sendfile_server, 0},
+    #ifdef WOLFSSL_KTLS
+            /* records sent by the kernel where available */
+            {0, 0, use_ktls, sendfile_client, 0},
+            {0, 0, use_ktls, sendfile_server, 0},
+    #endif
+        };
+
+        for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions);
+                                                                     i += 2) {
+            callbacks[i    ].method = wolfSSLv23_client_method;
+            callbacks[i + 1].method = wolfSSLv23_server_method;
+            test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+        }
+    }
+#endif
+#endif
+}
+
+#if defined(WOLFSSL_DYNAMIC_RECORD_SIZE) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+#define DYN_RECORD_SMALL_SZ     1000
+#define DYN_RECORD_THRESHOLD    4000
+#define DYN_RECORD_DATA_SZ      8000
+
+static int dynRecordSendSz[8];
+static int dynRecordSends;
+
+static int dyn_record_send(WOLFSSL* ssl, char* buf, int sz, void* ctx)
+{
+    int ret = EmbedSend(ssl, buf, sz, ctx);
+
+    if (ret > 0 && dynRecordSends < (int)(sizeof(dynRecordSendSz) /
+                                                    sizeof(dynRecordSendSz[0])))
+        dynRecordSendSz[dynRecordSends] = ret;
+    dynRecordSends++;
+
+    return ret;
+}
+
+static void dyn_record_server(WOLFSSL* ssl)
+{
+    static byte data[DYN_RECORD_DATA_SZ];
+    int i;
+
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_set_dynamic_record_size(ssl,
+                      DYN_RECORD_SMALL_SZ, DYN_RECORD_THRESHOLD, 0));
+    wolfSSL_SSLSetIOSend(ssl, dyn_record_send);
+    dynRecordSends = 0;
+
+    XMEMSET(data, 0x5a, sizeof(data));
+    AssertIntEQ(DYN_RECORD_DATA_SZ, wolfSSL_write(ssl, data, sizeof(data)));
+
+    /* small records until the threshold then the rest in one record */
+    AssertIntEQ(DYN_RECORD_THRESHOLD / DYN_RECORD_SMALL_SZ + 1,
+                dynRecordSends);
+    for (i = 0; i < DYN_RECORD_THRESHOLD / DYN_RECORD_SMALL_SZ; i++) {
+        AssertIntGT(dynRecordSendSz[i], DYN_RECORD_SMALL_SZ);
+        AssertIntLT(dynRecordSendSz[i], DYN_RECORD_SMALL_SZ + 64);
+    }
+    AssertIntGT(dynRecordSendSz[i], DYN_RECORD_DATA_SZ - DYN_RECORD_THRESHOLD);
+}
+
+static void dyn_record_client(WOLFSSL* ssl)
+{
+    byte data[DYN_RECORD_DATA_SZ];
+    int  got = 0;
+    int  ret;
+
+    while (got < DYN_RECORD_DATA_SZ) {
+        ret = wolfSSL_read(ssl, data + got, DYN_RECORD_DATA_SZ - got);
+        AssertIntGT(ret, 0);
+        got += ret;
+    }
+}
+#endif
+
+static void test_wolfSSL_set_dynamic_record_size(void)
+{
+#if defined(WOLFSSL_DYNAMIC_RECORD_SIZE) && !defined(NO_WOLFSSL_CLIENT)
+    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    WOLFSSL     *ssl;
+
+    AssertNotNull(ctx);
+    ssl = wolfSSL_new(ctx);
+    AssertNotNull(ssl);
+
+    /* error cases */
+    AssertIntNE(WOLFSSL_SUCCESS,
+                wolfSSL_CTX_set_dynamic_record_size(NULL, 1400, 1000, 1));
+    AssertIntNE(WOLFSSL_SUCCESS,
+                wolfSSL_set_dynamic_record_size(NULL, 1400, 1000, 1));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_set_dynamic_record_size(ctx,
+                                               16 * 1024 + 1, 1000, 1));
+    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_set_dynamic_record_size(ssl,
+                                               16 * 1024 + 1, 1000, 1));
+
+    /* success cases */
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                wolfSSL_CTX_set_dynamic_record_size(ctx, 1400, 1000, 1));
+    AssertIntEQ(WOLFSSL_SUCCESS,
+                wolfSSL_set_dynamic_record_size(ssl, 0, 0, 0));
+
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+
+#if !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+    {
+        callback_functions client_cb;
+        callback_functions server_cb;
+
+        XMEMSET(&client_cb, 0, sizeof(callback_functions));
+        XMEMSET(&server_cb, 0, sizeof(callback_functions));
+        client_cb.method = wolfSSLv23_client_method;
+        server_cb.method = wolfSSLv23_server_method;
+        client_cb.on_result = dyn_record_client;
+        server_cb.on_result = dyn_record_server;
+        test_wolfSSL_client_server(&client_cb, &server_cb);
+    }
+#endif
+#endif
+}
+
+#if defined(WOLFSSL_CERT_MSG_CACHE) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES) && \
+    !defined(NO_RSA)
+/* server sends a certificate with a chain of intermediate CAs */
+static void use_cert_chain(WOLFSSL_CTX* ctx)
+{
+    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_use_certificate_chain_file(ctx,
+                                      "./certs/intermediate/server-chain.pem"));
+}
+
+static void cert_msg_cache_done(WOLFSSL* ssl)
+{
+    AssertTrue(wolfSSL_is_init_finished(ssl));
+}
+#endif
+
+static void test_wolfSSL_CTX_cert_msg_cache(void)
+{
+#if defined(WOLFSSL_CERT_MSG_CACHE) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES) && \
+    !defined(NO_RSA)
+    unsigned long i;
+    callback_functions callbacks[] = {
+        /* highest version, certificate and chain */
+        {0, 0, 0, cert_msg_cache_done, 0},
+        {0, use_cert_chain, 0, cert_msg_cache_done, 0},
+        /* certificate only */
+        {0, 0, 0, cert_msg_cache_done, 0},
+        {0, 0, 0, cert_msg_cache_done, 0},
+#ifndef WOLFSSL_NO_TLS12
+        /* TLS v1.2, certificate and chain */
+        {0, 0, 0, cert_msg_cache_done, 0},
+        {0, use_cert_chain, 0, cert_msg_cache_done, 0},
+        /* certificate only */
+        {0, 0, 0, cert_msg_cache_done, 0},
+        {0, 0, 0, cert_msg_cache_done, 0},
+#endif
+    };
+
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
+        callbacks[i    ].method = wolfSSLv23_client_method;
+        callbacks[i + 1].method = wolfSSLv23_server_method;
+    }
+#ifndef WOLFSSL_NO_TLS12
+    for (i = 4; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
+        callbacks[i    ].method = wolfTLSv1_2_client_method;
+        callbacks[i + 1].method = wolfTLSv1_2_server_method;
+    }
+#endif
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2)
+        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+#endif
+}
+
+#if defined(WOLFSSL_HANDSHAKE_TIMING) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && defined(HAVE_IO_TESTS_DEPENDENCIES)
+static void handshake_timing_done(WOLFSSL* ssl)
+{
+    WOLFSSL_HS_TIMING timing;
+
+    AssertIntEQ(wolfSSL_get_handshake_timing(ssl, &timing), WOLFSSL_SUCCESS);
+    AssertIntEQ(timing.calls[WOLFSSL_HS_TIME_TOTAL], 1);
+    AssertIntGE(timing.calls[WC_FUNC_FINISHED_SEND], 1);
+    AssertIntGE(timing.calls[WC_FUNC_FINISHED_DO], 1);
+    AssertIntGE(timing.calls[WOLFSSL_HS_TIME_IO_READ], 1);
+    AssertIntGE(timing.calls[WOLFSSL_HS_TIME_IO_WRITE], 1);
+    AssertIntLE(timing.usec[WC_FUNC_FINISHED_DO],
+                timing.usec[WOLFSSL_HS_TIME_TOTAL]);
+}
+#endif
+
+static void test_wolfSSL_get_handshake_timing(void)
+{
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+    WOLFSSL_HS_TIMING timing;
+    WOLFSSL_HS_HISTOGRAM hist;
+#if !defined(NO_WOLFSSL_CLIENT) && !defined(NO_WOLFSSL_SERVER) && \
+    defined(HAVE_IO_TESTS_DEPENDENCIES)
+    unsigned long i;
+    callback_functions callbacks[] = {
+        {wolfSSLv23_client_method, 0, 0, handshake_timing_done, 0},
+        {wolfSSLv23_server_method, 0, 0, handshake_timing_done, 0},
+#ifndef WOLFSSL_NO_TLS12
+        {wolfTLSv1_2_client_method, 0, 0, handshake_timing_done, 0},
+        {wolfTLSv1_2_server_method, 0, 0, handshake_timing_done, 0},
+#endif
+    };
+#endif
+
+    AssertIntEQ(wolfSSL_get_handshake_timing(NULL, &timing), BAD_FUNC_ARG);
+    AssertNull(wolfSSL_handshake_timing_name(-1));
+    AssertNull(wolfSSL_handshake_timing_name(WOLFSSL_HS_TIME_COUNT));
+    AssertStrEQ(wolfSSL_handshake_timing_name(WC_FUNC_CERTIFICATE_VERIFY_SEND),
+                "SendCertificateVerify");
+    AssertStrEQ(wolfSSL_handshake_timing_name(WOLFSSL_HS_TIME_TOTAL),
+                "Handshake");
+
+    XMEMSET(&timing, 0, sizeof(timing));
+    XMEMSET(&hist, 0, sizeof(hist));
+    timing.calls[WC_FUNC_FINISHED_DO] = 1;
+    timing.usec[WC_FUNC_FINISHED_DO] = 0;
+    timing.calls[WC_FUNC_FINISHED_SEND] = 1;
+    timing.usec[WC_FUNC_FINISHED_SEND] = 5;
+    timing.calls[WOLFSSL_HS_TIME_TOTAL] = 1;
+    timing.usec[WOLFSSL_HS_TIME_TOTAL] = 0xFFFFFFFF;
+    timing.usec[WOLFSSL_HS_TIME_IO_READ] = 5;
+    AssertIntEQ(wolfSSL_handshake_histogram_add(NULL, &timing), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_handshake_histogram_add(&hist, NULL), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_handshake_histogram_add(&hist, &timing),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(hist.count, 1);
+    AssertIntEQ(hist.bucket[WC_FUNC_FINISHED_DO][0], 1);
+    AssertIntEQ(hist.bucket[WC_FUNC_FINISHED_SEND][3], 1);
+    AssertIntEQ(hist.bucket[WOLFSSL_HS_TIME_TOTAL]
+                           [WOLFSSL_HS_HIST_BUCKETS - 1], 1);
+    /* phases without calls are not added */
+    AssertIntEQ(hist.bucket[WOLFSSL_HS_TIME_IO_READ][3], 0);
+
+#if !defined(NO_WOLFSSL_CLIENT) && !defined(NO_WOLFSSL_SERVER) && \
+    defined(HAVE_IO_TESTS_DEPENDENCIES)
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2)
+        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+#endif
+#endif
+}
+
+#if defined(HAVE_MEMIO_TEST) && defined(WOLFSSL_EARLY_DATA_ANTI_REPLAY) && \
+    defined(HAVE_CHACHA) && defined(HAVE_POLY1305)
+#define HAVE_ANTI_REPLAY_TEST
+
+/* Replay the client's first flight, with early data, to a new server. */
+static int test_early_data_replay(WOLFSSL_CTX* ctx, const byte* flight,
+                                  int flightSz)
+{
+    test_memio_ctx* mem;
+    WOLFSSL* ssl;
+    char     buf[64];
+    int      outSz = 0;
+    int      ret;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+    XMEMCPY(mem->c2s, flight, flightSz);
+    mem->c2sLen = flightSz;
+
+    ssl = test_memio_new_ssl(ctx, mem);
+    ret = wolfSSL_read_early_data(ssl, buf, sizeof(buf), &outSz);
+    if (ret <= 0)
+        outSz = 0;
+
+    wolfSSL_free(ssl);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return outSz;
+}
+#endif
+
+static void test_wolfSSL_CTX_set_early_data_anti_replay(void)
+{
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+    WOLFSSL_CTX* ctx;
+    unsigned int replays;
+#ifdef HAVE_ANTI_REPLAY_TEST
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL*        ssl_c;
+    WOLFSSL*        ssl_s;
+    WOLFSSL*        ssl_r;
+    WOLFSSL_SESSION* sess;
+    test_memio_ctx* mem;
+    byte*           flight;
+    int             flightSz;
+    const char      earlyMsg[] = "early data";
+    char            buf[64];
+    int             outSz = 0;
+    int             ret_c;
+    int             ret_s;
+    int             i;
+#endif
+
+    AssertIntEQ(wolfSSL_CTX_set_early_data_anti_replay(NULL, 0),
+                BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_get_early_data_replays(NULL, &replays),
+                BAD_FUNC_ARG);
+#ifndef NO_WOLFSSL_CLIENT
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method()));
+    AssertIntEQ(wolfSSL_CTX_set_early_data_anti_replay(ctx, 0), SIDE_ERROR);
+    AssertIntEQ(wolfSSL_CTX_get_early_data_replays(ctx, &replays),
+                SIDE_ERROR);
+    wolfSSL_CTX_free(ctx);
+#endif
+#ifndef NO_WOLFSSL_SERVER
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_3_server_method()));
+    AssertIntEQ(wolfSSL_CTX_get_early_data_replays(ctx, NULL), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_set_early_data_anti_replay(ctx,
+                        WOLFSSL_ANTI_REPLAY_MAX_WINDOW_MS + 1), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_set_early_data_anti_replay(ctx, 1000), 0);
+    AssertIntEQ(wolfSSL_CTX_get_early_data_replays(ctx, &replays), 0);
+    AssertIntEQ(replays, 0);
+    wolfSSL_CTX_free(ctx);
+#endif
+
+#ifdef HAVE_ANTI_REPLAY_TEST
+    AssertIntEQ(TicketInit(), 0);
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    AssertNotNull(flight = (byte*)XMALLOC(TEST_MEMIO_BUF_SZ, NULL,
+                                          DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+    AssertNotNull(ctx_c = wolfSSL_CTX_new(wolfTLSv1_3_client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_c, caCertFile, 0));
+    wolfSSL_SetIORecv(ctx_c, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_c, test_memio_write_cb);
+
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_3_server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    AssertIntEQ(wolfSSL_CTX_set_TicketEncCb(ctx, myTicketEncCb),
+                WOLFSSL_SUCCESS);
+    wolfSSL_SetIORecv(ctx, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx, test_memio_write_cb);
+
+    /* Full handshake to get a ticket that allows early data. */
+    ssl_c = test_memio_new_ssl(ctx_c, mem);
+    ssl_s = test_memio_new_ssl(ctx, mem);
+    for (i = 0; i < 10; i++) {
+        ret_c = wolfSSL_connect(ssl_c);
+        ret_s = wolfSSL_accept(ssl_s);
+        if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+            break;
+    }
+    AssertIntLT(i, 10);
+    AssertIntEQ(wolfSSL_read(ssl_c, buf, sizeof(buf)), WOLFSSL_FATAL_ERROR);
+    AssertIntEQ(wolfSSL_get_error(ssl_c, WOLFSSL_FATAL_ERROR),
+                WOLFSSL_ERROR_WANT_READ);
+    AssertNotNull(sess = wolfSSL_get_session(ssl_c));
+    wolfSSL_free(ssl_s);
+
+    /* Resume sending early data. */
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+    ssl_r = test_memio_new_ssl(ctx_c, mem);
+    AssertIntEQ(wolfSSL_set_session(ssl_r, sess), WOLFSSL_SUCCESS);
+    wolfSSL_free(ssl_c);
+    AssertIntEQ(wolfSSL_write_early_data(ssl_r, earlyMsg, sizeof(earlyMsg),
+                                         &outSz), sizeof(earlyMsg));
+    flightSz = mem->c2sLen;
+    XMEMCPY(flight, mem->c2s, flightSz);
+
+    /* First time seen - early data accepted. */
+    ssl_s = test_memio_new_ssl(ctx, mem);
+    AssertIntEQ(wolfSSL_read_early_data(ssl_s, buf, sizeof(buf), &outSz),
+                sizeof(earlyMsg));
+    AssertStrEQ(buf, earlyMsg);
+    wolfSSL_free(ssl_s);
+    wolfSSL_free(ssl_r);
+
+    /* Replayed - early data rejected. */
+    AssertIntEQ(test_early_data_replay(ctx, flight, flightSz), 0);
+    AssertIntEQ(wolfSSL_CTX_get_early_data_replays(ctx, &replays), 0);
+    AssertIntEQ(replays, 1);
+
+    /* Check turned off - replay accepted. */
+    AssertIntEQ(wolfSSL_CTX_set_early_data_anti_replay(ctx, 0), 0);
+    AssertIntEQ(test_early_data_replay(ctx, flight, flightSz),
+                sizeof(earlyMsg));
+    AssertIntEQ(wolfSSL_CTX_get_early_data_replays(ctx, &replays), 0);
+    AssertIntEQ(replays, 1);
+
+    wolfSSL_CTX_free(ctx);
+    wolfSSL_CTX_free(ctx_c);
+    XFREE(flight, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    TicketCleanup();
+#endif
+#endif
+}
+
+#if defined(WOLFSSL_LAZY_HANDSHAKE_HASH) && defined(HAVE_MEMIO_TEST)
+#define HAVE_LAZY_HASH_TEST
+
+#define LAZY_HASH_CLIENT_CERT   0x01
+#define LAZY_HASH_HRR           0x02
+#define LAZY_HASH_RESUME        0x04
+
+/* Handshake between a client and a server that each start the transcript
+ * hash lazily or not. The Finished messages only verify when the lazy and
+ * eager transcripts match. */
+static void test_lazy_hash_connect(method_provider client_method,
+    method_provider server_method, int lazy_c, int lazy_s, int flags)
+{
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL_CTX*    ctx_s;
+    WOLFSSL*        ssl_c;
+    WOLFSSL*        ssl_s;
+    WOLFSSL*        ssl_r = NULL;
+    test_memio_ctx* mem;
+    char            buf[64];
+    int             ret_c;
+    int             ret_s;
+    int             i;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+    AssertNotNull(ctx_c = wolfSSL_CTX_new(client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_c, caCertFile, 0));
+    AssertIntEQ(wolfSSL_CTX_set_lazy_handshake_hash(ctx_c, lazy_c),
+                WOLFSSL_SUCCESS);
+    wolfSSL_SetIORecv(ctx_c, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_c, test_memio_write_cb);
+
+    AssertNotNull(ctx_s = wolfSSL_CTX_new(server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx_s, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx_s, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    AssertIntEQ(wolfSSL_CTX_set_lazy_handshake_hash(ctx_s, lazy_s),
+                WOLFSSL_SUCCESS);
+#if defined(HAVE_SESSION_TICKET) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+    AssertIntEQ(wolfSSL_CTX_set_TicketEncCb(ctx_s, myTicketEncCb),
+                WOLFSSL_SUCCESS);
+#endif
+    wolfSSL_SetIORecv(ctx_s, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_s, test_memio_write_cb);
+
+    ssl_c = test_memio_new_ssl(ctx_c, mem);
+    ssl_s = test_memio_new_ssl(ctx_s, mem);
+    if (flags & LAZY_HASH_CLIENT_CERT) {
+        AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_s, cliCertFile, 0));
+        wolfSSL_set_verify(ssl_s, WOLFSSL_VERIFY_PEER |
+                           WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+        AssertTrue(wolfSSL_use_certificate_file(ssl_c, cliCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+        AssertTrue(wolfSSL_use_PrivateKey_file(ssl_c, cliKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    }
+#ifdef WOLFSSL_TLS13
+    if (flags & LAZY_HASH_HRR)
+        AssertIntEQ(wolfSSL_NoKeyShares(ssl_c), WOLFSSL_SUCCESS);
+#endif
+    for (i = 0; i < 10; i++) {
+        ret_c = wolfSSL_connect(ssl_c);
+        ret_s = wolfSSL_accept(ssl_s);
+        if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+            break;
+    }
+    AssertIntLT(i, 10);
+    /* a TLS v1.3 client reads the session ticket after the handshake */
+    AssertIntEQ(wolfSSL_read(ssl_c, buf, sizeof(buf)), WOLFSSL_FATAL_ERROR);
+    AssertIntEQ(wolfSSL_get_error(ssl_c, WOLFSSL_FATAL_ERROR),
+                WOLFSSL_ERROR_WANT_READ);
+    wolfSSL_free(ssl_s);
+
+    if (flags & LAZY_HASH_RESUME) {
+        XMEMSET(mem, 0, sizeof(test_memio_ctx));
+        ssl_r = test_memio_new_ssl(ctx_c, mem);
+        AssertIntEQ(wolfSSL_set_session(ssl_r, wolfSSL_get_session(ssl_c)),
+                    WOLFSSL_SUCCESS);
+        ssl_s = test_memio_new_ssl(ctx_s, mem);
+    #ifdef WOLFSSL_TLS13
+        if (flags & LAZY_HASH_HRR)
+            AssertIntEQ(wolfSSL_NoKeyShares(ssl_r), WOLFSSL_SUCCESS);
+    #endif
+        for (i = 0; i < 10; i++) {
+            ret_c = wolfSSL_connect(ssl_r);
+            ret_s = wolfSSL_accept(ssl_s);
+            if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+                break;
+        }
+        AssertIntLT(i, 10);
+        AssertIntEQ(wolfSSL_session_reused(ssl_r), 1);
+        wolfSSL_free(ssl_s);
+        wolfSSL_free(ssl_r);
+    }
+
+    wolfSSL_free(ssl_c);
+    wolfSSL_CTX_free(ctx_s);
+    wolfSSL_CTX_free(ctx_c);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+}
+
+/* Runs the handshakes with each side lazy against the other side eager. */
+static void test_lazy_hash_pairs(method_provider client_method,
+    method_provider server_method, int flags)
+{
+    test_lazy_hash_connect(client_method, server_method, 1, 0, flags);
+    test_lazy_hash_connect(client_method, server_method, 0, 1, flags);
+    test_lazy_hash_connect(client_method, server_method, 1, 1, flags);
+}
+#endif
+
+static void test_wolfSSL_set_lazy_handshake_hash(void)
+{
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    WOLFSSL_CTX* ctx;
+    WOLFSSL*     ssl;
+
+    AssertIntEQ(wolfSSL_CTX_set_lazy_handshake_hash(NULL, 1), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_set_lazy_handshake_hash(NULL, 1), BAD_FUNC_ARG);
+#ifndef NO_WOLFSSL_CLIENT
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfSSLv23_client_method()));
+    AssertNotNull(ssl = wolfSSL_new(ctx));
+    AssertIntEQ(wolfSSL_set_lazy_handshake_hash(ssl, 0), WOLFSSL_SUCCESS);
+    AssertIntEQ(wolfSSL_set_lazy_handshake_hash(ssl, 1), WOLFSSL_SUCCESS);
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+#endif
+
+#ifdef HAVE_LAZY_HASH_TEST
+#if defined(HAVE_SESSION_TICKET) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+    AssertIntEQ(TicketInit(), 0);
+#endif
+#ifndef WOLFSSL_NO_TLS12
+    test_lazy_hash_pairs(wolfTLSv1_2_client_method, wolfTLSv1_2_server_method,
+                         0);
+    test_lazy_hash_pairs(wolfTLSv1_2_client_method, wolfTLSv1_2_server_method,
+                         LAZY_HASH_CLIENT_CERT);
+#ifndef NO_SESSION_CACHE
+    test_lazy_hash_pairs(wolfTLSv1_2_client_method, wolfTLSv1_2_server_method,
+                         LAZY_HASH_RESUME);
+#endif
+#endif
+#ifdef WOLFSSL_TLS13
+    test_lazy_hash_pairs(wolfTLSv1_3_client_method, wolfTLSv1_3_server_method,
+                         0);
+    test_lazy_hash_pairs(wolfTLSv1_3_client_method, wolfTLSv1_3_server_method,
+                         LAZY_HASH_HRR);
+    test_lazy_hash_pairs(wolfTLSv1_3_client_method, wolfTLSv1_3_server_method,
+                         LAZY_HASH_CLIENT_CERT);
+#if defined(HAVE_SESSION_TICKET) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+    test_lazy_hash_pairs(wolfTLSv1_3_client_method, wolfTLSv1_3_server_method,
+                         LAZY_HASH_RESUME);
+    test_lazy_hash_pairs(wolfTLSv1_3_client_method, wolfTLSv1_3_server_method,
+                         LAZY_HASH_RESUME | LAZY_HASH_HRR);
+#endif
+#endif
+#if defined(HAVE_SESSION_TICKET) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+    TicketCleanup();
+#endif
+#endif
+#endif
+}
+
+#if defined(HAVE_MEMIO_TEST) && !defined(WOLFSSL_NO_TLS12) && \
+    defined(HAVE_AES_CBC) && defined(HAVE_AES_DECRYPT) && defined(HAVE_ECC) && \
+    defined(ATOMIC_USER)
+#define HAVE_CBC_RECORD_TEST
+
+/* Decrypt the TLS v1.2 AES-CBC record written by the client and check its MAC
+ * with the client's MAC secret, without the record layer of the connection.
+ * Returns the size of the record.
+ */
+static int test_cbc_record_check(WOLFSSL* ssl, const byte* rec,
+    const byte* msg, int msgSz, word32 seq)
+{
+    Aes   aes;
+    Hmac  hmac;
+    byte* plain;
+    byte  inner[13];
+    byte  mac[WC_MAX_DIGEST_SIZE];
+    int   macSz = wolfSSL_GetHmacSize(ssl);
+    int   sz = (rec[3] << 8) | rec[4];
+    int   padSz;
+
+    AssertIntEQ(rec[0], 23); /* application data */
+    AssertIntEQ(sz % AES_BLOCK_SIZE, 0);
+    AssertNotNull(plain = (byte*)XMALLOC(sz, NULL, DYNAMIC_TYPE_TMP_BUFFER));
+
+    AssertIntEQ(wc_AesInit(&aes, NULL, INVALID_DEVID), 0);
+    AssertIntEQ(wc_AesSetKey(&aes, wolfSSL_GetClientWriteKey(ssl),
+                             wolfSSL_GetKeySize(ssl), NULL, AES_DECRYPTION), 0);
+    AssertIntEQ(wc_AesCbcDecrypt(&aes, plain, rec + 5, sz), 0);
+    wc_AesFree(&aes);
+
+    /* explicit IV block, message, MAC and padding */
+    padSz = plain[sz - 1] + 1;
+    AssertIntEQ(sz - AES_BLOCK_SIZE - padSz, msgSz + macSz);
+    AssertIntEQ(XMEMCMP(plain + AES_BLOCK_SIZE, msg, msgSz), 0);
+
+    XMEMSET(inner, 0, sizeof(inner));
+    inner[4]  = (byte)(seq >> 24);
+    inner[5]  = (byte)(seq >> 16);
+    inner[6]  = (byte)(seq >> 8);
+    inner[7]  = (byte)seq;
+    inner[8]  = 23;
+    inner[9]  = 3;
+    inner[10] = 3;
+    inner[11] = (byte)(msgSz >> 8);
+    inner[12] = (byte)msgSz;
+    AssertIntEQ(wc_HmacInit(&hmac, NULL, INVALID_DEVID), 0);
+    AssertIntEQ(wc_HmacSetKey(&hmac, wolfSSL_GetHmacType(ssl),
+                              wolfSSL_GetMacSecret(ssl, 0), macSz), 0);
+    AssertIntEQ(wc_HmacUpdate(&hmac, inner, sizeof(inner)), 0);
+    AssertIntEQ(wc_HmacUpdate(&hmac, msg, msgSz), 0);
+    AssertIntEQ(wc_HmacFinal(&hmac, mac), 0);
+    wc_HmacFree(&hmac);
+    AssertIntEQ(XMEMCMP(mac, plain + AES_BLOCK_SIZE + msgSz, macSz), 0);
+
+    XFREE(plain, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return 5 + sz;
+}
+
+/* TLS v1.2 connection over memory with one AES-CBC cipher suite. */
+static void test_cbc_record_connect(const char* suite, test_memio_ctx* mem,
+    WOLFSSL_CTX** ctx_c, WOLFSSL_CTX** ctx_s, WOLFSSL** ssl_c, WOLFSSL** ssl_s,
+    int scr)
+{
+    int ret_c;
+    int ret_s;
+    int i;
+
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+    AssertNotNull(*ctx_c = wolfSSL_CTX_new(wolfTLSv1_2_client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(*ctx_c, caCertFile, 0));
+    AssertIntEQ(wolfSSL_CTX_set_cipher_list(*ctx_c, suite), WOLFSSL_SUCCESS);
+    wolfSSL_SetIORecv(*ctx_c, test_memio_read_cb);
+    wolfSSL_SetIOSend(*ctx_c, test_memio_write_cb);
+
+    AssertNotNull(*ctx_s = wolfSSL_CTX_new(wolfTLSv1_2_server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(*ctx_s, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(*ctx_s, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    wolfSSL_SetIORecv(*ctx_s, test_memio_read_cb);
+    wolfSSL_SetIOSend(*ctx_s, test_memio_write_cb);
+
+    *ssl_c = test_memio_new_ssl(*ctx_c, mem);
+    *ssl_s = test_memio_new_ssl(*ctx_s, mem);
+#ifdef HAVE_SECURE_RENEGOTIATION
+    if (scr) {
+        AssertIntEQ(wolfSSL_UseSecureRenegotiation(*ssl_c), WOLFSSL_SUCCESS);
+        AssertIntEQ(wolfSSL_UseSecureRenegotiation(*ssl_s), WOLFSSL_SUCCESS);
+    }
+#else
+    (void)scr;
+#endif
+    for (i = 0; i < 10; i++) {
+        ret_c = wolfSSL_connect(*ssl_c);
+        ret_s = wolfSSL_accept(*ssl_s);
+        if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+            break;
+    }
+    AssertIntLT(i, 10);
+}
+
+static const char* test_cbc_record_suites[] = {
+#ifndef NO_SHA
+    "ECDHE-RSA-AES128-SHA",
+#endif
+#ifndef NO_SHA256
+    "ECDHE-RSA-AES128-SHA256",
+#endif
+#ifdef WOLFSSL_SHA384
+    "ECDHE-RSA-AES256-SHA384",
+#endif
+};
+#endif /* HAVE_CBC_RECORD_TEST */
+
+#if defined(HAVE_CBC_RECORD_TEST) && defined(WOLFSSL_TLS_HMAC_CACHE) && \
+    defined(HAVE_SECURE_RENEGOTIATION)
+#define HAVE_HMAC_CACHE_TEST
+
+/* Client sends a message, checked on the wire and by the server, and the
+ * server answers. */
+static void test_hmac_cache_exchange(WOLFSSL* ssl_c, WOLFSSL* ssl_s,
+    test_memio_ctx* mem, word32 seq)
+{
+    const char msg[] = "keyed record MAC";
+    char       buf[64];
+
+    AssertIntEQ(wolfSSL_write(ssl_c, msg, sizeof(msg)), sizeof(msg));
+    AssertIntEQ(test_cbc_record_check(ssl_c, mem->c2s, (const byte*)msg,
+                                      sizeof(msg), seq), mem->c2sLen);
+    AssertIntEQ(wolfSSL_read(ssl_s, buf, sizeof(buf)), sizeof(msg));
+    AssertIntEQ(XMEMCMP(buf, msg, sizeof(msg)), 0);
+
+    AssertIntEQ(wolfSSL_write(ssl_s, msg, sizeof(msg)), sizeof(msg));
+    AssertIntEQ(wolfSSL_read(ssl_c, buf, sizeof(buf)), sizeof(msg));
+    AssertIntEQ(XMEMCMP(buf, msg, sizeof(msg)), 0);
+}
+#endif
+
+static void test_wolfSSL_Rehandshake_hmac_cache(void)
+{
+#ifdef HAVE_HMAC_CACHE_TEST
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL_CTX*    ctx_s;
+    WOLFSSL*        ssl_c;
+    WOLFSSL*        ssl_s;
+    test_memio_ctx* mem;
+    byte            secret[WC_MAX_DIGEST_SIZE];
+    char            buf[64];
+    int             ret_c;
+    int             i;
+    size_t          s;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+
+    for (s = 0; s < sizeof(test_cbc_record_suites) / sizeof(char*); s++) {
+        test_cbc_record_connect(test_cbc_record_suites[s], mem, &ctx_c, &ctx_s,
+                                &ssl_c, &ssl_s, 1);
+
+        /* Finished was the first record with the keys */
+        test_hmac_cache_exchange(ssl_c, ssl_s, mem, 1);
+        test_hmac_cache_exchange(ssl_c, ssl_s, mem, 2);
+        XMEMCPY(secret, wolfSSL_GetMacSecret(ssl_c, 0),
+                wolfSSL_GetHmacSize(ssl_c));
+
+        /* new keys are made in tmp_keys and swapped in at ChangeCipherSpec */
+        ret_c = wolfSSL_Rehandshake(ssl_c);
+        for (i = 0; i < 10 && ret_c != WOLFSSL_SUCCESS; i++) {
+            AssertIntEQ(wolfSSL_get_error(ssl_c, ret_c),
+                        WOLFSSL_ERROR_WANT_READ);
+            AssertIntEQ(wolfSSL_read(ssl_s, buf, sizeof(buf)),
+                        WOLFSSL_FATAL_ERROR);
+            AssertIntEQ(wolfSSL_get_error(ssl_s, WOLFSSL_FATAL_ERROR),
+                        WOLFSSL_ERROR_WANT_READ);
+            ret_c = wolfSSL_connect(ssl_c);
+        }
+        AssertIntLT(i, 10);
+        AssertIntNE(XMEMCMP(secret, wolfSSL_GetMacSecret(ssl_c, 0),
+                            wolfSSL_GetHmacSize(ssl_c)), 0);
+
+        test_hmac_cache_exchange(ssl_c, ssl_s, mem, 1);
+        test_hmac_cache_exchange(ssl_c, ssl_s, mem, 2);
+
+        wolfSSL_free(ssl_s);
+        wolfSSL_free(ssl_c);
+        wolfSSL_CTX_free(ctx_s);
+        wolfSSL_CTX_free(ctx_c);
+    }
+
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+#endif
+}
+
+/* Records MACed and encrypted in chunks of CBC_STITCH_CHUNK_SZ (1024) bytes
+ * must be the same as MACing and then encrypting the whole message. Sizes are
+ * around the AES block and chunk sizes, and up to the maximum record size.
+ * A zero length write sends no record. */
+static void test_wolfSSL_CBC_stitch(void)
+{
+#if defined(HAVE_CBC_RECORD_TEST) && defined(WOLFSSL_CBC_STITCH)
+    const int sizes[] = {
+        1, 15, 16, 17, 1000, 1023, 1024, 1025, 1040, 2047, 2048, 2049, 3000,
+        16383, 16384, 16385, 20000
+    };
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL_CTX*    ctx_s;
+    WOLFSSL*        ssl_c;
+    WOLFSSL*        ssl_s;
+    test_memio_ctx* mem;
+    byte*           msg;
+    byte*           buf;
+    word32          seq;
+    int             sz;
+    int             off;
+    int             recSz;
+    int             i;
+    size_t          s;
+    size_t          n;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    AssertNotNull(msg = (byte*)XMALLOC(20000, NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    AssertNotNull(buf = (byte*)XMALLOC(20000, NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    for (i = 0; i < 20000; i++)
+        msg[i] = (byte)(i * 7 + 1);
+
+    for (s = 0; s < sizeof(test_cbc_record_suites) / sizeof(char*); s++) {
+        test_cbc_record_connect(test_cbc_record_suites[s], mem, &ctx_c, &ctx_s,
+                                &ssl_c, &ssl_s, 0);
+    #ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+        /* full size records from the start */
+        AssertIntEQ(wolfSSL_set_dynamic_record_size(ssl_c, 0, 0, 0),
+                    WOLFSSL_SUCCESS);
+    #endif
+
+        AssertIntEQ(wolfSSL_write(ssl_c, msg, 0), 0);
+        AssertIntEQ(mem->c2sLen, 0);
+
+        seq = 1;
+        for (n = 0; n < sizeof(sizes) / sizeof(*sizes); n++) {
+            AssertIntEQ(wolfSSL_write(ssl_c, msg, sizes[n]), sizes[n]);
+
+            /* larger writes are split into maximum size records */
+            for (off = 0, recSz = 0; off < sizes[n]; off += sz) {
+                sz = sizes[n] - off;
+                if (sz > 16384)
+                    sz = 16384;
+                recSz += test_cbc_record_check(ssl_c, mem->c2s + recSz,
+                                               msg + off, sz, seq++);
+            }
+            AssertIntEQ(recSz, mem->c2sLen);
+
+            for (off = 0; off < sizes[n]; off += sz) {
+                sz = wolfSSL_read(ssl_s, buf + off, sizes[n] - off);
+                AssertIntGT(sz, 0);
+            }
+            AssertIntEQ(XMEMCMP(buf, msg, sizes[n]), 0);
+        }
+
+        wolfSSL_free(ssl_s);
+        wolfSSL_free(ssl_c);
+        wolfSSL_CTX_free(ctx_s);
+        wolfSSL_CTX_free(ctx_c);
+    }
+
+    XFREE(buf, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(msg, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+#endif
+}
+
+#if defined(HAVE_MATCH_SUITE_TEST) && defined(HAVE_MEMIO_TEST)
+#define MATCH_SUITE_MAX     32
+#define MATCH_SUITE_NAME_SZ 64
+
+/* Split a ':' separated list into names built into the library. */
+static int test_match_suite_split(const char* list, const char* all,
+    char names[MATCH_SUITE_MAX][MATCH_SUITE_NAME_SZ])
+{
+    const char* p;
+    const char* f;
+    int         cnt = 0;
+    int         len;
+
+    for (p = list; *p != '\0'; p += len + (p[len] == ':')) {
+        len = 0;
+        while (p[len] != '\0' && p[len] != ':')
+            len++;
+        AssertIntLT(len, MATCH_SUITE_NAME_SZ);
+        AssertIntLT(cnt, MATCH_SUITE_MAX);
+        XMEMCPY(names[cnt], p, len);
+        names[cnt][len] = '\0';
+
+        for (f = XSTRSTR(all, names[cnt]); f != NULL;
+                                            f = XSTRSTR(f + 1, names[cnt])) {
+            if ((f == all || f[-1] == ':') &&
+                                    (f[len] == ':' || f[len] == '\0')) {
+                cnt++;
+                break;
+            }
+        }
+    }
+
+    return cnt;
+}
+
+/* The server's choice with the nested loops MatchSuite() used to have. Only
+ * ECDHE-RSA suites are usable: the server has an RSA certificate and no DH
+ * parameters, and it is TLS v1.2 only. */
+static const char* test_match_suite_ref(const char* all, const char* server,
+    const char* client, int clientOrder)
+{
+    static char srv[MATCH_SUITE_MAX][MATCH_SUITE_NAME_SZ];
+    static char cli[MATCH_SUITE_MAX][MATCH_SUITE_NAME_SZ];
+    int srvCnt = test_match_suite_split(server, all, srv);
+    int cliCnt = test_match_suite_split(client, all, cli);
+    int i, j;
+
+    for (i = 0; i < (clientOrder ? cliCnt : srvCnt); i++) {
+        for (j = 0; j < (clientOrder ? srvCnt : cliCnt); j++) {
+            const char* s = clientOrder ? srv[j] : srv[i];
+            const char* c = clientOrder ? cli[i] : cli[j];
+
+            if (strcmp(s, c) == 0 && XSTRNCMP(s, "ECDHE-RSA-", 10) == 0)
+                return s;
+        }
+    }
+
+    return NULL;
+}
+#endif
+
+/* The hashed lookup in MatchSuite() picks the same suite as nested loops over
+ * the server's and the client's lists, in server and client order, with
+ * unusable and repeated suites in either list. */
+static void test_wolfSSL_MatchSuite(void)
+{
+#if defined(HAVE_MATCH_SUITE_TEST) && defined(HAVE_MEMIO_TEST)
+    const char* srvLong =
+        "TLS13-AES128-GCM-SHA256:ECDHE-ECDSA-AES128-GCM-SHA256:"
+        "DHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:"
+        "ECDHE-ECDSA-CHACHA20-POLY1305:DHE-RSA-AES256-GCM-SHA384:"
+        "ECDHE-RSA-AES256-GCM-SHA384:ECDHE-RSA-AES128-GCM-SHA256:"
+        "ECDHE-RSA-CHACHA20-POLY1305:DHE-RSA-AES128-SHA256:"
+        "ECDHE-RSA-AES256-SHA384:ECDHE-RSA-AES128-SHA256:"
+        "ECDHE-RSA-AES256-SHA:ECDHE-RSA-AES128-SHA:ECDHE-ECDSA-AES128-SHA:"
+        "ECDHE-ECDSA-AES256-SHA:DHE-RSA-AES128-SHA:DHE-RSA-AES256-SHA";
+    const char* cases[][2] = {
+        /* server, client */
+        { srvLong,
+          "ECDHE-RSA-AES128-SHA:ECDHE-ECDSA-AES128-GCM-SHA256:"
+          "DHE-RSA-AES128-GCM-SHA256:ECDHE-RSA-AES256-GCM-SHA384:"
+          "ECDHE-RSA-AES128-GCM-SHA256" },
+        { srvLong,
+          "ECDHE-ECDSA-AES256-SHA:DHE-RSA-AES256-SHA:ECDHE-ECDSA-AES128-SHA:"
+          "DHE-RSA-AES128-SHA256:ECDHE-RSA-AES128-SHA256" },
+        /* repeated suites from the client */
+        { srvLong,
+          "ECDHE-RSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+          "ECDHE-RSA-AES128-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+          "ECDHE-RSA-AES128-SHA256" },
+        /* repeated suites in the server's list */
+        { "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-SHA256:"
+          "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+          "ECDHE-RSA-AES128-SHA256:ECDHE-RSA-AES128-GCM-SHA256",
+          "ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES128-GCM-SHA256:"
+          "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-SHA256" },
+        /* common suites that the server can't use */
+        { "ECDHE-ECDSA-AES128-GCM-SHA256:DHE-RSA-AES128-GCM-SHA256:"
+          "ECDHE-RSA-AES128-GCM-SHA256",
+          "DHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES128-GCM-SHA256:"
+          "DHE-RSA-AES128-GCM-SHA256" },
+    };
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL_CTX*    ctx_s;
+    WOLFSSL*        ssl_c;
+    WOLFSSL*        ssl_s;
+    test_memio_ctx* mem;
+    char*           all;
+    const char*     expected;
+    int             ret_c = WOLFSSL_FATAL_ERROR;
+    int             ret_s = WOLFSSL_FATAL_ERROR;
+    int             clientOrder;
+    int             i;
+    size_t          n;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    AssertNotNull(all = (char*)XMALLOC(4096, NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    AssertIntEQ(wolfSSL_get_ciphers(all, 4096), WOLFSSL_SUCCESS);
+
+    for (n = 0; n < sizeof(cases) / sizeof(*cases); n++) {
+        for (clientOrder = 0; clientOrder <= 1; clientOrder++) {
+            expected = test_match_suite_ref(all, cases[n][0], cases[n][1],
+                                            clientOrder);
+            XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+            AssertNotNull(ctx_c = wolfSSL_CTX_new(wolfTLSv1_2_client_method()));
+            AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_c, caCertFile, 0));
+            AssertIntEQ(wolfSSL_CTX_set_cipher_list(ctx_c, cases[n][1]),
+                        WOLFSSL_SUCCESS);
+            wolfSSL_SetIORecv(ctx_c, test_memio_read_cb);
+            wolfSSL_SetIOSend(ctx_c, test_memio_write_cb);
+
+            AssertNotNull(ctx_s = wolfSSL_CTX_new(wolfTLSv1_2_server_method()));
+            AssertTrue(wolfSSL_CTX_use_certificate_file(ctx_s, svrCertFile,
+                                                        WOLFSSL_FILETYPE_PEM));
+            AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx_s, svrKeyFile,
+                                                       WOLFSSL_FILETYPE_PEM));
+            AssertIntEQ(wolfSSL_CTX_set_cipher_list(ctx_s, cases[n][0]),
+                        WOLFSSL_SUCCESS);
+            if (clientOrder)
+                AssertIntEQ(wolfSSL_CTX_UseClientSuites(ctx_s), 0);
+            wolfSSL_SetIORecv(ctx_s, test_memio_read_cb);
+            wolfSSL_SetIOSend(ctx_s, test_memio_write_cb);
+
+            ssl_c = test_memio_new_ssl(ctx_c, mem);
+            ssl_s = test_memio_new_ssl(ctx_s, mem);
+            for (i = 0; i < 10; i++) {
+                ret_c = wolfSSL_connect(ssl_c);
+                ret_s = wolfSSL_accept(ssl_s);
+                if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+                    break;
+                if (wolfSSL_get_error(ssl_s, ret_s) == MATCH_SUITE_ERROR)
+                    break;
+            }
+
+            if (expected == NULL) {
+                AssertIntEQ(wolfSSL_get_error(ssl_s, ret_s),
+                            MATCH_SUITE_ERROR);
+            }
+            else {
+                AssertIntLT(i, 10);
+                AssertStrEQ(wolfSSL_get_cipher_name(ssl_s), expected);
+                AssertStrEQ(wolfSSL_get_cipher_name(ssl_c), expected);
+            }
+
+            wolfSSL_free(ssl_s);
+            wolfSSL_free(ssl_c);
+            wolfSSL_CTX_free(ctx_s);
+            wolfSSL_CTX_free(ctx_c);
+        }
+    }
+
+    XFREE(all, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+#endif
+}
+
+#if defined(WOLFSSL_TLS13_GROUP_CACHE) && defined(HAVE_MEMIO_TEST) && \
+    defined(HAVE_ECC) && !defined(NO_ECC256) && \
+    (!defined(NO_ECC384) || defined(HAVE_ALL_CURVES)) && \
+    !defined(NO_SESSION_CACHE) && !defined(NO_CLIENT_CACHE)
+/* Connect to a server that only accepts P-384 using the server ID. */
+static void test_group_cache_connect(WOLFSSL_CTX* ctx_c, WOLFSSL_CTX* ctx_s,
+                                     const char* id)
+{
+    test_memio_ctx* mem;
+    WOLFSSL* ssl_c;
+    WOLFSSL* ssl_s;
+    int      ret_c;
+    int      ret_s;
+    int      i;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+    ssl_c = test_memio_new_ssl(ctx_c, mem);
+    ssl_s = test_memio_new_ssl(ctx_s, mem);
+    AssertIntEQ(wolfSSL_SetServerID(ssl_c, (const byte*)id, (int)XSTRLEN(id),
+                                    1), WOLFSSL_SUCCESS);
+    for (i = 0; i < 10; i++) {
+        ret_c = wolfSSL_connect(ssl_c);
+        ret_s = wolfSSL_accept(ssl_s);
+        if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+            break;
+    }
+    AssertIntLT(i, 10);
+
+    wolfSSL_free(ssl_s);
+    wolfSSL_free(ssl_c);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+}
+#endif
+
+static void test_wolfSSL_CTX_get_hrr_stats(void)
+{
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+    WOLFSSL_CTX* ctx;
+    unsigned int hrr = 1;
+    unsigned int hits = 1;
+#if defined(HAVE_MEMIO_TEST) && defined(HAVE_ECC) && !defined(NO_ECC256) && \
+    (!defined(NO_ECC384) || defined(HAVE_ALL_CURVES)) && \
+    !defined(NO_SESSION_CACHE) && !defined(NO_CLIENT_CACHE)
+    WOLFSSL_CTX* ctx_s;
+    int          groups[] = { WOLFSSL_ECC_SECP384R1 };
+#endif
+
+    printf(testingFmt, "wolfSSL_CTX_get_hrr_stats()");
+
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(NULL, &hrr, &hits), BAD_FUNC_ARG);
+#ifndef NO_WOLFSSL_CLIENT
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method()));
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(ctx, NULL, &hits), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(ctx, &hrr, NULL), 0);
+    AssertIntEQ(hrr, 0);
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(ctx, &hrr, &hits), 0);
+    AssertIntEQ(hits, 0);
+    wolfSSL_CTX_free(ctx);
+#endif
+
+#if defined(HAVE_MEMIO_TEST) && defined(HAVE_ECC) && !defined(NO_ECC256) && \
+    (!defined(NO_ECC384) || defined(HAVE_ALL_CURVES)) && \
+    !defined(NO_SESSION_CACHE) && !defined(NO_CLIENT_CACHE)
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx, caCertFile, 0));
+    wolfSSL_SetIORecv(ctx, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx, test_memio_write_cb);
+
+    AssertNotNull(ctx_s = wolfSSL_CTX_new(wolfTLSv1_3_server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx_s, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx_s, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    AssertIntEQ(wolfSSL_CTX_set_groups(ctx_s, groups, 1), WOLFSSL_SUCCESS);
+    wolfSSL_SetIORecv(ctx_s, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_s, test_memio_write_cb);
+
+    /* Client guesses P-256 - server asks for P-384. */
+    test_group_cache_connect(ctx, ctx_s, "hrr.example.com");
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(ctx, &hrr, &hits), 0);
+    AssertIntEQ(hrr, 1);
+    AssertIntEQ(hits, 0);
+
+    /* Same server - P-384 key share sent straight away. */
+    test_group_cache_connect(ctx, ctx_s, "hrr.example.com");
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(ctx, &hrr, &hits), 0);
+    AssertIntEQ(hrr, 1);
+    AssertIntEQ(hits, 1);
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(ctx_s, &hrr, NULL), 0);
+    AssertIntEQ(hrr, 1);
+
+    /* Unknown server - back to the default guess. */
+    test_group_cache_connect(ctx, ctx_s, "other.example.com");
+    AssertIntEQ(wolfSSL_CTX_get_hrr_stats(ctx, &hrr, &hits), 0);
+    AssertIntEQ(hrr, 2);
+    AssertIntEQ(hits, 1);
+
+    wolfSSL_CTX_free(ctx_s);
+    wolfSSL_CTX_free(ctx);
+#endif
+    (void)ctx;
+
+    printf(resultFmt, passed);
+#endif
+}
+
+#if defined(WOLFSSL_CERT_COMPRESSION) && defined(HAVE_MEMIO_TEST)
+/* Run a handshake and return the size of the server's first flight. */
+static int test_cert_compress_connect(WOLFSSL_CTX* ctx_c, WOLFSSL_CTX* ctx_s)
+{
+    test_memio_ctx* mem;
+    WOLFSSL* ssl_c;
+    WOLFSSL* ssl_s;
+    int      ret_c;
+    int      ret_s;
+    int      flightSz;
+    int      i;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+    ssl_c = test_memio_new_ssl(ctx_c, mem);
+    ssl_s = test_memio_new_ssl(ctx_s, mem);
+    AssertIntNE(wolfSSL_connect(ssl_c), WOLFSSL_SUCCESS);
+    AssertIntNE(wolfSSL_accept(ssl_s), WOLFSSL_SUCCESS);
+    flightSz = mem->s2cLen;
+    for (i = 0; i < 10; i++) {
+        ret_c = wolfSSL_connect(ssl_c);
+        ret_s = wolfSSL_accept(ssl_s);
+        if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+            break;
+    }
+    AssertIntLT(i, 10);
+
+    wolfSSL_free(ssl_s);
+    wolfSSL_free(ssl_c);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return flightSz;
+}
+#endif
+
+static void test_wolfSSL_UseCertCompression(void)
+{
+#ifdef WOLFSSL_CERT_COMPRESSION
+    WOLFSSL_CTX* ctx;
+#ifdef HAVE_MEMIO_TEST
+    WOLFSSL_CTX* ctx_s;
+    int          plainSz;
+    int          compSz;
+#endif
+
+    printf(testingFmt, "wolfSSL_UseCertCompression()");
+
+    AssertIntEQ(wolfSSL_CTX_UseCertCompression(NULL), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_UseCertCompression(NULL), BAD_FUNC_ARG);
+#if !defined(NO_WOLFSSL_CLIENT) && !defined(WOLFSSL_NO_TLS12)
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_2_client_method()));
+    AssertIntEQ(wolfSSL_CTX_UseCertCompression(ctx), BAD_FUNC_ARG);
+    wolfSSL_CTX_free(ctx);
+#endif
+
+#ifdef HAVE_MEMIO_TEST
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx, caCertFile, 0));
+    wolfSSL_SetIORecv(ctx, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx, test_memio_write_cb);
+
+    AssertNotNull(ctx_s = wolfSSL_CTX_new(wolfTLSv1_3_server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx_s, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx_s, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    wolfSSL_SetIORecv(ctx_s, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_s, test_memio_write_cb);
+
+    plainSz = test_cert_compress_connect(ctx, ctx_s);
+
+    /* Only the client allows compression - sent uncompressed. */
+    AssertIntEQ(wolfSSL_CTX_UseCertCompression(ctx), 0);
+    AssertIntEQ(test_cert_compress_connect(ctx, ctx_s), plainSz);
+
+    /* Both allow compression - smaller flight, the same with the cache. */
+    AssertIntEQ(wolfSSL_CTX_UseCertCompression(ctx_s), 0);
+    compSz = test_cert_compress_connect(ctx, ctx_s);
+    AssertIntLT(compSz, plainSz);
+    AssertIntEQ(test_cert_compress_connect(ctx, ctx_s), compSz);
+
+    wolfSSL_CTX_free(ctx_s);
+    wolfSSL_CTX_free(ctx);
+#endif
+    (void)ctx;
+
+    printf(resultFmt, passed);
+#endif
+}
+
+#if defined(HAVE_RECORD_SIZE_LIMIT) && defined(HAVE_MEMIO_TEST)
+/* Handshake with the limits set and check the server's records keep to the
+ * client's limit. maxLimit is what a server without a limit answers with. */
+static void test_record_size_limit(wolfSSL_method_func client,
+    wolfSSL_method_func server, int maxLimit, word16 limit_c, word16 limit_s)
+{
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL_CTX*    ctx_s;
+    WOLFSSL*        ssl_c;
+    WOLFSSL*        ssl_s;
+    test_memio_ctx* mem;
+    byte            msg[2000];
+    int             idx;
+    int             sz;
+    int             recs;
+    int             maxOut;
+    int             ret_c;
+    int             ret_s;
+    int             i;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+    AssertNotNull(ctx_c = wolfSSL_CTX_new(client(NULL)));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_c, caCertFile, 0));
+    wolfSSL_SetIORecv(ctx_c, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_c, test_memio_write_cb);
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx_c, limit_c),
+                WOLFSSL_SUCCESS);
+
+    AssertNotNull(ctx_s = wolfSSL_CTX_new(server(NULL)));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx_s, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx_s, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    wolfSSL_SetIORecv(ctx_s, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_s, test_memio_write_cb);
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx_s, limit_s),
+                WOLFSSL_SUCCESS);
+
+    ssl_c = test_memio_new_ssl(ctx_c, mem);
+    ssl_s = test_memio_new_ssl(ctx_s, mem);
+    for (i = 0; i < 10; i++) {
+        ret_c = wolfSSL_connect(ssl_c);
+        ret_s = wolfSSL_accept(ssl_s);
+        if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+            break;
+    }
+    AssertIntLT(i, 10);
+
+    /* Only negotiated when the client offers it. */
+    if (limit_c == 0) {
+        AssertIntEQ(wolfSSL_GetPeerRecordSizeLimit(ssl_s), 0);
+        AssertIntEQ(wolfSSL_GetPeerRecordSizeLimit(ssl_c), 0);
+        maxOut = 16384;
+    }
+    else {
+        AssertIntEQ(wolfSSL_GetPeerRecordSizeLimit(ssl_s), limit_c);
+        AssertIntEQ(wolfSSL_GetPeerRecordSizeLimit(ssl_c),
+                    limit_s != 0 ? limit_s : maxLimit);
+        /* TLS v1.3 counts the content type in the limit */
+        maxOut = limit_c - (maxLimit - 16384);
+    }
+    AssertIntEQ(wolfSSL_GetMaxOutputSize(ssl_s), maxOut);
+
+    /* Read anything left over from the handshake. */
+    AssertIntEQ(wolfSSL_read(ssl_c, msg, sizeof(msg)), WOLFSSL_FATAL_ERROR);
+    AssertIntEQ(mem->s2cLen, 0);
+
+    XMEMSET(msg, 0x5a, sizeof(msg));
+    AssertIntEQ(wolfSSL_write(ssl_s, msg, sizeof(msg)), sizeof(msg));
+    for (idx = 0, recs = 0; idx < mem->s2cLen; idx += 5 + sz, recs++) {
+        sz = (mem->s2c[idx + 3] << 8) | mem->s2c[idx + 4];
+        if (limit_c != 0)
+            AssertIntLE(sz, limit_c + 64);
+    }
+    AssertIntGE(recs, (int)(sizeof(msg) + maxOut - 1) / maxOut);
+    for (idx = 0; idx < (int)sizeof(msg); idx += sz) {
+        sz = wolfSSL_read(ssl_c, msg, sizeof(msg));
+        AssertIntGT(sz, 0);
+    }
+    AssertIntEQ(idx, sizeof(msg));
+
+    /* The client's records go by the server's limit. */
+    AssertIntEQ(wolfSSL_write(ssl_c, msg, sizeof(msg)), sizeof(msg));
+    for (idx = 0; idx < (int)sizeof(msg); idx += sz) {
+        sz = wolfSSL_read(ssl_s, msg, sizeof(msg));
+        AssertIntGT(sz, 0);
+    }
+    AssertIntEQ(idx, sizeof(msg));
+
+    /* A record one byte over the limit is refused. */
+    if (limit_c != 0) {
+        AssertIntEQ(wolfSSL_UseRecordSizeLimit(ssl_c, limit_c - 1),
+                    WOLFSSL_SUCCESS);
+        AssertIntEQ(wolfSSL_write(ssl_s, msg, maxOut), maxOut);
+        AssertIntEQ(wolfSSL_read(ssl_c, msg, sizeof(msg)),
+                    WOLFSSL_FATAL_ERROR);
+        AssertIntEQ(wolfSSL_get_error(ssl_c, WOLFSSL_FATAL_ERROR),
+                    LENGTH_ERROR);
+    }
+
+    wolfSSL_free(ssl_s);
+    wolfSSL_free(ssl_c);
+    wolfSSL_CTX_free(ctx_s);
+    wolfSSL_CTX_free(ctx_c);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+}
+
+#ifndef WOLFSSL_NO_TLS12
+/* A client refuses a server's limit over the TLS v1.2 maximum. */
+static void test_record_size_limit_over_max(void)
+{
+    /* record_size_limit extension with a limit of 1024 */
+    const byte      ext[] = { 0x00, 0x1c, 0x00, 0x02, 0x04, 0x00 };
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL_CTX*    ctx_s;
+    WOLFSSL*        ssl_c;
+    WOLFSSL*        ssl_s;
+    test_memio_ctx* mem;
+    int             idx;
+
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+
+    AssertNotNull(ctx_c = wolfSSL_CTX_new(wolfTLSv1_2_client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_c, caCertFile, 0));
+    wolfSSL_SetIORecv(ctx_c, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_c, test_memio_write_cb);
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx_c, 512), WOLFSSL_SUCCESS);
+
+    AssertNotNull(ctx_s = wolfSSL_CTX_new(wolfTLSv1_2_server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx_s, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx_s, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    wolfSSL_SetIORecv(ctx_s, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_s, test_memio_write_cb);
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx_s, 1024), WOLFSSL_SUCCESS);
+
+    ssl_c = test_memio_new_ssl(ctx_c, mem);
+    ssl_s = test_memio_new_ssl(ctx_s, mem);
+    AssertIntNE(wolfSSL_connect(ssl_c), WOLFSSL_SUCCESS);
+    AssertIntNE(wolfSSL_accept(ssl_s), WOLFSSL_SUCCESS);
+
+    /* Make the server's limit 16385 in the ServerHello. */
+    for (idx = 0; idx + (int)sizeof(ext) <= mem->s2cLen; idx++) {
+        if (XMEMCMP(mem->s2c + idx, ext, sizeof(ext)) == 0)
+            break;
+    }
+    AssertIntLT(idx + (int)sizeof(ext), mem->s2cLen);
+    mem->s2c[idx + 4] = 0x40;
+    mem->s2c[idx + 5] = 0x01;
+
+    AssertIntEQ(wolfSSL_connect(ssl_c), WOLFSSL_FATAL_ERROR);
+    AssertIntEQ(wolfSSL_get_error(ssl_c, WOLFSSL_FATAL_ERROR),
+                BAD_RECORD_SIZE_LIMIT_E);
+
+    wolfSSL_free(ssl_s);
+    wolfSSL_free(ssl_c);
+    wolfSSL_CTX_free(ctx_s);
+    wolfSSL_CTX_free(ctx_c);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+}
+#endif
+#endif
+
+static void test_wolfSSL_UseRecordSizeLimit(void)
+{
+#ifdef HAVE_RECORD_SIZE_LIMIT
+    WOLFSSL_CTX* ctx;
+    WOLFSSL*     ssl;
+
+    printf(testingFmt, "wolfSSL_UseRecordSizeLimit()");
+
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(NULL, 512), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_UseRecordSizeLimit(NULL, 512), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_GetPeerRecordSizeLimit(NULL), BAD_FUNC_ARG);
+#ifndef NO_WOLFSSL_CLIENT
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfSSLv23_client_method()));
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx, 63), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx, 16385), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx, 64), WOLFSSL_SUCCESS);
+    AssertIntEQ(wolfSSL_CTX_UseRecordSizeLimit(ctx, 16384), WOLFSSL_SUCCESS);
+    AssertNotNull(ssl = wolfSSL_new(ctx));
+    AssertIntEQ(wolfSSL_UseRecordSizeLimit(ssl, 63), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_UseRecordSizeLimit(ssl, 0), WOLFSSL_SUCCESS);
+    AssertIntEQ(wolfSSL_GetPeerRecordSizeLimit(ssl), 0);
+    wolfSSL_free(ssl);
+    wolfSSL_CTX_free(ctx);
+#endif
+    (void)ctx;
+    (void)ssl;
+
+#ifdef HAVE_MEMIO_TEST
+#ifdef WOLFSSL_TLS13
+    test_record_size_limit(wolfTLSv1_3_client_method_ex,
+                           wolfTLSv1_3_server_method_ex, 16385, 0, 1024);
+    test_record_size_limit(wolfTLSv1_3_client_method_ex,
+                           wolfTLSv1_3_server_method_ex, 16385, 512, 0);
+    test_record_size_limit(wolfTLSv1_3_client_method_ex,
+                           wolfTLSv1_3_server_method_ex, 16385, 512, 1024);
+#endif
+#ifndef WOLFSSL_NO_TLS12
+    test_record_size_limit(wolfTLSv1_2_client_method_ex,
+                           wolfTLSv1_2_server_method_ex, 16384, 512, 0);
+    test_record_size_limit(wolfTLSv1_2_client_method_ex,
+                           wolfTLSv1_2_server_method_ex, 16384, 700, 1024);
+    test_record_size_limit_over_max();
+#endif
+#endif
+
+    printf(resultFmt, passed);
+#endif
 }
 
-static void verify_ALPN_matching_http1(WOLFSSL* ssl)
+#if defined(WOLFSSL_HANDSHAKE_ADMISSION) && defined(HAVE_MEMIO_TEST)
+/* Send a ClientHello and have the server process it.
+ * returns the server's error, 0 when it has nothing to read */
+static int test_admission_start(WOLFSSL* ssl_c, WOLFSSL* ssl_s)
 {
-    /* http/1.1 */
-    char nego_proto[] = {0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e, 0x31};
-    char *proto;
-    word16 protoSz = 0;
+    int err;
 
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_GetProtocol(ssl, &proto, &protoSz));
+    AssertIntNE(wolfSSL_connect(ssl_c), WOLFSSL_SUCCESS);
+    AssertIntNE(wolfSSL_accept(ssl_s), WOLFSSL_SUCCESS);
+    err = wolfSSL_get_error(ssl_s, WOLFSSL_FATAL_ERROR);
 
-    /* check value */
-    AssertIntEQ(1, sizeof(nego_proto) == protoSz);
-    AssertIntEQ(0, XMEMCMP(nego_proto, proto, protoSz));
+    return err == WOLFSSL_ERROR_WANT_READ ? 0 : err;
 }
 
-static void verify_ALPN_matching_spdy2(WOLFSSL* ssl)
+static void test_admission_finish(WOLFSSL* ssl_c, WOLFSSL* ssl_s)
 {
-    /* spdy/2 */
-    char nego_proto[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x32};
-    char *proto;
-    word16 protoSz = 0;
-
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_GetProtocol(ssl, &proto, &protoSz));
+    int ret_c;
+    int ret_s;
+    int i;
 
-    /* check value */
-    AssertIntEQ(1, sizeof(nego_proto) == protoSz);
-    AssertIntEQ(0, XMEMCMP(nego_proto, proto, protoSz));
+    for (i = 0; i < 10; i++) {
+        ret_c = wolfSSL_connect(ssl_c);
+        ret_s = wolfSSL_accept(ssl_s);
+        if (ret_c == WOLFSSL_SUCCESS && ret_s == WOLFSSL_SUCCESS)
+            break;
+    }
+    AssertIntLT(i, 10);
 }
 
-static void verify_ALPN_client_list(WOLFSSL* ssl)
+static WOLFSSL_CTX* test_admission_server_ctx(wolfSSL_method_func method)
 {
-    /* http/1.1,spdy/1,spdy/2,spdy/3 */
-    char alpn_list[] = {0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e, 0x31, 0x2c,
-                        0x73, 0x70, 0x64, 0x79, 0x2f, 0x31, 0x2c,
-                        0x73, 0x70, 0x64, 0x79, 0x2f, 0x32, 0x2c,
-                        0x73, 0x70, 0x64, 0x79, 0x2f, 0x33};
-    char    *clist = NULL;
-    word16  clistSz = 0;
-
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_GetPeerProtocol(ssl, &clist,
-                                                          &clistSz));
+    WOLFSSL_CTX* ctx;
 
-    /* check value */
-    AssertIntEQ(1, sizeof(alpn_list) == clistSz);
-    AssertIntEQ(0, XMEMCMP(alpn_list, clist, clistSz));
+    AssertNotNull(ctx = wolfSSL_CTX_new(method(NULL)));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+    wolfSSL_SetIORecv(ctx, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx, test_memio_write_cb);
+    AssertIntEQ(wolfSSL_CTX_set_handshake_admission(ctx, 1, 0, 0),
+                WOLFSSL_SUCCESS);
 
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_ALPN_FreePeerProtocol(ssl, &clist));
+    return ctx;
 }
+#endif
 
-static void test_wolfSSL_UseALPN_connection(void)
+static void test_wolfSSL_CTX_set_handshake_admission(void)
 {
-    unsigned long i;
-    callback_functions callbacks[] = {
-        /* success case same list */
-        {0, 0, use_ALPN_all, 0, 0},
-        {0, 0, use_ALPN_all, verify_ALPN_matching_http1, 0},
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    WOLFSSL_CTX* ctx;
+    WOLFSSL_ADMISSION_STATS stats;
+#ifdef HAVE_MEMIO_TEST
+    WOLFSSL_CTX*    ctx_c;
+    WOLFSSL*        ssl_c[2];
+    WOLFSSL*        ssl_s[2];
+    test_memio_ctx* mem;
+#if defined(WOLFSSL_CLIENT_HELLO_CB) || defined(OPENSSL_ALL)
+    WOLFSSL_CTX*    ctx2;
+#endif
+#if !defined(WOLFSSL_NO_TLS12) && !defined(NO_SESSION_CACHE) && \
+    !defined(NO_CLIENT_CACHE)
+    WOLFSSL*        ssl_r[2];
+    WOLFSSL_SESSION* sess;
+#endif
+#endif
 
-        /* success case only one for server */
-        {0, 0, use_ALPN_all, 0, 0},
-        {0, 0, use_ALPN_one, verify_ALPN_matching_spdy2, 0},
+    printf(testingFmt, "wolfSSL_CTX_set_handshake_admission()");
 
-        /* success case only one for client */
-        {0, 0, use_ALPN_one, 0, 0},
-        {0, 0, use_ALPN_all, verify_ALPN_matching_spdy2, 0},
+    AssertIntEQ(wolfSSL_CTX_set_handshake_admission(NULL, 1, 0, 0),
+                BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(NULL, &stats),
+                BAD_FUNC_ARG);
+#ifndef NO_WOLFSSL_CLIENT
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfSSLv23_client_method()));
+    AssertIntEQ(wolfSSL_CTX_set_handshake_admission(ctx, 1, 0, 0),
+                SIDE_ERROR);
+    wolfSSL_CTX_free(ctx);
+#endif
+#ifndef NO_WOLFSSL_SERVER
+    AssertNotNull(ctx = wolfSSL_CTX_new(wolfSSLv23_server_method()));
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, NULL),
+                BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.fullAdmitted + stats.inFlight + stats.rejected, 0);
+    wolfSSL_CTX_free(ctx);
+#endif
 
-        /* success case none for client */
-        {0, 0, 0, 0, 0},
-        {0, 0, use_ALPN_all, 0, 0},
+#ifdef HAVE_MEMIO_TEST
+    AssertNotNull(mem = (test_memio_ctx*)XMALLOC(2 * sizeof(test_memio_ctx),
+                                             NULL, DYNAMIC_TYPE_TMP_BUFFER));
+    XMEMSET(mem, 0, 2 * sizeof(test_memio_ctx));
+
+    AssertNotNull(ctx_c = wolfSSL_CTX_new(wolfSSLv23_client_method()));
+    AssertTrue(wolfSSL_CTX_load_verify_locations(ctx_c, caCertFile, 0));
+    wolfSSL_SetIORecv(ctx_c, test_memio_read_cb);
+    wolfSSL_SetIOSend(ctx_c, test_memio_write_cb);
+    ctx = test_admission_server_ctx(wolfSSLv23_server_method_ex);
+
+    /* One full handshake at a time - the second is refused. */
+    ssl_c[0] = test_memio_new_ssl(ctx_c, &mem[0]);
+    ssl_s[0] = test_memio_new_ssl(ctx, &mem[0]);
+    ssl_c[1] = test_memio_new_ssl(ctx_c, &mem[1]);
+    ssl_s[1] = test_memio_new_ssl(ctx, &mem[1]);
+    AssertIntEQ(test_admission_start(ssl_c[0], ssl_s[0]), 0);
+    AssertIntEQ(test_admission_start(ssl_c[1], ssl_s[1]),
+                HANDSHAKE_ADMISSION_E);
+    test_admission_finish(ssl_c[0], ssl_s[0]);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.fullAdmitted, 1);
+    AssertIntEQ(stats.rejected, 1);
+    AssertIntEQ(stats.completed, 1);
+    AssertIntEQ(stats.inFlight, 0);
+    wolfSSL_free(ssl_s[1]);
+    wolfSSL_free(ssl_c[1]);
+    wolfSSL_free(ssl_s[0]);
+    wolfSSL_free(ssl_c[0]);
+
+    /* Deferring - the second goes ahead once the first is done. */
+    AssertIntEQ(wolfSSL_CTX_set_handshake_admission(ctx, 1, 0, 1),
+                WOLFSSL_SUCCESS);
+    XMEMSET(mem, 0, 2 * sizeof(test_memio_ctx));
+    ssl_c[0] = test_memio_new_ssl(ctx_c, &mem[0]);
+    ssl_s[0] = test_memio_new_ssl(ctx, &mem[0]);
+    ssl_c[1] = test_memio_new_ssl(ctx_c, &mem[1]);
+    ssl_s[1] = test_memio_new_ssl(ctx, &mem[1]);
+    AssertIntEQ(test_admission_start(ssl_c[0], ssl_s[0]), 0);
+    AssertIntEQ(test_admission_start(ssl_c[1], ssl_s[1]),
+                HANDSHAKE_ADMISSION_WANT);
+    AssertIntEQ(mem[1].s2cLen, 0);
+    AssertIntNE(wolfSSL_accept(ssl_s[1]), WOLFSSL_SUCCESS);
+    AssertIntEQ(wolfSSL_get_error(ssl_s[1], WOLFSSL_FATAL_ERROR),
+                HANDSHAKE_ADMISSION_WANT);
+    test_admission_finish(ssl_c[0], ssl_s[0]);
+    test_admission_finish(ssl_c[1], ssl_s[1]);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.fullAdmitted, 3);
+    AssertIntEQ(stats.deferred, 1);
+    AssertIntEQ(stats.completed, 3);
+    AssertIntEQ(stats.inFlight, 0);
+    wolfSSL_free(ssl_s[1]);
+    wolfSSL_free(ssl_c[1]);
+    wolfSSL_free(ssl_s[0]);
+    wolfSSL_free(ssl_c[0]);
+
+    /* Abandoned handshake no longer counted once freed. */
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+    ssl_c[0] = test_memio_new_ssl(ctx_c, &mem[0]);
+    ssl_s[0] = test_memio_new_ssl(ctx, &mem[0]);
+    AssertIntEQ(test_admission_start(ssl_c[0], ssl_s[0]), 0);
+    wolfSSL_free(ssl_s[0]);
+    wolfSSL_free(ssl_c[0]);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.inFlight, 0);
+    AssertIntEQ(stats.completed, 3);
+
+#if defined(WOLFSSL_CLIENT_HELLO_CB) || defined(OPENSSL_ALL)
+    /* Counted off the CTX that admitted it when moved to another CTX, which
+     * is kept while the handshake runs. */
+    ctx2 = test_admission_server_ctx(wolfSSLv23_server_method_ex);
+    XMEMSET(mem, 0, sizeof(test_memio_ctx));
+    ssl_c[0] = test_memio_new_ssl(ctx_c, &mem[0]);
+    ssl_s[0] = test_memio_new_ssl(ctx, &mem[0]);
+    AssertIntEQ(test_admission_start(ssl_c[0], ssl_s[0]), 0);
+    AssertTrue(wolfSSL_set_SSL_CTX(ssl_s[0], ctx2) == ctx2);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.inFlight, 1);
+    test_admission_finish(ssl_c[0], ssl_s[0]);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.inFlight, 0);
+    AssertIntEQ(stats.completed, 4);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx2, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.inFlight, 0);
+    AssertIntEQ(stats.completed, 0);
+    wolfSSL_free(ssl_s[0]);
+    wolfSSL_free(ssl_c[0]);
+    wolfSSL_CTX_free(ctx2);
+#endif
+    wolfSSL_CTX_free(ctx);
 
-        /* success case mismatch behavior but option 'continue' set */
-        {0, 0, use_ALPN_all_continue, verify_ALPN_not_matching_continue, 0},
-        {0, 0, use_ALPN_unknown_continue, 0, 0},
+#if !defined(WOLFSSL_NO_TLS12) && !defined(NO_SESSION_CACHE) && \
+    !defined(NO_CLIENT_CACHE)
+    /* A resumption goes ahead while a full handshake is running. */
+    ctx = test_admission_server_ctx(wolfTLSv1_2_server_method_ex);
+    XMEMSET(mem, 0, 2 * sizeof(test_memio_ctx));
+    ssl_c[0] = test_memio_new_ssl(ctx_c, &mem[0]);
+    ssl_s[0] = test_memio_new_ssl(ctx, &mem[0]);
+    test_admission_finish(ssl_c[0], ssl_s[0]);
+    AssertNotNull(sess = wolfSSL_get_session(ssl_c[0]));
+
+    XMEMSET(mem, 0, 2 * sizeof(test_memio_ctx));
+    ssl_c[1] = test_memio_new_ssl(ctx_c, &mem[0]);
+    ssl_s[1] = test_memio_new_ssl(ctx, &mem[0]);
+    ssl_r[0] = test_memio_new_ssl(ctx_c, &mem[1]);
+    ssl_r[1] = test_memio_new_ssl(ctx, &mem[1]);
+    AssertIntEQ(wolfSSL_set_session(ssl_r[0], sess), WOLFSSL_SUCCESS);
+    AssertIntEQ(test_admission_start(ssl_c[1], ssl_s[1]), 0);
+    AssertIntEQ(test_admission_start(ssl_r[0], ssl_r[1]), 0);
+    test_admission_finish(ssl_r[0], ssl_r[1]);
+    AssertIntEQ(wolfSSL_session_reused(ssl_r[1]), 1);
+    test_admission_finish(ssl_c[1], ssl_s[1]);
+    AssertIntEQ(wolfSSL_CTX_get_handshake_admission_stats(ctx, &stats),
+                WOLFSSL_SUCCESS);
+    AssertIntEQ(stats.fullAdmitted, 2);
+    AssertIntEQ(stats.resumed, 1);
+    AssertIntEQ(stats.rejected, 0);
+    wolfSSL_free(ssl_r[1]);
+    wolfSSL_free(ssl_r[0]);
+    wolfSSL_free(ssl_s[1]);
+    wolfSSL_free(ssl_c[1]);
+    wolfSSL_free(ssl_s[0]);
+    wolfSSL_free(ssl_c[0]);
+    wolfSSL_CTX_free(ctx);
+#endif
 
-        /* success case read protocol send by client */
-        {0, 0, use_ALPN_all, 0, 0},
-        {0, 0, use_ALPN_one, verify_ALPN_client_list, 0},
+    wolfSSL_CTX_free(ctx_c);
+    XFREE(mem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+#endif
 
-        /* mismatch behavior with same list
-         * the first and only this one must be taken */
-        {0, 0, use_ALPN_all, 0, 0},
-        {0, 0, use_ALPN_all, verify_ALPN_not_matching_spdy3, 0},
+    printf(resultFmt, passed);
+#endif
+}
 
-        /* default mismatch behavior */
-        {0, 0, use_ALPN_all, 0, 0},
-        {0, 0, use_ALPN_unknown, verify_ALPN_FATAL_ERROR_on_client, 0},
-    };
+#if defined(WOLFSSL_DTLS_DEMUX) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && !defined(NO_RSA) && !defined(NO_FILESYSTEM)
+#define TEST_DTLS_SEQ_MAX           16
+/* type, version, epoch, sequence number and length */
+#define TEST_DTLS_RECORD_HEADER_SZ  13
+#define TEST_DTLS_HANDSHAKE         22
+#define TEST_DTLS_CLIENT_HELLO       1
+#define TEST_DTLS_SERVER_HELLO       2
+#define TEST_DTLS_HELLO_VERIFY       3
+
+/* Epoch 0 handshake records seen by a client of the demultiplexer. */
+typedef struct test_dtls_seq {
+    byte   sent;
+    byte   msgType;
+    word16 seqHi;
+    word32 seqLo;
+} test_dtls_seq;
+
+static test_dtls_seq dtlsSeq[TEST_DTLS_SEQ_MAX];
+static int           dtlsSeqCnt = 0;
+
+static void test_dtls_seq_log(const char* data, int sz, byte sent)
+{
+    const byte* buf = (const byte*)data;
+    int idx = 0;
+    int len;
 
-    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
-        callbacks[i    ].method = wolfSSLv23_client_method;
-        callbacks[i + 1].method = wolfSSLv23_server_method;
-        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+    while (idx + TEST_DTLS_RECORD_HEADER_SZ < sz) {
+        len = (buf[idx + 11] << 8) | buf[idx + 12];
+        if (buf[idx] == TEST_DTLS_HANDSHAKE && buf[idx + 3] == 0 &&
+                buf[idx + 4] == 0 && dtlsSeqCnt < TEST_DTLS_SEQ_MAX) {
+            dtlsSeq[dtlsSeqCnt].sent    = sent;
+            dtlsSeq[dtlsSeqCnt].msgType =
+                                         buf[idx + TEST_DTLS_RECORD_HEADER_SZ];
+            dtlsSeq[dtlsSeqCnt].seqHi   = (word16)((buf[idx + 5] << 8) |
+                                                   buf[idx + 6]);
+            dtlsSeq[dtlsSeqCnt].seqLo   = ((word32)buf[idx + 7] << 24) |
+                                          ((word32)buf[idx + 8] << 16) |
+                                          ((word32)buf[idx + 9] <<  8) |
+                                           (word32)buf[idx + 10];
+            dtlsSeqCnt++;
+        }
+        idx += TEST_DTLS_RECORD_HEADER_SZ + len;
     }
 }
 
-static void test_wolfSSL_UseALPN_params(void)
+static int test_dtls_seq_recv(WOLFSSL* ssl, char* buf, int sz, void* ctx)
 {
-#ifndef NO_WOLFSSL_CLIENT
-    /* "http/1.1" */
-    char http1[] = {0x68, 0x74, 0x74, 0x70, 0x2f, 0x31, 0x2e, 0x31};
-    /* "spdy/1" */
-    char spdy1[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x31};
-    /* "spdy/2" */
-    char spdy2[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x32};
-    /* "spdy/3" */
-    char spdy3[] = {0x73, 0x70, 0x64, 0x79, 0x2f, 0x33};
-    char buff[256];
-    word32 idx;
+    int ret = EmbedReceiveFrom(ssl, buf, sz, ctx);
 
-    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
-    WOLFSSL     *ssl = wolfSSL_new(ctx);
+    if (ret > 0)
+        test_dtls_seq_log(buf, ret, 0);
 
-    AssertNotNull(ctx);
-    AssertNotNull(ssl);
+    return ret;
+}
 
-    /* error cases */
-    AssertIntNE(WOLFSSL_SUCCESS,
-                wolfSSL_UseALPN(NULL, http1, sizeof(http1),
-                                WOLFSSL_ALPN_FAILED_ON_MISMATCH));
-    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, NULL, 0,
-                                             WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+static int test_dtls_seq_send(WOLFSSL* ssl, char* buf, int sz, void* ctx)
+{
+    test_dtls_seq_log(buf, sz, 1);
 
-    /* success case */
-    /* http1 only */
-    AssertIntEQ(WOLFSSL_SUCCESS,
-                wolfSSL_UseALPN(ssl, http1, sizeof(http1),
-                                WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+    return EmbedSendTo(ssl, buf, sz, ctx);
+}
 
-    /* http1, spdy1 */
-    XMEMCPY(buff, http1, sizeof(http1));
-    idx = sizeof(http1);
-    buff[idx++] = ',';
-    XMEMCPY(buff+idx, spdy1, sizeof(spdy1));
-    idx += sizeof(spdy1);
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, buff, idx,
-                                             WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+static int test_dtls_demux_refuse(WOLFSSL* ssl, int* alert, void* arg)
+{
+    (void)ssl;
+    (void)arg;
 
-    /* http1, spdy2, spdy1 */
-    XMEMCPY(buff, http1, sizeof(http1));
-    idx = sizeof(http1);
-    buff[idx++] = ',';
-    XMEMCPY(buff+idx, spdy2, sizeof(spdy2));
-    idx += sizeof(spdy2);
-    buff[idx++] = ',';
-    XMEMCPY(buff+idx, spdy1, sizeof(spdy1));
-    idx += sizeof(spdy1);
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, buff, idx,
-                                             WOLFSSL_ALPN_FAILED_ON_MISMATCH));
+    *alert = unrecognized_name;
+    return WOLFSSL_CLIENT_HELLO_ERROR;
+}
+#endif
 
-    /* spdy3, http1, spdy2, spdy1 */
-    XMEMCPY(buff, spdy3, sizeof(spdy3));
-    idx = sizeof(spdy3);
-    buff[idx++] = ',';
-    XMEMCPY(buff+idx, http1, sizeof(http1));
-    idx += sizeof(http1);
-    buff[idx++] = ',';
-    XMEMCPY(buff+idx, spdy2, sizeof(spdy2));
-    idx += sizeof(spdy2);
-    buff[idx++] = ',';
-    XMEMCPY(buff+idx, spdy1, sizeof(spdy1));
-    idx += sizeof(spdy1);
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_UseALPN(ssl, buff, idx,
-                                             WOLFSSL_ALPN_CONTINUE_ON_MISMATCH));
+/* Reads all waiting datagrams, echoing application data to its session. */
+static void test_dtls_demux_drain(WOLFSSL_DTLS_DEMUXER* demux)
+{
+    WOLFSSL* ssl;
+    char     buf[64];
+    int      ret;
 
-    wolfSSL_free(ssl);
-    wolfSSL_CTX_free(ctx);
-#endif
+    while ((ret = wolfSSL_DtlsDemuxRead(demux, &ssl, buf,
+                                        (int)sizeof(buf))) != WANT_READ) {
+        AssertIntGE(ret, 0);
+        if (ret > 0) {
+            AssertNotNull(ssl);
+            AssertIntEQ(wolfSSL_write(ssl, buf, ret), ret);
+        }
+    }
 }
-#endif /* HAVE_ALPN  */
+#endif
 
-static void test_wolfSSL_UseALPN(void)
-{
-#ifdef HAVE_ALPN
-    test_wolfSSL_UseALPN_connection();
-    test_wolfSSL_UseALPN_params();
+static void test_wolfSSL_DtlsDemux(void)
+{
+#if defined(WOLFSSL_DTLS_DEMUX) && !defined(NO_WOLFSSL_CLIENT) && \
+    !defined(NO_WOLFSSL_SERVER) && !defined(NO_RSA) && !defined(NO_FILESYSTEM)
+    WOLFSSL_CTX*          ctx_c;
+    WOLFSSL_CTX*          ctx_s;
+    WOLFSSL_DTLS_DEMUXER* demux;
+    WOLFSSL*              ssl_c[3];
+    WOLFSSL*              ssl;
+    SOCKET_T              sd_s;
+    SOCKET_T              sd_c[3];
+    word16                port = 0;
+    int                   done[3] = { 0, 0, 0 };
+    char                  msg[16];
+    char                  reply[16];
+    int                   ret;
+    int                   round;
+    int                   i;
+    word32                seq;
+
+    printf(testingFmt, "wolfSSL_DtlsDemux()");
+
+    AssertNotNull(ctx_c = wolfSSL_CTX_new(wolfDTLSv1_2_client_method()));
+    wolfSSL_CTX_set_verify(ctx_c, WOLFSSL_VERIFY_NONE, 0);
+    AssertNotNull(ctx_s = wolfSSL_CTX_new(wolfDTLSv1_2_server_method()));
+    AssertTrue(wolfSSL_CTX_use_certificate_file(ctx_s, svrCertFile,
+                                                WOLFSSL_FILETYPE_PEM));
+    AssertTrue(wolfSSL_CTX_use_PrivateKey_file(ctx_s, svrKeyFile,
+                                               WOLFSSL_FILETYPE_PEM));
+
+    AssertNull(wolfSSL_DtlsDemuxNew(NULL, 0, 0));
+    AssertNull(wolfSSL_DtlsDemuxNew(ctx_c, 0, 0));
+    AssertIntEQ(wolfSSL_DtlsDemuxCount(NULL), 0);
+    AssertIntEQ(wolfSSL_DtlsDemuxRead(NULL, &ssl, msg, sizeof(msg)),
+                BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_DtlsDemuxRemove(NULL, NULL), BAD_FUNC_ARG);
+    wolfSSL_DtlsDemuxFree(NULL);
+
+    tcp_listen(&sd_s, &port, 0, 1, 0);
+    tcp_set_nonblocking(&sd_s);
+    /* room for two peers only */
+    AssertNotNull(demux = wolfSSL_DtlsDemuxNew(ctx_s, sd_s, 2));
+    AssertIntEQ(wolfSSL_DtlsDemuxRead(demux, &ssl, msg, sizeof(msg)),
+                WANT_READ);
+
+    for (i = 0; i < 3; i++) {
+        AssertNotNull(ssl_c[i] = wolfSSL_new(ctx_c));
+        tcp_connect(&sd_c[i], wolfSSLIP, port, 1, 0, ssl_c[i]);
+        tcp_set_nonblocking(&sd_c[i]);
+        AssertIntEQ(wolfSSL_set_fd(ssl_c[i], sd_c[i]), WOLFSSL_SUCCESS);
+        wolfSSL_dtls_set_using_nonblock(ssl_c[i], 1);
+    }
+    dtlsSeqCnt = 0;
+    wolfSSL_SSLSetIORecv(ssl_c[0], test_dtls_seq_recv);
+    wolfSSL_SSLSetIOSend(ssl_c[0], test_dtls_seq_send);
+
+    for (round = 0; round < 10; round++) {
+        for (i = 0; i < 3; i++) {
+            if (!done[i] && wolfSSL_connect(ssl_c[i]) == WOLFSSL_SUCCESS)
+                done[i] = 1;
+        }
+        test_dtls_demux_drain(demux);
+        /* first ClientHellos are answered without a session */
+        if (round == 0)
+            AssertIntEQ(wolfSSL_DtlsDemuxCount(demux), 0);
+    }
+    AssertIntEQ(done[0], 1);
+    AssertIntEQ(done[1], 1);
+    AssertIntEQ(done[2], 0);
+    AssertIntEQ(wolfSSL_DtlsDemuxCount(demux), 2);
+
+    /* HelloVerifyRequest has the number of the first ClientHello and the
+     * session answering the second ClientHello goes on from its number */
+    AssertIntGE(dtlsSeqCnt, 4);
+    AssertIntEQ(dtlsSeq[0].sent, 1);
+    AssertIntEQ(dtlsSeq[0].msgType, TEST_DTLS_CLIENT_HELLO);
+    AssertIntEQ(dtlsSeq[1].sent, 0);
+    AssertIntEQ(dtlsSeq[1].msgType, TEST_DTLS_HELLO_VERIFY);
+    AssertIntEQ(dtlsSeq[1].seqHi, dtlsSeq[0].seqHi);
+    AssertIntEQ(dtlsSeq[1].seqLo, dtlsSeq[0].seqLo);
+    AssertIntEQ(dtlsSeq[2].sent, 1);
+    AssertIntEQ(dtlsSeq[2].msgType, TEST_DTLS_CLIENT_HELLO);
+    AssertIntGT(dtlsSeq[2].seqLo, dtlsSeq[0].seqLo);
+    AssertIntEQ(dtlsSeq[3].sent, 0);
+    AssertIntEQ(dtlsSeq[3].msgType, TEST_DTLS_SERVER_HELLO);
+    AssertIntEQ(dtlsSeq[3].seqHi, dtlsSeq[2].seqHi);
+    AssertIntEQ(dtlsSeq[3].seqLo, dtlsSeq[2].seqLo);
+    seq = dtlsSeq[3].seqLo;
+    for (i = 4; i < dtlsSeqCnt; i++) {
+        if (!dtlsSeq[i].sent) {
+            AssertIntEQ(dtlsSeq[i].seqHi, dtlsSeq[3].seqHi);
+            AssertIntGT(dtlsSeq[i].seqLo, seq);
+            seq = dtlsSeq[i].seqLo;
+        }
+    }
+
+    /* each peer gets its own data back from its session */
+    for (i = 0; i < 2; i++) {
+        XSNPRINTF(msg, sizeof(msg), "peer %d", i);
+        AssertIntEQ(wolfSSL_write(ssl_c[i], msg, (int)XSTRLEN(msg)),
+                    (int)XSTRLEN(msg));
+    }
+    test_dtls_demux_drain(demux);
+    for (i = 0; i < 2; i++) {
+        XSNPRINTF(msg, sizeof(msg), "peer %d", i);
+        XMEMSET(reply, 0, sizeof(reply));
+        AssertIntEQ(wolfSSL_read(ssl_c[i], reply, sizeof(reply)),
+                    (int)XSTRLEN(msg));
+        AssertStrEQ(reply, msg);
+    }
+
+    /* close_notify fails the session, which is then removed */
+    wolfSSL_shutdown(ssl_c[0]);
+    ret = wolfSSL_DtlsDemuxRead(demux, &ssl, msg, sizeof(msg));
+    AssertIntEQ(ret, WOLFSSL_FATAL_ERROR);
+    AssertNotNull(ssl);
+    AssertIntEQ(wolfSSL_get_error(ssl, 0), WOLFSSL_ERROR_ZERO_RETURN);
+    AssertIntEQ(wolfSSL_DtlsDemuxRemove(demux, ssl), WOLFSSL_SUCCESS);
+    AssertIntEQ(wolfSSL_DtlsDemuxCount(demux), 1);
+
+    /* the third peer gets the free place when it sends again */
+    AssertIntEQ(wolfSSL_dtls_got_timeout(ssl_c[2]), WOLFSSL_SUCCESS);
+    for (round = 0; round < 10; round++) {
+        if (!done[2] && wolfSSL_connect(ssl_c[2]) == WOLFSSL_SUCCESS)
+            done[2] = 1;
+        test_dtls_demux_drain(demux);
+    }
+    AssertIntEQ(done[2], 1);
+    AssertIntEQ(wolfSSL_DtlsDemuxCount(demux), 2);
+
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+    /* an alert sent by the session follows the HelloVerifyRequest too, and
+     * so isn't dropped by the peer as a replay */
+    wolfSSL_DtlsDemuxFree(demux);
+    CloseSocket(sd_s);
+    wolfSSL_free(ssl_c[0]);
+    CloseSocket(sd_c[0]);
+    wolfSSL_CTX_set_client_hello_cb(ctx_s, test_dtls_demux_refuse, NULL);
+
+    port = 0;
+    tcp_listen(&sd_s, &port, 0, 1, 0);
+    tcp_set_nonblocking(&sd_s);
+    AssertNotNull(demux = wolfSSL_DtlsDemuxNew(ctx_s, sd_s, 0));
+    AssertNotNull(ssl_c[0] = wolfSSL_new(ctx_c));
+    tcp_connect(&sd_c[0], wolfSSLIP, port, 1, 0, ssl_c[0]);
+    tcp_set_nonblocking(&sd_c[0]);
+    AssertIntEQ(wolfSSL_set_fd(ssl_c[0], sd_c[0]), WOLFSSL_SUCCESS);
+    wolfSSL_dtls_set_using_nonblock(ssl_c[0], 1);
+
+    ret = WOLFSSL_FATAL_ERROR;
+    for (round = 0; round < 10; round++) {
+        ret = wolfSSL_connect(ssl_c[0]);
+        if (wolfSSL_get_error(ssl_c[0], ret) != WOLFSSL_ERROR_WANT_READ)
+            break;
+        while (wolfSSL_DtlsDemuxRead(demux, &ssl, msg, sizeof(msg)) !=
+                                                                  WANT_READ) {
+        }
+    }
+    AssertIntLT(round, 10);
+    AssertIntEQ(wolfSSL_get_error(ssl_c[0], ret), FATAL_ERROR);
+#endif
+
+    wolfSSL_DtlsDemuxFree(demux);
+    for (i = 0; i < 3; i++) {
+        wolfSSL_free(ssl_c[i]);
+        CloseSocket(sd_c[i]);
+    }
+    CloseSocket(sd_s);
+    wolfSSL_CTX_free(ctx_s);
+    wolfSSL_CTX_free(ctx_c);
+
+    printf(resultFmt, passed);
 #endif
 }
 
-static void test_wolfSSL_DisableExtendedMasterSecret(void)
+static void test_wolfSSL_key_share_pool_stats(void)
 {
-#if defined(HAVE_EXTENDED_MASTER) && !defined(NO_WOLFSSL_CLIENT)
-    WOLFSSL_CTX *ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
-    WOLFSSL     *ssl = wolfSSL_new(ctx);
-
-    AssertNotNull(ctx);
-    AssertNotNull(ssl);
+#ifdef WOLFSSL_KEY_SHARE_POOL
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+#if !defined(NO_WOLFSSL_CLIENT) && !defined(NO_WOLFSSL_SERVER) && \
+    defined(HAVE_IO_TESTS_DEPENDENCIES)
+    unsigned int used;
+    unsigned long i;
+    callback_functions callbacks[] = {
+        {wolfSSLv23_client_method, 0, 0, 0, 0},
+        {wolfSSLv23_server_method, 0, 0, 0, 0},
+#ifndef WOLFSSL_NO_TLS12
+        {wolfTLSv1_2_client_method, 0, 0, 0, 0},
+        {wolfTLSv1_2_server_method, 0, 0, 0, 0},
+#endif
+    };
+#endif
 
-    /* error cases */
-    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_CTX_DisableExtendedMasterSecret(NULL));
-    AssertIntNE(WOLFSSL_SUCCESS, wolfSSL_DisableExtendedMasterSecret(NULL));
+    AssertIntEQ(wolfSSL_key_share_pool_stats(NULL, &misses), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_key_share_pool_stats(&hits, NULL), BAD_FUNC_ARG);
+    AssertIntEQ(wolfSSL_key_share_pool_stats(&hits, &misses),
+                WOLFSSL_SUCCESS);
 
-    /* success cases */
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_CTX_DisableExtendedMasterSecret(ctx));
-    AssertIntEQ(WOLFSSL_SUCCESS, wolfSSL_DisableExtendedMasterSecret(ssl));
+#if !defined(NO_WOLFSSL_CLIENT) && !defined(NO_WOLFSSL_SERVER) && \
+    defined(HAVE_IO_TESTS_DEPENDENCIES)
+    /* Each ephemeral key of both sides is taken from the pool or counted as
+     * a miss. */
+    for (i = 0; i < sizeof(callbacks) / sizeof(callback_functions); i += 2) {
+        used = hits + misses;
+        test_wolfSSL_client_server(&callbacks[i], &callbacks[i + 1]);
+        AssertIntEQ(wolfSSL_key_share_pool_stats(&hits, &misses),
+                    WOLFSSL_SUCCESS);
+        AssertIntGE(hits + misses, used + 2);
+    }
+#endif
 
-    wolfSSL_free(ssl);
-    wolfSSL_CTX_free(ctx);
+    /* A forked child starts with an empty pool of its own. */
+    {
+        pid_t pid;
+        int   status;
+
+        pid = fork();
+        AssertIntGE(pid, 0);
+        if (pid == 0) {
+            if (wolfSSL_key_share_pool_stats(&hits, &misses) !=
+                    WOLFSSL_SUCCESS || hits != 0 || misses != 0) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        AssertIntEQ(waitpid(pid, &status, 0), pid);
+        AssertTrue(WIFEXITED(status));
+        AssertIntEQ(WEXITSTATUS(status), 0);
+        AssertIntEQ(wolfSSL_key_share_pool_stats(&hits, &misses),
+                    WOLFSSL_SUCCESS);
+    }
 #endif
 }
 
@@ -24439,13 +27361,38 @@ void ApiTest(void)
 
     /* TLS extensions tests */
     test_wolfSSL_UseSNI();
+    test_wolfSSL_CTX_set_client_hello_cb();
     test_wolfSSL_UseTrustedCA();
     test_wolfSSL_UseMaxFragment();
     test_wolfSSL_UseTruncatedHMAC();
     test_wolfSSL_UseSupportedCurve();
     test_wolfSSL_UseALPN();
+#ifdef HAVE_TLSX_INDEX_TEST
+    test_wolfSSL_TLSX_Index();
+#endif
     test_wolfSSL_DisableExtendedMasterSecret();
 
+    /* record layer tests */
+    test_wolfSSL_read_ahead();
+    test_wolfSSL_release_buffers();
+    test_wolfSSL_GetMemoryUsage();
+    test_wolfSSL_UseKTLS();
+    test_wolfSSL_sendfile();
+    test_wolfSSL_set_dynamic_record_size();
+    test_wolfSSL_CTX_cert_msg_cache();
+    test_wolfSSL_get_handshake_timing();
+    test_wolfSSL_set_lazy_handshake_hash();
+    test_wolfSSL_Rehandshake_hmac_cache();
+    test_wolfSSL_CBC_stitch();
+    test_wolfSSL_MatchSuite();
+    test_wolfSSL_CTX_set_early_data_anti_replay();
+    test_wolfSSL_key_share_pool_stats();
+    test_wolfSSL_CTX_get_hrr_stats();
+    test_wolfSSL_UseCertCompression();
+    test_wolfSSL_UseRecordSizeLimit();
+    test_wolfSSL_CTX_set_handshake_admission();
+    test_wolfSSL_DtlsDemux();
+
     /* X509 tests */
     test_wolfSSL_X509_NAME_get_entry();
     test_wolfSSL_PKCS12();
@@ -165,7 +165,11 @@
 #include <wolfssl/wolfcrypt/types.h>
 
 #ifdef WOLFSSL_ASYNC_CRYPT
-    #include <wolfssl/wolfcrypt/async.h>
+    #ifdef WOLFSSL_ASYNC_CRYPT_SW
+        #include <wolfssl/wolfcrypt/async_sw.h>
+    #else
+        #include <wolfssl/wolfcrypt/async.h>
+    #endif
 #endif
 
 
@@ -0,0 +1,879 @@
+/* async_sw.c
+ *
+ * Copyright (C) 2006-2019 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Software asynchronous crypto device.
+ *
+ * The device registers a crypto callback. A public key operation on an object
+ * using the device id is copied into a job, queued to the worker pool and
+ * WC_PENDING_E is returned. A worker runs the operation with the normal
+ * software implementation (the callback declines operations made on a worker
+ * thread) and marks the job done. Polling the event reports the result:
+ *
+ *  - RSA and key generation keep their own state, so the result is copied to
+ *    the caller's output when the completion is reported.
+ *  - ECDH and ECDSA have no state of their own. With
+ *    WC_ASYNC_FLAG_CALL_AGAIN the job is kept and the result is handed to
+ *    the repeated call, otherwise it is copied out when reported.
+ *
+ * Outputs of an operation must stay valid until its completion is reported,
+ * and an object, including the RNG passed in, must not be freed or reused
+ * while its operation is pending.
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include <wolfssl/wolfcrypt/settings.h>
+
+#if defined(WOLFSSL_ASYNC_CRYPT) && defined(WOLFSSL_ASYNC_CRYPT_SW)
+
+#include <wolfssl/wolfcrypt/async_sw.h>
+#include <wolfssl/wolfcrypt/cryptocb.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#ifdef NO_INLINE
+    #include <wolfssl/wolfcrypt/misc.h>
+#else
+    #define WOLFSSL_MISC_INCLUDED
+    #include <wolfcrypt/src/misc.c>
+#endif
+
+#include <unistd.h>
+#include <sched.h>
+
+
+enum {
+    ASYNC_SW_JOB_QUEUED = 0,
+    ASYNC_SW_JOB_DONE   = 1,
+};
+
+typedef struct WC_ASYNC_SW_JOB {
+    struct WC_ASYNC_SW_JOB* next;
+    void*           heap;
+    wc_CryptoInfo   info;       /* operation with pointers into data */
+    int             state;      /* protected by the pool lock */
+    int             ret;        /* result of the operation */
+    int             res;        /* ECDSA verify result */
+    byte*           out;        /* output in data */
+    word32          outSz;      /* output length */
+    byte*           callerOut;  /* where the output is copied to */
+    word32*         callerOutSz;
+    int*            callerRes;
+#ifndef NO_RSA
+    RsaKey*         callerKey;
+    RsaKey*         rsaKey;     /* copy of the key the worker operates on */
+#endif
+    byte            data[1];    /* copied input followed by the output */
+} WC_ASYNC_SW_JOB;
+
+typedef struct AsyncSwPool {
+    pthread_mutex_t     lock;
+    pthread_cond_t      jobCond;    /* signalled when a job is queued */
+    pthread_cond_t      doneCond;   /* signalled when a job is done */
+    WC_ASYNC_SW_JOB*    head;
+    WC_ASYNC_SW_JOB*    tail;
+    pthread_t           threads[WC_ASYNC_SW_MAX_THREADS];
+    int                 threadCount;
+    int                 openCount;
+    int                 stop;
+} AsyncSwPool;
+
+static AsyncSwPool gAsyncSw = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    NULL, NULL, { 0 }, 0, 0, 0
+};
+/* serializes opening and closing the device */
+static pthread_mutex_t gAsyncSwOpenLock = PTHREAD_MUTEX_INITIALIZER;
+static int gAsyncSwThreads = WC_ASYNC_SW_THREADS;
+static pthread_key_t  gAsyncSwWorkerKey;
+static pthread_once_t gAsyncSwKeyOnce = PTHREAD_ONCE_INIT;
+
+
+static void AsyncSwMakeKey(void)
+{
+    (void)pthread_key_create(&gAsyncSwWorkerKey, NULL);
+}
+
+static WC_INLINE int AsyncSwIsWorker(void)
+{
+    return pthread_getspecific(gAsyncSwWorkerKey) != NULL;
+}
+
+/* Run the operation with the software implementation. */
+static int AsyncSwDoJob(wc_CryptoInfo* info)
+{
+    int ret = CRYPTOCB_UNAVAILABLE;
+
+    switch (info->pk.type) {
+    #ifndef NO_RSA
+        case WC_PK_TYPE_RSA:
+            ret = wc_RsaFunction(info->pk.rsa.in, info->pk.rsa.inLen,
+                info->pk.rsa.out, info->pk.rsa.outLen, info->pk.rsa.type,
+                info->pk.rsa.key, info->pk.rsa.rng);
+            break;
+        #ifdef WOLFSSL_KEY_GEN
+        case WC_PK_TYPE_RSA_KEYGEN:
+            ret = wc_MakeRsaKey(info->pk.rsakg.key, info->pk.rsakg.size,
+                info->pk.rsakg.e, info->pk.rsakg.rng);
+            break;
+        #endif
+    #endif /* !NO_RSA */
+    #ifdef HAVE_ECC
+        case WC_PK_TYPE_EC_KEYGEN:
+            ret = wc_ecc_make_key_ex(info->pk.eckg.rng, info->pk.eckg.size,
+                info->pk.eckg.key, info->pk.eckg.curveId);
+            break;
+        #ifdef HAVE_ECC_DHE
+        case WC_PK_TYPE_ECDH:
+            ret = wc_ecc_shared_secret(info->pk.ecdh.private_key,
+                info->pk.ecdh.public_key, info->pk.ecdh.out,
+                info->pk.ecdh.outlen);
+            break;
+        #endif
+        #ifdef HAVE_ECC_SIGN
+        case WC_PK_TYPE_ECDSA_SIGN:
+            ret = wc_ecc_sign_hash(info->pk.eccsign.in, info->pk.eccsign.inlen,
+                info->pk.eccsign.out, info->pk.eccsign.outlen,
+                info->pk.eccsign.rng, info->pk.eccsign.key);
+            break;
+        #endif
+        #ifdef HAVE_ECC_VERIFY
+        case WC_PK_TYPE_ECDSA_VERIFY:
+            ret = wc_ecc_verify_hash(info->pk.eccverify.sig,
+                info->pk.eccverify.siglen, info->pk.eccverify.hash,
+                info->pk.eccverify.hashlen, info->pk.eccverify.res,
+                info->pk.eccverify.key);
+            break;
+        #endif
+    #endif /* HAVE_ECC */
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+static void* AsyncSwWorker(void* arg)
+{
+    AsyncSwPool* pool = (AsyncSwPool*)arg;
+    WC_ASYNC_SW_JOB* job;
+    int ret;
+
+    (void)pthread_setspecific(gAsyncSwWorkerKey, pool);
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->head == NULL && !pool->stop)
+            pthread_cond_wait(&pool->jobCond, &pool->lock);
+        /* queued jobs are still run when stopping */
+        job = pool->head;
+        if (job == NULL)
+            break;
+        pool->head = job->next;
+        if (pool->head == NULL)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        ret = AsyncSwDoJob(&job->info);
+
+        pthread_mutex_lock(&pool->lock);
+        job->ret = ret;
+        job->state = ASYNC_SW_JOB_DONE;
+        pthread_cond_broadcast(&pool->doneCond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* Start the worker threads. Open lock must be held. */
+static int AsyncSwStart(AsyncSwPool* pool)
+{
+    int i, count = gAsyncSwThreads;
+
+    if (count <= 0)
+        count = wc_AsyncGetNumberOfCpus();
+    if (count > WC_ASYNC_SW_MAX_THREADS)
+        count = WC_ASYNC_SW_MAX_THREADS;
+
+    pthread_once(&gAsyncSwKeyOnce, AsyncSwMakeKey);
+
+    pool->stop = 0;
+    for (i = 0; i < count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, AsyncSwWorker, pool) != 0)
+            break;
+    }
+    pool->threadCount = i;
+    if (i == 0) {
+        WOLFSSL_MSG("Async worker thread create failed");
+        return ASYNC_INIT_E;
+    }
+
+    return 0;
+}
+
+/* Run the queued jobs and stop the worker threads. Open lock must be held. */
+static void AsyncSwStop(AsyncSwPool* pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->jobCond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->threadCount; i++)
+        pthread_join(pool->threads[i], NULL);
+    pool->threadCount = 0;
+}
+
+static int AsyncSwJobIsDone(WC_ASYNC_SW_JOB* job)
+{
+    int done;
+
+    pthread_mutex_lock(&gAsyncSw.lock);
+    done = (job->state == ASYNC_SW_JOB_DONE);
+    pthread_mutex_unlock(&gAsyncSw.lock);
+
+    return done;
+}
+
+static void AsyncSwJobWait(WC_ASYNC_SW_JOB* job)
+{
+    pthread_mutex_lock(&gAsyncSw.lock);
+    while (job->state != ASYNC_SW_JOB_DONE)
+        pthread_cond_wait(&gAsyncSw.doneCond, &gAsyncSw.lock);
+    pthread_mutex_unlock(&gAsyncSw.lock);
+}
+
+static void AsyncSwJobFree(WC_ASYNC_DEV* dev)
+{
+    WC_ASYNC_SW_JOB* job = dev->job;
+
+    dev->job = NULL;
+#ifndef NO_RSA
+    if (job->rsaKey != NULL) {
+        wc_FreeRsaKey(job->rsaKey);
+        XFREE(job->rsaKey, job->heap, DYNAMIC_TYPE_RSA);
+    }
+#endif
+    XFREE(job, job->heap, DYNAMIC_TYPE_ASYNC);
+}
+
+/* Copy the result of a done job out and free it.
+ *
+ * info  Repeated call to take the output pointers from, or NULL to use the
+ *       outputs of the call that queued the job.
+ * Returns the result of the operation.
+ */
+static int AsyncSwJobFinish(WC_ASYNC_DEV* dev, wc_CryptoInfo* info)
+{
+    WC_ASYNC_SW_JOB* job = dev->job;
+    byte*   out   = job->callerOut;
+    word32* outSz = job->callerOutSz;
+    int*    res   = job->callerRes;
+    int     ret   = job->ret;
+
+    if (info != NULL) {
+        switch (info->pk.type) {
+        #ifdef HAVE_ECC
+            case WC_PK_TYPE_ECDH:
+                out   = info->pk.ecdh.out;
+                outSz = info->pk.ecdh.outlen;
+                break;
+            case WC_PK_TYPE_ECDSA_SIGN:
+                out   = info->pk.eccsign.out;
+                outSz = info->pk.eccsign.outlen;
+                break;
+            case WC_PK_TYPE_ECDSA_VERIFY:
+                res   = info->pk.eccverify.res;
+                break;
+        #endif
+            default:
+                break;
+        }
+    }
+
+    if (ret >= 0) {
+        if (out != NULL && outSz != NULL) {
+            if (job->outSz > *outSz)
+                ret = BUFFER_E;
+            else {
+                XMEMCPY(out, job->out, job->outSz);
+                *outSz = job->outSz;
+            }
+        }
+        if (res != NULL)
+            *res = job->res;
+    }
+#ifndef NO_RSA
+    else if (job->info.pk.type == WC_PK_TYPE_RSA) {
+        /* the key is not called again to clean up */
+        wc_RsaAsyncReset(job->callerKey);
+    }
+#endif
+
+    AsyncSwJobFree(dev);
+
+    return ret;
+}
+
+/* Report the completion of a done job.
+ *
+ * The job is kept for the repeated call when the caller calls again with an
+ * operation that has no state of its own.
+ */
+static int AsyncSwJobReport(WC_ASYNC_DEV* dev, word32 flags)
+{
+    WC_ASYNC_SW_JOB* job = dev->job;
+
+    if (job->ret >= 0 && (flags & WC_ASYNC_FLAG_CALL_AGAIN)) {
+        switch (job->info.pk.type) {
+            case WC_PK_TYPE_ECDH:
+            case WC_PK_TYPE_ECDSA_SIGN:
+            case WC_PK_TYPE_ECDSA_VERIFY:
+                return job->ret;
+            default:
+                break;
+        }
+    }
+
+    return AsyncSwJobFinish(dev, NULL);
+}
+
+/* Returns the device context of the object the operation is made with, or
+ * NULL when the operation is not run by the worker pool. */
+static WC_ASYNC_DEV* AsyncSwGetDev(wc_CryptoInfo* info)
+{
+    switch (info->pk.type) {
+    #ifndef NO_RSA
+        case WC_PK_TYPE_RSA:
+            return &info->pk.rsa.key->asyncDev;
+        #ifdef WOLFSSL_KEY_GEN
+        case WC_PK_TYPE_RSA_KEYGEN:
+            return &info->pk.rsakg.key->asyncDev;
+        #endif
+    #endif /* !NO_RSA */
+    #ifdef HAVE_ECC
+        case WC_PK_TYPE_EC_KEYGEN:
+            return &info->pk.eckg.key->asyncDev;
+        #ifdef HAVE_ECC_DHE
+        case WC_PK_TYPE_ECDH:
+            return &info->pk.ecdh.private_key->asyncDev;
+        #endif
+        #ifdef HAVE_ECC_SIGN
+        case WC_PK_TYPE_ECDSA_SIGN:
+            return &info->pk.eccsign.key->asyncDev;
+        #endif
+        #ifdef HAVE_ECC_VERIFY
+        case WC_PK_TYPE_ECDSA_VERIFY:
+            return &info->pk.eccverify.key->asyncDev;
+        #endif
+    #endif /* HAVE_ECC */
+        default:
+            break;
+    }
+
+    return NULL;
+}
+
+#ifndef NO_RSA
+/* Make a copy of the key for the worker. The numbers are copied, not shared,
+ * so that the copy doesn't depend on how the math library holds them and its
+ * private parts are zeroized when the job is freed. */
+static int AsyncSwRsaKeyCopy(RsaKey* dst, RsaKey* src, void* heap)
+{
+    int ret;
+
+    ret = wc_InitRsaKey_ex(dst, heap, INVALID_DEVID);
+    if (ret != 0)
+        return ret;
+
+    ret = mp_copy(&src->n, &dst->n);
+    if (ret == MP_OKAY)
+        ret = mp_copy(&src->e, &dst->e);
+#ifndef WOLFSSL_RSA_PUBLIC_ONLY
+    if (ret == MP_OKAY)
+        ret = mp_copy(&src->d, &dst->d);
+    if (ret == MP_OKAY)
+        ret = mp_copy(&src->p, &dst->p);
+    if (ret == MP_OKAY)
+        ret = mp_copy(&src->q, &dst->q);
+#if defined(WOLFSSL_KEY_GEN) || defined(OPENSSL_EXTRA) || !defined(RSA_LOW_MEM)
+    if (ret == MP_OKAY)
+        ret = mp_copy(&src->dP, &dst->dP);
+    if (ret == MP_OKAY)
+        ret = mp_copy(&src->dQ, &dst->dQ);
+    if (ret == MP_OKAY)
+        ret = mp_copy(&src->u, &dst->u);
+#endif
+#endif
+    if (ret != MP_OKAY) {
+        wc_FreeRsaKey(dst);
+        return MP_INIT_E;
+    }
+    dst->type = src->type;
+#ifdef WC_RSA_BLINDING
+    dst->rng = src->rng;
+#endif
+
+    return 0;
+}
+#endif
+
+/* Copy the operation into a job and queue it to the workers. */
+static int AsyncSwJobQueue(AsyncSwPool* pool, WC_ASYNC_DEV* dev,
+    wc_CryptoInfo* info)
+{
+    WC_ASYNC_SW_JOB* job;
+    wc_CryptoInfo* jobInfo;
+    const byte* in  = NULL;
+    const byte* in2 = NULL;
+    word32 inSz = 0, in2Sz = 0, outSz = 0;
+
+    switch (info->pk.type) {
+    #ifndef NO_RSA
+        case WC_PK_TYPE_RSA:
+            in    = info->pk.rsa.in;
+            inSz  = info->pk.rsa.inLen;
+            outSz = *info->pk.rsa.outLen;
+            break;
+    #endif
+    #ifdef HAVE_ECC
+        case WC_PK_TYPE_ECDH:
+            outSz = *info->pk.ecdh.outlen;
+            break;
+        case WC_PK_TYPE_ECDSA_SIGN:
+            in    = info->pk.eccsign.in;
+            inSz  = info->pk.eccsign.inlen;
+            outSz = *info->pk.eccsign.outlen;
+            break;
+        case WC_PK_TYPE_ECDSA_VERIFY:
+            in    = info->pk.eccverify.sig;
+            inSz  = info->pk.eccverify.siglen;
+            in2   = info->pk.eccverify.hash;
+            in2Sz = info->pk.eccverify.hashlen;
+            break;
+    #endif
+        default:
+            /* key generation works on the key itself */
+            break;
+    }
+
+    job = (WC_ASYNC_SW_JOB*)XMALLOC(sizeof(WC_ASYNC_SW_JOB) + inSz + in2Sz +
+                                    outSz, dev->heap, DYNAMIC_TYPE_ASYNC);
+    if (job == NULL)
+        return MEMORY_E;
+    XMEMSET(job, 0, sizeof(WC_ASYNC_SW_JOB));
+    job->heap = dev->heap;
+    job->state = ASYNC_SW_JOB_QUEUED;
+    XMEMCPY(&job->info, info, sizeof(wc_CryptoInfo));
+    if (in != NULL)
+        XMEMCPY(job->data, in, inSz);
+    if (in2 != NULL)
+        XMEMCPY(job->data + inSz, in2, in2Sz);
+    job->out = job->data + inSz + in2Sz;
+    job->outSz = outSz;
+#ifndef NO_RSA
+    if (info->pk.type == WC_PK_TYPE_RSA) {
+        /* the caller keeps the operation state in the key, so the worker
+         * works on a copy that only it uses */
+        int ret;
+
+        job->rsaKey = (RsaKey*)XMALLOC(sizeof(RsaKey), dev->heap,
+                                       DYNAMIC_TYPE_RSA);
+        if (job->rsaKey == NULL) {
+            XFREE(job, dev->heap, DYNAMIC_TYPE_ASYNC);
+            return MEMORY_E;
+        }
+        ret = AsyncSwRsaKeyCopy(job->rsaKey, info->pk.rsa.key, dev->heap);
+        if (ret != 0) {
+            XFREE(job->rsaKey, dev->heap, DYNAMIC_TYPE_RSA);
+            XFREE(job, dev->heap, DYNAMIC_TYPE_ASYNC);
+            return ret;
+        }
+    }
+#endif
+
+    /* point the operation at the job's copies */
+    jobInfo = &job->info;
+    switch (info->pk.type) {
+    #ifndef NO_RSA
+        case WC_PK_TYPE_RSA:
+            jobInfo->pk.rsa.in     = job->data;
+            jobInfo->pk.rsa.out    = job->out;
+            jobInfo->pk.rsa.outLen = &job->outSz;
+            jobInfo->pk.rsa.key    = job->rsaKey;
+            job->callerKey   = info->pk.rsa.key;
+            job->callerOut   = info->pk.rsa.out;
+            job->callerOutSz = info->pk.rsa.outLen;
+            break;
+    #endif
+    #ifdef HAVE_ECC
+        case WC_PK_TYPE_ECDH:
+            jobInfo->pk.ecdh.out    = job->out;
+            jobInfo->pk.ecdh.outlen = &job->outSz;
+            job->callerOut   = info->pk.ecdh.out;
+            job->callerOutSz = info->pk.ecdh.outlen;
+            break;
+        case WC_PK_TYPE_ECDSA_SIGN:
+            jobInfo->pk.eccsign.in     = job->data;
+            jobInfo->pk.eccsign.out    = job->out;
+            jobInfo->pk.eccsign.outlen = &job->outSz;
+            job->callerOut   = info->pk.eccsign.out;
+            job->callerOutSz = info->pk.eccsign.outlen;
+            break;
+        case WC_PK_TYPE_ECDSA_VERIFY:
+            jobInfo->pk.eccverify.sig  = job->data;
+            jobInfo->pk.eccverify.hash = job->data + inSz;
+            jobInfo->pk.eccverify.res  = &job->res;
+            job->callerRes = info->pk.eccverify.res;
+            break;
+    #endif
+        default:
+            break;
+    }
+
+    dev->job = job;
+    dev->event.dev.async = dev;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail != NULL)
+        pool->tail->next = job;
+    else
+        pool->head = job;
+    pool->tail = job;
+    pthread_cond_signal(&pool->jobCond);
+    pthread_mutex_unlock(&pool->lock);
+
+    return WC_PENDING_E;
+}
+
+/* Crypto callback of the software device. */
+static int AsyncSwCryptoCb(int devId, wc_CryptoInfo* info, void* ctx)
+{
+    AsyncSwPool* pool = (AsyncSwPool*)ctx;
+    WC_ASYNC_DEV* dev;
+
+    (void)devId;
+
+    /* workers run the operation with the software implementation */
+    if (info == NULL || info->algo_type != WC_ALGO_TYPE_PK || AsyncSwIsWorker())
+        return CRYPTOCB_UNAVAILABLE;
+    dev = AsyncSwGetDev(info);
+    if (dev == NULL)
+        return CRYPTOCB_UNAVAILABLE;
+
+    if (dev->job != NULL) {
+        if (dev->job->info.pk.type == info->pk.type) {
+            if (!AsyncSwJobIsDone(dev->job))
+                return WC_PENDING_E;
+            /* called again once done, hand back the result */
+            return AsyncSwJobFinish(dev, info);
+        }
+        /* result of a different operation that was not collected */
+        WOLFSSL_MSG("Async discarding uncollected job");
+        AsyncSwJobWait(dev->job);
+        AsyncSwJobFree(dev);
+    }
+
+    return AsyncSwJobQueue(pool, dev, info);
+}
+
+
+/* Device */
+
+int wolfAsync_HardwareStart(void)
+{
+    /* worker threads are started when the device is opened */
+    return 0;
+}
+
+void wolfAsync_HardwareStop(void)
+{
+    pthread_mutex_lock(&gAsyncSwOpenLock);
+    if (gAsyncSw.openCount > 0) {
+        gAsyncSw.openCount = 0;
+        wc_CryptoCb_UnRegisterDevice(WC_ASYNC_SW_DEVID);
+        AsyncSwStop(&gAsyncSw);
+    }
+    pthread_mutex_unlock(&gAsyncSwOpenLock);
+}
+
+int wolfAsync_DevOpen(int* devId)
+{
+    int ret = 0;
+
+    WOLFSSL_ENTER("wolfAsync_DevOpen");
+
+    if (devId == NULL)
+        return BAD_FUNC_ARG;
+
+    pthread_mutex_lock(&gAsyncSwOpenLock);
+    if (gAsyncSw.openCount == 0)
+        ret = AsyncSwStart(&gAsyncSw);
+    if (ret == 0) {
+        /* registered on each open as wolfCrypt_Init resets the devices */
+        ret = wc_CryptoCb_RegisterDevice(WC_ASYNC_SW_DEVID, AsyncSwCryptoCb,
+                                         &gAsyncSw);
+        if (ret == 0)
+            gAsyncSw.openCount++;
+        else if (gAsyncSw.openCount == 0)
+            AsyncSwStop(&gAsyncSw);
+    }
+    pthread_mutex_unlock(&gAsyncSwOpenLock);
+
+    *devId = (ret == 0) ? WC_ASYNC_SW_DEVID : INVALID_DEVID;
+
+    return ret;
+}
+
+int wolfAsync_DevOpenThread(int* devId, void* threadId)
+{
+    /* the worker pool is shared by all threads */
+    (void)threadId;
+
+    return wolfAsync_DevOpen(devId);
+}
+
+void wolfAsync_DevClose(int* devId)
+{
+    if (devId == NULL || *devId != WC_ASYNC_SW_DEVID)
+        return;
+
+    pthread_mutex_lock(&gAsyncSwOpenLock);
+    if (gAsyncSw.openCount > 0 && --gAsyncSw.openCount == 0) {
+        wc_CryptoCb_UnRegisterDevice(WC_ASYNC_SW_DEVID);
+        AsyncSwStop(&gAsyncSw);
+    }
+    pthread_mutex_unlock(&gAsyncSwOpenLock);
+
+    *devId = INVALID_DEVID;
+}
+
+int wolfAsync_SetThreadCount(int count)
+{
+    int ret = 0;
+
+    if (count < 0)
+        return BAD_FUNC_ARG;
+
+    pthread_mutex_lock(&gAsyncSwOpenLock);
+    if (gAsyncSw.openCount > 0)
+        ret = BAD_STATE_E;
+    else
+        gAsyncSwThreads = count;
+    pthread_mutex_unlock(&gAsyncSwOpenLock);
+
+    return ret;
+}
+
+
+/* Device context */
+
+int wolfAsync_DevCtxInit(WC_ASYNC_DEV* asyncDev, word32 marker, void* heap,
+    int devId)
+{
+    (void)devId;
+
+    if (asyncDev == NULL)
+        return BAD_FUNC_ARG;
+
+    XMEMSET(asyncDev, 0, sizeof(WC_ASYNC_DEV));
+    asyncDev->marker = marker;
+    asyncDev->heap = heap;
+
+    return 0;
+}
+
+void wolfAsync_DevCtxFree(WC_ASYNC_DEV* asyncDev, word32 marker)
+{
+    (void)marker;
+
+    if (asyncDev == NULL || asyncDev->job == NULL)
+        return;
+
+    /* the worker may still be using the object */
+    AsyncSwJobWait(asyncDev->job);
+    AsyncSwJobFree(asyncDev);
+}
+
+int wolfAsync_DevCopy(WC_ASYNC_DEV* src, WC_ASYNC_DEV* dst)
+{
+    if (src == NULL || dst == NULL)
+        return BAD_FUNC_ARG;
+
+    /* a pending operation belongs to the source only */
+    dst->job = NULL;
+    XMEMSET(&dst->event, 0, sizeof(WOLF_EVENT));
+
+    return 0;
+}
+
+
+/* Events */
+
+int wolfAsync_EventInit(WOLF_EVENT* event, WOLF_EVENT_TYPE type, void* context,
+    word32 flags)
+{
+    int ret = wolfEvent_Init(event, type, context);
+    if (ret == 0)
+        event->flags = flags;
+
+    return ret;
+}
+
+int wolfAsync_EventPoll(WOLF_EVENT* event, WOLF_EVENT_FLAG flags)
+{
+    WC_ASYNC_DEV* dev;
+
+    (void)flags;
+
+    if (event == NULL)
+        return BAD_FUNC_ARG;
+    if (event->state != WOLF_EVENT_STATE_PENDING)
+        return 0;
+
+    dev = event->dev.async;
+    if (dev == NULL || dev->job == NULL) {
+        /* nothing outstanding */
+        event->ret = 0;
+        event->state = WOLF_EVENT_STATE_DONE;
+    }
+    else if (AsyncSwJobIsDone(dev->job)) {
+        event->ret = AsyncSwJobReport(dev, event->flags);
+        event->state = WOLF_EVENT_STATE_DONE;
+    }
+
+    return 0;
+}
+
+int wolfAsync_EventPop(WOLF_EVENT* event, WOLF_EVENT_TYPE type)
+{
+    int ret;
+
+    if (event == NULL)
+        return BAD_FUNC_ARG;
+    if (event->type != type)
+        return WC_NOT_PENDING_E;
+
+    if (event->state == WOLF_EVENT_STATE_DONE) {
+        ret = event->ret;
+        event->state = WOLF_EVENT_STATE_READY;
+    }
+    else if (event->state == WOLF_EVENT_STATE_PENDING)
+        ret = WC_PENDING_E;
+    else
+        ret = WC_NOT_PENDING_E;
+
+    return ret;
+}
+
+int wolfAsync_EventQueuePush(WOLF_EVENT_QUEUE* queue, WOLF_EVENT* event)
+{
+    if (queue == NULL || event == NULL)
+        return BAD_FUNC_ARG;
+
+    event->state = WOLF_EVENT_STATE_PENDING;
+
+    return wolfEventQueue_Push(queue, event);
+}
+
+int wolfAsync_EventQueuePoll(WOLF_EVENT_QUEUE* queue, void* context_filter,
+    WOLF_EVENT** events, int maxEvents, WOLF_EVENT_FLAG flags, int* eventCount)
+{
+    return wolfEventQueue_Poll(queue, context_filter, events, maxEvents, flags,
+                               eventCount);
+}
+
+
+/* Helpers for wolfCrypt callers */
+
+int wc_AsyncHandle(WC_ASYNC_DEV* asyncDev, WOLF_EVENT_QUEUE* queue,
+    word32 flags)
+{
+    int ret;
+
+    if (asyncDev == NULL || queue == NULL)
+        return BAD_FUNC_ARG;
+
+    ret = wolfAsync_EventInit(&asyncDev->event, WOLF_EVENT_TYPE_ASYNC_WOLFCRYPT,
+                              asyncDev, flags);
+    if (ret == 0) {
+        asyncDev->event.dev.async = asyncDev;
+        ret = wolfAsync_EventQueuePush(queue, &asyncDev->event);
+    }
+
+    return ret;
+}
+
+int wc_AsyncWait(int ret, WC_ASYNC_DEV* asyncDev, word32 flags)
+{
+    if (ret != WC_PENDING_E)
+        return ret;
+    if (asyncDev == NULL)
+        return BAD_FUNC_ARG;
+    if (asyncDev->job == NULL) {
+        WOLFSSL_MSG("Async wait with no operation pending");
+        return BAD_STATE_E;
+    }
+
+    AsyncSwJobWait(asyncDev->job);
+
+    return AsyncSwJobReport(asyncDev, flags);
+}
+
+
+/* Threading */
+
+int wc_AsyncGetNumberOfCpus(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (cpus > 0) ? (int)cpus : 1;
+}
+
+int wc_AsyncThreadCreate(pthread_t* thread, AsyncThreadFunc_t func, void* arg)
+{
+    if (thread == NULL || func == NULL)
+        return BAD_FUNC_ARG;
+
+    return (pthread_create(thread, NULL, func, arg) == 0) ? 0 : ASYNC_INIT_E;
+}
+
+int wc_AsyncThreadJoin(pthread_t* thread)
+{
+    if (thread == NULL)
+        return BAD_FUNC_ARG;
+
+    return (pthread_join(*thread, NULL) == 0) ? 0 : BAD_STATE_E;
+}
+
+void wc_AsyncThreadYield(void)
+{
+    (void)sched_yield();
+}
+
+#endif /* WOLFSSL_ASYNC_CRYPT && WOLFSSL_ASYNC_CRYPT_SW */
@@ -1346,6 +1346,89 @@ int wc_HashGetFlags(wc_HashAlg* hash, enum wc_HashType type, word32* flags)
     #define P_HASH_MAX_SIZE WC_SHA256_DIGEST_SIZE
 #endif
 
+#ifdef WOLFSSL_HMAC_PADS
+/* P_hash with the key pads of the secret hashed once for all the HMACs.
+ *
+ * len       The size of the hash output.
+ * previous  Buffer for A(i) of hash output size.
+ * current   Buffer for an HMAC output of hash output size.
+ */
+static int P_HashPads(byte* result, word32 resLen, const byte* secret,
+                      word32 secLen, const byte* seed, word32 seedLen,
+                      int hash, word32 len, byte* previous, byte* current,
+                      void* heap)
+{
+    word32 idx = 0;
+    word32 left;
+    int    ret;
+#ifdef WOLFSSL_SMALL_STACK
+    HmacPads*   pads;
+    wc_HashAlg* hmac;
+#else
+    HmacPads    pads[1];
+    wc_HashAlg  hmac[1];
+#endif
+
+#ifdef WOLFSSL_SMALL_STACK
+    pads = (HmacPads*)XMALLOC(sizeof(HmacPads), heap, DYNAMIC_TYPE_HMAC);
+    hmac = (wc_HashAlg*)XMALLOC(sizeof(wc_HashAlg), heap, DYNAMIC_TYPE_HMAC);
+
+    if (pads == NULL || hmac == NULL) {
+        if (pads) XFREE(pads, heap, DYNAMIC_TYPE_HMAC);
+        if (hmac) XFREE(hmac, heap, DYNAMIC_TYPE_HMAC);
+
+        return MEMORY_E;
+    }
+#endif
+    (void)heap;
+
+    ret = wc_HmacPadsSetKey(pads, hash, secret, secLen);
+    /* A1 = HMAC(secret, A0 = seed) */
+    if (ret == 0)
+        ret = wc_HmacPadsStart(pads, hmac);
+    if (ret == 0)
+        ret = wc_HmacPadsUpdate(pads, hmac, seed, seedLen);
+    if (ret == 0)
+        ret = wc_HmacPadsFinal(pads, hmac, previous);
+
+    while (ret == 0) {
+        /* HMAC(secret, Ai | seed) */
+        ret = wc_HmacPadsStart(pads, hmac);
+        if (ret == 0)
+            ret = wc_HmacPadsUpdate(pads, hmac, previous, len);
+        if (ret == 0)
+            ret = wc_HmacPadsUpdate(pads, hmac, seed, seedLen);
+        if (ret == 0)
+            ret = wc_HmacPadsFinal(pads, hmac, current);
+        if (ret != 0)
+            break;
+
+        left = min(resLen - idx, len);
+        XMEMCPY(&result[idx], current, left);
+        idx += left;
+        if (idx == resLen)
+            break;
+
+        /* Ai+1 = HMAC(secret, Ai) */
+        ret = wc_HmacPadsStart(pads, hmac);
+        if (ret == 0)
+            ret = wc_HmacPadsUpdate(pads, hmac, previous, len);
+        if (ret == 0)
+            ret = wc_HmacPadsFinal(pads, hmac, previous);
+    }
+
+    wc_HmacPadsFree(pads);
+    ForceZero(hmac, sizeof(wc_HashAlg));
+
+#ifdef WOLFSSL_SMALL_STACK
+    XFREE(pads, heap, DYNAMIC_TYPE_HMAC);
+    XFREE(hmac, heap, DYNAMIC_TYPE_HMAC);
+#endif
+
+    return ret;
+}
+#endif /* WOLFSSL_HMAC_PADS */
+
 /* Pseudo Random Function for MD5, SHA-1, SHA-256, or SHA-384 */
 int wc_PRF(byte* result, word32 resLen, const byte* secret,
                   word32 secLen, const byte* seed, word32 seedLen, int hash,
@@ -1421,8 +1504,15 @@ int wc_PRF(byte* result, word32 resLen, const byte* secret,
 
     lastTime = times - 1;
 
-    ret = wc_HmacInit(hmac, heap, devId);
-    if (ret == 0) {
+#ifdef WOLFSSL_HMAC_PADS
+    /* Devices are given the secret to do the HMACs. */
+    if (devId == INVALID_DEVID) {
+        ret = P_HashPads(result, resLen, secret, secLen, seed, seedLen, hash,
+                         len, previous, current, heap);
+    }
+    else
+#endif
+    if ((ret = wc_HmacInit(hmac, heap, devId)) == 0) {
         ret = wc_HmacSetKey(hmac, hash, secret, secLen);
         if (ret == 0)
             ret = wc_HmacUpdate(hmac, seed, seedLen); /* A0 = seed */
@@ -1224,6 +1224,217 @@ int wolfSSL_GetHmacMaxSize(void)
     return WC_MAX_DIGEST_SIZE;
 }
 
+#ifdef WOLFSSL_HMAC_PADS
+/* Copy a hash state with the Copy function of the hash, which handles hash
+ * state held by hardware.
+ *
+ * type  The hash algorithm type.
+ * src   The hash state to copy.
+ * dst   The hash state to copy into.
+ * returns 0 on success, otherwise failure.
+ */
+static int HmacPadsCopy(int type, const wc_HashAlg* src, wc_HashAlg* dst)
+{
+    wc_HashAlg* hash = (wc_HashAlg*)src;
+    int         ret = HASH_TYPE_E;
+
+    switch (type) {
+    #ifndef NO_MD5
+        case WC_MD5:
+            ret = wc_Md5Copy(&hash->md5, &dst->md5);
+            break;
+    #endif
+    #ifndef NO_SHA
+        case WC_SHA:
+            ret = wc_ShaCopy(&hash->sha, &dst->sha);
+            break;
+    #endif
+    #ifdef WOLFSSL_SHA224
+        case WC_SHA224:
+            ret = wc_Sha224Copy(&hash->sha224, &dst->sha224);
+            break;
+    #endif
+    #ifndef NO_SHA256
+        case WC_SHA256:
+            ret = wc_Sha256Copy(&hash->sha256, &dst->sha256);
+            break;
+    #endif
+    #ifdef WOLFSSL_SHA384
+        case WC_SHA384:
+            ret = wc_Sha384Copy(&hash->sha384, &dst->sha384);
+            break;
+    #endif
+    #ifdef WOLFSSL_SHA512
+        case WC_SHA512:
+            ret = wc_Sha512Copy(&hash->sha512, &dst->sha512);
+            break;
+    #endif
+    #ifdef WOLFSSL_SHA3
+        #ifndef WOLFSSL_NOSHA3_224
+        case WC_SHA3_224:
+            ret = wc_Sha3_224_Copy(&hash->sha3, &dst->sha3);
+            break;
+        #endif
+        #ifndef WOLFSSL_NOSHA3_256
+        case WC_SHA3_256:
+            ret = wc_Sha3_256_Copy(&hash->sha3, &dst->sha3);
+            break;
+        #endif
+        #ifndef WOLFSSL_NOSHA3_384
+        case WC_SHA3_384:
+            ret = wc_Sha3_384_Copy(&hash->sha3, &dst->sha3);
+            break;
+        #endif
+        #ifndef WOLFSSL_NOSHA3_512
+        case WC_SHA3_512:
+            ret = wc_Sha3_512_Copy(&hash->sha3, &dst->sha3);
+            break;
+        #endif
+    #endif
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+/* Hash the inner and outer key pads once for computing many HMACs with a key.
+ *
+ * pads   The key pad hash states.
+ * type   The hash algorithm type. BLAKE2b not supported.
+ * key    The HMAC key.
+ * keySz  The size of the key.
+ * returns 0 on success, otherwise failure.
+ */
+int wc_HmacPadsSetKey(HmacPads* pads, int type, const byte* key, word32 keySz)
+{
+    Hmac hmac;
+    int  blockSz;
+    int  ret;
+
+    if (pads == NULL)
+        return BAD_FUNC_ARG;
+
+    XMEMSET(pads, 0, sizeof(HmacPads));
+    if (type == BLAKE2B_ID)
+        return BAD_FUNC_ARG;
+
+    blockSz = wc_HashGetBlockSize((enum wc_HashType)type);
+    pads->digestSz = wc_HmacSizeByType(type);
+    pads->type = type;
+    if (blockSz <= 0 || pads->digestSz <= 0)
+        return BAD_FUNC_ARG;
+
+    ret = wc_HmacInit(&hmac, NULL, INVALID_DEVID);
+    if (ret != 0)
+        return ret;
+
+    /* Set key puts the key XORed with the pads into ipad and opad. */
+    ret = wc_HmacSetKey(&hmac, type, key, keySz);
+    if (ret == 0)
+        ret = wc_HashInit(&pads->inner, (enum wc_HashType)type);
+    if (ret == 0)
+        ret = wc_HashUpdate(&pads->inner, (enum wc_HashType)type,
+                            (byte*)hmac.ipad, blockSz);
+    if (ret == 0)
+        ret = wc_HashInit(&pads->outer, (enum wc_HashType)type);
+    if (ret == 0)
+        ret = wc_HashUpdate(&pads->outer, (enum wc_HashType)type,
+                            (byte*)hmac.opad, blockSz);
+
+    wc_HmacFree(&hmac);
+    ForceZero(&hmac, sizeof(hmac));
+
+    return ret;
+}
+
+/* Start an HMAC with the inner key pad already hashed.
+ * The hash state is freed by wc_HmacPadsFinal() or on error.
+ *
+ * pads  The key pad hash states.
+ * hash  The hash state to use for the HMAC.
+ * returns 0 on success, otherwise failure.
+ */
+int wc_HmacPadsStart(const HmacPads* pads, wc_HashAlg* hash)
+{
+    int ret;
+
+    ret = HmacPadsCopy(pads->type, &pads->inner, hash);
+    if (ret != 0)
+        wc_HashFree(hash, (enum wc_HashType)pads->type);
+
+    return ret;
+}
+
+/* Add data to an HMAC started with wc_HmacPadsStart().
+ *
+ * pads  The key pad hash states.
+ * hash  The hash state of the HMAC, freed on error.
+ * data  The data to MAC.
+ * sz    The size of the data.
+ * returns 0 on success, otherwise failure.
+ */
+int wc_HmacPadsUpdate(const HmacPads* pads, wc_HashAlg* hash,
+                      const byte* data, word32 sz)
+{
+    int ret;
+
+    if (sz == 0)
+        return 0;
+
+    ret = wc_HashUpdate(hash, (enum wc_HashType)pads->type, data, sz);
+    if (ret != 0)
+        wc_HashFree(hash, (enum wc_HashType)pads->type);
+
+    return ret;
+}
+
+/* Finish an HMAC with the outer key pad already hashed.
+ *
+ * pads  The key pad hash states.
+ * hash  The hash state of the HMAC, freed on return.
+ * out   The buffer to hold the HMAC of the digest size.
+ * returns 0 on success, otherwise failure.
+ */
+int wc_HmacPadsFinal(const HmacPads* pads, wc_HashAlg* hash, byte* out)
+{
+    byte innerHash[WC_MAX_DIGEST_SIZE];
+    int  ret;
+
+    ret = wc_HashFinal(hash, (enum wc_HashType)pads->type, innerHash);
+    wc_HashFree(hash, (enum wc_HashType)pads->type);
+    if (ret == 0) {
+        ret = HmacPadsCopy(pads->type, &pads->outer, hash);
+        if (ret == 0) {
+            ret = wc_HashUpdate(hash, (enum wc_HashType)pads->type,
+                                innerHash, pads->digestSz);
+        }
+        if (ret == 0)
+            ret = wc_HashFinal(hash, (enum wc_HashType)pads->type, out);
+        wc_HashFree(hash, (enum wc_HashType)pads->type);
+    }
+
+    ForceZero(innerHash, sizeof(innerHash));
+
+    return ret;
+}
+
+/* Free and clear the key pad hash states.
+ *
+ * pads  The key pad hash states.
+ */
+void wc_HmacPadsFree(HmacPads* pads)
+{
+    if (pads != NULL) {
+        if (pads->digestSz > 0) {
+            wc_HashFree(&pads->inner, (enum wc_HashType)pads->type);
+            wc_HashFree(&pads->outer, (enum wc_HashType)pads->type);
+        }
+        ForceZero(pads, sizeof(HmacPads));
+    }
+}
+#endif /* WOLFSSL_HMAC_PADS */
+
 #ifdef HAVE_HKDF
     /* HMAC-KDF-Extract.
      * RFC 5869 - HMAC-based Extract-and-Expand Key Derivation Function (HKDF).
@@ -1290,18 +1501,28 @@ int wolfSSL_GetHmacMaxSize(void)
         word32 outIdx = 0;
         word32 hashSz = wc_HmacSizeByType(type);
         byte   n = 0x1;
+    #ifdef WOLFSSL_HMAC_PADS
+        HmacPads pads;
+
+        /* Hash the key pads once when more than one block of output. */
+        if (type != BLAKE2B_ID && outSz > hashSz) {
+            ret = wc_HmacPadsSetKey(&pads, type, inKey, inKeySz);
+            if (ret == 0)
+                ret = wc_HKDF_ExpandPads(&pads, info, infoSz, out, outSz);
+            wc_HmacPadsFree(&pads);
+            return ret;
+        }
+    #endif
 
         ret = wc_HmacInit(&myHmac, NULL, INVALID_DEVID);
         if (ret != 0)
             return ret;
 
-        while (outIdx < outSz) {
+        ret = wc_HmacSetKey(&myHmac, type, inKey, inKeySz);
+        while (ret == 0 && outIdx < outSz) {
             int    tmpSz = (n == 1) ? 0 : hashSz;
             word32 left = outSz - outIdx;
 
-            ret = wc_HmacSetKey(&myHmac, type, inKey, inKeySz);
-            if (ret != 0)
-                break;
             ret = wc_HmacUpdate(&myHmac, tmp, tmpSz);
             if (ret != 0)
                 break;
@@ -1327,6 +1548,55 @@ int wolfSSL_GetHmacMaxSize(void)
         return ret;
     }
 
+#ifdef WOLFSSL_HMAC_PADS
+    /* HMAC-KDF-Expand using the key pad hash states of the pseudo-random key.
+     *
+     * pads     The key pad hash states of the pseudo-random key.
+     * info     The application specific information.
+     * infoSz   The size of the application specific information.
+     * out      The output keying material.
+     * outSz    The size of the output keying material.
+     * returns 0 on success, otherwise failure.
+     */
+    int wc_HKDF_ExpandPads(const HmacPads* pads, const byte* info,
+                           word32 infoSz, byte* out, word32 outSz)
+    {
+        byte       tmp[WC_MAX_DIGEST_SIZE];
+        wc_HashAlg hash;
+        int        ret = 0;
+        word32     outIdx = 0;
+        word32     hashSz = (word32)pads->digestSz;
+        byte       n = 0x1;
+
+        while (ret == 0 && outIdx < outSz) {
+            word32 tmpSz = (n == 1) ? 0 : hashSz;
+            word32 left = outSz - outIdx;
+
+            ret = wc_HmacPadsStart(pads, &hash);
+            if (ret == 0)
+                ret = wc_HmacPadsUpdate(pads, &hash, tmp, tmpSz);
+            if (ret == 0)
+                ret = wc_HmacPadsUpdate(pads, &hash, info, infoSz);
+            if (ret == 0)
+                ret = wc_HmacPadsUpdate(pads, &hash, &n, 1);
+            if (ret == 0)
+                ret = wc_HmacPadsFinal(pads, &hash, tmp);
+            if (ret == 0) {
+                left = min(left, hashSz);
+                XMEMCPY(out+outIdx, tmp, left);
+
+                outIdx += hashSz;
+                n++;
+            }
+        }
+
+        ForceZero(tmp, sizeof(tmp));
+        ForceZero(&hash, sizeof(hash));
+
+        return ret;
+    }
+#endif /* WOLFSSL_HMAC_PADS */
+
     /* HMAC-KDF.
      * RFC 5869 - HMAC-based Extract-and-Expand Key Derivation Function (HKDF).
      *
@@ -249,6 +249,15 @@ static void wc_RsaCleanup(RsaKey* key)
 #endif
 }
 
+#if defined(WOLFSSL_ASYNC_CRYPT) && defined(WOLFSSL_ASYNC_CRYPT_SW)
+/* Return the key to its initial state when a queued operation failed. */
+void wc_RsaAsyncReset(RsaKey* key)
+{
+    key->state = RSA_STATE_NONE;
+    wc_RsaCleanup(key);
+}
+#endif
+
 int wc_InitRsaKey_ex(RsaKey* key, void* heap, int devId)
 {
     int ret = 0;
@@ -517,6 +526,11 @@ int wc_FreeRsaKey(RsaKey* key)
         return BAD_FUNC_ARG;
     }
 
+#if defined(WOLFSSL_ASYNC_CRYPT) && defined(WOLFSSL_ASYNC_CRYPT_SW)
+    /* wait for a worker still using the key */
+    wolfAsync_DevCtxFree(&key->asyncDev, WOLFSSL_ASYNC_MARKER_RSA);
+#endif
+
     wc_RsaCleanup(key);
 
 #if defined(WOLFSSL_ASYNC_CRYPT) && defined(WC_ASYNC_ENABLE_RSA)
@@ -33,7 +33,11 @@
     #include <wolfssl/wolfcrypt/ecc.h>
 #endif
 #ifdef WOLFSSL_ASYNC_CRYPT
-    #include <wolfssl/wolfcrypt/async.h>
+    #ifdef WOLFSSL_ASYNC_CRYPT_SW
+        #include <wolfssl/wolfcrypt/async_sw.h>
+    #else
+        #include <wolfssl/wolfcrypt/async.h>
+    #endif
 #endif
 
 /* IPP header files for library initialization */
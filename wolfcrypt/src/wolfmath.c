@@ -37,7 +37,11 @@
 #if defined(USE_FAST_MATH) || !defined(NO_BIG_INT)
 
 #ifdef WOLFSSL_ASYNC_CRYPT
-    #include <wolfssl/wolfcrypt/async.h>
+    #ifdef WOLFSSL_ASYNC_CRYPT_SW
+        #include <wolfssl/wolfcrypt/async_sw.h>
+    #else
+        #include <wolfssl/wolfcrypt/async.h>
+    #endif
 #endif
 
 #ifdef NO_INLINE
@@ -179,7 +179,11 @@
     #include <wolfssl/wolfcrypt/selftest.h>
 #endif
 #ifdef WOLFSSL_ASYNC_CRYPT
-    #include <wolfssl/wolfcrypt/async.h>
+    #ifdef WOLFSSL_ASYNC_CRYPT_SW
+        #include <wolfssl/wolfcrypt/async_sw.h>
+    #else
+        #include <wolfssl/wolfcrypt/async.h>
+    #endif
 #endif
 #if defined(OPENSSL_EXTRA) || defined(DEBUG_WOLFSSL_VERBOSE)
     #include <wolfssl/wolfcrypt/logging.h>
@@ -278,6 +282,7 @@ int  hmac_sha512_test(void);
 int  hmac_blake2b_test(void);
 int  hmac_sha3_test(void);
 int  hkdf_test(void);
+int  prf_test(void);
 int  x963kdf_test(void);
 int  arc4_test(void);
 int  hc128_test(void);
@@ -392,6 +397,9 @@ int blob_test(void);
 #ifdef WOLF_CRYPTO_CB
 int cryptocb_test(void);
 #endif
+#if defined(WOLFSSL_ASYNC_CRYPT) && defined(WOLFSSL_ASYNC_CRYPT_SW)
+int async_test(void);
+#endif
 #ifdef WOLFSSL_CERT_PIV
 int certpiv_test(void);
 #endif
@@ -725,6 +733,13 @@ initDefaultName();
         else
             test_pass("HMAC-KDF    test passed!\n");
     #endif
+
+    #if defined(WOLFSSL_HAVE_PRF) && !defined(NO_SHA256)
+        if ( (ret = prf_test()) != 0)
+            return err_sys("PRF         test failed!\n", ret);
+        else
+            test_pass("PRF         test passed!\n");
+    #endif
 #endif /* !NO_HMAC */
 
 #if defined(HAVE_X963_KDF) && defined(HAVE_ECC)
@@ -1083,6 +1098,13 @@ initDefaultName();
         test_pass("blob     test passed!\n");
 #endif
 
+#if defined(WOLFSSL_ASYNC_CRYPT) && defined(WOLFSSL_ASYNC_CRYPT_SW)
+    if ( (ret = async_test()) != 0)
+        return err_sys("async    test failed!\n", ret);
+    else
+        test_pass("async    test passed!\n");
+#endif
+
 #ifdef WOLF_CRYPTO_CB
     if ( (ret = cryptocb_test()) != 0)
         return err_sys("crypto callback test failed!\n", ret);
@@ -15230,8 +15252,13 @@ int pwdbased_test(void)
 int hkdf_test(void)
 {
     int ret;
+    int i;
     int L = 42;
     byte okm1[42];
+    byte okm2[82];
+    byte ikm2[80];
+    byte salt2[80];
+    byte info2[80];
     byte ikm1[22] = { 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
                       0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
                       0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b };
@@ -15263,11 +15290,40 @@ int hkdf_test(void)
                       0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf,
                       0x34, 0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18,
                       0x58, 0x65 };
+    byte res5[82] = { 0xb1, 0x1e, 0x39, 0x8d, 0xc8, 0x03, 0x27, 0xa1,
+                      0xc8, 0xe7, 0xf7, 0x8c, 0x59, 0x6a, 0x49, 0x34,
+                      0x4f, 0x01, 0x2e, 0xda, 0x2d, 0x4e, 0xfa, 0xd8,
+                      0xa0, 0x50, 0xcc, 0x4c, 0x19, 0xaf, 0xa9, 0x7c,
+                      0x59, 0x04, 0x5a, 0x99, 0xca, 0xc7, 0x82, 0x72,
+                      0x71, 0xcb, 0x41, 0xc6, 0x5e, 0x59, 0x0e, 0x09,
+                      0xda, 0x32, 0x75, 0x60, 0x0c, 0x2f, 0x09, 0xb8,
+                      0x36, 0x77, 0x93, 0xa9, 0xac, 0xa3, 0xdb, 0x71,
+                      0xcc, 0x30, 0xc5, 0x81, 0x79, 0xec, 0x3e, 0x87,
+                      0xc1, 0x4c, 0x01, 0xd5, 0xc1, 0xf3, 0x43, 0x4f,
+                      0x1d, 0x87 };
+    byte res6[82] = { 0x48, 0x4c, 0xa0, 0x52, 0xb8, 0xcc, 0x72, 0x4f,
+                      0xd1, 0xc4, 0xec, 0x64, 0xd5, 0x7b, 0x4e, 0x81,
+                      0x8c, 0x7e, 0x25, 0xa8, 0xe0, 0xf4, 0x56, 0x9e,
+                      0xd7, 0x2a, 0x6a, 0x05, 0xfe, 0x06, 0x49, 0xee,
+                      0xbf, 0x69, 0xf8, 0xd5, 0xc8, 0x32, 0x85, 0x6b,
+                      0xf4, 0xe4, 0xfb, 0xc1, 0x79, 0x67, 0xd5, 0x49,
+                      0x75, 0x32, 0x4a, 0x94, 0x98, 0x7f, 0x7f, 0x41,
+                      0x83, 0x58, 0x17, 0xd8, 0x99, 0x4f, 0xdb, 0xd6,
+                      0xf4, 0xc0, 0x9c, 0x55, 0x00, 0xdc, 0xa2, 0x4a,
+                      0x56, 0x22, 0x2f, 0xea, 0x53, 0xd8, 0x96, 0x7a,
+                      0x8b, 0x2e };
 
     (void)res1;
     (void)res2;
     (void)res3;
     (void)res4;
+    (void)res5;
+    (void)res6;
+    (void)i;
+    (void)okm2;
+    (void)ikm2;
+    (void)salt2;
+    (void)info2;
     (void)salt1;
     (void)info1;
 
@@ -15307,13 +15363,119 @@ int hkdf_test(void)
     if (XMEMCMP(okm1, res4, L) != 0)
         return -8207;
 #endif /* HAVE_FIPS */
+
+    /* More than one block of output, RFC 5869 test case 2 */
+    for (i = 0; i < (int)sizeof(ikm2); i++) {
+        ikm2[i]  = (byte)i;
+        salt2[i] = (byte)(0x60 + i);
+        info2[i] = (byte)(0xb0 + i);
+    }
+    ret = wc_HKDF(WC_SHA256, ikm2, sizeof(ikm2), salt2, sizeof(salt2), info2,
+                  sizeof(info2), okm2, sizeof(okm2));
+    if (ret != 0)
+        return -8208;
+
+    if (XMEMCMP(okm2, res5, sizeof(okm2)) != 0)
+        return -8209;
 #endif /* NO_SHA256 */
 
+#ifdef WOLFSSL_SHA384
+    for (i = 0; i < (int)sizeof(ikm2); i++) {
+        ikm2[i]  = (byte)i;
+        salt2[i] = (byte)(0x60 + i);
+        info2[i] = (byte)(0xb0 + i);
+    }
+    ret = wc_HKDF(WC_SHA384, ikm2, sizeof(ikm2), salt2, sizeof(salt2), info2,
+                  sizeof(info2), okm2, sizeof(okm2));
+    if (ret != 0)
+        return -8210;
+
+    if (XMEMCMP(okm2, res6, sizeof(okm2)) != 0)
+        return -8211;
+#endif /* WOLFSSL_SHA384 */
+
     return 0;
 }
 
 #endif /* HAVE_HKDF */
 
+#if defined(WOLFSSL_HAVE_PRF) && !defined(NO_SHA256)
+
+int prf_test(void)
+{
+    int  ret;
+    int  i;
+    byte out[100];
+    byte secret[48];
+    byte seed[40];
+    byte res1[100] = { 0x85, 0x80, 0xc5, 0xce, 0x08, 0x17, 0x94, 0x23,
+                       0x15, 0xd8, 0x62, 0x37, 0x80, 0xb5, 0xb9, 0xaf,
+                       0xab, 0xc7, 0xec, 0x7e, 0xe2, 0xef, 0x1f, 0x77,
+                       0x74, 0x55, 0xae, 0x97, 0x46, 0x89, 0x51, 0xc6,
+                       0xf1, 0x00, 0x87, 0xc7, 0x4e, 0x0c, 0x88, 0xf5,
+                       0x92, 0x41, 0x5a, 0xa8, 0xec, 0x48, 0xab, 0xa4,
+                       0x34, 0x9b, 0x5a, 0x56, 0x39, 0x54, 0x63, 0x97,
+                       0xeb, 0x86, 0x41, 0x94, 0xdb, 0x49, 0x87, 0x84,
+                       0xb1, 0x8c, 0xaf, 0xd8, 0x17, 0xcb, 0x6b, 0xc0,
+                       0xbe, 0x5d, 0x02, 0x4a, 0xee, 0x57, 0x30, 0xd9,
+                       0xc3, 0xe2, 0x02, 0xde, 0x7b, 0xc7, 0xe9, 0xe5,
+                       0x2a, 0x63, 0x87, 0x6c, 0x45, 0xd1, 0xa6, 0x23,
+                       0x80, 0x11, 0x14, 0x6c };
+    byte res2[100] = { 0xd6, 0xbc, 0xcd, 0xd2, 0x44, 0x42, 0x27, 0x5b,
+                       0xfc, 0x61, 0x19, 0x68, 0x7a, 0x3f, 0x4b, 0xe6,
+                       0xf1, 0x33, 0xe7, 0x8e, 0xde, 0x0d, 0x60, 0x80,
+                       0xf7, 0xe0, 0x3b, 0x83, 0xd2, 0xec, 0x3d, 0xa7,
+                       0x0f, 0xbb, 0xf2, 0x57, 0xc7, 0xb0, 0x75, 0x97,
+                       0x38, 0x67, 0x46, 0xb1, 0x4e, 0x92, 0x32, 0x6c,
+                       0x7a, 0xdb, 0x8e, 0x1d, 0x1a, 0x8d, 0x46, 0x6a,
+                       0x5e, 0x9b, 0x2f, 0x1d, 0x68, 0x4a, 0x3f, 0xe1,
+                       0xfe, 0x3b, 0x50, 0xba, 0x24, 0xa0, 0x91, 0xf8,
+                       0x3f, 0xa7, 0xd3, 0xd8, 0x93, 0x2c, 0x40, 0x1a,
+                       0x06, 0x82, 0xc8, 0xed, 0x32, 0x2c, 0x28, 0x32,
+                       0x3b, 0xe9, 0x46, 0xce, 0xa9, 0x18, 0x76, 0x66,
+                       0xdb, 0x93, 0x36, 0xfe };
+
+    (void)res2;
+
+    for (i = 0; i < (int)sizeof(secret); i++)
+        secret[i] = (byte)i;
+    for (i = 0; i < (int)sizeof(seed); i++)
+        seed[i] = (byte)(0x60 + i);
+
+    /* Output is not a multiple of the digest size */
+    ret = wc_PRF(out, sizeof(out), secret, sizeof(secret), seed, sizeof(seed),
+                 sha256_mac, HEAP_HINT, devId);
+    if (ret != 0)
+        return -8620;
+
+    if (XMEMCMP(out, res1, sizeof(out)) != 0)
+        return -8621;
+
+    /* TLS v1.2 PRF puts the label in front of the seed */
+    ret = wc_PRF_TLS(out, sizeof(out), secret, sizeof(secret), seed, 13,
+                     seed + 13, sizeof(seed) - 13, 1, sha256_mac, HEAP_HINT,
+                     devId);
+    if (ret != 0)
+        return -8622;
+
+    if (XMEMCMP(out, res1, sizeof(out)) != 0)
+        return -8623;
+
+#ifdef WOLFSSL_SHA384
+    ret = wc_PRF(out, sizeof(out), secret, sizeof(secret), seed, sizeof(seed),
+                 sha384_mac, HEAP_HINT, devId);
+    if (ret != 0)
+        return -8624;
+
+    if (XMEMCMP(out, res2, sizeof(out)) != 0)
+        return -8625;
+#endif
+
+    return 0;
+}
+
+#endif /* WOLFSSL_HAVE_PRF && !NO_SHA256 */
+
 
 #if defined(HAVE_ECC) && defined(HAVE_X963_KDF)
 
@@ -23686,6 +23848,288 @@ int cryptocb_test(void)
 }
 #endif /* WOLF_CRYPTO_CB */
 
+#if defined(WOLFSSL_ASYNC_CRYPT) && defined(WOLFSSL_ASYNC_CRYPT_SW)
+/* Wait for the operation of an object on the software device the way the TLS
+ * layer does: queue its event and poll the queue without blocking.
+ * Returns the result of the operation. */
+static int async_test_poll(WC_ASYNC_DEV* asyncDev, word32 flags)
+{
+    int ret;
+    int count = 0;
+    WOLF_EVENT_QUEUE queue;
+
+    ret = wolfEventQueue_Init(&queue);
+    if (ret == 0)
+        ret = wc_AsyncHandle(asyncDev, &queue, flags);
+    while (ret == 0 && count == 0) {
+        ret = wolfAsync_EventQueuePoll(&queue, NULL, NULL, 1,
+                                       WOLF_POLL_FLAG_CHECK_HW, &count);
+        if (ret == 0 && count == 0)
+            wc_AsyncThreadYield();
+    }
+    if (ret == 0) {
+        ret = wolfAsync_EventPop(&asyncDev->event,
+                                 WOLF_EVENT_TYPE_ASYNC_WOLFCRYPT);
+    }
+    wolfEventQueue_Free(&queue);
+
+    return ret;
+}
+
+#if !defined(NO_RSA) && !defined(NO_ASN) && \
+    (defined(USE_CERT_BUFFERS_1024) || defined(USE_CERT_BUFFERS_2048) || \
+     !defined(NO_FILESYSTEM))
+/* RSA private key operation is pending, then completes with the same
+ * signature as without the device. */
+static int async_rsa_test(WC_RNG* rng, int asyncDevId)
+{
+    int    ret;
+    byte   tmp[FOURK_BUF];
+    byte   in[] = "Everyone gets Friday off.";
+    byte   out[512];
+    byte   ref[512];
+    word32 outSz;
+    word32 idx = 0;
+    size_t bytes;
+    RsaKey key;
+    RsaKey refKey;
+#if !defined(USE_CERT_BUFFERS_1024) && !defined(USE_CERT_BUFFERS_2048)
+    XFILE  file;
+#endif
+
+#ifdef USE_CERT_BUFFERS_1024
+    XMEMCPY(tmp, client_key_der_1024, (size_t)sizeof_client_key_der_1024);
+    bytes = (size_t)sizeof_client_key_der_1024;
+#elif defined(USE_CERT_BUFFERS_2048)
+    XMEMCPY(tmp, client_key_der_2048, (size_t)sizeof_client_key_der_2048);
+    bytes = (size_t)sizeof_client_key_der_2048;
+#else
+    file = XFOPEN(clientKey, "rb");
+    if (!file)
+        return -10200;
+    bytes = XFREAD(tmp, 1, sizeof(tmp), file);
+    XFCLOSE(file);
+#endif
+
+    ret = wc_InitRsaKey_ex(&key, HEAP_HINT, asyncDevId);
+    if (ret != 0)
+        return -10201;
+    ret = wc_InitRsaKey_ex(&refKey, HEAP_HINT, INVALID_DEVID);
+    if (ret != 0) {
+        wc_FreeRsaKey(&key);
+        return -10202;
+    }
+    ret = wc_RsaPrivateKeyDecode(tmp, &idx, &key, (word32)bytes);
+    if (ret != 0)
+        ERROR_OUT(-10203, exit_rsa);
+    idx = 0;
+    ret = wc_RsaPrivateKeyDecode(tmp, &idx, &refKey, (word32)bytes);
+    if (ret != 0)
+        ERROR_OUT(-10204, exit_rsa);
+
+    ret = wc_RsaSSL_Sign(in, sizeof(in), ref, sizeof(ref), &refKey, rng);
+    if (ret <= 0)
+        ERROR_OUT(-10205, exit_rsa);
+    outSz = (word32)ret;
+
+    ret = wc_RsaSSL_Sign(in, sizeof(in), out, sizeof(out), &key, rng);
+    if (ret != WC_PENDING_E)
+        ERROR_OUT(-10206, exit_rsa);
+    ret = async_test_poll(&key.asyncDev, WC_ASYNC_FLAG_CALL_AGAIN);
+    if (ret < 0)
+        ERROR_OUT(-10207, exit_rsa);
+    /* the key's state machine hands back the result */
+    ret = wc_RsaSSL_Sign(in, sizeof(in), out, sizeof(out), &key, rng);
+    if (ret != (int)outSz || XMEMCMP(out, ref, outSz) != 0)
+        ERROR_OUT(-10208, exit_rsa);
+    ret = 0;
+
+exit_rsa:
+    wc_FreeRsaKey(&refKey);
+    wc_FreeRsaKey(&key);
+
+    return ret;
+}
+#endif
+
+#if defined(HAVE_ECC) && defined(HAVE_ECC_DHE) && defined(HAVE_ECC_SIGN) && \
+    defined(HAVE_ECC_VERIFY) && (!defined(NO_ECC256) || defined(HAVE_ALL_CURVES))
+/* ECC key generation, ECDH, and ECDSA sign and verify are pending, then
+ * complete. */
+static int async_ecc_test(WC_RNG* rng, int asyncDevId)
+{
+    int     ret;
+    int     verify = 0;
+    byte    hash[32];
+    byte    sig[ECC_MAX_SIG_SIZE];
+    byte    secret[32];
+    byte    ref[32];
+    word32  sigSz = (word32)sizeof(sig);
+    word32  secretSz = (word32)sizeof(secret);
+    word32  refSz = (word32)sizeof(ref);
+    ecc_key key;
+    ecc_key peer;
+
+    XMEMSET(hash, 0x5a, sizeof(hash));
+
+    ret = wc_ecc_init_ex(&key, HEAP_HINT, asyncDevId);
+    if (ret != 0)
+        return -10210;
+    ret = wc_ecc_init_ex(&peer, HEAP_HINT, INVALID_DEVID);
+    if (ret != 0) {
+        wc_ecc_free(&key);
+        return -10211;
+    }
+
+    /* key generation completes into the key itself */
+    ret = wc_ecc_make_key(rng, 32, &key);
+    if (ret != WC_PENDING_E)
+        ERROR_OUT(-10212, exit_ecc);
+    ret = async_test_poll(&key.asyncDev, WC_ASYNC_FLAG_NONE);
+    if (ret != 0)
+        ERROR_OUT(-10213, exit_ecc);
+    ret = wc_ecc_make_key(rng, 32, &peer);
+    if (ret != 0)
+        ERROR_OUT(-10214, exit_ecc);
+
+    ret = wc_ecc_shared_secret(&key, &peer, secret, &secretSz);
+    if (ret != WC_PENDING_E)
+        ERROR_OUT(-10215, exit_ecc);
+    ret = async_test_poll(&key.asyncDev, WC_ASYNC_FLAG_CALL_AGAIN);
+    if (ret == 0)
+        ret = wc_ecc_shared_secret(&key, &peer, secret, &secretSz);
+    if (ret != 0)
+        ERROR_OUT(-10216, exit_ecc);
+    ret = wc_ecc_shared_secret(&peer, &key, ref, &refSz);
+    if (ret != 0 || secretSz != refSz || XMEMCMP(secret, ref, refSz) != 0)
+        ERROR_OUT(-10217, exit_ecc);
+
+    ret = wc_ecc_sign_hash(hash, sizeof(hash), sig, &sigSz, rng, &key);
+    if (ret != WC_PENDING_E)
+        ERROR_OUT(-10218, exit_ecc);
+    ret = async_test_poll(&key.asyncDev, WC_ASYNC_FLAG_CALL_AGAIN);
+    if (ret == 0)
+        ret = wc_ecc_sign_hash(hash, sizeof(hash), sig, &sigSz, rng, &key);
+    if (ret != 0)
+        ERROR_OUT(-10219, exit_ecc);
+
+    ret = wc_ecc_verify_hash(sig, sigSz, hash, sizeof(hash), &verify, &key);
+    if (ret != WC_PENDING_E)
+        ERROR_OUT(-10220, exit_ecc);
+    ret = async_test_poll(&key.asyncDev, WC_ASYNC_FLAG_CALL_AGAIN);
+    if (ret == 0) {
+        ret = wc_ecc_verify_hash(sig, sigSz, hash, sizeof(hash), &verify,
+                                 &key);
+    }
+    if (ret != 0 || verify != 1)
+        ERROR_OUT(-10221, exit_ecc);
+
+exit_ecc:
+    wc_ecc_free(&peer);
+    wc_ecc_free(&key);
+
+    return ret;
+}
+#endif
+
+#if !defined(NO_DH) && defined(HAVE_FFDHE_2048)
+/* DH has no crypto callback, so keys on the device run synchronously. */
+static int async_dh_test(WC_RNG* rng, int asyncDevId)
+{
+    int    ret;
+    byte   priv[256], pub[256], priv2[256], pub2[256];
+    byte   agree[256], agree2[256];
+    word32 privSz = (word32)sizeof(priv), pubSz = (word32)sizeof(pub);
+    word32 privSz2 = (word32)sizeof(priv2), pubSz2 = (word32)sizeof(pub2);
+    word32 agreeSz = (word32)sizeof(agree), agreeSz2 = (word32)sizeof(agree2);
+    const DhParams* params = wc_Dh_ffdhe2048_Get();
+    DhKey  key;
+    DhKey  key2;
+
+    ret = wc_InitDhKey_ex(&key, HEAP_HINT, asyncDevId);
+    if (ret != 0)
+        return -10230;
+    ret = wc_InitDhKey_ex(&key2, HEAP_HINT, asyncDevId);
+    if (ret != 0) {
+        wc_FreeDhKey(&key);
+        return -10231;
+    }
+
+    ret = wc_DhSetKey(&key, params->p, params->p_len, params->g,
+                      params->g_len);
+    if (ret == 0) {
+        ret = wc_DhSetKey(&key2, params->p, params->p_len, params->g,
+                          params->g_len);
+    }
+    if (ret != 0)
+        ERROR_OUT(-10232, exit_dh);
+
+    ret = wc_DhGenerateKeyPair(&key, rng, priv, &privSz, pub, &pubSz);
+    if (ret != 0)
+        ERROR_OUT(-10233, exit_dh);
+    ret = wc_DhGenerateKeyPair(&key2, rng, priv2, &privSz2, pub2, &pubSz2);
+    if (ret != 0)
+        ERROR_OUT(-10234, exit_dh);
+    ret = wc_DhAgree(&key, agree, &agreeSz, priv, privSz, pub2, pubSz2);
+    if (ret != 0)
+        ERROR_OUT(-10235, exit_dh);
+    ret = wc_DhAgree(&key2, agree2, &agreeSz2, priv2, privSz2, pub, pubSz);
+    if (ret != 0)
+        ERROR_OUT(-10236, exit_dh);
+    if (agreeSz != agreeSz2 || XMEMCMP(agree, agree2, agreeSz) != 0)
+        ERROR_OUT(-10237, exit_dh);
+
+exit_dh:
+    wc_FreeDhKey(&key2);
+    wc_FreeDhKey(&key);
+
+    return ret;
+}
+#endif
+
+/* Operations on objects opened with the software async device. */
+int async_test(void)
+{
+    int    ret;
+    int    asyncDevId = INVALID_DEVID;
+    WC_RNG rng;
+
+    ret = wolfAsync_DevOpen(&asyncDevId);
+    if (ret != 0)
+        return -10240;
+#ifndef HAVE_FIPS
+    ret = wc_InitRng_ex(&rng, HEAP_HINT, INVALID_DEVID);
+#else
+    ret = wc_InitRng(&rng);
+#endif
+    if (ret != 0) {
+        wolfAsync_DevClose(&asyncDevId);
+        return -10241;
+    }
+
+#if !defined(NO_RSA) && !defined(NO_ASN) && \
+    (defined(USE_CERT_BUFFERS_1024) || defined(USE_CERT_BUFFERS_2048) || \
+     !defined(NO_FILESYSTEM))
+    if (ret == 0)
+        ret = async_rsa_test(&rng, asyncDevId);
+#endif
+#if defined(HAVE_ECC) && defined(HAVE_ECC_DHE) && defined(HAVE_ECC_SIGN) && \
+    defined(HAVE_ECC_VERIFY) && (!defined(NO_ECC256) || defined(HAVE_ALL_CURVES))
+    if (ret == 0)
+        ret = async_ecc_test(&rng, asyncDevId);
+#endif
+#if !defined(NO_DH) && defined(HAVE_FFDHE_2048)
+    if (ret == 0)
+        ret = async_dh_test(&rng, asyncDevId);
+#endif
+
+    wc_FreeRng(&rng);
+    wolfAsync_DevClose(&asyncDevId);
+
+    return ret;
+}
+#endif /* WOLFSSL_ASYNC_CRYPT && WOLFSSL_ASYNC_CRYPT_SW */
+
 #ifdef WOLFSSL_CERT_PIV
 int certpiv_test(void)
 {
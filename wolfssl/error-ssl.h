@@ -163,6 +163,11 @@ enum wolfSSL_ErrorCodes {
     DH_PARAMS_NOT_FFDHE_E        = -432,   /* DH params from server not FFDHE */
     TCA_INVALID_ID_TYPE          = -433,   /* TLSX TCA ID type invalid */
     TCA_ABSENT_ERROR             = -434,   /* TLSX TCA ID no response */
+    CLIENT_HELLO_CB_E            = -435,   /* ClientHello callback abort */
+    CLIENT_HELLO_WANT_CB         = -436,   /* ClientHello callback deferred */
+    HANDSHAKE_ADMISSION_E        = -437,   /* full handshake refused, busy */
+    HANDSHAKE_ADMISSION_WANT     = -438,   /* full handshake held back, busy */
+    BAD_RECORD_SIZE_LIMIT_E      = -439,   /* record_size_limit below 64 */
     /* add strings to wolfSSL_ERR_reason_error_string in internal.c !!!!! */
 
     /* begin negotiation parameter errors */
@@ -194,9 +194,16 @@
 #ifdef HAVE_LIBZ
     #include "zlib.h"
 #endif
+#ifdef WOLFSSL_CERT_COMPRESSION
+    #include <wolfssl/wolfcrypt/compress.h>
+#endif
 
 #ifdef WOLFSSL_ASYNC_CRYPT
-    #include <wolfssl/wolfcrypt/async.h>
+    #ifdef WOLFSSL_ASYNC_CRYPT_SW
+        #include <wolfssl/wolfcrypt/async_sw.h>
+    #else
+        #include <wolfssl/wolfcrypt/async.h>
+    #endif
 #endif
 
 #ifdef OPENSSL_EXTRA
@@ -1629,6 +1636,14 @@ WOLFSSL_LOCAL int  DoClientHello(WOLFSSL* ssl, const byte* input, word32*,
 WOLFSSL_LOCAL int DoTls13ClientHello(WOLFSSL* ssl, const byte* input,
                                      word32* inOutIdx, word32 helloSz);
 #endif
+#if defined(WOLFSSL_CLIENT_HELLO_CB) && defined(NO_WOLFSSL_SERVER)
+    /* only servers receive a ClientHello */
+    #undef WOLFSSL_CLIENT_HELLO_CB
+#endif
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+WOLFSSL_LOCAL int  DoClientHelloCb(WOLFSSL* ssl, const byte* input,
+                                   word32 helloSz);
+#endif
 WOLFSSL_LOCAL int  DoServerHello(WOLFSSL* ssl, const byte* input, word32*,
                                  word32);
 WOLFSSL_LOCAL int  CompleteServerHello(WOLFSSL *ssl);
@@ -1653,6 +1668,11 @@ WOLFSSL_LOCAL int  HashOutputRaw(WOLFSSL* ssl, const byte* output, int sz);
 WOLFSSL_LOCAL int  HashOutput(WOLFSSL* ssl, const byte* output, int sz,
                               int ivSz);
 WOLFSSL_LOCAL int  HashInput(WOLFSSL* ssl, const byte* input, int sz);
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+WOLFSSL_LOCAL int  HashPending(WOLFSSL* ssl, const byte* data, int sz);
+WOLFSSL_LOCAL int  HashCommit(WOLFSSL* ssl, byte mask);
+WOLFSSL_LOCAL byte HashNegotiatedMask(WOLFSSL* ssl);
+#endif
 #if defined(OPENSSL_ALL) || defined(HAVE_STUNNEL) || defined(WOLFSSL_NGINX) || defined(WOLFSSL_HAPROXY)
 WOLFSSL_LOCAL int SNI_Callback(WOLFSSL* ssl);
 #endif
@@ -1677,6 +1697,84 @@ enum {
     NO_FORCED_FREE = 0
 };
 
+#ifdef WOLFSSL_CERT_COMPRESSION
+/* Certificate compression algorithms - RFC 8879 */
+enum CertCompressAlgo {
+    CERT_COMPRESS_ZLIB = 1
+};
+
+/* compressed Certificate message body is cached with the other encodings */
+#ifndef WOLFSSL_CERT_MSG_CACHE
+    #error WOLFSSL_CERT_COMPRESSION requires WOLFSSL_CERT_MSG_CACHE
+#endif
+#endif
+
+#ifdef WOLFSSL_CERT_MSG_CACHE
+/* encodings of the Certificate message body cached in the CTX */
+enum {
+    CERT_MSG_TLS12 = 0,
+    CERT_MSG_TLS13 = 1,
+#ifdef WOLFSSL_CERT_COMPRESSION
+    CERT_MSG_TLS13_ZLIB = 2,
+#endif
+    CERT_MSG_CACHE_CNT
+};
+#endif
+
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+/* Anti-replay cache for TLS v1.3 early data.
+ * A ClientHello is identified by its first PSK binder. Binders seen in the
+ * last window are recorded in bloom filters sharded by binder, each shard
+ * having a current and a previous generation of the window's length.
+ */
+#ifndef WOLFSSL_ANTI_REPLAY_SHARDS
+    #define WOLFSSL_ANTI_REPLAY_SHARDS      16
+#endif
+#ifndef WOLFSSL_ANTI_REPLAY_BITS
+    #define WOLFSSL_ANTI_REPLAY_BITS        (1 << 14) /* per generation */
+#endif
+#define ANTI_REPLAY_HASHES  4       /* bloom filter bits set per binder */
+
+typedef struct AntiReplayShard {
+    wolfSSL_Mutex lock;
+    word32        genStart;         /* time current generation started, ms */
+    word32        replays;          /* early data rejected as replayed */
+    byte          cur;              /* index of the current generation */
+    byte          filter[2][WOLFSSL_ANTI_REPLAY_BITS / WOLFSSL_BIT_SIZE];
+} AntiReplayShard;
+
+typedef struct AntiReplay {
+    word32          windowMs;       /* freshness window, 0 accepts all */
+    AntiReplayShard shard[WOLFSSL_ANTI_REPLAY_SHARDS];
+} AntiReplay;
+#endif
+
+#if defined(WOLFSSL_HANDSHAKE_ADMISSION) && defined(NO_WOLFSSL_SERVER)
+    #undef WOLFSSL_HANDSHAKE_ADMISSION
+#endif
+
+#if defined(WOLFSSL_DTLS_DEMUX) && (!defined(WOLFSSL_DTLS) || \
+    defined(NO_WOLFSSL_SERVER) || defined(WOLFSSL_USER_IO))
+    /* DTLS server sessions of many peers on one socket */
+    #undef WOLFSSL_DTLS_DEMUX
+#endif
+
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+/* Admission control of full handshakes on a server CTX.
+ * Full handshakes are counted from their ClientHello until they finish or
+ * the SSL is freed. New full handshakes are refused or held back while too
+ * many are running or while they take too long on average. Resumptions are
+ * always let through.
+ */
+typedef struct HsAdmission {
+    wolfSSL_Mutex lock;
+    word32        maxInFlight;      /* full handshakes at once, 0 no limit */
+    word32        maxLatencyUs;     /* average to stay under, 0 no limit */
+    byte          defer;            /* hold back instead of refusing */
+    WOLFSSL_ADMISSION_STATS stats;
+} HsAdmission;
+#endif
+
 
 /* only use compression extra if using compression */
 #ifdef HAVE_LIBZ
@@ -1738,6 +1836,46 @@ enum {
     #define STATIC_BUFFER_LEN RECORD_HEADER_SZ
 #endif
 
+#ifdef WOLFSSL_BUFFER_POOL
+    /* size of the largest pooled input/output buffer, room for a full record
+     * plus the default read ahead slack */
+    #ifndef WOLFSSL_BUFFER_POOL_SZ
+        #define WOLFSSL_BUFFER_POOL_SZ (RECORD_HEADER_SZ + MAX_RECORD_SIZE + \
+                    COMP_EXTRA + MTU_EXTRA + MAX_MSG_EXTRA + 2048)
+    #endif
+    /* size of the smallest pooled buffer, each size class doubles it and the
+     * last class is WOLFSSL_BUFFER_POOL_SZ */
+    #ifndef WOLFSSL_BUFFER_POOL_MIN_SZ
+        #define WOLFSSL_BUFFER_POOL_MIN_SZ 1024
+    #endif
+    /* number of buffer size classes */
+    #ifndef WOLFSSL_BUFFER_POOL_CLASSES
+        #define WOLFSSL_BUFFER_POOL_CLASSES 5
+    #endif
+    #if WOLFSSL_BUFFER_POOL_CLASSES < 1 || WOLFSSL_BUFFER_POOL_CLASSES > 16
+        #error WOLFSSL_BUFFER_POOL_CLASSES must be from 1 to 16
+    #endif
+    /* number of independently locked free lists */
+    #ifndef WOLFSSL_BUFFER_POOL_SHARDS
+        #ifdef SINGLE_THREADED
+            #define WOLFSSL_BUFFER_POOL_SHARDS 1
+        #else
+            #define WOLFSSL_BUFFER_POOL_SHARDS 8
+        #endif
+    #endif
+    /* maximum free buffers of each size class kept per shard */
+    #ifndef WOLFSSL_BUFFER_POOL_MAX
+        #define WOLFSSL_BUFFER_POOL_MAX 64
+    #endif
+#endif
+
+#ifdef WOLFSSL_KEY_SHARE_POOL
+    /* number of pre-generated X25519 and P-256 key pairs kept per group */
+    #ifndef WOLFSSL_KEY_SHARE_POOL_SZ
+        #define WOLFSSL_KEY_SHARE_POOL_SZ 64
+    #endif
+#endif
+
 typedef struct {
     ALIGN16 byte staticBuffer[STATIC_BUFFER_LEN];
     byte*  buffer;       /* place holder for static or dynamic buffer */
@@ -1746,6 +1884,9 @@ typedef struct {
     word32 bufferSize;   /* current buffer size */
     byte   dynamicFlag;  /* dynamic memory currently in use */
     byte   offset;       /* alignment offset attempt */
+#ifdef WOLFSSL_BUFFER_POOL
+    byte   pooled;       /* size class + 1 of a buffer from the shared pool */
+#endif
 } bufferStatic;
 
 /* Cipher Suites holder */
@@ -1960,6 +2101,35 @@ typedef struct WOLFSSL_DTLS_CTX {
     int wfd;
 } WOLFSSL_DTLS_CTX;
 
+#ifdef WOLFSSL_DTLS_DEMUX
+#ifndef DTLS_DEMUX_INIT_SZ
+    #define DTLS_DEMUX_INIT_SZ 64   /* initial number of buckets, power of 2 */
+#endif
+
+/* session of one peer of a DTLS demultiplexer */
+typedef struct DtlsDemuxPeer {
+    struct DtlsDemuxPeer* next;
+    WOLFSSL*              ssl;
+    word32                hash;     /* of the peer address */
+} DtlsDemuxPeer;
+
+/* DTLS server sessions of many peers on one UDP socket, by peer address */
+struct WOLFSSL_DTLS_DEMUXER {
+    WOLFSSL_CTX*    ctx;
+    DtlsDemuxPeer** bucket;
+    word32          bucketSz;       /* number of buckets, power of 2 */
+    word32          count;          /* number of sessions */
+    word32          maxPeers;       /* 0 when not limited */
+    word32          hashSeed;       /* random start of the address hash */
+    WOLFSSL*        pending;        /* session the datagram is handed to */
+    int             bufLen;         /* length of datagram not yet handed */
+    int             sd;
+    WC_RNG          rng;
+    byte            secret[COOKIE_SECRET_SZ];
+    byte            buf[MAX_UDP_SIZE];
+};
+#endif /* WOLFSSL_DTLS_DEMUX */
+
 
 typedef struct WOLFSSL_DTLS_PEERSEQ {
     word32 window[WOLFSSL_DTLS_WINDOW_WORDS];
@@ -2053,6 +2223,12 @@ typedef enum {
     TLSX_APPLICATION_LAYER_PROTOCOL = 0x0010, /* a.k.a. ALPN */
     TLSX_STATUS_REQUEST_V2          = 0x0011, /* a.k.a. OCSP stapling v2 */
     TLSX_QUANTUM_SAFE_HYBRID        = 0x0018, /* a.k.a. QSH  */
+#ifdef HAVE_RECORD_SIZE_LIMIT
+    TLSX_RECORD_SIZE_LIMIT          = 0x001c,
+#endif
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_CERT_COMPRESSION)
+    TLSX_CERT_COMPRESSION           = 0x001b,
+#endif
     TLSX_SESSION_TICKET             = 0x0023,
 #ifdef WOLFSSL_TLS13
     #if defined(HAVE_SESSION_TICKET) || !defined(NO_PSK)
@@ -2079,17 +2255,37 @@ typedef enum {
     TLSX_RENEGOTIATION_INFO         = 0xff01
 } TLSX_Type;
 
+#ifdef WOLFSSL_TLSX_INDEX
+/* Number of extension types with a slot in the lookup table. */
+#define TLSX_INDEX_SZ 64
+/* Number of extensions a list needs before it gets a lookup table. */
+#ifndef TLSX_INDEX_MIN
+    #define TLSX_INDEX_MIN 8
+#endif
+
+struct TLSX;
+
+/* Lookup table shared by all extensions of a long list, indexed by type. */
+typedef struct TLSX_Index {
+    struct TLSX* slot[TLSX_INDEX_SZ];
+} TLSX_Index;
+#endif
+
 typedef struct TLSX {
     TLSX_Type    type; /* Extension Type  */
     void*        data; /* Extension Data  */
     word32       val;  /* Extension Value */
     byte         resp; /* IsResponse Flag */
+#ifdef WOLFSSL_TLSX_INDEX
+    TLSX_Index*  index; /* Lookup Table, NULL for short lists */
+#endif
     struct TLSX* next; /* List Behavior   */
 } TLSX;
 
 WOLFSSL_LOCAL TLSX* TLSX_Find(TLSX* list, TLSX_Type type);
 WOLFSSL_LOCAL void  TLSX_Remove(TLSX** list, TLSX_Type type, void* heap);
 WOLFSSL_LOCAL void  TLSX_FreeAll(TLSX* list, void* heap);
+WOLFSSL_LOCAL void  TLSX_FreeHandshake(WOLFSSL* ssl);
 WOLFSSL_LOCAL int   TLSX_SupportExtensions(WOLFSSL* ssl);
 WOLFSSL_LOCAL int   TLSX_PopulateExtensions(WOLFSSL* ssl, byte isRequest);
 
@@ -2115,6 +2311,7 @@ WOLFSSL_LOCAL int   TLSX_Parse(WOLFSSL* ssl, byte* input, word16 length,
 
 #elif defined(HAVE_SNI)                           \
    || defined(HAVE_MAX_FRAGMENT)                  \
+   || defined(HAVE_RECORD_SIZE_LIMIT)             \
    || defined(HAVE_TRUSTED_CA)                    \
    || defined(HAVE_TRUNCATED_HMAC)                \
    || defined(HAVE_CERTIFICATE_STATUS_REQUEST)    \
@@ -2156,6 +2353,55 @@ WOLFSSL_LOCAL int    TLSX_SNI_GetFromBuffer(const byte* buffer, word32 bufferSz,
                                          byte type, byte* sni, word32* inOutSz);
 #endif
 
+#if defined(WOLFSSL_SNI_STORE) && \
+    (defined(NO_WOLFSSL_SERVER) || defined(NO_CERTS))
+    /* server certificates selected by the requested host name */
+    #undef WOLFSSL_SNI_STORE
+#endif
+
+/* Certificate, chain and key served for one host name or wildcard. Defined
+ * in all builds, the certificate loading code takes one. */
+typedef struct SNI_StoreEntry {
+    struct SNI_StoreEntry* next;        /* bucket chain */
+    char*       name;                   /* lower case, "*.suffix" wildcard */
+    word16      nameSz;
+    word32      hash;
+    DerBuffer*  certificate;
+    DerBuffer*  certChain;
+#ifdef WOLFSSL_TLS13
+    int         certChainCnt;
+#endif
+    DerBuffer*  key;
+    int         keySz;
+    byte        keyType;
+#if defined(HAVE_ECC) || defined(HAVE_ED25519)
+    word32      pkCurveOID;
+#endif
+    byte        haveECDSAsig:1;
+    byte        haveECC:1;
+    byte        haveStaticECC:1;
+} SNI_StoreEntry;
+
+#ifdef WOLFSSL_SNI_STORE
+#ifndef SNI_STORE_INIT_SZ
+    /* initial number of buckets, doubled as names are added */
+    #define SNI_STORE_INIT_SZ 64
+#endif
+/* longest host name in the store, DNS limit */
+#define SNI_STORE_MAX_NAME 253
+
+/* Hash table of entries by host name, owned by the CTX. */
+typedef struct SNI_Store {
+    SNI_StoreEntry** bucket;
+    word32           bucketSz;          /* power of two */
+    word32           count;
+} SNI_Store;
+
+WOLFSSL_LOCAL int  SNI_StoreAdd(WOLFSSL_CTX* ctx, SNI_StoreEntry* entry);
+WOLFSSL_LOCAL void FreeSNIStoreEntry(SNI_StoreEntry* entry, void* heap);
+WOLFSSL_LOCAL void FreeSNIStore(WOLFSSL_CTX* ctx);
+#endif /* WOLFSSL_SNI_STORE */
+
 #endif /* HAVE_SNI */
 
 /* Trusted CA Key Indication - RFC 6066 (section 6) */
@@ -2520,6 +2766,14 @@ struct WOLFSSL_CTX {
     #endif
 #ifdef WOLFSSL_TLS13
     int         certChainCnt;
+#endif
+#ifdef WOLFSSL_CERT_MSG_CACHE
+    byte*       certMsg[CERT_MSG_CACHE_CNT];   /* encoded Certificate bodies */
+    word32      certMsgSz[CERT_MSG_CACHE_CNT];
+    byte        certMsgFailed;     /* bit per encoding that failed to encode */
+#endif
+#ifdef WOLFSSL_SNI_STORE
+    SNI_Store*  sniStore;          /* certificates by requested host name */
 #endif
     DerBuffer*  privateKey;
     byte        privateKeyType:7;
@@ -2554,6 +2808,7 @@ struct WOLFSSL_CTX {
     byte        partialWrite:1;   /* only one msg per write call */
     byte        quietShutdown:1;  /* don't send close notify */
     byte        groupMessages:1;  /* group handshake messages before sending */
+    byte        releaseBuffers:1; /* free I/O buffers when idle */
     byte        minDowngrade;     /* minimum downgrade version */
     byte        haveEMS:1;        /* have extended master secret extension */
     byte        useClientOrder:1; /* Use client's cipher preference order */
@@ -2564,6 +2819,9 @@ struct WOLFSSL_CTX {
 #if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
     byte        postHandshakeAuth:1;  /* Post-handshake auth supported. */
 #endif
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_CERT_COMPRESSION)
+    byte        certCompress:1;   /* Certificate compression supported. */
+#endif
 #ifndef NO_DH
     #if !defined(WOLFSSL_OLD_PRIME_CHECK) && !defined(HAVE_FIPS) && \
         !defined(HAVE_SELFTEST)
@@ -2638,6 +2896,35 @@ struct WOLFSSL_CTX {
 #ifdef WOLFSSL_EARLY_DATA
     word32          maxEarlyDataSz;
 #endif
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+    AntiReplay*     antiReplay;         /* early data replay cache */
+#endif
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    HsAdmission*    admission;          /* full handshake admission control */
+#endif
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+    word32          hrrCount;           /* HelloRetryRequests sent/received */
+    word32          groupCacheHits;     /* key shares from group cache */
+#endif
+#ifdef WOLFSSL_READ_AHEAD
+    word32          readAheadSz;        /* max bytes to read ahead, 0 off */
+    byte            readBatch:1;        /* read all buffered data records */
+#endif
+#ifdef WOLFSSL_KTLS
+    byte            useKtls:1;          /* offload records to kernel TLS */
+#endif
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    byte            eagerHash:1;        /* hash messages from the start */
+#endif
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+    word16          dynRecSmallSz;      /* small record size, 0 off */
+    word32          dynRecThreshold;    /* bytes sent before full size */
+    word32          dynRecIdleSec;      /* idle time that restarts small */
+#endif
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+    CallbackClientHello clientHelloCb;  /* sees ClientHello before use */
+    void*           clientHelloCbArg;
+#endif
 #ifdef HAVE_ANON
     byte        haveAnon;               /* User wants to allow Anon suites */
 #endif /* HAVE_ANON */
@@ -2676,6 +2963,9 @@ struct WOLFSSL_CTX {
     int             devId;              /* async device id to use */
 #ifdef HAVE_TLS_EXTENSIONS
     TLSX* extensions;                  /* RFC 6066 TLS Extensions data */
+    #ifdef HAVE_RECORD_SIZE_LIMIT
+        word16 recordSizeLimit;        /* largest plaintext we accept */
+    #endif
     #ifndef NO_WOLFSSL_SERVER
         #if defined(HAVE_CERTIFICATE_STATUS_REQUEST) \
          || defined(HAVE_CERTIFICATE_STATUS_REQUEST_V2)
@@ -2853,6 +3143,27 @@ enum CipherType { aead };
 
 
 /* cipher for now */
+#if defined(WOLFSSL_TLS_HMAC_CACHE) && \
+    (defined(WOLFSSL_AEAD_ONLY) || defined(WOLFSSL_NO_TLS12))
+    /* no record MACs with HMAC */
+    #undef WOLFSSL_TLS_HMAC_CACHE
+#endif
+#if defined(WOLFSSL_TLS_HMAC_CACHE) && \
+    (defined(WOLFSSL_ASYNC_CRYPT) || defined(WOLFSSL_SMALL_STACK_CACHE))
+    #error WOLFSSL_TLS_HMAC_CACHE copies hash state so needs plain hashes
+#endif
+#if defined(WOLFSSL_CBC_STITCH) && \
+    (defined(WOLFSSL_AEAD_ONLY) || defined(WOLFSSL_NO_TLS12) || \
+     defined(NO_TLS) || !defined(BUILD_AES) || !defined(HAVE_AES_CBC) || \
+     defined(WOLFSSL_ASYNC_CRYPT) || defined(HAVE_FUZZER))
+    /* only synchronous AES-CBC with HMAC records */
+    #undef WOLFSSL_CBC_STITCH
+#endif
+#ifndef CBC_STITCH_CHUNK_SZ
+    /* bytes of message MACed and then encrypted at a time */
+    #define CBC_STITCH_CHUNK_SZ 1024
+#endif
+
 typedef struct Ciphers {
 #ifdef BUILD_ARC4
     Arc4*   arc4;
@@ -2881,6 +3192,9 @@ typedef struct Ciphers {
 #endif
 #ifdef HAVE_IDEA
     Idea* idea;
+#endif
+#ifdef WOLFSSL_TLS_HMAC_CACHE
+    Hmac*   hmac;        /* keyed record MAC with inner pad hashed */
 #endif
     byte    state;
     byte    setup;       /* have we set it up flag for detection */
@@ -3019,6 +3333,10 @@ typedef int (*hmacfp) (WOLFSSL*, byte*, const byte*, word32, int, int, int);
 
 #ifndef NO_CLIENT_CACHE
     WOLFSSL_SESSION* GetSessionClient(WOLFSSL*, const byte*, int);
+    #ifdef WOLFSSL_TLS13_GROUP_CACHE
+    WOLFSSL_LOCAL word16 GetSessionClientGroup(WOLFSSL*, const byte*, int);
+    WOLFSSL_LOCAL void AddSessionClientGroup(WOLFSSL*);
+    #endif
 #endif
 
 /* client connect state for nonblocking restart */
@@ -3085,6 +3403,10 @@ typedef struct Buffers {
     buffer          clearOutputBuffer;
     buffer          sig;                   /* signature data */
     buffer          digest;                /* digest data */
+#ifdef WOLFSSL_READ_AHEAD
+    word32          inputAheadSz;          /* bytes read ahead that follow the
+                                              record being processed         */
+#endif
     int             prevSent;              /* previous plain text bytes sent
                                               when got WANT_WRITE            */
     int             plainSz;               /* plain text bytes in buffer to send
@@ -3219,6 +3541,7 @@ typedef struct Options {
     word16            quietShutdown:1;    /* don't send close notify */
     word16            certOnly:1;         /* stop once we get cert */
     word16            groupMessages:1;    /* group handshake messages */
+    word16            releaseBuffers:1;   /* free I/O buffers when idle */
     word16            saveArrays:1;       /* save array Memory for user get keys
                                            or psk */
     word16            weOwnRng:1;         /* will be true unless CTX owns */
@@ -3254,6 +3577,10 @@ typedef struct Options {
     word16            postHandshakeAuth:1;/* Client send post_handshake_auth
                                            * extension */
 #endif
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_CERT_COMPRESSION)
+    word16            certCompress:1;     /* Certificate compression allowed */
+    word16            peerCertCompress:1; /* Peer can decompress with zlib */
+#endif
 #if defined(WOLFSSL_TLS13) && !defined(NO_WOLFSSL_SERVER)
     word16            sendCookie:1;       /* Server creates a Cookie in HRR */
 #endif
@@ -3313,6 +3640,35 @@ typedef struct Options {
     word16          pskIdIndex;
     word32          maxEarlyDataSz;
 #endif
+#ifdef WOLFSSL_READ_AHEAD
+    word32          readAheadSz;        /* max bytes to read ahead, 0 off */
+    byte            readBatch:1;        /* read all buffered data records */
+    byte            readBatchClose:1;   /* close_notify read in a batch */
+#endif
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    byte            eagerHash:1;        /* hash messages from the start */
+#endif
+#ifdef WOLFSSL_KTLS
+    byte            useKtls:1;          /* offload records to kernel TLS */
+    byte            ktlsTx:1;           /* kernel encrypts sent records */
+    byte            ktlsRx:1;           /* kernel decrypts received records */
+    byte            ktlsTxRekey:1;      /* new send keys once buffer flushed */
+    byte            ktlsTxPending:1;    /* send offload once buffer flushed */
+    byte            ktlsRxPending:1;    /* receive offload once input drained */
+#endif
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+    word16          dynRecSmallSz;      /* small record size, 0 off */
+    word32          dynRecThreshold;    /* bytes sent before full size */
+    word32          dynRecIdleSec;      /* idle time that restarts small */
+    word32          dynRecSent;         /* bytes sent in this burst */
+    word32          dynRecLastSend;     /* time of last send, seconds */
+#endif
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+    byte            clientHelloCbDone:1; /* callback accepted ClientHello */
+#endif
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    byte            admitWait:1;       /* full hs held back by admission */
+#endif
 #ifdef WOLFSSL_TLS13
     byte            oldMinor;          /* client preferred version < TLS 1.3 */
 #endif
@@ -3550,6 +3906,27 @@ typedef struct MsgsReceived {
 } MsgsReceived;
 
 
+/* Handshake transcript hashes, as bits for HashCommit() */
+enum HsHashMask {
+    HS_HASH_MD5    = 0x01,
+    HS_HASH_SHA    = 0x02,
+    HS_HASH_SHA256 = 0x04,
+    HS_HASH_SHA384 = 0x08,
+    HS_HASH_SHA512 = 0x10,
+    HS_HASH_ALL    = 0x1f
+};
+
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    /* initial size of the buffer for messages hashed before the suite is
+     * known, grows as needed */
+    #ifndef HS_HASH_PENDING_SZ
+        #define HS_HASH_PENDING_SZ 512
+    #endif
+    #define HS_HASH_ON(ssl, h) ((ssl)->hsHashes->active & (h))
+#else
+    #define HS_HASH_ON(ssl, h) 1
+#endif
+
 /* Handshake hashes */
 typedef struct HS_Hashes {
     Hashes          verifyHashes;
@@ -3574,6 +3951,13 @@ typedef struct HS_Hashes {
     int             length;             /* length of handshake messages' data */
     int             prevLen;            /* length of messages but last */
 #endif
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+    byte*           pending;            /* messages before HashCommit */
+    word32          pendingSz;          /* length of pending data */
+    word32          pendingMax;         /* size of pending buffer */
+    byte            lazy;               /* hashes not instantiated yet */
+    byte            active;             /* HS_HASH_* of instantiated hashes */
+#endif
 } HS_Hashes;
 
 
@@ -3622,6 +4006,22 @@ typedef enum EarlyDataState {
 } EarlyDataState;
 #endif
 
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+/* Fields of a received ClientHello, valid during the ClientHello callback. */
+typedef struct ClientHelloInfo {
+    const byte*     random;
+    const byte*     sessionId;
+    const byte*     suites;
+    const byte*     comp;
+    const byte*     exts;
+    word16          suitesSz;
+    word16          extsSz;
+    byte            sessionIdSz;
+    byte            compSz;
+    ProtocolVersion version;
+} ClientHelloInfo;
+#endif
+
 /* wolfSSL ssl type */
 struct WOLFSSL {
     WOLFSSL_CTX*    ctx;
@@ -3723,6 +4123,9 @@ struct WOLFSSL {
 #if defined(WOLFSSL_TLS13) || defined(HAVE_FFDHE)
     word16          namedGroup;
 #endif
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+    word16          cachedGroup;       /* group server picked last time */
+#endif
 #ifdef WOLFSSL_TLS13
     word16          group[WOLFSSL_MAX_GROUP_COUNT];
     byte            numGroups;
@@ -3815,6 +4218,10 @@ struct WOLFSSL {
 #if defined(WOLFSSL_TLS13) && defined(WOLFSSL_POST_HANDSHAKE_AUTH)
     CertReqCtx*     certReqCtx;
 #endif
+#if defined(WOLFSSL_TLS13) && defined(WOLFSSL_CERT_COMPRESSION)
+    byte*           certDecomp;         /* decompressed peer Certificate */
+    word32          certDecompSz;
+#endif
 #ifdef KEEP_PEER_CERT
     WOLFSSL_X509     peerCert;           /* X509 peer cert */
 #endif
@@ -3836,6 +4243,10 @@ struct WOLFSSL {
     #ifdef HAVE_MAX_FRAGMENT
         word16 max_fragment;
     #endif
+    #ifdef HAVE_RECORD_SIZE_LIMIT
+        word16 recordSizeLimit;     /* largest plaintext we accept, 0 none */
+        word16 peerRecordSizeLimit; /* peer's limit, 0 not negotiated */
+    #endif
     #ifdef HAVE_TRUNCATED_HMAC
         byte truncated_hmac;
     #endif
@@ -3925,6 +4336,20 @@ struct WOLFSSL {
     EarlyDataState earlyData;
     word32 earlyDataSz;
 #endif
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+    WOLFSSL_HS_TIMING hsTiming;
+    word32 hsTimeStart[WC_FUNC_COUNT];  /* start of each running handler */
+    word32 hsTimeBegin;                 /* start of the handshake */
+    byte   hsTimeBegun;                 /* handshake is being timed */
+#endif
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+    const ClientHelloInfo* clientHello; /* set while the callback runs */
+#endif
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+    HsAdmission* admission;             /* counting this full handshake */
+    WOLFSSL_CTX* admitCtx;              /* reference held for admission */
+    word32 admitTime;                   /* full handshake admitted, usec */
+#endif
 };
 
 
@@ -3935,6 +4360,8 @@ int  InitSSL(WOLFSSL*, WOLFSSL_CTX*, int);
 WOLFSSL_LOCAL
 void FreeSSL(WOLFSSL*, void* heap);
 WOLFSSL_API void SSL_ResourceFree(WOLFSSL*);   /* Micrium uses */
+WOLFSSL_LOCAL
+word32 SSL_MemoryUsage(const WOLFSSL*);
 
 
 
@@ -3943,6 +4370,12 @@ WOLFSSL_API void SSL_ResourceFree(WOLFSSL*);   /* Micrium uses */
     WOLFSSL_LOCAL int ProcessBuffer(WOLFSSL_CTX* ctx, const unsigned char* buff,
                                     long sz, int format, int type, WOLFSSL* ssl,
                                     long* used, int userChain);
+    #ifdef WOLFSSL_SNI_STORE
+    WOLFSSL_LOCAL int ProcessSNIStoreBuffer(WOLFSSL_CTX* ctx,
+                                    const unsigned char* buff, long sz,
+                                    int format, int type,
+                                    SNI_StoreEntry* entry, int userChain);
+    #endif
     WOLFSSL_LOCAL int ProcessFile(WOLFSSL_CTX* ctx, const char* fname, int format,
                                  int type, WOLFSSL* ssl, int userChain,
                                 WOLFSSL_CRL* crl);
@@ -4021,6 +4454,7 @@ enum HandShakeType {
     finished             =  20,
     certificate_status   =  22,
     key_update           =  24,
+    compressed_certificate = 25,
     change_cipher_hs     =  55,    /* simulate unique handshake type for sanity
                                       checks.  record layer change_cipher
                                       conflicts with handshake finished */
@@ -4086,6 +4520,55 @@ WOLFSSL_LOCAL int IsAtLeastTLSv1_3(const ProtocolVersion pv);
 WOLFSSL_LOCAL void FreeHandshakeResources(WOLFSSL* ssl);
 WOLFSSL_LOCAL void ShrinkInputBuffer(WOLFSSL* ssl, int forcedFree);
 WOLFSSL_LOCAL void ShrinkOutputBuffer(WOLFSSL* ssl);
+#ifdef WOLFSSL_BUFFER_POOL
+WOLFSSL_LOCAL int  InitBufferPool(void);
+WOLFSSL_LOCAL void FreeBufferPool(void);
+#endif
+#ifdef WOLFSSL_KEY_SHARE_POOL
+WOLFSSL_LOCAL int  InitKeySharePool(void);
+WOLFSSL_LOCAL void FreeKeySharePool(void);
+WOLFSSL_LOCAL int  KeySharePoolGet(WOLFSSL* ssl, word16 group, void* key);
+WOLFSSL_LOCAL void KeySharePoolStats(word32* hits, word32* misses);
+#endif
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+WOLFSSL_LOCAL int  InitAntiReplay(WOLFSSL_CTX* ctx, void* heap);
+WOLFSSL_LOCAL void FreeAntiReplay(WOLFSSL_CTX* ctx);
+#endif
+#ifdef WOLFSSL_HANDSHAKE_ADMISSION
+WOLFSSL_LOCAL int  InitHsAdmission(WOLFSSL_CTX* ctx, void* heap);
+WOLFSSL_LOCAL void FreeHsAdmission(WOLFSSL_CTX* ctx);
+WOLFSSL_LOCAL int  HsAdmit(WOLFSSL* ssl, int resuming);
+WOLFSSL_LOCAL int  HsAdmitWait(WOLFSSL* ssl);
+WOLFSSL_LOCAL void HsAdmitDone(WOLFSSL* ssl, int done);
+#endif
+#if !defined(NO_CERTS) && defined(WOLFSSL_CERT_MSG_CACHE)
+WOLFSSL_LOCAL void FreeCertMsgCache(WOLFSSL_CTX* ctx);
+WOLFSSL_LOCAL const byte* GetCertMsgCache(WOLFSSL* ssl, int type,
+                                          word32* sz);
+#endif
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+WOLFSSL_LOCAL void HsTimeStart(WOLFSSL* ssl, int funcNum);
+WOLFSSL_LOCAL void HsTimeEnd(WOLFSSL* ssl, int funcNum);
+WOLFSSL_LOCAL void HsTimeDone(WOLFSSL* ssl);
+/* time a handshake message handler, also with WOLFSSL_FUNC_TIME */
+#define HS_TIME_START(ssl, n)   do { WOLFSSL_START(n); HsTimeStart(ssl, n); } \
+                                while (0)
+#define HS_TIME_END(ssl, n)     do { WOLFSSL_END(n); HsTimeEnd(ssl, n); } \
+                                while (0)
+#define HS_TIME_DONE(ssl)       HsTimeDone(ssl)
+#else
+#define HS_TIME_START(ssl, n)   WOLFSSL_START(n)
+#define HS_TIME_END(ssl, n)     WOLFSSL_END(n)
+#define HS_TIME_DONE(ssl)
+#endif
+#ifdef WOLFSSL_KTLS
+WOLFSSL_LOCAL void KTLS_Enable(WOLFSSL* ssl);
+WOLFSSL_LOCAL void KTLS_EnablePending(WOLFSSL* ssl);
+WOLFSSL_LOCAL int  KTLS_SetKeys(WOLFSSL* ssl, int side);
+WOLFSSL_LOCAL int  KTLS_BuildMessage(WOLFSSL* ssl, byte* output, int outSz,
+                                     const byte* input, int inSz, int type,
+                                     int hashOutput, int sizeOnly);
+#endif
 
 WOLFSSL_LOCAL int VerifyClientSuite(WOLFSSL* ssl);
 
@@ -4164,6 +4647,10 @@ WOLFSSL_LOCAL  int GrowInputBuffer(WOLFSSL* ssl, int size, int usedLength);
 #ifndef WOLFSSL_AEAD_ONLY
     WOLFSSL_LOCAL int  TLS_hmac(WOLFSSL* ssl, byte* digest, const byte* in,
                                 word32 sz, int padSz, int content, int verify);
+    #ifdef WOLFSSL_CBC_STITCH
+    WOLFSSL_LOCAL int  TLS_HmacStart(WOLFSSL* ssl, Hmac* hmac, word32 sz,
+                                     int content, int verify);
+    #endif
 #endif
 #endif
 
@@ -4197,6 +4684,14 @@ WOLFSSL_LOCAL  int GrowInputBuffer(WOLFSSL* ssl, int size, int usedLength);
     WOLFSSL_LOCAL int  VerifyForDtlsMsgPoolSend(WOLFSSL*, byte, word32);
     WOLFSSL_LOCAL void DtlsMsgPoolReset(WOLFSSL*);
     WOLFSSL_LOCAL int  DtlsMsgPoolSend(WOLFSSL*, int);
+    #ifdef WOLFSSL_DTLS_DEMUX
+    WOLFSSL_LOCAL int  DtlsCheckHelloCookie(WOLFSSL_CTX* ctx,
+                                const byte* secret, word32 secretSz,
+                                const byte* peer, word32 peerSz,
+                                const byte* input, word32 sz,
+                                byte* hvr, word32* hvrSz);
+    WOLFSSL_LOCAL void DtlsSetHelloVerifySent(WOLFSSL* ssl, const byte* input);
+    #endif
 #endif /* WOLFSSL_DTLS */
 
 #ifndef NO_TLS
@@ -233,6 +233,7 @@ typedef WOLFSSL_X509_STORE_CTX X509_STORE_CTX;
 #define SSL_CTX_set_verify              wolfSSL_CTX_set_verify
 #define SSL_set_verify                  wolfSSL_set_verify
 #define SSL_pending                     wolfSSL_pending
+#define SSL_has_pending                 wolfSSL_has_pending
 #define SSL_load_error_strings          wolfSSL_load_error_strings
 #define SSL_library_init                wolfSSL_library_init
 #define SSL_CTX_set_session_cache_mode  wolfSSL_CTX_set_session_cache_mode
@@ -867,6 +868,21 @@ typedef STACK_OF(WOLFSSL_ASN1_OBJECT) GENERAL_NAMES;
 
 
 #endif /* HAVE_STUNNEL || WOLFSSL_NGINX */
+
+#ifdef WOLFSSL_CLIENT_HELLO_CB
+#define SSL_CLIENT_HELLO_SUCCESS        WOLFSSL_CLIENT_HELLO_SUCCESS
+#define SSL_CLIENT_HELLO_ERROR          WOLFSSL_CLIENT_HELLO_ERROR
+#define SSL_CLIENT_HELLO_RETRY          WOLFSSL_CLIENT_HELLO_RETRY
+#define SSL_CTX_set_client_hello_cb     wolfSSL_CTX_set_client_hello_cb
+#define SSL_client_hello_get0_legacy_version \
+                                     wolfSSL_client_hello_get0_legacy_version
+#define SSL_client_hello_get0_random    wolfSSL_client_hello_get0_random
+#define SSL_client_hello_get0_session_id wolfSSL_client_hello_get0_session_id
+#define SSL_client_hello_get0_ciphers   wolfSSL_client_hello_get0_ciphers
+#define SSL_client_hello_get0_compression_methods \
+                               wolfSSL_client_hello_get0_compression_methods
+#define SSL_client_hello_get0_ext       wolfSSL_client_hello_get0_ext
+#endif /* WOLFSSL_CLIENT_HELLO_CB */
 #define SSL_CTX_get_default_passwd_cb   wolfSSL_CTX_get_default_passwd_cb
 #define SSL_CTX_get_default_passwd_cb_userdata wolfSSL_CTX_get_default_passwd_cb_userdata
 
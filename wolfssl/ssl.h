@@ -591,6 +591,9 @@ WOLFSSL_API int  wolfSSL_get_fd(const WOLFSSL*);
 /* please see note at top of README if you get an error from connect */
 WOLFSSL_API int  wolfSSL_connect(WOLFSSL*);
 WOLFSSL_API int  wolfSSL_write(WOLFSSL*, const void*, int);
+#ifdef WOLFSSL_SENDFILE
+WOLFSSL_API int  wolfSSL_sendfile(WOLFSSL*, int fd, long offset, int sz);
+#endif
 WOLFSSL_API int  wolfSSL_read(WOLFSSL*, void*, int);
 WOLFSSL_API int  wolfSSL_peek(WOLFSSL*, void*, int);
 WOLFSSL_API int  wolfSSL_accept(WOLFSSL*);
@@ -604,6 +607,8 @@ WOLFSSL_API int  wolfSSL_no_dhe_psk(WOLFSSL* ssl);
 WOLFSSL_API int  wolfSSL_update_keys(WOLFSSL* ssl);
 WOLFSSL_API int  wolfSSL_CTX_allow_post_handshake_auth(WOLFSSL_CTX* ctx);
 WOLFSSL_API int  wolfSSL_allow_post_handshake_auth(WOLFSSL* ssl);
+WOLFSSL_API int  wolfSSL_CTX_UseCertCompression(WOLFSSL_CTX* ctx);
+WOLFSSL_API int  wolfSSL_UseCertCompression(WOLFSSL* ssl);
 WOLFSSL_API int  wolfSSL_request_certificate(WOLFSSL* ssl);
 
 WOLFSSL_API int  wolfSSL_preferred_group(WOLFSSL* ssl);
@@ -620,6 +625,19 @@ WOLFSSL_API int  wolfSSL_CTX_set_max_early_data(WOLFSSL_CTX* ctx,
 WOLFSSL_API int  wolfSSL_set_max_early_data(WOLFSSL* ssl, unsigned int sz);
 WOLFSSL_API int  wolfSSL_write_early_data(WOLFSSL*, const void*, int, int*);
 WOLFSSL_API int  wolfSSL_read_early_data(WOLFSSL*, void*, int, int*);
+#ifdef WOLFSSL_EARLY_DATA_ANTI_REPLAY
+/* default and maximum early data anti-replay window in milliseconds */
+#ifndef WOLFSSL_ANTI_REPLAY_WINDOW_MS
+    #define WOLFSSL_ANTI_REPLAY_WINDOW_MS       10000
+#endif
+#ifndef WOLFSSL_ANTI_REPLAY_MAX_WINDOW_MS
+    #define WOLFSSL_ANTI_REPLAY_MAX_WINDOW_MS   60000
+#endif
+WOLFSSL_API int  wolfSSL_CTX_set_early_data_anti_replay(WOLFSSL_CTX* ctx,
+                                                        unsigned int windowMs);
+WOLFSSL_API int  wolfSSL_CTX_get_early_data_replays(WOLFSSL_CTX* ctx,
+                                                    unsigned int* replays);
+#endif
 #endif
 #endif
 WOLFSSL_API void wolfSSL_CTX_free(WOLFSSL_CTX*);
@@ -687,6 +705,104 @@ WOLFSSL_API void wolfSSL_set_verify(WOLFSSL*, int, VerifyCallback verify_callbac
 WOLFSSL_API void wolfSSL_SetCertCbCtx(WOLFSSL*, void*);
 
 WOLFSSL_API int  wolfSSL_pending(WOLFSSL*);
+WOLFSSL_API int  wolfSSL_has_pending(const WOLFSSL*);
+#ifdef WOLFSSL_READ_AHEAD
+/* default read ahead size, room for a full size record with overhead */
+#ifndef WOLFSSL_READ_AHEAD_SZ
+    #define WOLFSSL_READ_AHEAD_SZ       (18 * 1024)
+#endif
+/* largest read ahead size that may be set */
+#ifndef WOLFSSL_MAX_READ_AHEAD_SZ
+    #define WOLFSSL_MAX_READ_AHEAD_SZ   (64 * 1024)
+#endif
+WOLFSSL_API int  wolfSSL_CTX_set_read_ahead_size(WOLFSSL_CTX*, unsigned int);
+WOLFSSL_API int  wolfSSL_set_read_ahead_size(WOLFSSL*, unsigned int);
+WOLFSSL_API int  wolfSSL_CTX_set_read_batch(WOLFSSL_CTX*, int);
+WOLFSSL_API int  wolfSSL_set_read_batch(WOLFSSL*, int);
+#endif
+WOLFSSL_API int  wolfSSL_CTX_set_release_buffers(WOLFSSL_CTX*, int);
+WOLFSSL_API int  wolfSSL_set_release_buffers(WOLFSSL*, int);
+#ifdef WOLFSSL_KTLS
+/* record directions handled by the kernel, see wolfSSL_GetKTLS() */
+enum {
+    WOLFSSL_KTLS_TX = 0x01,
+    WOLFSSL_KTLS_RX = 0x02
+};
+WOLFSSL_API int  wolfSSL_CTX_UseKTLS(WOLFSSL_CTX*);
+WOLFSSL_API int  wolfSSL_UseKTLS(WOLFSSL*);
+WOLFSSL_API int  wolfSSL_GetKTLS(WOLFSSL*);
+#endif
+#ifdef WOLFSSL_DYNAMIC_RECORD_SIZE
+/* default plaintext size of records at the start of a burst, fits a segment */
+#ifndef WOLFSSL_DYN_RECORD_SMALL_SZ
+    #define WOLFSSL_DYN_RECORD_SMALL_SZ     1400
+#endif
+/* default bytes sent in small records before using full size records */
+#ifndef WOLFSSL_DYN_RECORD_THRESHOLD
+    #define WOLFSSL_DYN_RECORD_THRESHOLD    (1024 * 1024)
+#endif
+/* default seconds without sending after which small records are used again */
+#ifndef WOLFSSL_DYN_RECORD_IDLE_SEC
+    #define WOLFSSL_DYN_RECORD_IDLE_SEC     1
+#endif
+WOLFSSL_API int  wolfSSL_CTX_set_dynamic_record_size(WOLFSSL_CTX*,
+                            unsigned int smallSz, unsigned int threshold,
+                            unsigned int idleSec);
+WOLFSSL_API int  wolfSSL_set_dynamic_record_size(WOLFSSL*,
+                            unsigned int smallSz, unsigned int threshold,
+                            unsigned int idleSec);
+#endif
+#ifdef WOLFSSL_LAZY_HANDSHAKE_HASH
+WOLFSSL_API int  wolfSSL_CTX_set_lazy_handshake_hash(WOLFSSL_CTX*, int);
+WOLFSSL_API int  wolfSSL_set_lazy_handshake_hash(WOLFSSL*, int);
+#endif
+#ifdef WOLFSSL_HANDSHAKE_TIMING
+/* Timed handshake phases: the message handlers (enum wc_FuncNum in
+ * logging.h), then the I/O callbacks and the whole handshake */
+enum {
+    WOLFSSL_HS_TIME_IO_READ = WC_FUNC_COUNT,
+    WOLFSSL_HS_TIME_IO_WRITE,
+    WOLFSSL_HS_TIME_TOTAL,
+    WOLFSSL_HS_TIME_COUNT
+};
+/* number of histogram buckets, bucket n > 0 counts [2^(n-1), 2^n) usec */
+#ifndef WOLFSSL_HS_HIST_BUCKETS
+    #define WOLFSSL_HS_HIST_BUCKETS     24
+#endif
+typedef struct WOLFSSL_HS_TIMING {
+    unsigned int usec[WOLFSSL_HS_TIME_COUNT];   /* time spent, microseconds */
+    unsigned int calls[WOLFSSL_HS_TIME_COUNT];  /* number of timed calls */
+} WOLFSSL_HS_TIMING;
+typedef struct WOLFSSL_HS_HISTOGRAM {
+    unsigned int count;                         /* handshakes added */
+    unsigned int bucket[WOLFSSL_HS_TIME_COUNT][WOLFSSL_HS_HIST_BUCKETS];
+} WOLFSSL_HS_HISTOGRAM;
+WOLFSSL_API int  wolfSSL_get_handshake_timing(WOLFSSL*, WOLFSSL_HS_TIMING*);
+WOLFSSL_API const char* wolfSSL_handshake_timing_name(int phase);
+WOLFSSL_API int  wolfSSL_handshake_histogram_add(WOLFSSL_HS_HISTOGRAM*,
+                                                 const WOLFSSL_HS_TIMING*);
+#endif
+#ifdef WOLFSSL_KEY_SHARE_POOL
+WOLFSSL_API int  wolfSSL_key_share_pool_stats(unsigned int* hits,
+                                              unsigned int* misses);
+#endif
+#if defined(WOLFSSL_HANDSHAKE_ADMISSION) && !defined(NO_WOLFSSL_SERVER)
+/* what the full handshake admission control of a server CTX has done */
+typedef struct WOLFSSL_ADMISSION_STATS {
+    unsigned int fullAdmitted;  /* full handshakes started */
+    unsigned int resumed;       /* resumptions, never held back */
+    unsigned int rejected;      /* full handshakes refused with an alert */
+    unsigned int deferred;      /* full handshakes held back to retry */
+    unsigned int completed;     /* full handshakes finished */
+    unsigned int inFlight;      /* full handshakes running now */
+    unsigned int latencyUs;     /* average full handshake time, usec */
+} WOLFSSL_ADMISSION_STATS;
+WOLFSSL_API int  wolfSSL_CTX_set_handshake_admission(WOLFSSL_CTX*,
+                            unsigned int maxInFlight,
+                            unsigned int maxLatencyUs, int defer);
+WOLFSSL_API int  wolfSSL_CTX_get_handshake_admission_stats(WOLFSSL_CTX*,
+                            WOLFSSL_ADMISSION_STATS*);
+#endif
 
 WOLFSSL_API void wolfSSL_load_error_strings(void);
 WOLFSSL_API int  wolfSSL_library_init(void);
@@ -739,6 +855,17 @@ WOLFSSL_API int  wolfSSL_dtls_set_mtu(WOLFSSL*, unsigned short);
 
 WOLFSSL_API int  wolfSSL_dtls_get_drop_stats(WOLFSSL*,
                                              unsigned int*, unsigned int*);
+#if defined(WOLFSSL_DTLS_DEMUX) && !defined(NO_WOLFSSL_SERVER)
+typedef struct WOLFSSL_DTLS_DEMUXER WOLFSSL_DTLS_DEMUXER;
+
+WOLFSSL_API WOLFSSL_DTLS_DEMUXER* wolfSSL_DtlsDemuxNew(WOLFSSL_CTX*, int sd,
+                                                       unsigned int maxPeers);
+WOLFSSL_API void wolfSSL_DtlsDemuxFree(WOLFSSL_DTLS_DEMUXER*);
+WOLFSSL_API int  wolfSSL_DtlsDemuxRead(WOLFSSL_DTLS_DEMUXER*, WOLFSSL** ssl,
+                                       void* data, int sz);
+WOLFSSL_API int  wolfSSL_DtlsDemuxRemove(WOLFSSL_DTLS_DEMUXER*, WOLFSSL*);
+WOLFSSL_API unsigned int wolfSSL_DtlsDemuxCount(WOLFSSL_DTLS_DEMUXER*);
+#endif
 WOLFSSL_API int  wolfSSL_CTX_mcast_set_member_id(WOLFSSL_CTX*, unsigned short);
 WOLFSSL_API int  wolfSSL_set_secret(WOLFSSL*, unsigned short,
                      const unsigned char*, unsigned int,
@@ -1212,6 +1339,7 @@ enum {
 	SSL_CB_MODE_WRITE = 2,
 
     SSL_MODE_ENABLE_PARTIAL_WRITE = 2,
+    SSL_MODE_RELEASE_BUFFERS = 16,
 
     BIO_FLAGS_BASE64_NO_NL = 1,
     BIO_CLOSE   = 1,
@@ -1828,6 +1956,7 @@ WOLFSSL_API int wolfSSL_SetMinVersion(WOLFSSL* ssl, int version);
 WOLFSSL_API int wolfSSL_GetObjectSize(void);  /* object size based on build */
 WOLFSSL_API int wolfSSL_CTX_GetObjectSize(void);
 WOLFSSL_API int wolfSSL_METHOD_GetObjectSize(void);
+WOLFSSL_API int wolfSSL_GetMemoryUsage(WOLFSSL*);
 WOLFSSL_API int wolfSSL_GetOutputSize(WOLFSSL*, int);
 WOLFSSL_API int wolfSSL_GetMaxOutputSize(WOLFSSL*);
 WOLFSSL_API int wolfSSL_GetVersion(WOLFSSL* ssl);
@@ -2247,6 +2376,12 @@ WOLFSSL_API int wolfSSL_SNI_GetFromBuffer(
                  const unsigned char* clientHello, unsigned int helloSz,
                  unsigned char type, unsigned char* sni, unsigned int* inOutSz);
 
+#if defined(WOLFSSL_SNI_STORE) && !defined(NO_CERTS)
+WOLFSSL_API int wolfSSL_CTX_SNI_AddCertificate(WOLFSSL_CTX* ctx,
+                 const char* name, const unsigned char* chain, long chainSz,
+                 const unsigned char* key, long keySz, int format);
+#endif
+
 #endif /* NO_WOLFSSL_SERVER */
 
 /* SNI status */
@@ -2264,6 +2399,43 @@ WOLFSSL_API unsigned short wolfSSL_SNI_GetRequest(WOLFSSL *ssl,
 
 #endif /* HAVE_SNI */
 
+/* ClientHello callback */
+#if defined(WOLFSSL_CLIENT_HELLO_CB) && !defined(NO_WOLFSSL_SERVER)
+
+/* ClientHello callback return values */
+enum {
+    WOLFSSL_CLIENT_HELLO_RETRY   = -1, /* call again, accept returns
+                                          CLIENT_HELLO_WANT_CB */
+    WOLFSSL_CLIENT_HELLO_ERROR   =  0, /* abort with the alert set */
+    WOLFSSL_CLIENT_HELLO_SUCCESS =  1  /* carry on with the handshake */
+};
+
+typedef int (*CallbackClientHello)(WOLFSSL* ssl, int* alert, void* arg);
+
+WOLFSSL_API void wolfSSL_CTX_set_client_hello_cb(WOLFSSL_CTX* ctx,
+                                         CallbackClientHello cb, void* arg);
+WOLFSSL_API unsigned int wolfSSL_client_hello_get0_legacy_version(
+                                                                WOLFSSL* ssl);
+WOLFSSL_API size_t wolfSSL_client_hello_get0_random(WOLFSSL* ssl,
+                                                   const unsigned char** out);
+WOLFSSL_API size_t wolfSSL_client_hello_get0_session_id(WOLFSSL* ssl,
+                                                   const unsigned char** out);
+WOLFSSL_API size_t wolfSSL_client_hello_get0_ciphers(WOLFSSL* ssl,
+                                                   const unsigned char** out);
+WOLFSSL_API size_t wolfSSL_client_hello_get0_compression_methods(
+                                   WOLFSSL* ssl, const unsigned char** out);
+WOLFSSL_API int wolfSSL_client_hello_get0_ext(WOLFSSL* ssl, unsigned int type,
+                               const unsigned char** out, size_t* outSz);
+
+#endif /* WOLFSSL_CLIENT_HELLO_CB && !NO_WOLFSSL_SERVER */
+
+#if defined(OPENSSL_ALL) || defined(HAVE_STUNNEL) || defined(WOLFSSL_NGINX) || \
+    defined(WOLFSSL_HAPROXY) || defined(OPENSSL_EXTRA) || \
+    defined(HAVE_LIGHTY) || (defined(WOLFSSL_CLIENT_HELLO_CB) && \
+                                                !defined(NO_WOLFSSL_SERVER))
+WOLFSSL_API WOLFSSL_CTX* wolfSSL_set_SSL_CTX(WOLFSSL*,WOLFSSL_CTX*);
+#endif
+
 /* Trusted CA Key Indication - RFC 6066 (Section 6) */
 #ifdef HAVE_TRUSTED_CA
 
@@ -2336,6 +2508,22 @@ WOLFSSL_API int wolfSSL_CTX_UseMaxFragment(WOLFSSL_CTX* ctx, unsigned char mfl);
 #endif
 #endif /* HAVE_MAX_FRAGMENT */
 
+/* Record Size Limit */
+#ifdef HAVE_RECORD_SIZE_LIMIT
+
+/* Limits on the advertised plaintext size */
+enum {
+    WOLFSSL_RECORD_SIZE_LIMIT_MIN = 64,
+    WOLFSSL_RECORD_SIZE_LIMIT_MAX = 16384,
+};
+
+WOLFSSL_API int wolfSSL_UseRecordSizeLimit(WOLFSSL* ssl, unsigned short limit);
+WOLFSSL_API int wolfSSL_CTX_UseRecordSizeLimit(WOLFSSL_CTX* ctx,
+                                               unsigned short limit);
+WOLFSSL_API int wolfSSL_GetPeerRecordSizeLimit(WOLFSSL* ssl);
+
+#endif /* HAVE_RECORD_SIZE_LIMIT */
+
 /* Truncated HMAC */
 #ifdef HAVE_TRUNCATED_HMAC
 #ifndef NO_WOLFSSL_CLIENT
@@ -2457,6 +2645,10 @@ WOLFSSL_API int wolfSSL_CTX_UseSupportedCurve(WOLFSSL_CTX* ctx,
 #ifdef WOLFSSL_TLS13
 WOLFSSL_API int wolfSSL_UseKeyShare(WOLFSSL* ssl, word16 group);
 WOLFSSL_API int wolfSSL_NoKeyShares(WOLFSSL* ssl);
+#ifdef WOLFSSL_TLS13_GROUP_CACHE
+WOLFSSL_API int wolfSSL_CTX_get_hrr_stats(WOLFSSL_CTX* ctx,
+                                unsigned int* hrrCount, unsigned int* cacheHits);
+#endif
 #endif
 
 
@@ -2873,7 +3065,6 @@ WOLFSSL_API int wolfSSL_set_tlsext_host_name(WOLFSSL *, const char *);
 
 WOLFSSL_API const char* wolfSSL_get_servername(WOLFSSL *, unsigned char);
 
-WOLFSSL_API WOLFSSL_CTX* wolfSSL_set_SSL_CTX(WOLFSSL*,WOLFSSL_CTX*);
 
 WOLFSSL_API VerifyCallback wolfSSL_CTX_get_verify_callback(WOLFSSL_CTX*);
 
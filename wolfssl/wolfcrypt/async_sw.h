@@ -0,0 +1,159 @@
+/* async_sw.h
+ *
+ * Copyright (C) 2006-2019 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Software asynchronous crypto device.
+ *
+ * Public key operations (RSA, ECC key generation, ECDH, ECDSA sign and
+ * verify) submitted through the crypto callback layer are queued to a pool of
+ * worker threads and return WC_PENDING_E. Completion is reported through the
+ * wolf event queue (wolfSSL_CTX_AsyncPoll / wolfSSL_AsyncPoll), so a single
+ * event loop thread can keep many handshakes in flight while the public key
+ * math runs on all cores.
+ *
+ * The software device provides the async API on its own. It is used in place
+ * of async.h and async.c from the separate wolfSSL async package, which are
+ * needed for hardware devices (Intel QuickAssist, Cavium Nitrox) and the
+ * async simulator.
+ */
+
+#ifndef WOLF_CRYPT_ASYNC_SW_H
+#define WOLF_CRYPT_ASYNC_SW_H
+
+#include <wolfssl/wolfcrypt/types.h>
+
+#if defined(WOLFSSL_ASYNC_CRYPT) && defined(WOLFSSL_ASYNC_CRYPT_SW)
+
+#ifndef WOLF_CRYPTO_CB
+    #error The software async device requires WOLF_CRYPTO_CB
+#endif
+#if defined(SINGLE_THREADED) || defined(WC_NO_ASYNC_THREADING)
+    #error The software async device requires threading
+#endif
+
+#include <wolfssl/wolfcrypt/wolfevent.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+/* Markers for the wolfCrypt objects that carry a WC_ASYNC_DEV */
+#define WOLFSSL_ASYNC_MARKER_ARC4       0xBEEF0001
+#define WOLFSSL_ASYNC_MARKER_AES        0xBEEF0002
+#define WOLFSSL_ASYNC_MARKER_3DES       0xBEEF0003
+#define WOLFSSL_ASYNC_MARKER_RNG        0xBEEF0004
+#define WOLFSSL_ASYNC_MARKER_HMAC       0xBEEF0005
+#define WOLFSSL_ASYNC_MARKER_RSA        0xBEEF0006
+#define WOLFSSL_ASYNC_MARKER_ECC        0xBEEF0007
+#define WOLFSSL_ASYNC_MARKER_SHA512     0xBEEF0008
+#define WOLFSSL_ASYNC_MARKER_SHA        0xBEEF0009
+#define WOLFSSL_ASYNC_MARKER_SHA256     0xBEEF000A
+#define WOLFSSL_ASYNC_MARKER_DH         0xBEEF000B
+#define WOLFSSL_ASYNC_MARKER_MD5        0xBEEF000C
+#define WOLFSSL_ASYNC_MARKER_SHA224     0xBEEF000D
+#define WOLFSSL_ASYNC_MARKER_SHA384     0xBEEF000E
+#define WOLFSSL_ASYNC_MARKER_SHA3       0xBEEF000F
+
+enum WC_ASYNC_FLAGS {
+    WC_ASYNC_FLAG_NONE =        0x00000000,
+
+    /* Flag to indicate the function needs called again once the event is
+     * done. The result is handed back by that call. */
+    WC_ASYNC_FLAG_CALL_AGAIN =  0x00000001,
+};
+
+/* Device id the software device registers with the crypto callbacks */
+#ifndef WC_ASYNC_SW_DEVID
+    #define WC_ASYNC_SW_DEVID   0x41535744
+#endif
+
+/* Number of worker threads, 0 uses one per online CPU */
+#ifndef WC_ASYNC_SW_THREADS
+    #define WC_ASYNC_SW_THREADS 0
+#endif
+
+/* Maximum number of worker threads */
+#ifndef WC_ASYNC_SW_MAX_THREADS
+    #define WC_ASYNC_SW_MAX_THREADS 64
+#endif
+
+/* Number of operations a caller keeps in flight, used by the benchmark */
+#ifndef WOLF_ASYNC_MAX_PENDING
+    #define WOLF_ASYNC_MAX_PENDING  8
+#endif
+
+struct WC_ASYNC_SW_JOB;
+
+/* Asynchronous device context, embedded in each wolfCrypt object */
+typedef struct WC_ASYNC_DEV {
+    word32                  marker;  /* WOLFSSL_ASYNC_MARKER_* */
+    void*                   heap;
+    WOLF_EVENT              event;   /* event used by the TLS layer */
+    struct WC_ASYNC_SW_JOB* job;     /* operation owned by the worker pool */
+} WC_ASYNC_DEV;
+
+typedef void* (*AsyncThreadFunc_t)(void*);
+
+
+/* Device */
+WOLFSSL_API int  wolfAsync_HardwareStart(void);
+WOLFSSL_API void wolfAsync_HardwareStop(void);
+WOLFSSL_API int  wolfAsync_DevOpen(int* devId);
+WOLFSSL_API int  wolfAsync_DevOpenThread(int* devId, void* threadId);
+WOLFSSL_API void wolfAsync_DevClose(int* devId);
+WOLFSSL_API int  wolfAsync_SetThreadCount(int count);
+
+/* Device context */
+WOLFSSL_API int  wolfAsync_DevCtxInit(WC_ASYNC_DEV* asyncDev, word32 marker,
+    void* heap, int devId);
+WOLFSSL_API void wolfAsync_DevCtxFree(WC_ASYNC_DEV* asyncDev, word32 marker);
+WOLFSSL_API int  wolfAsync_DevCopy(WC_ASYNC_DEV* src, WC_ASYNC_DEV* dst);
+
+/* Events */
+WOLFSSL_API int  wolfAsync_EventInit(WOLF_EVENT* event, WOLF_EVENT_TYPE type,
+    void* context, word32 flags);
+WOLFSSL_API int  wolfAsync_EventPoll(WOLF_EVENT* event, WOLF_EVENT_FLAG flags);
+WOLFSSL_API int  wolfAsync_EventPop(WOLF_EVENT* event, WOLF_EVENT_TYPE type);
+WOLFSSL_API int  wolfAsync_EventQueuePush(WOLF_EVENT_QUEUE* queue,
+    WOLF_EVENT* event);
+WOLFSSL_API int  wolfAsync_EventQueuePoll(WOLF_EVENT_QUEUE* queue,
+    void* context_filter, WOLF_EVENT** events, int maxEvents,
+    WOLF_EVENT_FLAG flags, int* eventCount);
+
+/* Helpers for wolfCrypt callers */
+WOLFSSL_API int  wc_AsyncHandle(WC_ASYNC_DEV* asyncDev,
+    WOLF_EVENT_QUEUE* queue, word32 flags);
+WOLFSSL_API int  wc_AsyncWait(int ret, WC_ASYNC_DEV* asyncDev, word32 flags);
+
+/* Threading */
+WOLFSSL_API int  wc_AsyncGetNumberOfCpus(void);
+WOLFSSL_API int  wc_AsyncThreadCreate(pthread_t* thread,
+    AsyncThreadFunc_t func, void* arg);
+WOLFSSL_API int  wc_AsyncThreadJoin(pthread_t* thread);
+WOLFSSL_API void wc_AsyncThreadYield(void);
+
+#ifdef __cplusplus
+    }   /* extern "C" */
+#endif
+
+#endif /* WOLFSSL_ASYNC_CRYPT && WOLFSSL_ASYNC_CRYPT_SW */
+
+#endif /* WOLF_CRYPT_ASYNC_SW_H */
@@ -52,7 +52,11 @@
     (defined(HAVE_FIPS_VERSION) && (HAVE_FIPS_VERSION >= 2))
 
 #ifdef WOLFSSL_ASYNC_CRYPT
-    #include <wolfssl/wolfcrypt/async.h>
+    #ifdef WOLFSSL_ASYNC_CRYPT_SW
+        #include <wolfssl/wolfcrypt/async_sw.h>
+    #else
+        #include <wolfssl/wolfcrypt/async.h>
+    #endif
 #endif
 
 #ifndef NO_OLD_WC_NAMES
@@ -182,6 +186,32 @@ WOLFSSL_API int wolfSSL_GetHmacMaxSize(void);
 
 WOLFSSL_LOCAL int _InitHmac(Hmac* hmac, int type, void* heap);
 
+/* Keep hash states with the key pads hashed when computing many HMACs with the
+ * same key, enabled with WOLFSSL_HMAC_PADS. States are copied with the Copy
+ * function of the hash. */
+#if defined(WOLFSSL_HMAC_PADS) && (defined(HAVE_FIPS) || \
+    defined(HAVE_SELFTEST) || defined(WOLFSSL_ASYNC_CRYPT))
+    #undef WOLFSSL_HMAC_PADS
+#endif
+
+#ifdef WOLFSSL_HMAC_PADS
+typedef struct HmacPads {
+    wc_HashAlg inner;     /* hash state after the inner pad */
+    wc_HashAlg outer;     /* hash state after the outer pad */
+    int        type;      /* hash algorithm */
+    int        digestSz;  /* size of HMAC output */
+} HmacPads;
+
+WOLFSSL_LOCAL int  wc_HmacPadsSetKey(HmacPads* pads, int type, const byte* key,
+                                     word32 keySz);
+WOLFSSL_LOCAL int  wc_HmacPadsStart(const HmacPads* pads, wc_HashAlg* hash);
+WOLFSSL_LOCAL int  wc_HmacPadsUpdate(const HmacPads* pads, wc_HashAlg* hash,
+                                     const byte* data, word32 sz);
+WOLFSSL_LOCAL int  wc_HmacPadsFinal(const HmacPads* pads, wc_HashAlg* hash,
+                                    byte* out);
+WOLFSSL_LOCAL void wc_HmacPadsFree(HmacPads* pads);
+#endif
+
 #ifdef HAVE_HKDF
 
 WOLFSSL_API int wc_HKDF_Extract(int type, const byte* salt, word32 saltSz,
@@ -189,6 +219,10 @@ WOLFSSL_API int wc_HKDF_Extract(int type, const byte* salt, word32 saltSz,
 WOLFSSL_API int wc_HKDF_Expand(int type, const byte* inKey, word32 inKeySz,
                                const byte* info, word32 infoSz,
                                byte* out,        word32 outSz);
+#ifdef WOLFSSL_HMAC_PADS
+WOLFSSL_LOCAL int wc_HKDF_ExpandPads(const HmacPads* pads, const byte* info,
+                                     word32 infoSz, byte* out, word32 outSz);
+#endif
 
 WOLFSSL_API int wc_HKDF(int type, const byte* inKey, word32 inKeySz,
                     const byte* salt, word32 saltSz,
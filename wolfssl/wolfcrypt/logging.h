@@ -45,10 +45,12 @@ enum wc_LogLevels {
     OTHER_LOG
 };
 
-#ifdef WOLFSSL_FUNC_TIME
+#if defined(WOLFSSL_FUNC_TIME) || defined(WOLFSSL_HANDSHAKE_TIMING)
 /* WARNING: This code is only to be used for debugging performance.
  *          The code is not thread-safe.
  *          Do not use WOLFSSL_FUNC_TIME in production code.
+ * WOLFSSL_HANDSHAKE_TIMING times the same handshake message handlers per
+ * connection and may be used in production code.
  */
 enum wc_FuncNum {
     WC_FUNC_HELLO_REQUEST_SEND = 0,
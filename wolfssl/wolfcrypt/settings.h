@@ -1769,14 +1769,14 @@ extern void uITRON4_free(void *p) ;
     #undef HAVE_WOLF_EVENT
     #define HAVE_WOLF_EVENT
 
-    #ifdef WOLFSSL_ASYNC_CRYPT_TEST
+    #if defined(WOLFSSL_ASYNC_CRYPT_TEST) || defined(WOLFSSL_ASYNC_CRYPT_SW)
         #define WC_ASYNC_DEV_SIZE 168
     #else
         #define WC_ASYNC_DEV_SIZE 336
     #endif
 
     #if !defined(HAVE_CAVIUM) && !defined(HAVE_INTEL_QA) && \
-        !defined(WOLFSSL_ASYNC_CRYPT_TEST)
+        !defined(WOLFSSL_ASYNC_CRYPT_TEST) && !defined(WOLFSSL_ASYNC_CRYPT_SW)
         #error No async hardware defined with WOLFSSL_ASYNC_CRYPT!
     #endif
 
@@ -47,6 +47,10 @@
     #endif
 #endif
 
+#if defined(WOLFSSL_KTLS) && !defined(USE_WOLFSSL_IO)
+    #error Kernel TLS offload requires the default socket I/O callbacks
+#endif
+
 
 #if defined(USE_WOLFSSL_IO) || defined(HAVE_HTTP_CLIENT)
 
@@ -356,6 +360,22 @@ WOLFSSL_API int BioReceive(WOLFSSL* ssl, char* buf, int sz, void* ctx);
     WOLFSSL_API int EmbedReceive(WOLFSSL* ssl, char* buf, int sz, void* ctx);
     WOLFSSL_API int EmbedSend(WOLFSSL* ssl, char* buf, int sz, void* ctx);
 
+    #ifdef WOLFSSL_KTLS
+        WOLFSSL_LOCAL int wolfIO_KtlsInit(SOCKET_T sd);
+        WOLFSSL_LOCAL int wolfIO_KtlsSetKey(SOCKET_T sd, int rx, int tls13,
+                                int cipher, const unsigned char* key, int keySz,
+                                const unsigned char* iv,
+                                const unsigned char* seq);
+        WOLFSSL_LOCAL int EmbedKtlsReceive(WOLFSSL* ssl, char* buf, int sz,
+                                           unsigned char* type);
+        WOLFSSL_LOCAL int EmbedKtlsSend(WOLFSSL* ssl, char* buf, int sz,
+                                        unsigned char type);
+        #ifdef WOLFSSL_SENDFILE
+        WOLFSSL_LOCAL int EmbedKtlsSendFile(WOLFSSL* ssl, int fd, long offset,
+                                            int sz);
+        #endif
+    #endif /* WOLFSSL_KTLS */
+
     #ifdef WOLFSSL_DTLS
         WOLFSSL_API int EmbedReceiveFrom(WOLFSSL* ssl, char* buf, int sz, void*);
         WOLFSSL_API int EmbedSendTo(WOLFSSL* ssl, char* buf, int sz, void* ctx);